@@ -0,0 +1,135 @@
+#pragma once
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <atomic>
+#include <memory>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Admission control for the web server. The server closes each connection
+// once its response is sent, so a request that has been admitted and not
+// yet disconnected holds one connection, its request buffers and its
+// response. At most HTTP_MAX_CONNECTIONS are served at once; beyond that a
+// request is answered with a short 503 and Retry-After at once, instead of
+// every client slowing down while the heap runs out.
+//
+//   server.on("/metrics", HTTP_GET, admission.guard(metrics.instrument("/metrics", handleMetrics)));
+//
+// SampleBody holds the response of a route that only changes once per
+// sample. The sensor task formats it once with publish(); every request in
+// that sample period is answered from the same immutable body, held by
+// reference until its response is sent, so a burst of polls costs neither a
+// String per request nor any formatting on the TCP task.
+
+#define HTTP_MAX_CONNECTIONS 4
+#define HTTP_RETRY_AFTER_S 1
+
+class Admission {
+private:
+    int limit;
+    std::atomic<int> active{0};
+    std::atomic<int> peak{0};
+
+    void reject(AsyncWebServerRequest* request) {
+        rejected.fetch_add(1, std::memory_order_relaxed);
+        AsyncWebServerResponse* response = request->beginResponse(503, "text/plain", "busy");
+        response->addHeader("Retry-After", String(HTTP_RETRY_AFTER_S));
+        request->send(response);
+    }
+
+public:
+    std::atomic<uint32_t> admitted{0};
+    std::atomic<uint32_t> rejected{0};
+    std::atomic<uint32_t> bodiesPublished{0};  // SampleBody::publish(): one serialisation each
+    std::atomic<uint32_t> bodiesShared{0};     // Responses sent from a published body
+
+    explicit Admission(int limit = HTTP_MAX_CONNECTIONS) : limit(limit) {}
+
+    // Takes a connection slot; false if all are in use
+    bool enter() {
+        int n = active.fetch_add(1) + 1;
+        if (n > limit) {
+            active.fetch_sub(1);
+            return false;
+        }
+        int p = peak.load(std::memory_order_relaxed);
+        while (n > p && !peak.compare_exchange_weak(p, n, std::memory_order_relaxed)) {
+        }
+        admitted.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void leave() { active.fetch_sub(1); }
+
+    // Wraps a route handler; the slot is given back when the client disconnects
+    ArRequestHandlerFunction guard(ArRequestHandlerFunction fn) {
+        return [this, fn](AsyncWebServerRequest* request) {
+            if (!enter()) {
+                reject(request);
+                return;
+            }
+            request->onDisconnect([this] { leave(); });
+            fn(request);
+        };
+    }
+
+    int inFlight() const { return active.load(); }
+    int peakInFlight() const { return peak.load(); }
+    int capacity() const { return limit; }
+};
+
+Admission admission;
+
+class SampleBody {
+private:
+    struct Snapshot {
+        int code;
+        String text;
+        Snapshot(int code, const String& text) : code(code), text(text) {}
+    };
+
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    std::shared_ptr<const Snapshot> latest;  // Swapped by the sensor task, copied by the TCP task
+    const char* type;
+    const char* missing;  // Answered with 500 until the first publish()
+
+public:
+    SampleBody(const char* type, const char* missing) : type(type), missing(missing) {}
+
+    // Replaces the body; requests still sending the old one keep it alive
+    void publish(int code, const String& text) {
+        std::shared_ptr<const Snapshot> next = std::make_shared<const Snapshot>(code, text);
+        taskENTER_CRITICAL(&lock);
+        latest.swap(next);
+        taskEXIT_CRITICAL(&lock);
+        admission.bodiesPublished.fetch_add(1, std::memory_order_relaxed);
+    }  // The old body is freed here, outside the critical section, unless a response holds it
+
+    void serve(AsyncWebServerRequest* request) {
+        taskENTER_CRITICAL(&lock);
+        std::shared_ptr<const Snapshot> s = latest;
+        taskEXIT_CRITICAL(&lock);
+        if (!s) {
+            request->send(500, type, missing);
+            return;
+        }
+        AsyncWebServerResponse* response = request->beginResponse(
+            type, s->text.length(), [s](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+                size_t n = s->text.length() - index;
+                n = n < maxLen ? n : maxLen;
+                memcpy(buffer, s->text.c_str() + index, n);
+                return n;
+            });
+        response->setCode(s->code);
+        request->send(response);
+        admission.bodiesShared.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Number of owners of the current body: 1 plus the responses sending it
+    long users() {
+        taskENTER_CRITICAL(&lock);
+        long n = latest.use_count();
+        taskEXIT_CRITICAL(&lock);
+        return n;
+    }
+};
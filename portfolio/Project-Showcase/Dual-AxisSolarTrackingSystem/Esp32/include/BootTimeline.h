@@ -0,0 +1,65 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include <BinLog.h>
+
+// Boot-phase timestamps in micros() since reset. Each phase is stamped the
+// first time it is reached, from whichever task gets there (Wi-Fi phases are
+// stamped from the Wi-Fi event task), and report() logs new stamps as
+//
+//   boot <phase> <ms> ms
+//
+// "serving" is never marked directly: the web server answers only once it
+// listens *and* the station has an address, so it is stamped when the later
+// of the two arrives.
+enum BootPhase {
+    BOOT_SETUP,        // setup() entered
+    BOOT_UART,         // RP link to the Linux controller open
+    BOOT_FIRST_SAMPLE, // First light sample sent to the controller
+    BOOT_HTTP_LISTEN,  // server.begin() returned
+    BOOT_WIFI_UP,      // Station got an IP address
+    BOOT_SERVING,      // Later of HTTP_LISTEN and WIFI_UP
+    BOOT_PHASES
+};
+
+class BootTimeline {
+private:
+    std::atomic<uint32_t> stamp[BOOT_PHASES] = {};
+    uint32_t printed = 0; // Bit per phase already reported
+
+    bool stampOnce(BootPhase phase, uint32_t us) {
+        uint32_t unset = 0;
+        return stamp[phase].compare_exchange_strong(unset, us ? us : 1); // 0 means "not yet"
+    }
+
+public:
+    static const char* name(BootPhase phase) {
+        static const char* const names[BOOT_PHASES] = {
+            "setup", "uart", "first_sample", "http_listen", "wifi_up", "serving",
+        };
+        return names[phase];
+    }
+
+    void mark(BootPhase phase) {
+        uint32_t us = micros();
+        if (stampOnce(phase, us) && at(BOOT_HTTP_LISTEN) && at(BOOT_WIFI_UP)) {
+            stampOnce(BOOT_SERVING, us);
+        }
+    }
+
+    // Microseconds since reset at which `phase` was reached, 0 if not yet
+    uint32_t at(BootPhase phase) const { return stamp[phase].load(); }
+
+    // Log the phases stamped since the last call; only the loop task calls this
+    void report() {
+        for (int p = 0; p < BOOT_PHASES; p++) {
+            uint32_t us = at((BootPhase)p);
+            if (us && !(printed & (1u << p))) {
+                printed |= 1u << p;
+                LOG_INFO("boot %s %lu ms", name((BootPhase)p), (unsigned long)(us / 1000));
+            }
+        }
+    }
+};
+
+BootTimeline bootTimeline;
@@ -23,6 +23,9 @@ public:
         tft.fillScreen(TFT_BLACK);
     }
 
+    // For widgets that draw themselves, such as StripChart
+    TFT_eSPI& screen() { return tft; }
+
  // Show a message on the display
 void showMessage(const char* message, int x, int y, bool clear = true) {
 
@@ -238,9 +238,11 @@ setInterval(function () {
                 },
                 body: requestData 
             })
-            .then(response => response.text())
-            .then(data => {
-                document.getElementById("setpointMessage").textContent = "Setpoint successfully sent to server: " + data;
+            .then(response => response.text().then(data => ({ ok: response.ok, data: data })))
+            .then(result => {
+                document.getElementById("setpointMessage").textContent = result.ok
+                    ? "Setpoint successfully sent to server: " + result.data
+                    : "Setpoint rejected: " + result.data;
             });
         });
     </script>
@@ -0,0 +1,39 @@
+#pragma once
+#include <Arduino.h>
+#include <BinLog.h>
+#include "Metrics.h"
+
+// Frame sent to the Linux controller over the RP UART for every light sample:
+//
+//   <direction> <trace id> <capture us> <tx us> <light>\n
+//
+// The controller acts on the direction word. <light> is the reading of the
+// brightest sensor (0-4095), which Linux/trackstats integrates into the
+// energy yield; it is left out when the caller passes none. The trace id and the two
+// micros() stamps let Linux/tracelat follow one sample from the LDR read to
+// the first step edge in the motor driver. The same stamps are logged as
+// "trace <id> cap <us> tx <us>" (decode the debug port with Linux/logdecode)
+// so frames that never reach the controller still show up in the ESP32 log.
+
+// Returns a new trace id for each light sample
+inline uint32_t nextTraceId() {
+    static uint32_t traceId = 0;
+    return ++traceId;
+}
+
+inline void sendFrame(Print& link, const String& direction, uint32_t traceId, uint32_t captureUs, int light = -1) {
+    uint32_t txUs = micros();
+    char frame[64];
+    int len = snprintf(frame, sizeof(frame), "%s %lu %lu %lu", direction.c_str(), (unsigned long)traceId,
+                       (unsigned long)captureUs, (unsigned long)txUs);
+    if (len > 0 && len < (int)sizeof(frame)) {
+        len += light >= 0 ? snprintf(frame + len, sizeof(frame) - len, " %d\n", light)
+                          : snprintf(frame + len, sizeof(frame) - len, "\n");
+    }
+    if (len > 0 && len < (int)sizeof(frame) && link.write((const uint8_t*)frame, len) == (size_t)len) {
+        metrics.uartFramesSent.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        metrics.uartFramesDropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    LOG_INFO("trace %lu cap %lu tx %lu", (unsigned long)traceId, (unsigned long)captureUs, (unsigned long)txUs);
+}
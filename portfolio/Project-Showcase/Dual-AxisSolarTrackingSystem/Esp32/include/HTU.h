@@ -1,30 +1,64 @@
 #pragma once
-#include <Wire.h>
 #include <ESPAsyncWebServer.h>
 #include <AsyncTCP.h>
 #include <Arduino.h>
+#include <I2CBus.h>
+#include <BinLog.h>
 #include <HTU21D.h>  // Include the SparkFun HTU21D library
+#include "Admission.h"
 
 #define SDA_PIN 21
 #define SCL_PIN 22
 
-// HTU21D sensor class
+// /temperature and /humidity bodies, formatted once per measurement
+SampleBody temperatureBody("text/plain", "Failed to read temperature");
+SampleBody humidityBody("text/plain", "Failed to read humidity");
+
+// HTU21D sensor class. The bus is set up by i2cBus.begin() in setup();
+// nothing here touches I2C during static initialisation.
 class HTU21D_Sensor {
 private:
     HTU21D htu21d;  // SparkFun HTU21D object
-    bool sensorFound; // Flag to check if sensor was initialized properly 
+    bool sensorFound = false; // Flag to check if sensor was initialized properly 
 
 public:
-    HTU21D_Sensor() {
-        // Constructor: Initialize I2C and HTU21D sensor
-        Wire.begin(SDA_PIN, SCL_PIN);  // Initialize I2C bus
-        if (!htu21d.begin()) {
-            Serial.println("HTU21D sensor not detected.");
-            sensorFound = false;
+    // Probe and reset the sensor
+    bool begin() {
+        sensorFound = htu21d.begin();
+        if (sensorFound) {
+            LOG_INFO("HTU21D sensor initialized.");
+        } else {
+            LOG_WARN("HTU21D sensor not detected.");
+        }
+        return sensorFound;
+    }
+
+    // Take a new measurement; the read functions below return the latest one
+    // without touching the bus, so web handlers never wait on I2C. The
+    // /temperature and /humidity bodies are published from it here.
+    bool update() {
+        bool ok = sensorFound && htu21d.measure();
+        int16_t temp = sensorFound ? htu21d.getTemperatureCenti() : HTU21D_INVALID;
+        int16_t humidity = sensorFound ? htu21d.getHumidityCenti() : HTU21D_INVALID;
+        if (temp == HTU21D_INVALID) {
+            temperatureBody.publish(500, "Failed to read temperature");
         } else {
-            sensorFound = true;
-            Serial.println("HTU21D sensor initialized.");
+            temperatureBody.publish(200, centiToString(temp));
         }
+        if (humidity == HTU21D_INVALID) {
+            humidityBody.publish(500, "Failed to read humidity");
+        } else {
+            humidityBody.publish(200, centiToString(humidity));
+        }
+        return ok;
+    }
+
+    // "24.54" from 2454, as String(float) prints it, without float formatting
+    static String centiToString(int16_t v) {
+        char text[8];
+        int a = v < 0 ? -v : v;
+        snprintf(text, sizeof(text), "%s%d.%02d", v < 0 ? "-" : "", a / 100, a % 100);
+        return String(text);
     }
 
     // Read temperature in Celsius
@@ -32,7 +66,7 @@ public:
         if (sensorFound) {
             return htu21d.getTemperature();  // Returns temperature in Celsius
         } else {
-            Serial.println("Error: HTU21D sensor not found.");
+            LOG_WARN("Error: HTU21D sensor not found.");
             return NAN;
         }
     }
@@ -42,7 +76,7 @@ public:
         if (sensorFound) {
             return htu21d.getHumidity();  // Returns humidity as percentage
         } else {
-            Serial.println("Error: HTU21D sensor not found.");
+            LOG_WARN("Error: HTU21D sensor not found.");
             return NAN;
         }
     }
@@ -51,23 +85,14 @@ public:
 // Global sensor instance
 HTU21D_Sensor sensor;
 
-// Web handler functions outside the HTU21D class
+// Web handler functions outside the HTU21D class; they answer with the body
+// of the latest sample and format nothing themselves
 void handleTemperature(AsyncWebServerRequest *request) {
-    float temp = sensor.readTemperature();
-    if (isnan(temp)) {
-        request->send(500, "text/plain", "Failed to read temperature");
-    } else {
-        request->send(200, "text/plain", String(temp));
-    }
+    temperatureBody.serve(request);
 }
 
 void handleHumidity(AsyncWebServerRequest *request) {
-    float humidity = sensor.readHumidity();
-    if (isnan(humidity)) {
-        request->send(500, "text/plain", "Failed to read humidity");
-    } else {
-        request->send(200, "text/plain", String(humidity));
-    }
+    humidityBody.serve(request);
 }
 
 void handleGraph_Temp(AsyncWebServerRequest *request) {
@@ -2,6 +2,80 @@
 #include <Arduino.h>
 #include <driver/adc.h>
 #include <Displayhandler.h>
+#include <BinLog.h>
+
+// ADC1 channel wired to a GPIO, -1 if the pin has none. ADC2 pins are left
+// out on purpose: ADC2 cannot be read while Wi-Fi is on.
+constexpr int adc1ChannelOf(int gpio) {
+    return gpio == 36 ? 0 : gpio == 37 ? 1 : gpio == 38 ? 2 : gpio == 39 ? 3
+         : gpio == 32 ? 4 : gpio == 33 ? 5 : gpio == 34 ? 6 : gpio == 35 ? 7 : -1;
+}
+
+template <int Pin>
+struct Adc1Channel {
+    static_assert(adc1ChannelOf(Pin) >= 0, "light sensor pin is not an ADC1 GPIO (32-39)");
+    static const adc1_channel_t value = (adc1_channel_t)adc1ChannelOf(Pin);
+};
+
+constexpr bool adc1Pins() { return true; }
+template <typename... Rest>
+constexpr bool adc1Pins(int first, Rest... rest) {
+    return adc1ChannelOf(first) >= 0 && adc1Pins(rest...);
+}
+
+constexpr bool pinListed(int) { return false; }
+template <typename... Rest>
+constexpr bool pinListed(int pin, int first, Rest... rest) {
+    return pin == first || pinListed(pin, rest...);
+}
+constexpr bool pinsDistinct() { return true; }
+template <typename... Rest>
+constexpr bool pinsDistinct(int first, Rest... rest) {
+    return !pinListed(first, rest...) && pinsDistinct(rest...);
+}
+
+// A fixed set of light sensors on ADC1, described by their GPIOs:
+//
+//   LightSensorArray<32, 33, 39, 36> lightSensors; // left, right, up, down
+//
+// The pin-to-channel mapping is resolved at compile time and a pin without
+// an ADC1 channel, or listed twice, does not compile. begin() configures
+// each channel once; sample() reads them in the listed order, one
+// adc1_get_raw() per pin with the channel as a constant.
+template <int... Pins>
+class LightSensorArray {
+    static_assert(sizeof...(Pins) > 0, "no light sensor pins");
+    static_assert(adc1Pins(Pins...), "light sensor pin is not an ADC1 GPIO (32-39)");
+    static_assert(pinsDistinct(Pins...), "light sensor pin listed twice");
+
+public:
+    static const size_t size = sizeof...(Pins);
+
+    void begin() {
+        adc1_config_width(ADC_WIDTH_BIT_12);
+        // 11 dB attenuation (ADC_ATTEN_DB_12 in newer IDF), full 0-3.3 V range
+        int expand[] = {0, (adc1_config_channel_atten(Adc1Channel<Pins>::value, ADC_ATTEN_DB_12), 0)...};
+        (void)expand;
+        LOG_INFO("ADC1 configured for %u light sensors with 11 dB attenuation", (unsigned)size);
+    }
+
+    void sample(int (&values)[sizeof...(Pins)]) const {
+        int* out = values;
+        int expand[] = {0, (*out++ = adc1_get_raw(Adc1Channel<Pins>::value), 0)...};
+        (void)expand;
+    }
+
+    // Index of the brightest sensor; the first one wins a tie
+    static size_t brightest(const int (&values)[sizeof...(Pins)]) {
+        size_t best = 0;
+        for (size_t i = 1; i < size; i++) {
+            if (values[i] > values[best]) {
+                best = i;
+            }
+        }
+        return best;
+    }
+};
 
 class LightSensor {
 
@@ -12,19 +86,13 @@ public:
     // Constructor to initialize the pin
     LightSensor(int pin) : sensorPin(pin) {}
 
-    void initLight() {
-        adc1_config_width(ADC_WIDTH_BIT_12);
-        // Set 11 dB attenuation
-        adc1_config_channel_atten(ADC1_CHANNEL_0, ADC_ATTEN_DB_12); // GPIO36
-        adc1_config_channel_atten(ADC1_CHANNEL_1, ADC_ATTEN_DB_12); // GPIO35
-        adc1_config_channel_atten(ADC1_CHANNEL_4, ADC_ATTEN_DB_12); // GPIO32
-        adc1_config_channel_atten(ADC1_CHANNEL_5, ADC_ATTEN_DB_12); // GPIO33
-        Serial.println("ADC1 channels configured with 11 dB attenuation");
-    }
-
     // Method to read and log the light intensity, also display on TFT
     void logLightIntensity(DisplayHandler& display, int x, int y) {
-        int sensorValue = analogRead(sensorPin);
+        logLightIntensity(analogRead(sensorPin), display, x, y);
+    }
+
+    // Same, for a value already sampled by LightSensorArray
+    void logLightIntensity(int sensorValue, DisplayHandler& display, int x, int y) {
         float voltage = sensorValue * (3.3 / 4095.0);
 
         // Display data on TFT screen
@@ -32,17 +100,14 @@ public:
 
         // Example logic based on sensor value (for serial monitor)
         if (sensorValue > 3000) {
-            Serial.println("High light intensity - solar panels adjusted optimally.");
-            Serial.println(sensorValue);
+            LOG_DEBUG("High light intensity - solar panels adjusted optimally. %d", sensorValue);
         } else if (sensorValue < 1000) {
-            Serial.println("Low light intensity - consider changing solar panel direction.");
-            Serial.println(sensorValue);
-
+            LOG_DEBUG("Low light intensity - consider changing solar panel direction. %d", sensorValue);
         }
     }
 
-    // Find the sensor with the highest intensity and display it
-    void Sunsearch(int Left, int Right, int Up, int Down, DisplayHandler& display) {
+    // Find the sensor with the highest intensity, display it and return its direction
+    String Sunsearch(int Left, int Right, int Up, int Down, DisplayHandler& display) {
         int maxIntensity = Left;
         String direction = "Venstre";  // Left
 
@@ -62,10 +127,7 @@ public:
         // Output the result on the TFT display
         display.showDirection(direction, maxIntensity, 10, 100);
 
-        // You can also print this to the serial monitor if needed
-        Serial.print("Maximum intensity is in direction: ");
-        Serial.print(direction);
-        Serial.print(" with value: ");
-        Serial.println(maxIntensity);
+        LOG_INFO("Maximum intensity is in direction: %s with value: %d", direction, maxIntensity);
+        return direction;
     }
 };
\ No newline at end of file
@@ -0,0 +1,355 @@
+#pragma once
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <WiFi.h>
+#include <atomic>
+#include <stdarg.h>
+#include <I2CBus.h>
+#include <BinLog.h>
+#include <esp_timer.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "Admission.h"
+#include "BootTimeline.h"
+#include "PowerManager.h"
+#include "Supervisor.h"
+
+// Counters behind the /metrics route, in the Prometheus text exposition
+// format. Hot paths only bump atomics (a histogram observation is three
+// relaxed adds); everything is formatted when a scraper asks. Figures that
+// other modules already keep (I2C statistics, dropped log records, boot
+// stamps, heap, web admission, power mode) are read at scrape time rather than
+// duplicated here.
+//
+//   server.on("/metrics", HTTP_GET, metrics.instrument("/metrics", handleMetrics));
+
+#define METRICS_MAX_ROUTES 12
+#define METRICS_MAX_TASKS 8
+
+// Upper bounds of the duration histograms in microseconds, 100 us to 2.5 s;
+// one more bucket catches everything above
+#define METRICS_BOUNDS 14
+static const uint32_t metricsBoundsUs[METRICS_BOUNDS] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000,
+};
+
+struct Histogram {
+    std::atomic<uint32_t> buckets[METRICS_BOUNDS + 1];
+    std::atomic<uint32_t> count;
+    std::atomic<uint64_t> sumUs;
+
+    Histogram() : count(0), sumUs(0) {
+        for (int i = 0; i <= METRICS_BOUNDS; i++) {
+            buckets[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void observe(uint32_t us) {
+        int b = 0;
+        while (b < METRICS_BOUNDS && us > metricsBoundsUs[b]) {
+            b++;
+        }
+        buckets[b].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        sumUs.fetch_add(us, std::memory_order_relaxed);
+    }
+};
+
+// Period of a loop that is meant to run every `nominalUs`, and how far each
+// iteration strayed from it. Call tick() once per iteration, from one task.
+struct PeriodMonitor {
+    const char* name;
+    uint32_t nominalUs;
+    uint32_t lastUs = 0;
+    Histogram period;
+    Histogram jitter;
+
+    PeriodMonitor(const char* name, uint32_t nominalUs) : name(name), nominalUs(nominalUs) {}
+
+    void tick() {
+        uint32_t now = micros();
+        if (lastUs) {
+            uint32_t us = now - lastUs;
+            period.observe(us);
+            jitter.observe(us > nominalUs ? us - nominalUs : nominalUs - us);
+        }
+        lastUs = now ? now : 1;
+    }
+};
+
+struct RouteMetrics {
+    const char* uri = nullptr;
+    Histogram handler; // Time spent in the handler; its count is the request count
+};
+
+class Metrics {
+private:
+    RouteMetrics routes[METRICS_MAX_ROUTES];
+    int nroutes = 0;
+    struct WatchedTask {
+        const char* name;
+        TaskHandle_t handle;
+    } tasks[METRICS_MAX_TASKS];
+    int ntasks = 0;
+
+    static void appendf(String& out, const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        char line[160];
+        va_list ap;
+        va_start(ap, fmt);
+        vsnprintf(line, sizeof(line), fmt, ap);
+        va_end(ap);
+        out += line;
+    }
+
+    static void header(String& out, const char* name, const char* type, const char* help) {
+        appendf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+    }
+
+    // One histogram series; `labels` is either empty or "key=\"value\","
+    static void histogram(String& out, const char* name, const char* labels, const uint32_t* boundsUs,
+                          int nbounds, const uint32_t* buckets, uint32_t count, uint64_t sumUs) {
+        uint32_t cumulative = 0;
+        for (int b = 0; b < nbounds; b++) {
+            cumulative += buckets[b];
+            appendf(out, "%s_bucket{%sle=\"%g\"} %lu\n", name, labels, boundsUs[b] / 1e6, (unsigned long)cumulative);
+        }
+        appendf(out, "%s_bucket{%sle=\"+Inf\"} %lu\n", name, labels, (unsigned long)count);
+        size_t n = strlen(labels);
+        char plain[64] = "";
+        if (n) {
+            snprintf(plain, sizeof(plain), "{%.*s}", (int)n - 1, labels); // Without the trailing comma
+        }
+        appendf(out, "%s_sum%s %.6f\n", name, plain, sumUs / 1e6);
+        appendf(out, "%s_count%s %lu\n", name, plain, (unsigned long)count);
+    }
+
+    static void histogram(String& out, const char* name, const char* labels, const Histogram& h) {
+        uint32_t buckets[METRICS_BOUNDS + 1];
+        for (int b = 0; b <= METRICS_BOUNDS; b++) {
+            buckets[b] = h.buckets[b].load(std::memory_order_relaxed);
+        }
+        histogram(out, name, labels, metricsBoundsUs, METRICS_BOUNDS, buckets,
+                  h.count.load(std::memory_order_relaxed), h.sumUs.load(std::memory_order_relaxed));
+    }
+
+public:
+    PeriodMonitor loopPeriod{"loop", 1000000};
+    PeriodMonitor sensorPeriod{"sensor", 1000000};
+
+    std::atomic<uint32_t> uartFramesSent{0};
+    std::atomic<uint32_t> uartFramesDropped{0}; // The UART took less than the whole frame
+    std::atomic<uint32_t> wifiAttempts{0};
+    std::atomic<uint32_t> wifiDisconnects{0};
+    std::atomic<uint32_t> telemetrySent{0};
+    std::atomic<uint32_t> telemetryFailed{0};   // The UDP stack refused the datagram
+    std::atomic<uint32_t> setpointUpdates{0};
+    std::atomic<uint32_t> setpointResends{0};
+    std::atomic<uint32_t> setpointUnacked{0};   // Given up after the last resend
+    std::atomic<uint32_t> setpointRejected{0};  // Refused by the controller with a NAK
+    std::atomic<uint32_t> setpointSaves{0};     // NVS writes
+    Histogram setpointLatency;    // POST received -> controller acknowledged the servo command
+    Histogram setpointActuation;  // Controller side: line received -> servo command issued
+
+    // Stack high-water mark of `handle` is reported as task="<name>". Call
+    // from setup(); a null handle is ignored.
+    void watchTask(const char* name, TaskHandle_t handle) {
+        if (handle && ntasks < METRICS_MAX_TASKS) {
+            tasks[ntasks++] = {name, handle};
+        }
+    }
+
+    // Wraps a route handler so its requests and handler time are counted
+    // under `uri`. Call while registering routes, before the server runs.
+    ArRequestHandlerFunction instrument(const char* uri, ArRequestHandlerFunction fn) {
+        RouteMetrics* r = nullptr;
+        for (int i = 0; i < nroutes && !r; i++) {
+            if (strcmp(routes[i].uri, uri) == 0) {
+                r = &routes[i];
+            }
+        }
+        if (!r && nroutes < METRICS_MAX_ROUTES) {
+            r = &routes[nroutes++];
+            r->uri = uri;
+        }
+        if (!r) {
+            return fn;
+        }
+        return [r, fn](AsyncWebServerRequest* request) {
+            uint32_t start = micros();
+            fn(request);
+            r->handler.observe(micros() - start);
+        };
+    }
+
+    void render(String& out) {
+        out.reserve(6144);
+
+        header(out, "tracker_uptime_seconds", "gauge", "Time since reset.");
+        appendf(out, "tracker_uptime_seconds %.3f\n", esp_timer_get_time() / 1e6);
+
+        header(out, "tracker_heap_free_bytes", "gauge", "Free heap.");
+        appendf(out, "tracker_heap_free_bytes %lu\n", (unsigned long)ESP.getFreeHeap());
+        header(out, "tracker_heap_min_free_bytes", "gauge", "Lowest free heap since reset.");
+        appendf(out, "tracker_heap_min_free_bytes %lu\n", (unsigned long)ESP.getMinFreeHeap());
+        header(out, "tracker_heap_largest_block_bytes", "gauge", "Largest block malloc() can return.");
+        appendf(out, "tracker_heap_largest_block_bytes %lu\n", (unsigned long)ESP.getMaxAllocHeap());
+
+        header(out, "tracker_task_stack_free_bytes", "gauge", "Least stack a task has had left.");
+        for (int i = 0; i < ntasks; i++) {
+            appendf(out, "tracker_task_stack_free_bytes{task=\"%s\"} %lu\n", tasks[i].name,
+                    (unsigned long)uxTaskGetStackHighWaterMark(tasks[i].handle));
+        }
+
+        char labels[48];
+        PeriodMonitor* periods[] = {&loopPeriod, &sensorPeriod};
+        header(out, "tracker_period_seconds", "histogram", "Time between iterations of a periodic loop.");
+        for (PeriodMonitor* p : periods) {
+            snprintf(labels, sizeof(labels), "loop=\"%s\",", p->name);
+            histogram(out, "tracker_period_seconds", labels, p->period);
+        }
+        header(out, "tracker_jitter_seconds", "histogram", "Deviation of each period from the nominal one.");
+        for (PeriodMonitor* p : periods) {
+            snprintf(labels, sizeof(labels), "loop=\"%s\",", p->name);
+            histogram(out, "tracker_jitter_seconds", labels, p->jitter);
+        }
+
+        header(out, "tracker_deadline_cycles_total", "counter", "Cycles run by each supervised task.");
+        for (int id = 0; id < supervisor.count(); id++) {
+            appendf(out, "tracker_deadline_cycles_total{task=\"%s\"} %lu\n", supervisor.name(id),
+                    (unsigned long)supervisor.cycles(id));
+        }
+        header(out, "tracker_deadline_violations_total", "counter", "Budget overruns, late starts and stalls.");
+        for (int id = 0; id < supervisor.count(); id++) {
+            for (int k = 0; k < DEADLINE_KINDS; k++) {
+                appendf(out, "tracker_deadline_violations_total{task=\"%s\",kind=\"%s\"} %lu\n",
+                        supervisor.name(id), Supervisor::kindName((DeadlineKind)k),
+                        (unsigned long)supervisor.violations(id, (DeadlineKind)k));
+            }
+        }
+        header(out, "tracker_deadline_max_cycle_seconds", "gauge", "Longest cycle of each supervised task.");
+        for (int id = 0; id < supervisor.count(); id++) {
+            appendf(out, "tracker_deadline_max_cycle_seconds{task=\"%s\"} %.6f\n", supervisor.name(id),
+                    supervisor.maxCycleUs(id) / 1e6);
+        }
+        header(out, "tracker_deadline_last_violation_seconds", "gauge",
+               "Cycle time or lateness of the latest violation, with the stage blamed.");
+        for (int id = 0; id < supervisor.count(); id++) {
+            DeadlineViolation v = supervisor.lastViolation(id);
+            if (v.atUs) {
+                appendf(out, "tracker_deadline_last_violation_seconds{task=\"%s\",kind=\"%s\",stage=\"%s\"} %.6f\n",
+                        supervisor.name(id), Supervisor::kindName(v.kind), v.stage ? v.stage : "", v.us / 1e6);
+            }
+        }
+        header(out, "tracker_deadline_last_violation_uptime_seconds", "gauge", "When the latest violation was seen.");
+        for (int id = 0; id < supervisor.count(); id++) {
+            DeadlineViolation v = supervisor.lastViolation(id);
+            if (v.atUs) {
+                appendf(out, "tracker_deadline_last_violation_uptime_seconds{task=\"%s\"} %.3f\n", supervisor.name(id),
+                        v.atUs / 1e6);
+            }
+        }
+
+        I2CStats i2c = i2cBus.stats();
+        header(out, "tracker_i2c_transactions_total", "counter", "I2C transactions run.");
+        appendf(out, "tracker_i2c_transactions_total %lu\n", (unsigned long)i2c.transactions);
+        header(out, "tracker_i2c_errors_total", "counter", "Failed I2C transactions by cause.");
+        for (int s = 1; s < I2C_STATUSES; s++) {
+            appendf(out, "tracker_i2c_errors_total{status=\"%s\"} %lu\n", I2CBus::statusName((I2CStatus)s),
+                    (unsigned long)i2c.errors[s]);
+        }
+        header(out, "tracker_i2c_recoveries_total", "counter", "I2C bus recoveries.");
+        appendf(out, "tracker_i2c_recoveries_total %lu\n", (unsigned long)i2c.recoveries);
+        header(out, "tracker_i2c_queue_high_water", "gauge", "Most transactions queued at once.");
+        appendf(out, "tracker_i2c_queue_high_water %lu\n", (unsigned long)i2c.queueHighWater);
+        header(out, "tracker_i2c_latency_seconds", "histogram", "I2C transaction time, queueing included.");
+        histogram(out, "tracker_i2c_latency_seconds", "", i2cLatencyBoundsUs, I2C_LATENCY_BUCKETS - 1,
+                  i2c.latencyBuckets, i2c.transactions, i2c.latencySumUs);
+
+        header(out, "tracker_http_handler_seconds", "histogram", "HTTP handler time by route.");
+        for (int i = 0; i < nroutes; i++) {
+            snprintf(labels, sizeof(labels), "route=\"%s\",", routes[i].uri);
+            histogram(out, "tracker_http_handler_seconds", labels, routes[i].handler);
+        }
+
+        header(out, "tracker_http_in_flight", "gauge", "Admitted requests whose connection is still open.");
+        appendf(out, "tracker_http_in_flight %d\n", admission.inFlight());
+        header(out, "tracker_http_in_flight_peak", "gauge", "Most requests in flight at once.");
+        appendf(out, "tracker_http_in_flight_peak %d\n", admission.peakInFlight());
+        header(out, "tracker_http_in_flight_limit", "gauge", "Requests in flight before new ones get a 503.");
+        appendf(out, "tracker_http_in_flight_limit %d\n", admission.capacity());
+        header(out, "tracker_http_admitted_total", "counter", "Requests admitted.");
+        appendf(out, "tracker_http_admitted_total %lu\n", (unsigned long)admission.admitted.load());
+        header(out, "tracker_http_rejected_total", "counter", "Requests answered 503 for want of a slot.");
+        appendf(out, "tracker_http_rejected_total %lu\n", (unsigned long)admission.rejected.load());
+        header(out, "tracker_http_bodies_published_total", "counter", "Sample bodies formatted.");
+        appendf(out, "tracker_http_bodies_published_total %lu\n", (unsigned long)admission.bodiesPublished.load());
+        header(out, "tracker_http_bodies_shared_total", "counter", "Responses sent from a sample body.");
+        appendf(out, "tracker_http_bodies_shared_total %lu\n", (unsigned long)admission.bodiesShared.load());
+
+        header(out, "tracker_wifi_connected", "gauge", "1 while the station has an address.");
+        appendf(out, "tracker_wifi_connected %d\n", WiFi.status() == WL_CONNECTED);
+        header(out, "tracker_wifi_rssi_dbm", "gauge", "Signal strength of the AP, 0 when not connected.");
+        appendf(out, "tracker_wifi_rssi_dbm %d\n", (int)WiFi.RSSI());
+        header(out, "tracker_wifi_connect_attempts_total", "counter", "Station connect attempts.");
+        appendf(out, "tracker_wifi_connect_attempts_total %lu\n", (unsigned long)wifiAttempts.load());
+        header(out, "tracker_wifi_disconnects_total", "counter", "Lost links and failed attempts.");
+        appendf(out, "tracker_wifi_disconnects_total %lu\n", (unsigned long)wifiDisconnects.load());
+
+        header(out, "tracker_uart_frames_sent_total", "counter", "Frames sent to the Linux controller.");
+        appendf(out, "tracker_uart_frames_sent_total %lu\n", (unsigned long)uartFramesSent.load());
+        header(out, "tracker_uart_frames_dropped_total", "counter", "Frames the UART did not take whole.");
+        appendf(out, "tracker_uart_frames_dropped_total %lu\n", (unsigned long)uartFramesDropped.load());
+
+        header(out, "tracker_telemetry_sent_total", "counter", "Telemetry datagrams multicast.");
+        appendf(out, "tracker_telemetry_sent_total %lu\n", (unsigned long)telemetrySent.load());
+        header(out, "tracker_telemetry_failed_total", "counter", "Telemetry datagrams the UDP stack refused.");
+        appendf(out, "tracker_telemetry_failed_total %lu\n", (unsigned long)telemetryFailed.load());
+
+        header(out, "tracker_setpoint_updates_total", "counter", "Setpoints accepted on /setpoint.");
+        appendf(out, "tracker_setpoint_updates_total %lu\n", (unsigned long)setpointUpdates.load());
+        header(out, "tracker_setpoint_resends_total", "counter", "Setpoint lines sent again for want of an ack.");
+        appendf(out, "tracker_setpoint_resends_total %lu\n", (unsigned long)setpointResends.load());
+        header(out, "tracker_setpoint_unacked_total", "counter", "Setpoints the controller never acknowledged.");
+        appendf(out, "tracker_setpoint_unacked_total %lu\n", (unsigned long)setpointUnacked.load());
+        header(out, "tracker_setpoint_rejected_total", "counter", "Setpoints the controller refused.");
+        appendf(out, "tracker_setpoint_rejected_total %lu\n", (unsigned long)setpointRejected.load());
+        header(out, "tracker_setpoint_saves_total", "counter", "Setpoint writes to NVS.");
+        appendf(out, "tracker_setpoint_saves_total %lu\n", (unsigned long)setpointSaves.load());
+        header(out, "tracker_setpoint_latency_seconds", "histogram", "POST /setpoint to the controller's ack.");
+        histogram(out, "tracker_setpoint_latency_seconds", "", setpointLatency);
+        header(out, "tracker_setpoint_actuation_seconds", "histogram", "Controller: setpoint line to servo command.");
+        histogram(out, "tracker_setpoint_actuation_seconds", "", setpointActuation);
+
+        header(out, "tracker_power_mode", "gauge", "1 for the current power mode.");
+        for (int m = 0; m < POWER_MODES; m++) {
+            appendf(out, "tracker_power_mode{mode=\"%s\"} %d\n", PowerPolicy::name((PowerMode)m),
+                    power.current() == m);
+        }
+        header(out, "tracker_power_mode_changes_total", "counter", "Power mode changes.");
+        appendf(out, "tracker_power_mode_changes_total %lu\n", (unsigned long)power.modeChanges());
+        header(out, "tracker_power_light_sleeps_total", "counter", "Light sleeps between night samples.");
+        appendf(out, "tracker_power_light_sleeps_total %lu\n", (unsigned long)power.lightSleeps());
+        header(out, "tracker_power_light_sleep_seconds_total", "counter", "Time spent in light sleep.");
+        appendf(out, "tracker_power_light_sleep_seconds_total %.3f\n", power.lightSleepMs() / 1e3);
+
+        header(out, "tracker_log_records_dropped_total", "counter", "Log records lost to a full ring.");
+        appendf(out, "tracker_log_records_dropped_total %lu\n", (unsigned long)binlog.dropped());
+
+        header(out, "tracker_boot_phase_seconds", "gauge", "Time from reset to each boot phase.");
+        for (int p = 0; p < BOOT_PHASES; p++) {
+            uint32_t us = bootTimeline.at((BootPhase)p);
+            if (us) {
+                appendf(out, "tracker_boot_phase_seconds{phase=\"%s\"} %.3f\n", BootTimeline::name((BootPhase)p),
+                        us / 1e6);
+            }
+        }
+    }
+};
+
+Metrics metrics;
+
+void handleMetrics(AsyncWebServerRequest* request) {
+    String body;
+    metrics.render(body);
+    request->send(200, "text/plain; version=0.0.4", body);
+}
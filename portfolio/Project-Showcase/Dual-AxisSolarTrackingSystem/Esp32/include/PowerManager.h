@@ -0,0 +1,104 @@
+#pragma once
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_sleep.h>
+#include <atomic>
+#include <BinLog.h>
+#include "PowerPolicy.h"
+#include "Supervisor.h"
+
+// Paces loop() with PowerPolicy instead of a fixed delay(1000), and puts
+// the node in the matching power state between samples:
+//
+//   tracking  240 MHz, Wi-Fi modem sleep (woken every DTIM): the loop waits
+//             in vTaskDelay, the web server and telemetry stay responsive
+//   steady    80 MHz, Wi-Fi max modem sleep; same wait, slower answers
+//   night     80 MHz, light sleep between samples with the RTC timer as
+//             the only wake source. Every task is frozen while it sleeps,
+//             so the web server and the sensor task only run in the short
+//             awake spells, and the AP may drop the link, which WifiLink
+//             then restores at dawn.
+//
+//   power.begin(RP, loopDeadline);
+//   ...                                   // End of loop():
+//   uint32_t ms = power.plan(light, lightSensors.size);
+//   supervisor.end(loopDeadline);
+//   power.wait(ms);
+
+class PowerManager {
+private:
+    PowerPolicy policy;
+    PowerMode applied = POWER_MODES;
+    HardwareSerial* uart = nullptr;
+    int deadline = -1;
+
+    std::atomic<uint8_t> mode{POWER_TRACKING};
+    std::atomic<uint32_t> sleeps{0};
+    std::atomic<uint32_t> sleptMs{0};
+    std::atomic<uint32_t> changes{0};
+
+    void apply(PowerMode m) {
+        setCpuFrequencyMhz(m == POWER_TRACKING ? 240 : 80);
+        WiFi.setSleep(m == POWER_TRACKING ? WIFI_PS_MIN_MODEM : WIFI_PS_MAX_MODEM);
+        if (applied != POWER_MODES) {
+            changes.fetch_add(1, std::memory_order_relaxed);
+        }
+        applied = m;
+        mode.store(m, std::memory_order_relaxed);
+        LOG_INFO("power mode %s, sampling every %lu ms", PowerPolicy::name(m),
+                 (unsigned long)PowerPolicy::intervalMs(m));
+    }
+
+    void lightSleep(uint32_t ms) {
+        // The UARTs lose what is still in their FIFOs when the clocks stop
+        Serial.flush();
+        if (uart) {
+            uart->flush();
+        }
+        supervisor.suspend();
+        esp_sleep_enable_timer_wakeup((uint64_t)ms * 1000);
+        uint32_t start = micros();
+        esp_light_sleep_start();
+        sleptMs.fetch_add((micros() - start) / 1000, std::memory_order_relaxed);
+        sleeps.fetch_add(1, std::memory_order_relaxed);
+        supervisor.resume();
+    }
+
+public:
+    // `link` is flushed before each light sleep; `loopDeadline` is the
+    // supervisor id of loop(), whose period follows the chosen rate
+    void begin(HardwareSerial& link, int loopDeadline) {
+        uart = &link;
+        deadline = loopDeadline;
+        apply(policy.mode());
+    }
+
+    // Feeds one sample to the policy and returns how long to wait before
+    // the next one
+    uint32_t plan(const int* light, size_t n) {
+        PowerMode m = policy.update(millis(), light, n);
+        if (m != applied) {
+            apply(m);
+        }
+        uint32_t ms = policy.intervalMs();
+        supervisor.setPeriod(deadline, ms);
+        return ms;
+    }
+
+    // Waits `ms` in the state of the current mode
+    void wait(uint32_t ms) {
+        if (applied == POWER_NIGHT) {
+            lightSleep(ms);
+        } else {
+            delay(ms);
+        }
+    }
+
+    PowerMode current() const { return (PowerMode)mode.load(std::memory_order_relaxed); }
+    float rate() const { return policy.rate(); }
+    uint32_t lightSleeps() const { return sleeps.load(std::memory_order_relaxed); }
+    uint32_t lightSleepMs() const { return sleptMs.load(std::memory_order_relaxed); }
+    uint32_t modeChanges() const { return changes.load(std::memory_order_relaxed); }
+};
+
+PowerManager power;
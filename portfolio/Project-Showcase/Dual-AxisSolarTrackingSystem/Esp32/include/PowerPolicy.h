@@ -0,0 +1,185 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Sampling rate of the light loop, picked from how fast the light changes.
+// Pure: it sees timestamps and ADC readings only, so it runs the same on
+// the board (through PowerManager) and on the host, where EnergyModel
+// replays a recorded light trace through it.
+//
+//   tracking  the light is moving (clouds, a fresh morning): sample every
+//             POWER_TRACKING_MS
+//   steady    it barely changes: every POWER_STEADY_MS
+//   night     the brightest channel has stayed below POWER_NIGHT_LEVEL for
+//             POWER_NIGHT_HOLD_MS: every POWER_NIGHT_MS, until it is above
+//             POWER_DAWN_LEVEL again
+//
+// The rate of change is the fastest-moving channel in ADC counts per
+// second. The estimate jumps up with the light but decays with a time
+// constant of POWER_RATE_DECAY_MS, and tracking has a higher threshold to
+// start than to end, so a passing cloud keeps the fast rate for a while
+// and the mode does not flap on a noisy reading.
+
+#define POWER_TRACKING_MS 500
+#define POWER_STEADY_MS 5000
+#define POWER_NIGHT_MS 60000
+#define POWER_FAST_RATE 40.0f     // Counts/s at which tracking starts
+#define POWER_SLOW_RATE 10.0f     // ...and below which it falls back to steady
+#define POWER_RATE_DECAY_MS 30000
+#define POWER_NIGHT_LEVEL 100
+#define POWER_DAWN_LEVEL 200
+#define POWER_NIGHT_HOLD_MS 600000
+#define POWER_MAX_CHANNELS 8
+
+enum PowerMode : uint8_t {
+    POWER_TRACKING,
+    POWER_STEADY,
+    POWER_NIGHT,
+    POWER_MODES
+};
+
+class PowerPolicy {
+private:
+    PowerMode current = POWER_TRACKING;
+    int previous[POWER_MAX_CHANNELS];
+    uint32_t previousMs = 0;
+    bool primed = false;
+    float smoothedRate = POWER_FAST_RATE; // Starts tracking, until the light is seen to settle
+    uint32_t darkSinceMs = 0;
+    bool dark = false;
+
+public:
+    static const char* name(PowerMode mode) {
+        static const char* const names[POWER_MODES] = {"tracking", "steady", "night"};
+        return names[mode];
+    }
+
+    static uint32_t intervalMs(PowerMode mode) {
+        static const uint32_t intervals[POWER_MODES] = {POWER_TRACKING_MS, POWER_STEADY_MS, POWER_NIGHT_MS};
+        return intervals[mode];
+    }
+
+    // One sample of `n` channels taken at `nowMs`; returns the mode to use
+    // until the next one
+    PowerMode update(uint32_t nowMs, const int* light, size_t n) {
+        if (n > POWER_MAX_CHANNELS) {
+            n = POWER_MAX_CHANNELS;
+        }
+        int level = 0;
+        float rate = 0;
+        uint32_t dt = nowMs - previousMs;
+        for (size_t i = 0; i < n; i++) {
+            if (light[i] > level) {
+                level = light[i];
+            }
+            if (primed && dt) {
+                int change = light[i] > previous[i] ? light[i] - previous[i] : previous[i] - light[i];
+                float r = change * 1000.0f / dt;
+                if (r > rate) {
+                    rate = r;
+                }
+            }
+            previous[i] = light[i];
+        }
+        if (primed) {
+            smoothedRate = smoothedRate * POWER_RATE_DECAY_MS / (POWER_RATE_DECAY_MS + dt);
+            if (rate > smoothedRate) {
+                smoothedRate = rate;
+            }
+        }
+        primed = true;
+        previousMs = nowMs;
+
+        if (current == POWER_NIGHT) {
+            if (level >= POWER_DAWN_LEVEL) {
+                current = POWER_TRACKING; // The sun has moved all night
+                smoothedRate = POWER_FAST_RATE;
+                dark = false;
+            }
+            return current;
+        }
+
+        if (level >= POWER_NIGHT_LEVEL) {
+            dark = false;
+        } else if (!dark) {
+            dark = true;
+            darkSinceMs = nowMs;
+        } else if (nowMs - darkSinceMs >= POWER_NIGHT_HOLD_MS) {
+            current = POWER_NIGHT;
+            return current;
+        }
+
+        if (smoothedRate >= POWER_FAST_RATE) {
+            current = POWER_TRACKING;
+        } else if (smoothedRate < POWER_SLOW_RATE) {
+            current = POWER_STEADY;
+        }
+        return current;
+    }
+
+    PowerMode mode() const { return current; }
+    uint32_t intervalMs() const { return intervalMs(current); }
+    float rate() const { return smoothedRate; }
+};
+
+// Supply current of the node in each state. The defaults are datasheet-order
+// figures for an ESP32 devkit with the TFT lit; pass measured ones for a
+// real estimate.
+struct PowerProfile {
+    float activeMa;      // Awake, running one loop iteration
+    float activeMs;      // Length of one loop iteration
+    float idleMa;        // Awake and idle with Wi-Fi fully on: delay(1000) before power management
+    float modemSleepMa;  // Idle between samples with Wi-Fi in modem sleep
+    float lightSleepMa;  // Light sleep, woken by the RTC timer
+};
+
+static const PowerProfile defaultPowerProfile = {120.0f, 40.0f, 95.0f, 45.0f, 15.0f};
+
+struct EnergyEstimate {
+    float mAhPerDay;          // With the power policy
+    float baselineMAhPerDay;  // Sampling every second with Wi-Fi fully on
+    uint32_t samples;
+    uint32_t msInMode[POWER_MODES];
+};
+
+// Replays a light trace through PowerPolicy and integrates the supply
+// current: each sample costs activeMs at activeMa, the rest of its interval
+// is spent in modem sleep, or light sleep at night. The trace is `rows`
+// samples of `channels` readings, light[row * channels + channel], taken at
+// ms[row]; between rows the last reading holds. The charge is scaled from
+// the trace's length to a day.
+struct EnergyModel {
+    static EnergyEstimate estimate(const uint32_t* ms, const int* light, size_t rows, size_t channels,
+                                   const PowerProfile& profile = defaultPowerProfile) {
+        EnergyEstimate e = {0, 0, 0, {0}};
+        if (rows < 2 || ms[rows - 1] <= ms[0]) {
+            return e;
+        }
+        uint32_t end = ms[rows - 1] - ms[0];
+        PowerPolicy policy;
+        double charge = 0; // mA * ms
+        size_t row = 0;
+        for (uint32_t t = 0; t < end;) {
+            while (row + 1 < rows && ms[row + 1] - ms[0] <= t) {
+                row++;
+            }
+            PowerMode mode = policy.update(t, light + row * channels, channels);
+            uint32_t interval = PowerPolicy::intervalMs(mode);
+            if (interval > end - t) {
+                interval = end - t;
+            }
+            float awake = profile.activeMs < interval ? profile.activeMs : interval;
+            float sleepMa = mode == POWER_NIGHT ? profile.lightSleepMa : profile.modemSleepMa;
+            charge += awake * profile.activeMa + (interval - awake) * sleepMa;
+            e.msInMode[mode] += interval;
+            e.samples++;
+            t += interval;
+        }
+        double perDay = 86400000.0 / end / 3600000.0; // mA * ms over the trace -> mAh per day
+        e.mAhPerDay = (float)(charge * perDay);
+        double baseline =
+            end / 1000.0 * (profile.activeMs * profile.activeMa + (1000 - profile.activeMs) * profile.idleMa);
+        e.baselineMAhPerDay = (float)(baseline * perDay);
+        return e;
+    }
+};
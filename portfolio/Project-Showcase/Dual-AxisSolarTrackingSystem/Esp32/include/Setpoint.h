@@ -0,0 +1,311 @@
+#pragma once
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <Preferences.h>
+#include <atomic>
+#include <BinLog.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "Metrics.h"
+
+// Servo setpoint and limits set from the web page. POST /setpoint is
+// validated and applied to the in-RAM config at once, and the request is
+// answered without waiting for the UART or flash. The link task then sends
+// the config to the Linux controller over the RP UART,
+//
+//   SET <id> <setpoint> <min> <max>\n
+//
+// and the controller answers once the servo command is issued,
+//
+//   ACK <id> <setpoint> <min> <max> <us from line received to command>\n
+//
+// or refuses a setpoint outside its limits, naming the config it keeps,
+//
+//   NAK <id> <setpoint> <min> <max>\n
+//
+// A refused setpoint is not sent again and counts as rejected on /metrics.
+// A SET without an ACK within SETPOINT_ACK_TIMEOUT_MS is sent again, up to
+// SETPOINT_RESENDS times; a newer edit replaces it. The time from the POST
+// to the ACK is the setpoint-to-actuation latency on /metrics.
+//
+// NVS writes are debounced: an edit is saved once no other edit came for
+// SETPOINT_SAVE_QUIET_MS, or SETPOINT_SAVE_MAX_MS after the first unsaved
+// one, so a burst of edits costs one flash write, made by the link task
+// rather than the TCP task.
+//
+//   setpoints.begin();    // setup(), after RP.begin()
+//   setpoints.start(RP);  // The link task becomes the only reader of RP
+//   server.on("/setpoint", HTTP_POST, metrics.instrument("/setpoint", handleSetpoint));
+
+#define SETPOINT_MIN_ANGLE 0
+#define SETPOINT_MAX_ANGLE 180
+#define SETPOINT_ACK_TIMEOUT_MS 300
+#define SETPOINT_RESENDS 5
+#define SETPOINT_SAVE_QUIET_MS 2000
+#define SETPOINT_SAVE_MAX_MS 10000
+#define SETPOINT_POLL_MS 10
+
+struct SetpointConfig {
+    int16_t setpoint;
+    int16_t minLimit;
+    int16_t maxLimit;
+};
+
+class SetpointLink {
+private:
+    // Written by the TCP task, read by the link task
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    SetpointConfig config = {90, 0, 90}; // What the controller did before setpoints: up is 90, down 0
+    uint32_t version = 0;      // Bumped by every accepted edit; the SET id
+    uint32_t editUs = 0;       // micros() of the latest edit
+    uint32_t firstUnsavedMs = 0;
+    uint32_t lastEditMs = 0;
+    bool unsaved = false;
+    TaskHandle_t task = nullptr;
+
+    // Owned by the link task
+    uint32_t sentVersion = 0;
+    uint32_t sentAtMs = 0;
+    uint32_t sentEditUs = 0;
+    int resends = 0;
+    std::atomic<uint32_t> ackedVersion{0};
+    uint32_t rejectedVersion = 0;
+    SetpointConfig sentConfig = {};
+    SetpointConfig savedConfig = {};
+    char rx[64];
+    size_t rxLen = 0;
+    Stream* link = nullptr;
+
+    std::atomic<uint32_t> lastLatencyUs{0}; // Of the newest acknowledged edit
+
+    static bool parseAngle(AsyncWebServerRequest* request, const char* name, int16_t& out) {
+        AsyncWebParameter* p = request->getParam(name, true);
+        if (!p || p->value().length() == 0) {
+            return true; // Optional on the form: keep the current value
+        }
+        char* end;
+        long v = strtol(p->value().c_str(), &end, 10);
+        if (*end || v < SETPOINT_MIN_ANGLE || v > SETPOINT_MAX_ANGLE) {
+            return false;
+        }
+        out = (int16_t)v;
+        return true;
+    }
+
+    void send(Print& out, uint32_t id, const SetpointConfig& c) {
+        char line[48];
+        int len = snprintf(line, sizeof(line), "SET %lu %d %d %d\n", (unsigned long)id, c.setpoint, c.minLimit,
+                           c.maxLimit);
+        out.write((const uint8_t*)line, len); // One write, so it cannot interleave with a sensor frame
+        sentAtMs = millis();
+    }
+
+    void onNak(const char* line) {
+        unsigned long id;
+        int sp, lo, hi;
+        if (sscanf(line, "NAK %lu %d %d %d", &id, &sp, &lo, &hi) != 4 || id != sentVersion ||
+            rejectedVersion == sentVersion || ackedVersion == sentVersion) {
+            return;
+        }
+        rejectedVersion = sentVersion;
+        metrics.setpointRejected.fetch_add(1, std::memory_order_relaxed);
+        LOG_WARN("setpoint %lu rejected, controller keeps %d [%d, %d]", id, sp, lo, hi);
+    }
+
+    void onAck(const char* line) {
+        unsigned long id, us;
+        int sp, lo, hi;
+        if (sscanf(line, "ACK %lu %d %d %d %lu", &id, &sp, &lo, &hi, &us) != 5 || id != sentVersion ||
+            ackedVersion == sentVersion) {
+            return; // Stale (superseded edit) or repeated ack
+        }
+        ackedVersion.store(sentVersion);
+        uint32_t latency = micros() - sentEditUs;
+        lastLatencyUs.store(latency);
+        metrics.setpointLatency.observe(latency);
+        metrics.setpointActuation.observe(us);
+        if (sp != sentConfig.setpoint || lo != sentConfig.minLimit || hi != sentConfig.maxLimit) {
+            LOG_WARN("setpoint %lu acked as %d [%d, %d]", id, sp, lo, hi);
+        }
+        LOG_INFO("setpoint %d [%d, %d] actuated in %lu us", sp, lo, hi, (unsigned long)latency);
+    }
+
+    // A line from the controller about the setpoint in flight
+    void onReply(const char* line) {
+        if (strncmp(line, "NAK ", 4) == 0) {
+            onNak(line);
+        } else {
+            onAck(line);
+        }
+    }
+
+    void save(const SetpointConfig& c) {
+        if (memcmp(&c, &savedConfig, sizeof(c)) == 0) {
+            return;
+        }
+        Preferences prefs;
+        if (!prefs.begin("setpoint", false)) {
+            return;
+        }
+        prefs.putBytes("cfg", &c, sizeof(c));
+        prefs.end();
+        savedConfig = c;
+        metrics.setpointSaves.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static void taskMain(void* arg) {
+        SetpointLink* s = (SetpointLink*)arg;
+        for (;;) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SETPOINT_POLL_MS)); // Woken at once by an edit
+            s->poll(*s->link);
+        }
+    }
+
+public:
+    static bool valid(const SetpointConfig& c) {
+        return c.minLimit >= SETPOINT_MIN_ANGLE && c.maxLimit <= SETPOINT_MAX_ANGLE && c.minLimit <= c.setpoint &&
+               c.setpoint <= c.maxLimit;
+    }
+
+    // Loads the saved config; the first poll() sends it to the controller
+    void begin() {
+        Preferences prefs;
+        SetpointConfig c;
+        if (prefs.begin("setpoint", true)) {
+            if (prefs.getBytes("cfg", &c, sizeof(c)) == sizeof(c) && valid(c)) {
+                config = c;
+            }
+            prefs.end();
+        }
+        savedConfig = config;
+        version = 1;
+        editUs = micros();
+    }
+
+    // Starts the link task, which from then on owns reading `rp`
+    bool start(Stream& rp, UBaseType_t priority = 2, BaseType_t core = 1) {
+        link = &rp;
+        return xTaskCreatePinnedToCore(taskMain, "Setpoint", 3072, this, priority, &task, core) == pdPASS;
+    }
+
+    // Applies an edit; false (and nothing changes) if it is out of range
+    bool apply(const SetpointConfig& c) {
+        if (!valid(c)) {
+            return false;
+        }
+        uint32_t nowMs = millis();
+        taskENTER_CRITICAL(&lock);
+        config = c;
+        version++;
+        editUs = micros();
+        if (!unsaved) {
+            firstUnsavedMs = nowMs;
+        }
+        lastEditMs = nowMs;
+        unsaved = true;
+        taskEXIT_CRITICAL(&lock);
+        metrics.setpointUpdates.fetch_add(1, std::memory_order_relaxed);
+        if (task) {
+            xTaskNotifyGive(task);
+        }
+        return true;
+    }
+
+    SetpointConfig current() {
+        taskENTER_CRITICAL(&lock);
+        SetpointConfig c = config;
+        taskEXIT_CRITICAL(&lock);
+        return c;
+    }
+
+    // One round of the link task: read replies, send or resend the newest
+    // config, save it when the edits have settled
+    void poll(Stream& rp) {
+        while (rp.available() > 0) {
+            int c = rp.read();
+            if (c == '\n') {
+                rx[rxLen] = '\0';
+                onReply(rx);
+                rxLen = 0;
+            } else if (c >= 0 && rxLen < sizeof(rx) - 1) {
+                rx[rxLen++] = (char)c;
+            }
+        }
+
+        uint32_t nowMs = millis();
+        taskENTER_CRITICAL(&lock);
+        SetpointConfig c = config;
+        uint32_t v = version, edit = editUs;
+        bool due = unsaved &&
+                   (nowMs - lastEditMs >= SETPOINT_SAVE_QUIET_MS || nowMs - firstUnsavedMs >= SETPOINT_SAVE_MAX_MS);
+        if (due) {
+            unsaved = false;
+        }
+        taskEXIT_CRITICAL(&lock);
+
+        if (v != sentVersion) {
+            sentVersion = v;
+            sentConfig = c;
+            sentEditUs = edit;
+            resends = 0;
+            send(rp, v, c);
+        } else if (ackedVersion != sentVersion && rejectedVersion != sentVersion &&
+                   resends <= SETPOINT_RESENDS && nowMs - sentAtMs >= SETPOINT_ACK_TIMEOUT_MS) {
+            if (resends++ == SETPOINT_RESENDS) {
+                metrics.setpointUnacked.fetch_add(1, std::memory_order_relaxed);
+                LOG_WARN("setpoint %lu not acknowledged by the controller", (unsigned long)v);
+            } else {
+                metrics.setpointResends.fetch_add(1, std::memory_order_relaxed);
+                send(rp, v, c);
+            }
+        }
+        if (due) {
+            save(c);
+        }
+    }
+
+    // Form fields setpoint (required), maxLimit, minLimit; empty limits are kept
+    void handlePost(AsyncWebServerRequest* request) {
+        SetpointConfig c = current();
+        AsyncWebParameter* sp = request->getParam("setpoint", true);
+        if (!sp || sp->value().length() == 0 || !parseAngle(request, "setpoint", c.setpoint) ||
+            !parseAngle(request, "minLimit", c.minLimit) || !parseAngle(request, "maxLimit", c.maxLimit)) {
+            request->send(400, "text/plain", "setpoint and limits must be whole degrees 0-180");
+            return;
+        }
+        if (!apply(c)) {
+            request->send(400, "text/plain", "need minLimit <= setpoint <= maxLimit");
+            return;
+        }
+        char body[48];
+        snprintf(body, sizeof(body), "%d [%d, %d]", c.setpoint, c.minLimit, c.maxLimit);
+        request->send(200, "text/plain", body);
+    }
+
+    void handleGet(AsyncWebServerRequest* request) {
+        SetpointConfig c = current();
+        char body[128];
+        snprintf(body, sizeof(body), "{\"setpoint\":%d,\"minLimit\":%d,\"maxLimit\":%d,\"acked\":%s,\"latencyUs\":%lu}",
+                 c.setpoint, c.minLimit, c.maxLimit, acked() ? "true" : "false", (unsigned long)lastLatencyUs.load());
+        request->send(200, "application/json", body);
+    }
+
+    // True once the controller acknowledged the newest edit
+    bool acked() {
+        taskENTER_CRITICAL(&lock);
+        uint32_t v = version;
+        taskEXIT_CRITICAL(&lock);
+        return ackedVersion.load() == v;
+    }
+    uint32_t latencyUs() const { return lastLatencyUs.load(); }
+};
+
+SetpointLink setpoints;
+
+void handleSetpoint(AsyncWebServerRequest* request) {
+    setpoints.handlePost(request);
+}
+
+void handleSetpointGet(AsyncWebServerRequest* request) {
+    setpoints.handleGet(request);
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include <math.h>
+
+// Scrolling strip chart for the TFT, one pixel column per sample, newest on
+// the right. The chart lives in an 8-bit sprite: add() shifts the sprite one
+// column left, draws the newest column only and pushes the sprite, so a
+// sample costs the same however wide the window is; nothing is cleared and
+// redrawn. The last Width samples are also kept in a ring so redraw() can
+// rebuild the picture after the screen was cleared.
+//
+//   StripChart<90, 2> balance(display.screen(), 150, 72, 28, -4095, 4095);
+//   balance.begin();
+//   float lr[2] = {left - right, up - down};
+//   balance.add(lr);
+//
+// Values outside [min, max] are drawn at the edge; NAN leaves a gap.
+template <int Width, int Series = 1>
+class StripChart {
+    static_assert(Width > 1, "a strip chart needs at least two columns");
+    static_assert(Series > 0, "a strip chart needs a series");
+
+private:
+    static const uint16_t background = TFT_BLACK;
+    static const uint16_t gridColor = TFT_DARKGREY;
+
+    TFT_eSprite sprite;
+    int x, y, height;
+    float lo, hi;
+    uint16_t colors[Series];
+    float ring[Width][Series];
+    int head = 0;  // Next slot in ring
+    int count = 0;
+
+    int rowOf(float value) const {
+        float f = (value - lo) / (hi - lo);
+        int row = (int)lroundf((1 - f) * (height - 1));
+        return row < 0 ? 0 : row >= height ? height - 1 : row;
+    }
+
+    // Column `col` for the sample `now` that follows `prev`; each series
+    // is a vertical segment from the previous row to the new one, so steep
+    // changes stay connected
+    void drawColumn(int col, const float* prev, const float* now) {
+        if (lo < 0 && hi > 0) {
+            sprite.drawPixel(col, rowOf(0), gridColor);
+        }
+        for (int s = 0; s < Series; s++) {
+            if (isnan(now[s])) {
+                continue;
+            }
+            int row = rowOf(now[s]);
+            int from = prev && !isnan(prev[s]) ? rowOf(prev[s]) : row;
+            int top = from < row ? from : row;
+            int len = (from < row ? row - from : from - row) + 1;
+            sprite.drawFastVLine(col, top, len, colors[s]);
+        }
+    }
+
+public:
+    StripChart(TFT_eSPI& tft, int x, int y, int height, float min, float max)
+        : sprite(&tft), x(x), y(y), height(height), lo(min), hi(max) {
+        static const uint16_t palette[] = {TFT_YELLOW, TFT_CYAN, TFT_GREEN, TFT_RED};
+        for (int s = 0; s < Series; s++) {
+            colors[s] = palette[s % 4];
+        }
+    }
+
+    // Allocates the sprite (Width * height bytes); false if the heap is short
+    bool begin() {
+        sprite.setColorDepth(8);
+        if (!sprite.createSprite(Width, height)) {
+            return false;
+        }
+        sprite.setScrollRect(0, 0, Width, height, background);
+        redraw();
+        return true;
+    }
+
+    void setColor(int series, uint16_t color) { colors[series] = color; }
+
+    void add(const float (&values)[Series]) {
+        const float* prev = count ? ring[(head + Width - 1) % Width] : nullptr;
+        if (sprite.created()) {
+            sprite.scroll(-1, 0);
+            drawColumn(Width - 1, prev, values);
+            sprite.pushSprite(x, y);
+        }
+        memcpy(ring[head], values, sizeof(ring[head]));
+        head = (head + 1) % Width;
+        if (count < Width) {
+            count++;
+        }
+    }
+
+    void add(float value) {
+        float values[1] = {value};
+        add(values);
+    }
+
+    // Full repaint from the ring, right-aligned like add() leaves it
+    void redraw() {
+        if (!sprite.created()) {
+            return;
+        }
+        sprite.fillSprite(background);
+        int first = (head + Width - count) % Width;
+        for (int i = 0; i < count; i++) {
+            const float* prev = i ? ring[(first + i - 1) % Width] : nullptr;
+            drawColumn(Width - count + i, prev, ring[(first + i) % Width]);
+        }
+        sprite.pushSprite(x, y);
+    }
+
+    int size() const { return count; }
+    const TFT_eSprite& pixels() const { return sprite; }
+};
@@ -0,0 +1,285 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include <esp_task_wdt.h>
+#include <esp_timer.h>
+#include <BinLog.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Per-task deadline supervisor. Each periodic task declares its period and
+// the time one cycle of work may take, then brackets every cycle:
+//
+//   supervisor.begin(id);
+//   supervisor.stage(id, "i2c");     // Optional, names what runs next
+//   ...
+//   supervisor.end(id);
+//   vTaskDelay(...);
+//
+// Three kinds of violation are counted per task, logged with LOG_WARN and
+// reported on /metrics:
+//
+//   budget  a cycle took longer than its budget; the slowest stage is blamed
+//   late    a cycle started more than period + budget after the previous one
+//   stall   a cycle is still running past its budget (seen by the
+//           supervisor task, so a task that never comes back is noticed)
+//
+// The task watchdog stays as the last resort, but only the supervisor task
+// is subscribed to it. It feeds the watchdog while every watched task is
+// alive, and stops once one has been stuck in a cycle, or has not started
+// one, for SUPERVISOR_HANG_PERIODS periods.
+//
+// A task whose rate changes at run time passes its new period to
+// setPeriod(). Around a light sleep, which freezes every task, suspend()
+// and resume() keep the sleep from counting as lateness or a hang.
+
+#define SUPERVISOR_MAX_TASKS 6
+#define SUPERVISOR_CHECK_MS 100
+#define SUPERVISOR_HANG_PERIODS 4
+
+enum DeadlineKind : uint8_t {
+    DEADLINE_BUDGET,
+    DEADLINE_LATE,
+    DEADLINE_STALL,
+    DEADLINE_KINDS
+};
+
+// Latest violation of one task
+struct DeadlineViolation {
+    int64_t atUs;       // esp_timer_get_time() when it was detected, 0 if none yet;
+                        // 64-bit, as micros() wraps every 71.6 min
+    DeadlineKind kind;
+    const char* stage;  // Stage blamed, nullptr if the task names none
+    uint32_t us;        // Cycle time (budget, stall) or lateness (late)
+};
+
+class Supervisor {
+private:
+    struct Watched {
+        const char* name;
+        std::atomic<uint32_t> periodUs;
+        uint32_t budgetUs;
+
+        // Shared between the task and the supervisor task
+        std::atomic<uint32_t> cycleStartUs; // 0 between cycles
+        std::atomic<uint32_t> lastBeginUs;
+        std::atomic<uint32_t> lastEndUs;
+        std::atomic<const char*> stage;
+        std::atomic<bool> stallReported;
+        std::atomic<uint32_t> cycles;
+        std::atomic<uint32_t> violations[DEADLINE_KINDS];
+        std::atomic<uint32_t> maxCycleUs;
+
+        // Owned by the task
+        uint32_t stageStartUs;
+        const char* slowStage;
+        uint32_t slowStageUs;
+    };
+
+    Watched tasks[SUPERVISOR_MAX_TASKS];
+    int ntasks = 0;
+    DeadlineViolation last[SUPERVISOR_MAX_TASKS] = {};
+    portMUX_TYPE lastLock = portMUX_INITIALIZER_UNLOCKED;
+    std::atomic<uint32_t> suspendedUs{0}; // stamp() of suspend(), 0 while running
+
+    static uint32_t stamp() {
+        uint32_t now = micros();
+        return now ? now : 1; // 0 means "not set"
+    }
+
+    void record(int id, DeadlineKind kind, const char* stage, uint32_t us) {
+        Watched& t = tasks[id];
+        t.violations[kind].fetch_add(1, std::memory_order_relaxed);
+        int64_t at = esp_timer_get_time();
+        DeadlineViolation v = {at ? at : 1, kind, stage, us};
+        taskENTER_CRITICAL(&lastLock);
+        last[id] = v;
+        taskEXIT_CRITICAL(&lastLock);
+        LOG_WARN("deadline %s %s %lu us in %s", t.name, kindName(kind), (unsigned long)us, stage ? stage : "-");
+    }
+
+    // Ends the running stage and remembers it if it is the slowest so far
+    void closeStage(Watched& t, uint32_t now) {
+        const char* running = t.stage.load(std::memory_order_relaxed);
+        uint32_t us = now - t.stageStartUs;
+        if (running && us >= t.slowStageUs) {
+            t.slowStage = running;
+            t.slowStageUs = us;
+        }
+        t.stageStartUs = now;
+    }
+
+    static void task(void* arg) {
+        Supervisor* s = (Supervisor*)arg;
+        esp_task_wdt_add(NULL);
+        for (;;) {
+            if (s->check()) {
+                esp_task_wdt_reset();
+            }
+            vTaskDelay(pdMS_TO_TICKS(SUPERVISOR_CHECK_MS));
+        }
+    }
+
+public:
+    static const char* kindName(DeadlineKind kind) {
+        static const char* const names[DEADLINE_KINDS] = {"budget", "late", "stall"};
+        return names[kind];
+    }
+
+    // Declares a task; call from setup() before the task runs. Returns the
+    // id for begin()/stage()/end(), or -1 if the table is full.
+    int watch(const char* name, uint32_t periodMs, uint32_t budgetMs) {
+        if (ntasks == SUPERVISOR_MAX_TASKS) {
+            return -1;
+        }
+        Watched& t = tasks[ntasks];
+        t.name = name;
+        t.periodUs = periodMs * 1000;
+        t.budgetUs = budgetMs * 1000;
+        t.cycleStartUs = 0;
+        t.lastBeginUs = 0;
+        t.lastEndUs = 0;
+        t.stage = nullptr;
+        t.stallReported = false;
+        t.cycles = 0;
+        for (int k = 0; k < DEADLINE_KINDS; k++) {
+            t.violations[k] = 0;
+        }
+        t.maxCycleUs = 0;
+        return ntasks++;
+    }
+
+    void begin(int id) {
+        if (id < 0) {
+            return;
+        }
+        Watched& t = tasks[id];
+        uint32_t now = stamp();
+        uint32_t prev = t.lastBeginUs.load(std::memory_order_relaxed);
+        uint32_t period = t.periodUs.load(std::memory_order_relaxed);
+        if (prev && now - prev > period + t.budgetUs) {
+            record(id, DEADLINE_LATE, nullptr, now - prev - period);
+        }
+        t.stage.store(nullptr, std::memory_order_relaxed);
+        t.stageStartUs = now;
+        t.slowStage = nullptr;
+        t.slowStageUs = 0;
+        t.stallReported.store(false, std::memory_order_relaxed);
+        t.lastBeginUs.store(now, std::memory_order_relaxed);
+        t.cycleStartUs.store(now, std::memory_order_release);
+    }
+
+    void stage(int id, const char* name) {
+        if (id < 0) {
+            return;
+        }
+        Watched& t = tasks[id];
+        closeStage(t, micros());
+        t.stage.store(name, std::memory_order_relaxed);
+    }
+
+    void end(int id) {
+        if (id < 0) {
+            return;
+        }
+        Watched& t = tasks[id];
+        uint32_t now = micros();
+        uint32_t start = t.cycleStartUs.exchange(0, std::memory_order_acq_rel);
+        if (!start) {
+            return;
+        }
+        closeStage(t, now);
+        t.lastEndUs.store(now ? now : 1, std::memory_order_relaxed);
+        uint32_t us = now - start;
+        t.cycles.fetch_add(1, std::memory_order_relaxed);
+        if (us > t.maxCycleUs.load(std::memory_order_relaxed)) {
+            t.maxCycleUs.store(us, std::memory_order_relaxed);
+        }
+        // A stall already reported this cycle is the same violation
+        if (us > t.budgetUs && !t.stallReported.load(std::memory_order_relaxed)) {
+            record(id, DEADLINE_BUDGET, t.slowStage, us);
+        }
+    }
+
+    // Looks for tasks stuck past their budget; true while every task is
+    // alive enough for the watchdog to be fed. Run by the supervisor task.
+    bool check() {
+        if (suspendedUs.load()) {
+            return true;
+        }
+        uint32_t now = micros();
+        bool healthy = true;
+        for (int id = 0; id < ntasks; id++) {
+            Watched& t = tasks[id];
+            uint32_t start = t.cycleStartUs.load(std::memory_order_acquire);
+            uint32_t hangUs = SUPERVISOR_HANG_PERIODS * t.periodUs.load(std::memory_order_relaxed);
+            if (start) {
+                uint32_t us = now - start;
+                if (us > t.budgetUs && !t.stallReported.exchange(true, std::memory_order_relaxed)) {
+                    record(id, DEADLINE_STALL, t.stage.load(std::memory_order_relaxed), us);
+                }
+                if (us > hangUs) {
+                    healthy = false;
+                }
+            } else {
+                uint32_t ended = t.lastEndUs.load(std::memory_order_relaxed);
+                if (ended && now - ended > hangUs) {
+                    healthy = false;
+                }
+            }
+        }
+        return healthy;
+    }
+
+    // New period for a task that changes its rate; takes effect from its
+    // next begin()
+    void setPeriod(int id, uint32_t periodMs) {
+        if (id >= 0) {
+            tasks[id].periodUs.store(periodMs * 1000, std::memory_order_relaxed);
+        }
+    }
+
+    // Call right before a light sleep; check() passes until resume()
+    void suspend() { suspendedUs.store(stamp()); }
+
+    // Call right after waking: every stamp is moved on by the time slept,
+    // as if the tasks had not been frozen
+    void resume() {
+        uint32_t from = suspendedUs.load();
+        if (!from) {
+            return;
+        }
+        uint32_t slept = micros() - from;
+        for (int id = 0; id < ntasks; id++) {
+            Watched& t = tasks[id];
+            std::atomic<uint32_t>* stamps[] = {&t.cycleStartUs, &t.lastBeginUs, &t.lastEndUs};
+            for (std::atomic<uint32_t>* a : stamps) {
+                uint32_t v = a->load();
+                while (v && !a->compare_exchange_weak(v, (v + slept) ? v + slept : 1)) {
+                }
+            }
+        }
+        suspendedUs.store(0);
+    }
+
+    // Starts the supervisor task, which takes over the task watchdog
+    bool start(UBaseType_t priority = 2, BaseType_t core = 1) {
+        return xTaskCreatePinnedToCore(task, "Supervisor", 2048, this, priority, nullptr, core) == pdPASS;
+    }
+
+    int count() const { return ntasks; }
+    const char* name(int id) const { return tasks[id].name; }
+    uint32_t cycles(int id) const { return tasks[id].cycles.load(std::memory_order_relaxed); }
+    uint32_t violations(int id, DeadlineKind kind) const {
+        return tasks[id].violations[kind].load(std::memory_order_relaxed);
+    }
+    uint32_t maxCycleUs(int id) const { return tasks[id].maxCycleUs.load(std::memory_order_relaxed); }
+    DeadlineViolation lastViolation(int id) {
+        taskENTER_CRITICAL(&lastLock);
+        DeadlineViolation v = last[id];
+        taskEXIT_CRITICAL(&lastLock);
+        return v;
+    }
+};
+
+Supervisor supervisor;
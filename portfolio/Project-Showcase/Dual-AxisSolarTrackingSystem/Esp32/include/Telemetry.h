@@ -0,0 +1,129 @@
+#pragma once
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <atomic>
+#include <math.h>
+#include "Metrics.h"
+
+// Field telemetry: one small binary datagram per sample, multicast so a
+// collector (Linux/telemcollect) hears every tracker on the segment without
+// knowing their addresses, and without a connection per tracker.
+//
+//   telemetry.begin(IPAddress(239, 255, 42, 1), TELEMETRY_PORT, 1000);
+//   telemetry.setClimate(temperature, humidity);   // Sensor task
+//   telemetry.publish(light, n, brightest);        // Loop, after sampling
+//
+// publish() sends at most one datagram per period and only while the
+// station has an address; it never blocks on the network. The layout is
+// Linux/telemetry.h (struct telem_v1), little-endian, written byte by byte
+// here so it does not depend on the compiler's struct packing:
+//
+//   0 magic u16   2 version u8   3 nlight u8   4 device u32   8 seq u32
+//  12 uptime_ms u32   16 temp_centi i16   18 humidity_centi u16
+//  20 light u16[8]   36 direction u8   37 rssi i8   38 reserved u16
+
+#define TELEMETRY_MAGIC 0x5354
+#define TELEMETRY_VERSION 1
+#define TELEMETRY_PORT 5005
+#define TELEMETRY_SIZE 40
+#define TELEMETRY_MAX_LIGHT 8
+#define TELEMETRY_NO_TEMP INT16_MIN
+#define TELEMETRY_NO_HUMIDITY UINT16_MAX
+
+class Telemetry {
+private:
+    WiFiUDP udp;
+    IPAddress group;
+    uint16_t port = TELEMETRY_PORT;
+    uint32_t periodMs = 1000;
+    uint32_t device = 0;
+    uint32_t seq = 0;
+    uint32_t lastMs = 0;
+    bool started = false;
+    bool sentAny = false;
+
+    // Written by the sensor task
+    std::atomic<int16_t> tempCenti{TELEMETRY_NO_TEMP};
+    std::atomic<uint16_t> humidityCenti{TELEMETRY_NO_HUMIDITY};
+
+    static void put16(uint8_t* p, uint16_t v) {
+        p[0] = v;
+        p[1] = v >> 8;
+    }
+
+    static void put32(uint8_t* p, uint32_t v) {
+        put16(p, v);
+        put16(p + 2, v >> 16);
+    }
+
+public:
+    // The device id is the last four bytes of the factory MAC, which is
+    // what tells trackers apart (the first three are Espressif's OUI).
+    void begin(IPAddress group, uint16_t port = TELEMETRY_PORT, uint32_t periodMs = 1000) {
+        this->group = group;
+        this->port = port;
+        this->periodMs = periodMs;
+        device = (uint32_t)(ESP.getEfuseMac() >> 16);
+        seq = 0;
+        sentAny = false;
+        started = true;
+    }
+
+    // Latest climate reading; NAN (no sensor) is sent as "missing"
+    void setClimate(float temperature, float humidity) {
+        tempCenti.store(isnan(temperature) ? TELEMETRY_NO_TEMP : (int16_t)lroundf(temperature * 100),
+                        std::memory_order_relaxed);
+        humidityCenti.store(isnan(humidity) ? TELEMETRY_NO_HUMIDITY : (uint16_t)lroundf(humidity * 100),
+                            std::memory_order_relaxed);
+    }
+
+    // Fills buf with the next datagram; light beyond TELEMETRY_MAX_LIGHT is cut
+    void encode(uint8_t (&buf)[TELEMETRY_SIZE], const int* light, size_t n, size_t direction, int8_t rssi,
+                uint32_t uptimeMs) const {
+        if (n > TELEMETRY_MAX_LIGHT) {
+            n = TELEMETRY_MAX_LIGHT;
+        }
+        memset(buf, 0, sizeof(buf));
+        put16(buf, TELEMETRY_MAGIC);
+        buf[2] = TELEMETRY_VERSION;
+        buf[3] = n;
+        put32(buf + 4, device);
+        put32(buf + 8, seq);
+        put32(buf + 12, uptimeMs);
+        put16(buf + 16, (uint16_t)tempCenti.load(std::memory_order_relaxed));
+        put16(buf + 18, humidityCenti.load(std::memory_order_relaxed));
+        for (size_t i = 0; i < n; i++) {
+            put16(buf + 20 + 2 * i, (uint16_t)light[i]);
+        }
+        buf[36] = direction;
+        buf[37] = (uint8_t)rssi;
+    }
+
+    // Sends one datagram if a period has passed since the last one. Returns
+    // true if a datagram went out.
+    bool publish(const int* light, size_t n, size_t direction) {
+        uint32_t now = millis();
+        if (!started || WiFi.status() != WL_CONNECTED || (sentAny && now - lastMs < periodMs)) {
+            return false;
+        }
+        // Keep the cadence of the period rather than drifting by loop jitter
+        lastMs = sentAny && now - lastMs < 2 * periodMs ? lastMs + periodMs : now;
+        sentAny = true;
+
+        uint8_t buf[TELEMETRY_SIZE];
+        encode(buf, light, n, direction, WiFi.RSSI(), now);
+        seq++; // A failed send is a gap the collector counts as lost
+        if (!udp.beginPacket(group, port) || udp.write(buf, sizeof(buf)) != sizeof(buf) || !udp.endPacket()) {
+            metrics.telemetryFailed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        metrics.telemetrySent.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    uint32_t deviceId() const { return device; }
+    uint32_t sequence() const { return seq; }
+};
+
+Telemetry telemetry;
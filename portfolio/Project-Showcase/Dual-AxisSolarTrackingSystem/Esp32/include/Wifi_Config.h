@@ -1,42 +1,213 @@
 #pragma once
 #include <WiFi.h>
-#include <esp_task_wdt.h>
-#include "DisplayHandler.h"
-#include <WiFi.h>
-#include <TFT_eSPI.h>
+#include <Preferences.h>
+#include <atomic>
+#include <BinLog.h>
+#include "Displayhandler.h"
+#include "BootTimeline.h"
+#include "Metrics.h"
+
+#define WIFI_BACKOFF_MIN_MS 1000
+#define WIFI_BACKOFF_MAX_MS 32000
+#define WIFI_ATTEMPT_TIMEOUT_MS 15000 // Attempt that produced no event at all
 
 // Create an instance of the DisplayHandler class
 DisplayHandler display;
 
+// Optional fixed address; skips the DHCP exchange on every (re)connect
+struct WifiStaticIp {
+    IPAddress ip, gateway, subnet, dns;
+};
 
-// Initialize WiFi configuration
-void HandleWiFi_init(const char* ssid, const char* password) {
-    esp_task_wdt_add(NULL);   // Add the task to watchdog monitoring
-    
-    display.initDisplay();    // Initialize display once
-    
-    WiFi.begin(ssid, password);  // Start WiFi connection
-    display.showMessage("Connecting to WiFi...", 10, 20);  // Show message on display
-
-    int dots = 0;  // To cycle dots on the display while connecting
-    while (WiFi.status() != WL_CONNECTED) {
-        String statusMsg = "Status: ";
-        
-        // Add dots to status message to indicate progress
-        for (int i = 0; i < dots; i++) {
-            statusMsg += ".";
-        }
-        
-        // Display connection status with dots cycling
-        display.showMessage(statusMsg.c_str(), 10, 50);  
-        dots = (dots + 1) % 4;  // Cycle dots (0 to 3)
-        
-        delay(1000);  // Wait for a second before retrying
-        yield();      // Allow other tasks to run and reset the watchdog
-    }
-    display.Clear();
-    // When WiFi is connected, display the connection success message
-    String ipMessage = "WiFi Connected!\nIP: " + WiFi.localIP().toString();
-    display.showMessage(ipMessage.c_str(), 0, 0);  // Clear and display the final message
+// Event-driven station link. begin() starts the first attempt and returns at
+// once, so sensing, the RP link and the web server come up without waiting
+// for the access point. The Wi-Fi driver reports progress through
+// WiFi.onEvent() on its own task; the handler only records what happened,
+// and poll(), called from loop(), acts on it: it redraws the status line,
+// saves the AP for the next boot and schedules reconnects with backoff.
+//
+// Fast reconnect: the BSSID and channel of the last AP that gave us an
+// address are kept in NVS and passed to WiFi.begin(), which lets the driver
+// skip the all-channel scan. If such an attempt fails (hotspot restarted on
+// another channel) the cache is dropped and the next attempt scans.
+class WifiLink {
+private:
+    const char* ssid = nullptr;
+    const char* password = nullptr;
+
+    // Written by the event task
+    std::atomic<bool> up{false};
+    std::atomic<bool> failed{false};  // Disconnected since the last poll()
+    std::atomic<bool> changed{false}; // Status line needs a redraw
+    std::atomic<uint8_t> lastReason{0};
+    uint8_t apBssid[6] = {0};
+    uint8_t apChannel = 0;
+
+    // Owned by poll()
+    uint8_t cachedBssid[6] = {0};
+    uint8_t cachedChannel = 0;       // 0: nothing cached
+    bool connecting = false;
+    bool fastAttempt = false;
+    bool saved = false;
+    uint32_t attemptStartMs = 0;
+    uint32_t retryAtMs = 0;
+    uint32_t backoffMs = WIFI_BACKOFF_MIN_MS;
+    uint32_t attempts = 0;
+
+    void onEvent(arduino_event_id_t event, arduino_event_info_t info) {
+        switch (event) {
+        case ARDUINO_EVENT_WIFI_STA_CONNECTED:
+            memcpy(apBssid, info.wifi_sta_connected.bssid, sizeof(apBssid));
+            apChannel = info.wifi_sta_connected.channel;
+            break;
+        case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+            bootTimeline.mark(BOOT_WIFI_UP);
+            up = true;
+            changed = true;
+            break;
+        case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+            lastReason = info.wifi_sta_disconnected.reason;
+            up = false;
+            failed = true;
+            changed = true;
+            break;
+        default:
+            break;
+        }
+    }
+
+    void loadAp() {
+        Preferences prefs;
+        cachedChannel = 0;
+        if (!prefs.begin("wifi", true)) {
+            return;
+        }
+        if (prefs.getString("ssid") == ssid && prefs.getBytes("bssid", cachedBssid, sizeof(cachedBssid)) == 6) {
+            cachedChannel = prefs.getUChar("chan", 0);
+        }
+        prefs.end();
+    }
+
+    // Only written when the AP changed, to spare the flash
+    void saveAp() {
+        if (cachedChannel == apChannel && memcmp(cachedBssid, apBssid, sizeof(apBssid)) == 0) {
+            return;
+        }
+        Preferences prefs;
+        if (!prefs.begin("wifi", false)) {
+            return;
+        }
+        prefs.putString("ssid", ssid);
+        prefs.putBytes("bssid", apBssid, sizeof(apBssid));
+        prefs.putUChar("chan", apChannel);
+        prefs.end();
+        memcpy(cachedBssid, apBssid, sizeof(apBssid));
+        cachedChannel = apChannel;
+    }
+
+    void forgetAp() {
+        Preferences prefs;
+        if (prefs.begin("wifi", false)) {
+            prefs.clear();
+            prefs.end();
+        }
+        cachedChannel = 0;
+    }
+
+    void connect(uint32_t nowMs) {
+        fastAttempt = cachedChannel != 0;
+        if (fastAttempt) {
+            WiFi.begin(ssid, password, cachedChannel, cachedBssid);
+        } else {
+            WiFi.begin(ssid, password);
+        }
+        connecting = true;
+        attemptStartMs = nowMs;
+        attempts++;
+        metrics.wifiAttempts.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void showStatus(DisplayHandler& display) {
+        // Padded to the full width so a shorter status overwrites a longer one
+        char state[24], line[41];
+        if (up) {
+            snprintf(state, sizeof(state), "%s", WiFi.localIP().toString().c_str());
+        } else {
+            snprintf(state, sizeof(state), "connecting (%lu)", (unsigned long)attempts);
+        }
+        snprintf(line, sizeof(line), "WiFi: %-34s", state);
+        display.showMessage(line, 0, 0);
+    }
+
+public:
+    void begin(const char* ssid, const char* password, const WifiStaticIp* staticIp = nullptr) {
+        this->ssid = ssid;
+        this->password = password;
+        loadAp();
+
+        WiFi.persistent(false);       // Credentials come from the firmware; don't rewrite them to flash
+        WiFi.mode(WIFI_STA);
+        WiFi.setAutoReconnect(false); // poll() owns the retry policy
+        if (staticIp) {
+            WiFi.config(staticIp->ip, staticIp->gateway, staticIp->subnet, staticIp->dns);
+        }
+        WiFi.onEvent([this](arduino_event_id_t event, arduino_event_info_t info) { onEvent(event, info); });
+        connect(millis());
+    }
+
+    void poll(DisplayHandler& display) {
+        uint32_t now = millis();
 
+        if (changed.exchange(false)) {
+            showStatus(display);
+        }
+        if (up) {
+            if (connecting) {
+                connecting = false;
+                fastAttempt = false;
+                backoffMs = WIFI_BACKOFF_MIN_MS;
+                LOG_INFO("wifi up %s after %lu attempt(s)", WiFi.localIP().toString(), (unsigned long)attempts);
+            }
+            if (!saved) {
+                saveAp();
+                saved = true;
+            }
+            return;
+        }
+
+        // A disconnect we caused ourselves (timeout below) is not a new failure
+        bool dropped = failed.exchange(false) && (connecting || saved);
+        bool timedOut = connecting && now - attemptStartMs >= WIFI_ATTEMPT_TIMEOUT_MS;
+        if (dropped || timedOut) {
+            metrics.wifiDisconnects.fetch_add(1, std::memory_order_relaxed);
+            LOG_WARN("wifi down reason %u, retry in %lu ms", (unsigned)lastReason.load(), (unsigned long)backoffMs);
+            if (connecting && fastAttempt) {
+                forgetAp(); // The cached AP did not answer; scan next time
+            }
+            if (timedOut) {
+                WiFi.disconnect();
+            }
+            connecting = false;
+            saved = false;
+            retryAtMs = now + backoffMs;
+            backoffMs = backoffMs * 2 > WIFI_BACKOFF_MAX_MS ? WIFI_BACKOFF_MAX_MS : backoffMs * 2;
+        }
+        if (!connecting && (int32_t)(now - retryAtMs) >= 0) {
+            connect(now);
+            showStatus(display);
+        }
+    }
+
+    bool connected() const { return up; }
+    uint32_t attemptCount() const { return attempts; }
+};
+
+WifiLink wifiLink;
+
+// Initialize the display and start connecting; returns immediately.
+// Call wifiLink.poll(display) from loop() to keep the link up.
+void HandleWiFi_init(const char* ssid, const char* password, const WifiStaticIp* staticIp = nullptr) {
+    display.initDisplay();    // Initialize display once
+    display.showMessage("WiFi: connecting", 0, 0);
+    wifiLink.begin(ssid, password, staticIp);
 }
@@ -0,0 +1,251 @@
+#include "BinLog.h"
+
+BinLog binlog;
+
+static uint8_t crc8(const uint8_t* data, size_t len) {
+    uint8_t crc = 0;
+    while (len--) {
+        crc ^= *data++;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+BinLog::BinLog() {
+    for (uint32_t i = 0; i < LOG_SLOTS; i++) {
+        ring[i].seq.store(i, std::memory_order_relaxed);
+    }
+    for (int i = 0; i < LOG_MAX_SITES; i++) {
+        sites[i].store(nullptr, std::memory_order_relaxed);
+    }
+    reannounce();
+}
+
+void BinLog::reannounce() {
+    memset(announced, 0, sizeof(announced));
+}
+
+// Slow path, once per call site. Two tasks racing here both get an id; the
+// loser's id stays valid and points at the same site.
+uint16_t BinLog::enroll(LogSite& site, const char* types) {
+    uint16_t id = nextId.fetch_add(1, std::memory_order_relaxed);
+    if (id >= LOG_MAX_SITES) {
+        nextId.store(LOG_MAX_SITES, std::memory_order_relaxed);
+        return 0;
+    }
+    strncpy(site.types, types, LOG_MAX_ARGS);
+    site.types[LOG_MAX_ARGS] = '\0';
+    sites[id].store(&site, std::memory_order_release);
+
+    uint16_t unset = 0;
+    if (!site.id.compare_exchange_strong(unset, id, std::memory_order_acq_rel)) {
+        return unset;
+    }
+    return id;
+}
+
+bool BinLog::start(Print& out, bool text, UBaseType_t priority, BaseType_t core) {
+    this->out = &out;
+    this->text = text;
+    return xTaskCreatePinnedToCore(task, "BinLog", 3072, this, priority, &drainer, core) == pdPASS;
+}
+
+size_t BinLog::drain(Print& out, bool text) {
+    size_t n = 0;
+
+    uint32_t lost = droppedPending.exchange(0, std::memory_order_relaxed);
+    if (lost) {
+        emitRecord(out, 0, micros(), (const uint8_t*)&lost, sizeof(lost), text);
+    }
+
+    for (;;) {
+        Slot* s = &ring[tail & (LOG_SLOTS - 1)];
+        if (s->seq.load(std::memory_order_acquire) != tail + 1) {
+            break;
+        }
+        uint16_t id = s->id;
+        uint32_t us = s->us;
+        uint8_t len = s->len;
+        uint8_t args[LOG_ARG_BYTES];
+        memcpy(args, s->args, len);
+        s->seq.store(tail + LOG_SLOTS, std::memory_order_release); // Free for the producer one lap on
+        tail++;
+
+        emitRecord(out, id, us, args, len, text);
+        n++;
+    }
+    return n;
+}
+
+void BinLog::emitDefinition(Print& out, uint16_t id, const LogSite& site) {
+    uint8_t frame[2 + 255 + 1];
+    uint8_t* p = frame + 2;
+    size_t ntypes = strlen(site.types);
+    size_t fmtLen = strlen(site.fmt);
+    if (fmtLen > 255 - 4 - ntypes) {
+        fmtLen = 255 - 4 - ntypes;
+    }
+
+    *p++ = id & 0xFF;
+    *p++ = id >> 8;
+    *p++ = site.level;
+    *p++ = (uint8_t)ntypes;
+    memcpy(p, site.types, ntypes);
+    p += ntypes;
+    memcpy(p, site.fmt, fmtLen);
+    p += fmtLen;
+
+    frame[0] = LOG_MAGIC_DEFINE;
+    frame[1] = (uint8_t)(p - frame - 2);
+    *p = crc8(frame + 1, p - frame - 1);
+    out.write(frame, p - frame + 1);
+}
+
+void BinLog::emitRecord(Print& out, uint16_t id, uint32_t us, const uint8_t* args, uint8_t len, bool text) {
+    LogSite* site = id ? sites[id].load(std::memory_order_acquire) : nullptr;
+
+    if (text) {
+        char line[160];
+        int n = snprintf(line, sizeof(line), "%lu.%03lu %c ", (unsigned long)(us / 1000000),
+                         (unsigned long)(us / 1000 % 1000), site ? levelLetter(site->level) : 'W');
+        if (site) {
+            n += logFormat(line + n, sizeof(line) - n - 1, site->fmt, site->types, args, len);
+        } else {
+            uint32_t lost;
+            memcpy(&lost, args, sizeof(lost));
+            n += snprintf(line + n, sizeof(line) - n - 1, "log: %lu records dropped", (unsigned long)lost);
+        }
+        if (n > (int)sizeof(line) - 2) {
+            n = sizeof(line) - 2;
+        }
+        line[n++] = '\n';
+        out.write((const uint8_t*)line, n);
+        return;
+    }
+
+    if (site && !(announced[id / 32] & (1u << (id % 32)))) {
+        announced[id / 32] |= 1u << (id % 32);
+        emitDefinition(out, id, *site);
+    }
+
+    uint8_t frame[2 + 6 + LOG_ARG_BYTES + 1];
+    uint8_t* p = frame + 2;
+    *p++ = id & 0xFF;
+    *p++ = id >> 8;
+    memcpy(p, &us, 4);
+    p += 4;
+    memcpy(p, args, len);
+    p += len;
+    frame[0] = LOG_MAGIC_RECORD;
+    frame[1] = (uint8_t)(p - frame - 2);
+    *p = crc8(frame + 1, p - frame - 1);
+    out.write(frame, p - frame + 1);
+}
+
+// printf with the arguments taken from a record. Each conversion is passed
+// to snprintf on its own, with the length modifier replaced to match how the
+// value was stored, so "%lu" and "%u" both work for a 'u' argument.
+size_t logFormat(char* out, size_t cap, const char* fmt, const char* types, const uint8_t* args, size_t len) {
+    const uint8_t* end = args + len;
+    size_t n = 0;
+
+    while (*fmt && n + 1 < cap) {
+        if (*fmt != '%') {
+            out[n++] = *fmt++;
+            continue;
+        }
+        if (fmt[1] == '%') {
+            out[n++] = '%';
+            fmt += 2;
+            continue;
+        }
+
+        // %[flags][width][.precision][length]conversion, without the length
+        char spec[24];
+        size_t k = 0;
+        spec[k++] = *fmt++;
+        while (*fmt && strchr("-+ #0123456789.", *fmt) && k < sizeof(spec) - 4) {
+            spec[k++] = *fmt++;
+        }
+        while (*fmt && strchr("hlLqjzt", *fmt)) {
+            fmt++;
+        }
+        char conv = *fmt ? *fmt++ : 's';
+
+        // Next argument, widened
+        char type = *types ? *types++ : 0;
+        long long i = 0;
+        double f = 0;
+        char s[LOG_ARG_BYTES + 1] = "";
+        if (type == 's' && args < end) {
+            size_t sl = *args++;
+            if (sl > (size_t)(end - args)) {
+                sl = end - args;
+            }
+            memcpy(s, args, sl);
+            s[sl] = '\0';
+            args += sl;
+        } else if (type && end - args >= 4) {
+            if (type == 'f') {
+                float v;
+                memcpy(&v, args, 4);
+                i = (long long)v;
+                f = v;
+            } else if (type == 'u') {
+                uint32_t v;
+                memcpy(&v, args, 4);
+                i = v;
+                f = v;
+            } else {
+                int32_t v;
+                memcpy(&v, args, 4);
+                i = v;
+                f = v;
+            }
+            args += 4;
+        }
+
+        int w;
+        if (strchr("diouxX", conv)) {
+            spec[k++] = 'l';
+            spec[k++] = 'l';
+            spec[k++] = conv;
+            spec[k] = '\0';
+            w = snprintf(out + n, cap - n, spec, i);
+        } else if (conv == 'c') {
+            spec[k++] = 'c';
+            spec[k] = '\0';
+            w = snprintf(out + n, cap - n, spec, (int)i);
+        } else if (strchr("fFeEgGaA", conv)) {
+            spec[k++] = conv;
+            spec[k] = '\0';
+            w = snprintf(out + n, cap - n, spec, f);
+        } else {
+            spec[k++] = 's';
+            spec[k] = '\0';
+            w = snprintf(out + n, cap - n, spec, s);
+        }
+        if (w > 0) {
+            n += (size_t)w < cap - n ? (size_t)w : cap - n - 1;
+        }
+    }
+    out[n] = '\0';
+    return n;
+}
+
+void BinLog::task(void* arg) {
+    BinLog* log = (BinLog*)arg;
+    uint32_t lastAnnounce = millis();
+
+    for (;;) {
+        if (millis() - lastAnnounce >= LOG_REANNOUNCE_MS) {
+            log->reannounce();
+            lastAnnounce = millis();
+        }
+        if (!log->drain(*log->out, log->text)) {
+            vTaskDelay(pdMS_TO_TICKS(20));
+        }
+    }
+}
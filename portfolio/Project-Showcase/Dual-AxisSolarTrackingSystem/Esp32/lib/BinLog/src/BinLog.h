@@ -0,0 +1,234 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Leveled binary log. A LOG_*() call stores a fixed 48-byte record (call
+// site id, micros() and the raw argument values) in a lock-free ring and
+// returns; no formatting and no UART on the caller's task. A low-priority
+// drain task empties the ring to Serial as binary frames, which
+// Linux/logdecode turns back into text:
+//
+//   LOG_INFO("trace %lu cap %lu tx %lu", id, cap, tx);
+//
+// Levels below LOG_LEVEL are compiled out, arguments included. Build with
+// -DLOG_TEXT=1 to have the drain task print plain text instead, for a bare
+// serial monitor.
+//
+// Call sites are numbered on first use. The drain task sends a site's
+// definition (level, argument types, format string) before its first
+// record, and again every LOG_REANNOUNCE_MS so a decoder attached late
+// catches up.
+//
+// Wire format, little-endian, crc8 (poly 0x31) over len and payload:
+//
+//   0xA5 len id:u16 us:u32 args...                       record
+//   0xA6 len id:u16 level:u8 ntypes:u8 types... format   definition
+//
+// Argument types: 'i' int32, 'u' uint32, 'f' float, 's' u8 length + bytes.
+// Record id 0 carries one 'u': the number of records dropped because the
+// ring was full.
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+#ifndef LOG_TEXT
+#define LOG_TEXT 0
+#endif
+
+#define LOG_SLOTS 128          // Power of two
+#define LOG_ARG_BYTES 36       // Per record; longer strings are truncated
+#define LOG_MAX_ARGS 8
+#define LOG_MAX_SITES 128
+#define LOG_REANNOUNCE_MS 60000
+
+#define LOG_MAGIC_RECORD 0xA5
+#define LOG_MAGIC_DEFINE 0xA6
+
+struct LogSite {
+    const char* fmt;
+    uint8_t level;
+    std::atomic<uint16_t> id;       // 0 until first use
+    char types[LOG_MAX_ARGS + 1];
+};
+
+// Argument encoding, picked by overload so a call site's types are fixed at
+// compile time
+inline char logTypeOf(bool) { return 'i'; }
+inline char logTypeOf(char) { return 'i'; }
+inline char logTypeOf(signed char) { return 'i'; }
+inline char logTypeOf(short) { return 'i'; }
+inline char logTypeOf(int) { return 'i'; }
+inline char logTypeOf(long) { return 'i'; }
+inline char logTypeOf(unsigned char) { return 'u'; }
+inline char logTypeOf(unsigned short) { return 'u'; }
+inline char logTypeOf(unsigned int) { return 'u'; }
+inline char logTypeOf(unsigned long) { return 'u'; }
+inline char logTypeOf(float) { return 'f'; }
+inline char logTypeOf(double) { return 'f'; }
+inline char logTypeOf(const char*) { return 's'; }
+inline char logTypeOf(const String&) { return 's'; }
+
+inline void logPut32(uint8_t*& p, uint8_t* end, const void* v) {
+    if (end - p >= 4) {
+        memcpy(p, v, 4);
+        p += 4;
+    }
+}
+inline void logPut(uint8_t*& p, uint8_t* end, long v) { int32_t x = (int32_t)v; logPut32(p, end, &x); }
+inline void logPut(uint8_t*& p, uint8_t* end, int v) { logPut(p, end, (long)v); }
+inline void logPut(uint8_t*& p, uint8_t* end, bool v) { logPut(p, end, (long)v); }
+inline void logPut(uint8_t*& p, uint8_t* end, char v) { logPut(p, end, (long)v); }
+inline void logPut(uint8_t*& p, uint8_t* end, signed char v) { logPut(p, end, (long)v); }
+inline void logPut(uint8_t*& p, uint8_t* end, short v) { logPut(p, end, (long)v); }
+inline void logPut(uint8_t*& p, uint8_t* end, unsigned long v) { uint32_t x = (uint32_t)v; logPut32(p, end, &x); }
+inline void logPut(uint8_t*& p, uint8_t* end, unsigned int v) { logPut(p, end, (unsigned long)v); }
+inline void logPut(uint8_t*& p, uint8_t* end, unsigned short v) { logPut(p, end, (unsigned long)v); }
+inline void logPut(uint8_t*& p, uint8_t* end, unsigned char v) { logPut(p, end, (unsigned long)v); }
+inline void logPut(uint8_t*& p, uint8_t* end, double v) { float x = (float)v; logPut32(p, end, &x); }
+inline void logPut(uint8_t*& p, uint8_t* end, float v) { logPut32(p, end, &v); }
+inline void logPut(uint8_t*& p, uint8_t* end, const char* s) {
+    if (p == end) {
+        return;
+    }
+    size_t n = s ? strnlen(s, end - p - 1) : 0;
+    *p++ = (uint8_t)n;
+    memcpy(p, s, n);
+    p += n;
+}
+inline void logPut(uint8_t*& p, uint8_t* end, const String& s) { logPut(p, end, s.c_str()); }
+
+class BinLog {
+public:
+    BinLog();
+
+    template <typename... Args>
+    void write(LogSite& site, const Args&... args) {
+        uint16_t id = site.id.load(std::memory_order_acquire);
+        if (!id) {
+            const char types[] = {logTypeOf(args)..., '\0'};
+            id = enroll(site, types);
+            if (!id) {
+                return;
+            }
+        }
+        Slot* s = reserve();
+        if (!s) {
+            return;
+        }
+        s->id = id;
+        s->us = micros();
+        uint8_t* p = s->args;
+        uint8_t* end = s->args + LOG_ARG_BYTES;
+        int expand[] = {0, (logPut(p, end, args), 0)...};
+        (void)expand;
+        (void)end;
+        s->len = (uint8_t)(p - s->args);
+        commit(s);
+    }
+
+    // Starts the drain task writing to `out`
+    bool start(Print& out, bool text = LOG_TEXT, UBaseType_t priority = 1, BaseType_t core = 0);
+
+    // Moves everything queued so far to `out`; returns the number of records
+    size_t drain(Print& out, bool text);
+    // Makes the next record of every site carry its definition again
+    void reannounce();
+
+    uint32_t dropped() const { return droppedTotal.load(std::memory_order_relaxed); }
+    TaskHandle_t drainTask() const { return drainer; }
+    static char levelLetter(uint8_t level) { return level <= LOG_LEVEL_DEBUG ? "-EWID"[level] : '?'; }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> seq;
+        uint16_t id;
+        uint8_t len;
+        uint32_t us;
+        uint8_t args[LOG_ARG_BYTES];
+    };
+
+    Slot ring[LOG_SLOTS];
+    std::atomic<uint32_t> head{0};
+    uint32_t tail = 0;                       // Drain side only
+    std::atomic<uint32_t> droppedPending{0};
+    std::atomic<uint32_t> droppedTotal{0};
+
+    std::atomic<LogSite*> sites[LOG_MAX_SITES];
+    std::atomic<uint16_t> nextId{1};
+    uint32_t announced[LOG_MAX_SITES / 32];  // Drain side only
+
+    Print* out = nullptr;
+    bool text = false;
+    TaskHandle_t drainer = nullptr;
+
+    uint16_t enroll(LogSite& site, const char* types);
+
+    // Bounded MPMC queue after D. Vyukov: a slot's sequence number says
+    // whether it is free for the producer at `pos` or full for the consumer
+    Slot* reserve() {
+        uint32_t pos = head.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot* s = &ring[pos & (LOG_SLOTS - 1)];
+            int32_t diff = (int32_t)(s->seq.load(std::memory_order_acquire) - pos);
+            if (diff == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    return s;
+                }
+            } else if (diff < 0) {
+                droppedPending.fetch_add(1, std::memory_order_relaxed);
+                droppedTotal.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            } else {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+    void commit(Slot* s) {
+        // seq still holds the reserved position; one past it marks the slot full
+        s->seq.store(s->seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    void emitRecord(Print& out, uint16_t id, uint32_t us, const uint8_t* args, uint8_t len, bool text);
+    void emitDefinition(Print& out, uint16_t id, const LogSite& site);
+    static void task(void* arg);
+};
+
+// Expands a site's format string with the arguments of one record
+size_t logFormat(char* out, size_t cap, const char* fmt, const char* types, const uint8_t* args, size_t len);
+
+extern BinLog binlog;
+
+#define LOG_AT(level, fmt, ...)                           \
+    do {                                                  \
+        static LogSite logSite_ = {fmt, level, {0}, {0}}; \
+        binlog.write(logSite_, ##__VA_ARGS__);            \
+    } while (0)
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(fmt, ...) LOG_AT(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(fmt, ...) LOG_AT(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#else
+#define LOG_WARN(fmt, ...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(fmt, ...) LOG_AT(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#else
+#define LOG_INFO(fmt, ...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(fmt, ...) LOG_AT(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(fmt, ...) do {} while (0)
+#endif
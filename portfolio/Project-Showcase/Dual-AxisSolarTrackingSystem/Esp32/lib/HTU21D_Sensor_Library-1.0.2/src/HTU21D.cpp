@@ -15,102 +15,177 @@
 
 #include "HTU21D.h"
 
-#if defined(ESP_PLATFORM) && not defined(ESP8266)
-#define I2C_DELAY_NOT_SUPPORTED 1
-#endif
-
 static const uint8_t HTU21D_DELAY_T[] = {50, 13, 25, 7};
 static const uint8_t HTU21D_DELAY_H[] = {16, 3, 5, 8};
-static const float HTU21D_TCoeff = -0.15;
+
+/* CRC-8 with polynomial x^8 + x^5 + x^4 + 1 (0x31), one entry per byte value */
+static const uint8_t HTU21D_CRC8[256] = {
+  0x00, 0x31, 0x62, 0x53, 0xC4, 0xF5, 0xA6, 0x97, 0xB9, 0x88, 0xDB, 0xEA, 0x7D, 0x4C, 0x1F, 0x2E,
+  0x43, 0x72, 0x21, 0x10, 0x87, 0xB6, 0xE5, 0xD4, 0xFA, 0xCB, 0x98, 0xA9, 0x3E, 0x0F, 0x5C, 0x6D,
+  0x86, 0xB7, 0xE4, 0xD5, 0x42, 0x73, 0x20, 0x11, 0x3F, 0x0E, 0x5D, 0x6C, 0xFB, 0xCA, 0x99, 0xA8,
+  0xC5, 0xF4, 0xA7, 0x96, 0x01, 0x30, 0x63, 0x52, 0x7C, 0x4D, 0x1E, 0x2F, 0xB8, 0x89, 0xDA, 0xEB,
+  0x3D, 0x0C, 0x5F, 0x6E, 0xF9, 0xC8, 0x9B, 0xAA, 0x84, 0xB5, 0xE6, 0xD7, 0x40, 0x71, 0x22, 0x13,
+  0x7E, 0x4F, 0x1C, 0x2D, 0xBA, 0x8B, 0xD8, 0xE9, 0xC7, 0xF6, 0xA5, 0x94, 0x03, 0x32, 0x61, 0x50,
+  0xBB, 0x8A, 0xD9, 0xE8, 0x7F, 0x4E, 0x1D, 0x2C, 0x02, 0x33, 0x60, 0x51, 0xC6, 0xF7, 0xA4, 0x95,
+  0xF8, 0xC9, 0x9A, 0xAB, 0x3C, 0x0D, 0x5E, 0x6F, 0x41, 0x70, 0x23, 0x12, 0x85, 0xB4, 0xE7, 0xD6,
+  0x7A, 0x4B, 0x18, 0x29, 0xBE, 0x8F, 0xDC, 0xED, 0xC3, 0xF2, 0xA1, 0x90, 0x07, 0x36, 0x65, 0x54,
+  0x39, 0x08, 0x5B, 0x6A, 0xFD, 0xCC, 0x9F, 0xAE, 0x80, 0xB1, 0xE2, 0xD3, 0x44, 0x75, 0x26, 0x17,
+  0xFC, 0xCD, 0x9E, 0xAF, 0x38, 0x09, 0x5A, 0x6B, 0x45, 0x74, 0x27, 0x16, 0x81, 0xB0, 0xE3, 0xD2,
+  0xBF, 0x8E, 0xDD, 0xEC, 0x7B, 0x4A, 0x19, 0x28, 0x06, 0x37, 0x64, 0x55, 0xC2, 0xF3, 0xA0, 0x91,
+  0x47, 0x76, 0x25, 0x14, 0x83, 0xB2, 0xE1, 0xD0, 0xFE, 0xCF, 0x9C, 0xAD, 0x3A, 0x0B, 0x58, 0x69,
+  0x04, 0x35, 0x66, 0x57, 0xC0, 0xF1, 0xA2, 0x93, 0xBD, 0x8C, 0xDF, 0xEE, 0x79, 0x48, 0x1B, 0x2A,
+  0xC1, 0xF0, 0xA3, 0x92, 0x05, 0x34, 0x67, 0x56, 0x78, 0x49, 0x1A, 0x2B, 0xBC, 0x8D, 0xDE, 0xEF,
+  0x82, 0xB3, 0xE0, 0xD1, 0x46, 0x77, 0x24, 0x15, 0x3B, 0x0A, 0x59, 0x68, 0xFF, 0xCE, 0x9D, 0xAC,
+};
 
 /**
  * Constructor
  * Initializes a new sensor instance
  * 
  * @param addr Sensor Address (default 0x40)
- * @param wire TWI bus instance (default Wire)
+ * @param bus Shared I2C bus (default i2cBus)
  */
-HTU21D::HTU21D(uint8_t addr, TwoWire& wire) : _addr(addr), _wire(wire), _resolution(RESOLUTION_RH12_T14) {
+HTU21D::HTU21D(uint8_t addr, I2CBus& bus) : _addr(addr), _bus(bus), _resolution(RESOLUTION_RH12_T14),
+  temperature(HTU21D_INVALID), humidity(HTU21D_INVALID) {
   
 }
 
-bool HTU21D::checkCRC8(uint8_t data[]) {
+/**
+ * CRC of a sensor reply, as appended by the sensor to each measurement
+ * 
+ * @param data Bytes to check
+ * @param len Number of bytes
+ * @return CRC-8 (polynomial 0x31, initial value 0)
+ */
+uint8_t HTU21D::crc8(const uint8_t data[], size_t len) {
   uint8_t crc = 0;
-  for(int i = 0; i < 2; i++) {
-    crc ^= data[i];
-    for(int b = 7; b >= 0; b--) {
-      if(crc & 0x80) crc = (crc << 1) ^ 0x31;
-      else crc = (crc << 1);
-    }
+  for(size_t i = 0; i < len; i++) {
+    crc = HTU21D_CRC8[crc ^ data[i]];
   }
-  
-  return crc == data[2];
+  return crc;
 }
 
-bool HTU21D::measureTemperature() {
-  /* Measure temperature */
-  _wire.beginTransmission(_addr);
-  _wire.write(TRIGGER_TEMP_MEAS_NH);
-#ifndef I2C_DELAY_NOT_SUPPORTED
-  _wire.endTransmission(false);
-#else
-  _wire.endTransmission(true);
-#endif
-  
-  delay(HTU21D_DELAY_T[_resolution]);
+/**
+ * Converts a raw temperature reading, T = -46.85 + 175.72 * St / 2^16,
+ * in integer arithmetic: the ESP32 has no double-precision FPU.
+ * 
+ * @param raw Raw value with the status bits cleared
+ * @return Temperature in 0.01 °C
+ */
+int16_t HTU21D::centiCelsius(uint16_t raw) {
+  return (int16_t)(-4685 + (int32_t)((17572UL * raw + 32768UL) >> 16));
+}
+
+/**
+ * Converts a raw humidity reading, RH = -6 + 125 * Srh / 2^16, applies the
+ * temperature coefficient of -0.15 %RH/°C around 25 °C and clamps the
+ * result to 0..100 %RH, all in integer arithmetic.
+ * 
+ * @param raw Raw value with the status bits cleared
+ * @param centiC Temperature of the same sample in 0.01 °C
+ * @return Relative humidity in 0.01 %RH
+ */
+int16_t HTU21D::centiHumidity(uint16_t raw, int16_t centiC) {
+  int32_t rh = -600 + (int32_t)((12500UL * raw + 32768UL) >> 16);
+  int32_t comp = (int32_t)(centiC - 2500) * 15; /* (25 - T) * -0.15, in 0.0001 %RH */
+  rh += (comp + (comp < 0 ? -50 : 50)) / 100;
+  return (int16_t)(rh < 0 ? 0 : rh > 10000 ? 10000 : rh);
+}
+
+bool HTU21D::command(uint8_t cmd) {
+  return _bus.write(_addr, &cmd, 1) == I2C_OK;
+}
+
+/* No-hold measurements: the bus is released while the sensor converts */
+bool HTU21D::readResult(uint8_t data[3]) {
+  return _bus.read(_addr, data, 3) == I2C_OK && crc8(data, 2) == data[2];
+}
+
+bool HTU21D::measureRaw(uint8_t cmd, const uint8_t delays[], uint16_t& raw) {
+  if(!command(cmd)) return false;
   
-  _wire.requestFrom(_addr, static_cast<uint8_t>(3));
-  if(_wire.available() != 3) return false;
+  delay(delays[_resolution]);
   
   uint8_t data[3];
-  for(int i = 0; i < 3; i++) data[i] = _wire.read();
-  if(!checkCRC8(data)) return false;
-  
-  uint16_t St = (data[0] << 8) | (data[1] & 0xFC);
-  temperature = -46.85 + 175.72 * St / 65536.0;
+  if(!readResult(data)) return false;
   
+  raw = (data[0] << 8) | (data[1] & 0xFC);
   return true;
 }
 
-bool HTU21D::measureHumidity() {
-  /* Measure humidity */
-  _wire.beginTransmission(_addr);
-  _wire.write(TRIGGER_HUM_MEAS_NH);
-#ifndef I2C_DELAY_NOT_SUPPORTED
-  _wire.endTransmission(false);
-#else
-  _wire.endTransmission(true);
-#endif
-  
-  delay(HTU21D_DELAY_H[_resolution]);
-  
-  _wire.requestFrom(_addr, static_cast<uint8_t>(3));
-  if(_wire.available() != 3) return false;
-  
-  uint8_t data[3];
-  for(uint8_t i = 0; i < 3; i++) data[i] = _wire.read();
-  if(!checkCRC8(data)) return false;
-  
-  uint16_t Srh = (data[0] << 8) | (data[1] & 0xFC);
-  humidity = -6.0 + 125.0 * Srh / 65536.0;
-  humidity += (25.0 - temperature) * HTU21D_TCoeff;
-  humidity = constrain(humidity, 0.0, 100.0);
+bool HTU21D::measurePair(int16_t& centiC, int16_t& centiRH) {
+  /* NOTE: Order is important as the temperature is needed to correct the humidity reading */
+  uint16_t St, Srh;
+  if(!measureRaw(TRIGGER_TEMP_MEAS_NH, HTU21D_DELAY_T, St)) return false;
+  if(!measureRaw(TRIGGER_HUM_MEAS_NH, HTU21D_DELAY_H, Srh)) return false;
   
+  centiC = centiCelsius(St);
+  centiRH = centiHumidity(Srh, centiC);
   return true;
 }
 
+/* Mean of the values left after dropping the lowest and highest quarter */
+static int16_t trimmedMean(int16_t v[], uint8_t n) {
+  for(uint8_t i = 1; i < n; i++) {
+    int16_t x = v[i];
+    uint8_t j = i;
+    for(; j > 0 && v[j - 1] > x; j--) v[j] = v[j - 1];
+    v[j] = x;
+  }
+  
+  uint8_t trim = n / 4;
+  int32_t sum = 0;
+  for(uint8_t i = trim; i < n - trim; i++) sum += v[i];
+  int32_t kept = n - 2 * trim;
+  return (int16_t)((sum + (sum < 0 ? -kept : kept) / 2) / kept);
+}
+
 /**
  * Starts a temperature and a humidity measurement and reads the result.
  * @return true if the result was read correctly, otherwise false
  */
 bool HTU21D::measure() {
   /* Reset values */
-  temperature = NAN;
-  humidity = NAN;
+  temperature = HTU21D_INVALID;
+  humidity = HTU21D_INVALID;
   
-  /* NOTE: Order is important as the temperature is needed to correct the humidity reading */
-  if(!measureTemperature()) return false;
-  if(!measureHumidity()) return false;
+  int16_t t, h;
+  if(!measurePair(t, h)) return false;
+  temperature = t;
+  humidity = h;
+  return true;
+}
+
+/**
+ * Takes several measurements back to back at the given resolution and keeps
+ * the trimmed mean: the lowest and highest quarter of the samples are
+ * dropped. A lower resolution converts faster, so e.g. four samples at
+ * RESOLUTION_RH11_T11 take less time than one at RESOLUTION_RH12_T14 and
+ * average the noise down. The previous resolution is restored afterwards.
+ * 
+ * @param samples Number of samples, 1 to HTU21D_BURST_MAX
+ * @param resolution Resolution of the samples
+ * @return true if at least half of the samples were read correctly
+ */
+bool HTU21D::measureBurst(uint8_t samples, HTU21DResolution resolution) {
+  temperature = HTU21D_INVALID;
+  humidity = HTU21D_INVALID;
+  if(samples == 0 || samples > HTU21D_BURST_MAX) return false;
+  
+  HTU21DResolution previous = _resolution;
+  if(resolution != previous) setResolution(resolution);
+  
+  int16_t t[HTU21D_BURST_MAX], h[HTU21D_BURST_MAX];
+  uint8_t n = 0;
+  for(uint8_t i = 0; i < samples; i++) {
+    if(measurePair(t[n], h[n])) n++;
+  }
+  
+  if(resolution != previous) setResolution(previous);
+  
+  if(n == 0 || n * 2 < samples) return false;
+  temperature = trimmedMean(t, n);
+  humidity = trimmedMean(h, n);
   return true;
 }
 
@@ -121,10 +196,8 @@ bool HTU21D::measure() {
  * @see HTU21DResolution for possible resolutions
  */
 void HTU21D::setResolution(HTU21DResolution resolution) {
-  _wire.beginTransmission(_addr);
-  _wire.write(WRITE_USER_REG);
-  _wire.write((resolution & 0x01) | ((resolution & 0x02) << 6) | 0x02);
-  _wire.endTransmission();
+  uint8_t cmd[2] = {WRITE_USER_REG, static_cast<uint8_t>((resolution & 0x01) | ((resolution & 0x02) << 6) | 0x02)};
+  _bus.write(_addr, cmd, 2);
   
   _resolution = resolution;
 }
@@ -139,11 +212,10 @@ HTU21DResolution HTU21D::getResolution() {
 }
 
 /**
- * Initializes the I2C transport (Wire.begin()) and resets the sensor.
+ * Resets the sensor. The bus itself is set up once by I2CBus::begin().
  * @return true if the initialization was successful, otherwise false
  */
 bool HTU21D::begin() {
-  _wire.begin();
   return reset();
 }
   
@@ -152,18 +224,13 @@ bool HTU21D::begin() {
  * @return true if the reset was successful, otherwise false
  */
 bool HTU21D::reset() {
-  _wire.beginTransmission(_addr);
-  _wire.write(SOFT_RESET);
-  _wire.endTransmission();
+  command(SOFT_RESET);
   
   delay(15);
   
-  _wire.beginTransmission(_addr);
-  _wire.write(READ_USER_REG);
-  _wire.endTransmission(false);
-  _wire.requestFrom(_addr, static_cast<uint8_t>(3));
-  if(_wire.available() != 1) return false;
-  if(_wire.read() != 0x02) return false;
+  uint8_t cmd = READ_USER_REG, reg = 0;
+  if(_bus.transfer(_addr, &cmd, 1, &reg, 1) != I2C_OK) return false;
+  if(reg != 0x02) return false;
   
   _resolution = RESOLUTION_RH12_T14;
 
@@ -172,20 +239,40 @@ bool HTU21D::reset() {
 
 /**
  * Returns the temperature value acquired with the last measurement.
- * To refresh this value call measure().
+ * To refresh this value call measure() or measureBurst().
+ * 
+ * @returns Temperature in 0.01 °C or HTU21D_INVALID
+ */
+int16_t HTU21D::getTemperatureCenti() const {
+  return temperature;
+}
+
+/**
+ * Returns the humidity value acquired with the last measurement.
+ * To refresh this value call measure() or measureBurst().
+ * 
+ * @returns Relative Humidity in 0.01 percent or HTU21D_INVALID
+ */
+int16_t HTU21D::getHumidityCenti() const {
+  return humidity;
+}
+
+/**
+ * Returns the temperature value acquired with the last measurement.
+ * To refresh this value call measure() or measureBurst().
  * 
  * @returns Temperature in °C or NaN
  */
 float HTU21D::getTemperature() const {
-  return temperature;
+  return temperature == HTU21D_INVALID ? NAN : temperature / 100.0f;
 }
 
 /**
  * Returns the humidity value acquired with the last measurement.
- * To refresh this value call measure().
+ * To refresh this value call measure() or measureBurst().
  * 
  * @returns Relative Humidity in percent or NaN
  */
 float HTU21D::getHumidity() const {
-  return humidity;
+  return humidity == HTU21D_INVALID ? NAN : humidity / 100.0f;
 }
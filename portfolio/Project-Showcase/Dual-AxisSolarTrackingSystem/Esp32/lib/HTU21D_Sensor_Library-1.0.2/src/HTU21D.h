@@ -6,7 +6,7 @@
 #define _HTU21D_H
 
 #include "Arduino.h"
-#include "Wire.h"
+#include "I2CBus.h"
 
 /**
  * HTU21D Measurement Resolution
@@ -18,6 +18,16 @@ enum HTU21DResolution {
   RESOLUTION_RH11_T11 = 3  //!< 11 bit for RH and 11 bit for temperature
 };
 
+/**
+ * No valid reading, as returned by the centi getters
+ */
+#define HTU21D_INVALID INT16_MIN
+
+/**
+ * Most samples one burst can take
+ */
+#define HTU21D_BURST_MAX 16
+
 /**
  * HTU21D Sensor Driver
  */
@@ -26,11 +36,11 @@ private:
   static const uint8_t HTU21D_ADDR = 0x40;
 
   const uint8_t _addr;
-  TwoWire& _wire;
+  I2CBus& _bus;
   HTU21DResolution _resolution;
   
-  float temperature;
-  float humidity;
+  int16_t temperature; // 0.01 °C, HTU21D_INVALID if unknown
+  int16_t humidity;    // 0.01 %RH, HTU21D_INVALID if unknown
   
   enum HTU21DCmd {
     TRIGGER_TEMP_MEAS_H = 0xE3,
@@ -42,13 +52,21 @@ private:
     SOFT_RESET = 0xFE
   };
   
-  bool measureTemperature();
-  bool measureHumidity();
-  bool checkCRC8(uint8_t data[]);
+  bool measureRaw(uint8_t cmd, const uint8_t delays[], uint16_t& raw);
+  bool measurePair(int16_t& centiC, int16_t& centiRH);
+  bool command(uint8_t cmd);
+  bool readResult(uint8_t data[3]);
 public:
-  HTU21D(uint8_t addr = HTU21D_ADDR, TwoWire& wire = Wire);
+  HTU21D(uint8_t addr = HTU21D_ADDR, I2CBus& bus = i2cBus);
+  
+  static uint8_t crc8(const uint8_t data[], size_t len);
+  static int16_t centiCelsius(uint16_t raw);
+  static int16_t centiHumidity(uint16_t raw, int16_t centiC);
   
   bool measure();
+  bool measureBurst(uint8_t samples, HTU21DResolution resolution);
+  int16_t getTemperatureCenti(void) const;
+  int16_t getHumidityCenti(void) const;
   float getTemperature(void) const;
   float getHumidity(void) const;
   void setResolution(HTU21DResolution resolution);
@@ -0,0 +1,197 @@
+#include "I2CBus.h"
+#include <BinLog.h>
+
+I2CBus i2cBus(Wire);
+
+static const char* const statusNames[I2C_STATUSES] = {
+    "ok", "too_long", "nack_addr", "nack_data", "bus_error", "timeout", "short_read", "queue_full",
+};
+
+const char* I2CBus::statusName(I2CStatus status) {
+    return status < I2C_STATUSES ? statusNames[status] : "unknown";
+}
+
+I2CBus::I2CBus(TwoWire& wire) : wire(wire) {
+    counters.latencyMinUs = UINT32_MAX;
+}
+
+bool I2CBus::begin(int sda, int scl, uint32_t hz) {
+    this->sda = sda;
+    this->scl = scl;
+    this->hz = hz;
+    if (!wire.begin(sda, scl, hz)) {
+        return false;
+    }
+    wire.setTimeOut(I2C_WIRE_TIMEOUT_MS);
+    return true;
+}
+
+bool I2CBus::start(UBaseType_t priority, BaseType_t core) {
+    if (owner) {
+        return true;
+    }
+    queue = xQueueCreate(I2C_QUEUE_LEN, sizeof(Transaction*));
+    if (!queue) {
+        return false;
+    }
+    if (xTaskCreatePinnedToCore(task, "I2CBus", 3072, this, priority, &owner, core) != pdPASS) {
+        vQueueDelete(queue);
+        queue = nullptr;
+        owner = nullptr;
+        return false;
+    }
+    return true;
+}
+
+// The caller's task notification is the completion signal, so a task must
+// not use its default notification for anything else while it talks I2C.
+I2CStatus I2CBus::transfer(uint8_t addr, const uint8_t* tx, size_t txLen, uint8_t* rx, size_t rxLen) {
+    Transaction t = {addr, tx, txLen, rx, rxLen, (uint32_t)micros(), nullptr, I2C_OK};
+
+    if (!owner || xTaskGetCurrentTaskHandle() == owner) {
+        execute(t);
+        return t.status;
+    }
+
+    t.waiter = xTaskGetCurrentTaskHandle();
+    Transaction* p = &t;
+    if (xQueueSend(queue, &p, pdMS_TO_TICKS(100)) != pdTRUE) {
+        t.status = I2C_QUEUE_FULL;
+        account(t);
+        return t.status;
+    }
+    UBaseType_t waiting = uxQueueMessagesWaiting(queue);
+    taskENTER_CRITICAL(&statsLock);
+    if (waiting > counters.queueHighWater) {
+        counters.queueHighWater = waiting;
+    }
+    taskEXIT_CRITICAL(&statsLock);
+
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY); // Wire's own timeout bounds this
+    return t.status;
+}
+
+void I2CBus::execute(Transaction& t) {
+    // A write, a probe (nothing to write or read), or the register pointer
+    // ahead of a read with a repeated start
+    if (t.txLen || !t.rxLen) {
+        wire.beginTransmission(t.addr);
+        if (t.txLen) {
+            wire.write(t.tx, t.txLen);
+        }
+        uint8_t err = wire.endTransmission(t.rxLen == 0);
+        t.status = err <= I2C_TIMEOUT ? (I2CStatus)err : I2C_BUS_ERROR;
+    }
+    if (t.status == I2C_OK && t.rxLen) {
+        size_t n = wire.requestFrom(t.addr, (uint8_t)t.rxLen);
+        for (size_t i = 0; i < n && i < t.rxLen; i++) {
+            t.rx[i] = wire.read();
+        }
+        if (n < t.rxLen) {
+            t.status = I2C_SHORT_READ;
+        }
+    }
+
+    // A slave can be left holding SDA low mid-byte, and then every later
+    // transaction fails the same way
+    if (t.status == I2C_TIMEOUT || t.status == I2C_BUS_ERROR) {
+        recover();
+    }
+    account(t);
+}
+
+bool I2CBus::recover() {
+    if (sda < 0 || scl < 0) {
+        return false;
+    }
+    wire.end();
+    pinMode(sda, INPUT_PULLUP);
+    pinMode(scl, OUTPUT_OPEN_DRAIN);
+    digitalWrite(scl, HIGH);
+    delayMicroseconds(5);
+
+    // Up to nine clocks let the slave finish the byte it is sending
+    for (int i = 0; i < 9 && digitalRead(sda) == LOW; i++) {
+        digitalWrite(scl, LOW);
+        delayMicroseconds(5);
+        digitalWrite(scl, HIGH);
+        delayMicroseconds(5);
+    }
+
+    // STOP: SDA rises while SCL is high
+    pinMode(sda, OUTPUT_OPEN_DRAIN);
+    digitalWrite(sda, LOW);
+    delayMicroseconds(5);
+    digitalWrite(sda, HIGH);
+    delayMicroseconds(5);
+    pinMode(sda, INPUT_PULLUP);
+    bool released = digitalRead(sda) == HIGH;
+
+    wire.begin(sda, scl, hz);
+    wire.setTimeOut(I2C_WIRE_TIMEOUT_MS);
+
+    taskENTER_CRITICAL(&statsLock);
+    counters.recoveries++;
+    taskEXIT_CRITICAL(&statsLock);
+    return released;
+}
+
+void I2CBus::account(const Transaction& t) {
+    uint32_t us = (uint32_t)micros() - t.queuedUs;
+    int bucket = 0;
+    while (bucket < I2C_LATENCY_BUCKETS - 1 && us > i2cLatencyBoundsUs[bucket]) {
+        bucket++;
+    }
+
+    taskENTER_CRITICAL(&statsLock);
+    counters.transactions++;
+    if (t.status != I2C_OK) {
+        counters.errors[t.status]++;
+    }
+    if (us < counters.latencyMinUs) {
+        counters.latencyMinUs = us;
+    }
+    if (us > counters.latencyMaxUs) {
+        counters.latencyMaxUs = us;
+    }
+    counters.latencySumUs += us;
+    counters.latencyBuckets[bucket]++;
+    taskEXIT_CRITICAL(&statsLock);
+}
+
+I2CStats I2CBus::stats() {
+    taskENTER_CRITICAL(&statsLock);
+    I2CStats s = counters;
+    taskEXIT_CRITICAL(&statsLock);
+    return s;
+}
+
+void I2CBus::logStats() {
+    I2CStats s = stats();
+    if (!s.transactions) {
+        LOG_INFO("i2c %lu Hz, no transactions", (unsigned long)hz);
+        return;
+    }
+    LOG_INFO("i2c %lu Hz, %lu transactions, latency us min %lu avg %lu max %lu, queue max %lu, recoveries %lu",
+             (unsigned long)hz, (unsigned long)s.transactions, (unsigned long)s.latencyMinUs,
+             (unsigned long)(s.latencySumUs / s.transactions), (unsigned long)s.latencyMaxUs,
+             (unsigned long)s.queueHighWater, (unsigned long)s.recoveries);
+    for (int i = 1; i < I2C_STATUSES; i++) {
+        if (s.errors[i]) {
+            LOG_WARN("i2c errors %s %lu", statusNames[i], (unsigned long)s.errors[i]);
+        }
+    }
+}
+
+void I2CBus::task(void* arg) {
+    I2CBus* bus = (I2CBus*)arg;
+    Transaction* t;
+
+    for (;;) {
+        if (xQueueReceive(bus->queue, &t, portMAX_DELAY) == pdTRUE) {
+            TaskHandle_t waiter = t->waiter;
+            bus->execute(*t);
+            xTaskNotifyGive(waiter); // *t may be gone once the waiter runs
+        }
+    }
+}
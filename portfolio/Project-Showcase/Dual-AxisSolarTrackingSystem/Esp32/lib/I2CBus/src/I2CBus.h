@@ -0,0 +1,105 @@
+#pragma once
+#include <Arduino.h>
+#include <Wire.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+// Shared I2C bus. One manager task owns the TwoWire instance; drivers on any
+// task call transfer() (or write()/read()), which queues the transaction and
+// sleeps on a task notification until the manager has run it. Transactions
+// therefore never interleave on the wire, and a driver's conversion delays
+// happen on its own task with the bus free for others.
+//
+// Before start() there is no manager task and transfers run directly on the
+// caller. That covers probing in setup() and the host tests.
+//
+// A transaction that times out or hits a bus error is followed by a bus
+// recovery: Wire is released, SCL is clocked by hand until a slave stuck
+// mid-byte lets go of SDA, a STOP is sent and Wire is started again.
+
+#define I2C_FAST_HZ 400000
+#define I2C_QUEUE_LEN 8
+#define I2C_WIRE_TIMEOUT_MS 20
+
+// Result of a transaction. 1-5 are the TwoWire::endTransmission() codes.
+enum I2CStatus : uint8_t {
+    I2C_OK = 0,
+    I2C_TOO_LONG = 1,
+    I2C_NACK_ADDR = 2,
+    I2C_NACK_DATA = 3,
+    I2C_BUS_ERROR = 4,
+    I2C_TIMEOUT = 5,
+    I2C_SHORT_READ = 6, // Fewer bytes than requested came back
+    I2C_QUEUE_FULL = 7, // The manager's queue stayed full for 100 ms
+    I2C_STATUSES
+};
+
+// Upper bounds of the latency histogram buckets; the last one is open
+#define I2C_LATENCY_BUCKETS 8
+static const uint32_t i2cLatencyBoundsUs[I2C_LATENCY_BUCKETS - 1] = {250, 500, 1000, 2000, 4000, 8000, 16000};
+
+struct I2CStats {
+    uint32_t transactions;
+    uint32_t errors[I2C_STATUSES];   // errors[I2C_OK] stays 0
+    uint32_t recoveries;
+    uint32_t latencyMinUs;           // Queued to completed, including waiting for the bus
+    uint32_t latencyMaxUs;
+    uint64_t latencySumUs;
+    uint32_t latencyBuckets[I2C_LATENCY_BUCKETS];
+    uint32_t queueHighWater;
+};
+
+class I2CBus {
+public:
+    explicit I2CBus(TwoWire& wire);
+
+    // Configures the pins and clock (400 kHz fast mode by default)
+    bool begin(int sda, int scl, uint32_t hz = I2C_FAST_HZ);
+    // Starts the manager task; later transfers are queued to it
+    bool start(UBaseType_t priority = 3, BaseType_t core = 1);
+
+    // Writes txLen bytes, then, if rxLen, reads rxLen bytes after a repeated
+    // start. Blocks until the transaction has run.
+    I2CStatus transfer(uint8_t addr, const uint8_t* tx, size_t txLen, uint8_t* rx = nullptr, size_t rxLen = 0);
+    I2CStatus write(uint8_t addr, const uint8_t* tx, size_t len) { return transfer(addr, tx, len); }
+    I2CStatus read(uint8_t addr, uint8_t* rx, size_t len) { return transfer(addr, nullptr, 0, rx, len); }
+
+    // Clocks a stuck slave free and restarts Wire; true if SDA is released
+    bool recover();
+
+    I2CStats stats();
+    // Summary and error counts as log records; formatted by the BinLog drain task
+    void logStats();
+    static const char* statusName(I2CStatus status);
+    uint32_t clock() const { return hz; }
+    // The manager task, null before start()
+    TaskHandle_t ownerTask() const { return owner; }
+
+private:
+    struct Transaction {
+        uint8_t addr;
+        const uint8_t* tx;
+        size_t txLen;
+        uint8_t* rx;
+        size_t rxLen;
+        uint32_t queuedUs;
+        TaskHandle_t waiter;
+        I2CStatus status;
+    };
+
+    TwoWire& wire;
+    int sda = -1, scl = -1;
+    uint32_t hz = I2C_FAST_HZ;
+    QueueHandle_t queue = nullptr;
+    TaskHandle_t owner = nullptr;
+    portMUX_TYPE statsLock = portMUX_INITIALIZER_UNLOCKED;
+    I2CStats counters = {};
+
+    void execute(Transaction& t);
+    void account(const Transaction& t);
+    static void task(void* arg);
+};
+
+// The board's only bus, on the Wire controller
+extern I2CBus i2cBus;
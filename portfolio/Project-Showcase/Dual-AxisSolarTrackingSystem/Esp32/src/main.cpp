@@ -1,13 +1,21 @@
 #include <esp_task_wdt.h>
 #include <esp_adc_cal.h>
 #include <Arduino.h>
+#include "Admission.h"
+#include "BootTimeline.h"
 #include "Endpoints.h"
+#include "Frame.h"
 #include "HTU.h"
 #include "Lys.h"
+#include "Metrics.h"
+#include "PowerManager.h"
+#include "Setpoint.h"
+#include "StripChart.h"
+#include "Supervisor.h"
+#include "Telemetry.h"
 #include "Wifi_Config.h"
 
 
-    HTU21D humidity_temperature;
     DisplayHandler HTU;
     HardwareSerial RP(1); // Use UART1
     TFT_eSPI tft;
@@ -15,68 +23,130 @@
     LightSensor rightSensor(33);
     LightSensor upSensor(39);
     LightSensor downSensor(36);
+    LightSensorArray<32, 33, 39, 36> lightSensors; // Left, right, up, down, as above
     AsyncWebServer server(80); // Initialisere AsyncWebServer til port 80
+    // 90 s of history right of the text: left-right and up-down light balance, then temperature
+    StripChart<90, 2> balanceChart(display.screen(), 150, 72, 28, -4095, 4095);
+    StripChart<90> temperatureChart(HTU.screen(), 150, 104, 28, 0, 50);
+    // Deadline supervisor ids; budgets are the work of one cycle, delays excluded
+    int loopDeadline = supervisor.watch("loop", 1000, 250);
+    int sensorDeadline = supervisor.watch("sensor", 1000, 250);
     
 void handleRoot(AsyncWebServerRequest *request) {
     request->send(200, "text/html", index_html);
 }
 
 void readSensorsTask(void *pvParameters) {
-    for (;;) {
-        float temperature = humidity_temperature.getTemperature();
-        float humidity = humidity_temperature.getHumidity();
-
-        Serial.println("Temperature: " + String(temperature) + " °C");
-        Serial.println("Humidity: " + String(humidity) + " %");
-
+    for (uint32_t n = 1;; n++) {
+        metrics.sensorPeriod.tick();
+        supervisor.begin(sensorDeadline);
+        supervisor.stage(sensorDeadline, "i2c");
+        sensor.update();
+        float temperature = sensor.readTemperature();
+        float humidity = sensor.readHumidity();
+
+        LOG_INFO("Temperature: %.2f °C", temperature);
+        LOG_INFO("Humidity: %.2f %%", humidity);
+        telemetry.setClimate(temperature, humidity);
+
+        supervisor.stage(sensorDeadline, "display");
         HTU.showTempAndHumidity(temperature, humidity, 0, 90);
+        temperatureChart.add(temperature);
+        if (n % 60 == 0) {
+            supervisor.stage(sensorDeadline, "log");
+            i2cBus.logStats();
+        }
+        supervisor.end(sensorDeadline);
         vTaskDelay(pdMS_TO_TICKS(1000)); // Delay to prevent constant polling
     }
 }
 
 void setup() {
+        bootTimeline.mark(BOOT_SETUP);
         esp_task_wdt_init(5, true); // Set WDT timeout to 5 seconds (or higher as needed)    
         Serial.begin(115200);
-        Wire.setClock(100000);
-    Wire.begin(SDA_PIN, SCL_PIN);
-    HandleWiFi_init("iPhone", "12341234");
+        binlog.start(Serial); // Everything LOG_*() leaves the board through this task
+    i2cBus.begin(SDA_PIN, SCL_PIN); // 400 kHz fast mode; the only Wire.begin()
+    i2cBus.start();                 // From here on all I2C goes through the bus task
+    sensor.begin();
     RP.begin(115200, SERIAL_8N1, 27, 26); // RX=27, TX=26
+    setpoints.begin();
+    setpoints.start(RP); // Sends the saved setpoint, then every edit, and reads the controller's acks
+    bootTimeline.mark(BOOT_UART);
+    // Returns at once; the link comes up in the background and loop() keeps it
+    // up. Pass a WifiStaticIp as third argument to skip DHCP.
+    HandleWiFi_init("iPhone", "12341234");
 
-    leftSensor.initLight();
-    rightSensor.initLight();
-    upSensor.initLight();
-    downSensor.initLight();
-
-    xTaskCreatePinnedToCore(readSensorsTask, "SensorReadTask", 2048, NULL, 1, NULL, 1);
+    lightSensors.begin();
+    balanceChart.begin();
+    temperatureChart.begin();
+
+    TaskHandle_t sensorTask = NULL;
+    xTaskCreatePinnedToCore(readSensorsTask, "SensorReadTask", 2048, NULL, 1, &sensorTask, 1);
+    metrics.watchTask("loop", xTaskGetCurrentTaskHandle());
+    metrics.watchTask("sensor", sensorTask);
+    metrics.watchTask("i2c", i2cBus.ownerTask());
+    metrics.watchTask("log", binlog.drainTask());
+    // Multicast to the site-local group telemcollect listens on, once a second
+    telemetry.begin(IPAddress(239, 255, 42, 1), TELEMETRY_PORT, 1000);
     server.begin();
-    server.on("/", HTTP_GET, handleRoot);
-    server.on("/temperature", HTTP_GET, handleTemperature);
-    server.on("/graph_Humidity", HTTP_GET, handleHumidity);
-    server.on("/humidity", HTTP_GET, handleHumidity); // /PIR
-    server.on("/graph_Temp", HTTP_POST, handleHumidity);
+    // Each route is timed, and turned away with a 503 while HTTP_MAX_CONNECTIONS are busy
+    auto route = [](const char* uri, ArRequestHandlerFunction fn) {
+        return admission.guard(metrics.instrument(uri, fn));
+    };
+    server.on("/", HTTP_GET, route("/", handleRoot));
+    server.on("/temperature", HTTP_GET, route("/temperature", handleTemperature));
+    server.on("/graph_Humidity", HTTP_GET, route("/graph_Humidity", handleHumidity));
+    server.on("/humidity", HTTP_GET, route("/humidity", handleHumidity)); // /PIR
+    server.on("/graph_Temp", HTTP_POST, route("/graph_Temp", handleHumidity));
+    server.on("/setpoint", HTTP_POST, route("/setpoint", handleSetpoint));
+    server.on("/setpoint", HTTP_GET, route("/setpoint", handleSetpointGet));
+    server.on("/metrics", HTTP_GET, route("/metrics", handleMetrics));
+    bootTimeline.mark(BOOT_HTTP_LISTEN);
+
+    power.begin(RP, loopDeadline); // Sampling rate and sleep between samples follow the light
+    supervisor.start(); // Feeds the watchdog while the loop and sensor tasks keep their deadlines
 };
 
 
 void loop() {
+    metrics.loopPeriod.tick();
+    supervisor.begin(loopDeadline);
     // Temperature and Humidity reading
     // Light sensor readings
-    int left = analogRead(32);
-    int right = analogRead(33);
-    int up = analogRead(39);
-    int down = analogRead(36);
+    supervisor.stage(loopDeadline, "adc");
+    int light[lightSensors.size];
+    lightSensors.sample(light);
+    uint32_t traceId = nextTraceId();
+    uint32_t captureUs = micros();
 
 
     // Log light intensities
-    leftSensor.logLightIntensity(display, 0, 30);
-    rightSensor.logLightIntensity(display, 0, 40);
-    upSensor.logLightIntensity(display, 0, 50);
-    downSensor.logLightIntensity(display, 0, 60);
+    supervisor.stage(loopDeadline, "display");
+    leftSensor.logLightIntensity(light[0], display, 0, 30);
+    rightSensor.logLightIntensity(light[1], display, 0, 40);
+    upSensor.logLightIntensity(light[2], display, 0, 50);
+    downSensor.logLightIntensity(light[3], display, 0, 60);
+
+    float balance[2] = {(float)(light[0] - light[1]), (float)(light[2] - light[3])};
+    balanceChart.add(balance);
 
     // Sunsearch function to find the sensor with the highest intensity
-    leftSensor.Sunsearch(left, right, up, down, display);
-    // Add delay to reduce the loop frequency and allow for serial readability
-    esp_task_wdt_reset();
-    delay(1000);
+    String direction = leftSensor.Sunsearch(light[0], light[1], light[2], light[3], display);
+    // Send the decision to the Linux controller
+    supervisor.stage(loopDeadline, "uart");
+    sendFrame(RP, direction, traceId, captureUs, light[lightSensors.brightest(light)]);
+    bootTimeline.mark(BOOT_FIRST_SAMPLE);
+
+    supervisor.stage(loopDeadline, "wifi");
+    wifiLink.poll(display);
+    telemetry.publish(light, lightSensors.size, lightSensors.brightest(light));
+    bootTimeline.report();
+    uint32_t intervalMs = power.plan(light, lightSensors.size);
+    metrics.loopPeriod.nominalUs = intervalMs * 1000; // Jitter is measured against the chosen rate
+    supervisor.end(loopDeadline);
+    // Faster while the light moves, slower when it is steady, light sleep at night
+    power.wait(intervalMs);
 };
 
 
@@ -0,0 +1,218 @@
+#pragma once
+// Host-side stand-in for the Arduino-ESP32 core, used by [env:native].
+// Only the surface the firmware actually touches is modelled. Time is
+// virtual: delay() advances the clock instead of sleeping, so tests and
+// benchmarks are not dominated by sensor conversion waits.
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+#include <math.h>
+#include <string>
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define PROGMEM
+#define F(s) (s)
+
+#define HIGH 0x1
+#define LOW  0x0
+#define INPUT  0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define OUTPUT_OPEN_DRAIN 0x13
+
+#ifndef constrain
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#endif
+
+using std::min;
+using std::max;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+namespace mock {
+    // Last value written/set per GPIO; analogRead() returns analog[pin].
+    inline std::map<int, int> analog;
+    inline std::map<int, int> digital;
+    // Every digitalWrite() as (pin, value), for bit-banged protocols
+    inline std::vector<std::pair<int, int>> digitalWrites;
+
+    inline void advance_us(uint64_t us) { now_us += us; }
+    inline void reset() {
+        now_us = 0;
+        analog.clear();
+        digital.clear();
+        digitalWrites.clear();
+    }
+}
+
+inline unsigned long millis() { return (unsigned long)(mock::now_us / 1000); }
+// 32 bits wide, as on the ESP32, so it wraps every 71.6 min
+inline unsigned long micros() { return (uint32_t)mock::now_us; }
+inline void delay(uint32_t ms) { mock::advance_us((uint64_t)ms * 1000); }
+inline void delayMicroseconds(uint32_t us) { mock::advance_us(us); }
+inline void yield() {}
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t pin, uint8_t val) {
+    mock::digital[pin] = val;
+    mock::digitalWrites.push_back({pin, val});
+}
+inline int digitalRead(uint8_t pin) { return mock::digital[pin]; }
+inline uint16_t analogRead(uint8_t pin) { return (uint16_t)mock::analog[pin]; }
+
+// Minimal Arduino String backed by std::string.
+class String {
+private:
+    std::string s;
+
+    static std::string fromFloat(double v, unsigned int decimals) {
+        char buf[48];
+        snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+        return buf;
+    }
+
+public:
+    String() {}
+    String(const char* c) : s(c ? c : "") {}
+    String(const std::string& str) : s(str) {}
+    String(char c) : s(1, c) {}
+    String(int v) : s(std::to_string(v)) {}
+    String(unsigned int v) : s(std::to_string(v)) {}
+    String(long v) : s(std::to_string(v)) {}
+    String(unsigned long v) : s(std::to_string(v)) {}
+    String(float v, unsigned int decimals = 2) : s(fromFloat(v, decimals)) {}
+    String(double v, unsigned int decimals = 2) : s(fromFloat(v, decimals)) {}
+
+    const char* c_str() const { return s.c_str(); }
+    unsigned int length() const { return (unsigned int)s.size(); }
+    bool reserve(unsigned int size) { s.reserve(size); return true; }
+    int toInt() const { return atoi(s.c_str()); }
+    float toFloat() const { return (float)atof(s.c_str()); }
+    bool equals(const String& o) const { return s == o.s; }
+
+    String& operator+=(const String& o) { s += o.s; return *this; }
+    String& operator+=(const char* o) { s += o; return *this; }
+    String& operator+=(char c) { s += c; return *this; }
+    bool operator==(const String& o) const { return s == o.s; }
+    bool operator==(const char* o) const { return s == o; }
+    bool operator!=(const String& o) const { return s != o.s; }
+    char operator[](unsigned int i) const { return s[i]; }
+
+    friend String operator+(const String& a, const String& b) { return String(a.s + b.s); }
+    friend String operator+(const String& a, const char* b) { return String(a.s + b); }
+    friend String operator+(const char* a, const String& b) { return String(a + b.s); }
+};
+
+// Print base shared by Serial and TFT_eSPI; everything funnels into write().
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buf, size_t size) {
+        size_t n = 0;
+        while (size--) n += write(*buf++);
+        return n;
+    }
+    size_t write(const char* str) { return write((const uint8_t*)str, strlen(str)); }
+
+    size_t print(const char* str) { return write(str); }
+    size_t print(const String& str) { return write(str.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v) { return print(String(v)); }
+    size_t print(unsigned int v) { return print(String(v)); }
+    size_t print(long v) { return print(String(v)); }
+    size_t print(unsigned long v) { return print(String(v)); }
+    size_t print(double v, int digits = 2) { return print(String(v, digits)); }
+
+    size_t println() { return write("\r\n"); }
+    template <typename T> size_t println(const T& v) { size_t n = print(v); return n + println(); }
+    size_t println(double v, int digits) { size_t n = print(v, digits); return n + println(); }
+
+    size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        char buf[256];
+        va_list ap;
+        va_start(ap, fmt);
+        int len = vsnprintf(buf, sizeof(buf), fmt, ap);
+        va_end(ap);
+        if (len < 0) return 0;
+        return write((const uint8_t*)buf, std::min((size_t)len, sizeof(buf) - 1));
+    }
+};
+
+// Readable side, as in the Arduino core
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+};
+
+#define SERIAL_8N1 0x800001c
+
+// HardwareSerial records everything written and serves queued input.
+class HardwareSerial : public Stream {
+public:
+    std::string output;
+    std::string input;
+
+    explicit HardwareSerial(int uart_nr = 0) : uart(uart_nr) {}
+
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1) {
+        this->baud = baud;
+        (void)config; (void)rxPin; (void)txPin;
+    }
+    void end() {}
+    int available() override { return (int)input.size(); }
+    int read() override {
+        if (input.empty()) return -1;
+        int c = (uint8_t)input[0];
+        input.erase(0, 1);
+        return c;
+    }
+    void flush() {}
+
+    using Print::write;
+    size_t write(uint8_t c) override { output += (char)c; return 1; }
+    size_t write(const uint8_t* buf, size_t size) override {
+        output.append((const char*)buf, size);
+        return size;
+    }
+
+    operator bool() const { return true; }
+
+private:
+    int uart;
+    unsigned long baud = 0;
+};
+
+inline HardwareSerial Serial(0);
+
+// Heap figures for ESP.getFreeHeap() and friends; tests set them directly.
+namespace mock {
+    inline uint32_t heapFree = 180000;
+    inline uint32_t heapMinFree = 150000;
+    inline uint32_t heapMaxAlloc = 110000;
+    inline uint64_t efuseMac = 0x2a3b4c3a0f24ull; // 24:0f:3a:4c:3b:2a, first byte lowest
+    inline uint32_t cpuMhz = 240;
+}
+
+inline bool setCpuFrequencyMhz(uint32_t mhz) { mock::cpuMhz = mhz; return true; }
+inline uint32_t getCpuFrequencyMhz() { return mock::cpuMhz; }
+
+class EspClass {
+public:
+    uint32_t getFreeHeap() { return mock::heapFree; }
+    uint32_t getMinFreeHeap() { return mock::heapMinFree; }
+    uint32_t getMaxAllocHeap() { return mock::heapMaxAlloc; }
+    uint64_t getEfuseMac() { return mock::efuseMac; }
+};
+
+inline EspClass ESP;
@@ -0,0 +1,2 @@
+#pragma once
+// AsyncTCP is only included by the firmware; nothing from it is used directly.
@@ -0,0 +1,176 @@
+#pragma once
+// ESPAsyncWebServer stand-in for [env:native]. Routes are stored and can be
+// dispatched from a test with AsyncWebServer::handle(); the request keeps
+// the response it was answered with. A response built with a filler is
+// drained in small chunks when sent, and the disconnect handler runs when
+// the test calls disconnect() or the request goes away.
+#include <Arduino.h>
+#include <functional>
+#include <vector>
+
+typedef enum {
+    HTTP_GET = 0b00000001,
+    HTTP_POST = 0b00000010,
+    HTTP_DELETE = 0b00000100,
+    HTTP_PUT = 0b00001000,
+    HTTP_PATCH = 0b00010000,
+    HTTP_HEAD = 0b00100000,
+    HTTP_OPTIONS = 0b01000000,
+    HTTP_ANY = 0b01111111,
+} WebRequestMethod;
+typedef uint8_t WebRequestMethodComposite;
+
+class AsyncWebParameter {
+public:
+    AsyncWebParameter(const String& name, const String& value, bool form = false)
+        : _name(name), _value(value), _isForm(form) {}
+    const String& name() const { return _name; }
+    const String& value() const { return _value; }
+    bool isPost() const { return _isForm; }
+
+private:
+    String _name;
+    String _value;
+    bool _isForm;
+};
+
+typedef std::function<size_t(uint8_t* buffer, size_t maxLen, size_t index)> AwsResponseFiller;
+typedef std::function<void()> ArDisconnectHandler;
+
+class AsyncWebServerResponse {
+public:
+    int code;
+    String contentType;
+    String content;
+    AwsResponseFiller filler;  // Set for responses of `length` bytes from a callback
+    size_t length = 0;
+    std::vector<std::pair<String, String>> headers;
+
+    AsyncWebServerResponse(int code, const String& type, const String& content)
+        : code(code), contentType(type), content(content), length(content.length()) {}
+    void addHeader(const String& name, const String& value) { headers.push_back({name, value}); }
+    void setCode(int c) { code = c; }
+};
+
+class AsyncWebServerRequest {
+public:
+    int responseCode = 0;
+    String responseType;
+    String responseBody;
+    std::vector<std::pair<String, String>> responseHeaders;
+    uint32_t sends = 0;
+
+    explicit AsyncWebServerRequest(const String& url = "/", WebRequestMethodComposite method = HTTP_GET)
+        : _url(url), _method(method) {}
+    ~AsyncWebServerRequest() {
+        disconnect();
+        for (AsyncWebParameter* p : _params) delete p;
+    }
+
+    const String& url() const { return _url; }
+    WebRequestMethodComposite method() const { return _method; }
+
+    void send(int code, const char* contentType = "", const String& content = String()) {
+        responseCode = code;
+        responseType = contentType;
+        responseBody = content;
+        sends++;
+    }
+    void send(int code, const String& contentType, const String& content = String()) {
+        send(code, contentType.c_str(), content);
+    }
+
+    AsyncWebServerResponse* beginResponse(int code, const String& contentType = String(),
+                                          const String& content = String()) {
+        return new AsyncWebServerResponse(code, contentType, content);
+    }
+    AsyncWebServerResponse* beginResponse(const String& contentType, size_t len, AwsResponseFiller callback) {
+        AsyncWebServerResponse* r = new AsyncWebServerResponse(200, contentType, String());
+        r->filler = callback;
+        r->length = len;
+        return r;
+    }
+    // Takes ownership, like the library
+    void send(AsyncWebServerResponse* response) {
+        String body = response->content;
+        if (response->filler) {
+            std::string out;
+            uint8_t chunk[16];
+            while (out.size() < response->length) {
+                size_t n = response->filler(chunk, sizeof(chunk), out.size());
+                if (!n) break;
+                out.append((const char*)chunk, n);
+            }
+            body = String(out.c_str());
+        }
+        send(response->code, response->contentType, body);
+        responseHeaders = response->headers;
+        delete response;
+    }
+    String header(const char* name) const {
+        for (const auto& h : responseHeaders)
+            if (h.first == name) return h.second;
+        return String();
+    }
+
+    void onDisconnect(ArDisconnectHandler fn) { _onDisconnect = fn; }
+    // Mock only: the client closed the connection
+    void disconnect() {
+        ArDisconnectHandler fn = _onDisconnect;
+        _onDisconnect = nullptr;
+        if (fn) fn();
+    }
+
+    void addParam(const String& name, const String& value, bool post = false) {
+        _params.push_back(new AsyncWebParameter(name, value, post));
+    }
+    bool hasParam(const char* name, bool post = false) const { return getParam(name, post) != nullptr; }
+    AsyncWebParameter* getParam(const char* name, bool post = false) const {
+        for (AsyncWebParameter* p : _params)
+            if (p->name() == name && p->isPost() == post) return p;
+        return nullptr;
+    }
+    size_t params() const { return _params.size(); }
+
+private:
+    String _url;
+    WebRequestMethodComposite _method;
+    std::vector<AsyncWebParameter*> _params;
+    ArDisconnectHandler _onDisconnect;
+};
+
+typedef std::function<void(AsyncWebServerRequest* request)> ArRequestHandlerFunction;
+
+class AsyncWebServer {
+public:
+    explicit AsyncWebServer(uint16_t port) : _port(port) {}
+
+    void begin() { _running = true; }
+    void end() { _running = false; }
+    void on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest) {
+        _routes.push_back({uri, method, onRequest});
+    }
+
+    // Mock only: run the handler registered for the request's url/method.
+    bool handle(AsyncWebServerRequest* request) {
+        for (const Route& r : _routes) {
+            if (r.uri == request->url() && (r.method & request->method())) {
+                r.fn(request);
+                return true;
+            }
+        }
+        request->send(404);
+        return false;
+    }
+    bool running() const { return _running; }
+
+private:
+    struct Route {
+        String uri;
+        WebRequestMethodComposite method;
+        ArRequestHandlerFunction fn;
+    };
+    uint16_t _port;
+    bool _running = false;
+    std::vector<Route> _routes;
+};
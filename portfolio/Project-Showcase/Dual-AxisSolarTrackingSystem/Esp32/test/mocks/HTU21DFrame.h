@@ -0,0 +1,21 @@
+#pragma once
+// HTU21D replies for the scripted Wire bus, shared by test_native and
+// test_bench: two data bytes and the CRC the sensor would send.
+#include <Arduino.h>
+#include <vector>
+
+// CRC-8 (poly 0x31, init 0x00) as specified in the HTU21D datasheet.
+inline uint8_t crc8(uint8_t msb, uint8_t lsb) {
+    uint8_t crc = 0;
+    uint8_t data[2] = {msb, lsb};
+    for (int i = 0; i < 2; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : (crc << 1);
+    }
+    return crc;
+}
+
+inline std::vector<uint8_t> htuFrame(uint16_t raw) {
+    uint8_t msb = raw >> 8, lsb = raw & 0xFF;
+    return {msb, lsb, crc8(msb, lsb)};
+}
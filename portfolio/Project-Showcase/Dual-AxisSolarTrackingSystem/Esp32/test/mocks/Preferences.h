@@ -0,0 +1,65 @@
+#pragma once
+// NVS key/value store for [env:native]. Contents live in mock::nvs and
+// survive across Preferences objects, like flash survives a reboot; tests
+// clear it in setUp().
+#include <Arduino.h>
+#include <map>
+#include <string>
+
+namespace mock {
+    // namespace -> key -> raw bytes
+    inline std::map<std::string, std::map<std::string, std::string>> nvs;
+    inline uint32_t nvsWrites = 0;
+}
+
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false, const char* partition = NULL) {
+        (void)partition;
+        if (readOnly && !mock::nvs.count(name)) return false;
+        ns = name;
+        ro = readOnly;
+        open = true;
+        mock::nvs[ns];
+        return true;
+    }
+    void end() { open = false; }
+
+    bool clear() { return write() && (mock::nvs[ns].clear(), true); }
+    bool remove(const char* key) { return write() && mock::nvs[ns].erase(key) > 0; }
+    bool isKey(const char* key) { return open && mock::nvs[ns].count(key); }
+
+    size_t putBytes(const char* key, const void* value, size_t len) {
+        if (!write()) return 0;
+        mock::nvs[ns][key] = std::string((const char*)value, len);
+        return len;
+    }
+    size_t getBytesLength(const char* key) { return isKey(key) ? mock::nvs[ns][key].size() : 0; }
+    size_t getBytes(const char* key, void* buf, size_t maxLen) {
+        size_t len = getBytesLength(key);
+        if (!len || len > maxLen) return 0;
+        memcpy(buf, mock::nvs[ns][key].data(), len);
+        return len;
+    }
+
+    size_t putUChar(const char* key, uint8_t value) { return putBytes(key, &value, 1); }
+    uint8_t getUChar(const char* key, uint8_t defaultValue = 0) {
+        uint8_t v;
+        return getBytes(key, &v, 1) ? v : defaultValue;
+    }
+    size_t putString(const char* key, const String& value) { return putBytes(key, value.c_str(), value.length()); }
+    String getString(const char* key, const String& defaultValue = String()) {
+        return isKey(key) ? String(mock::nvs[ns][key]) : defaultValue;
+    }
+
+private:
+    std::string ns;
+    bool ro = false;
+    bool open = false;
+
+    bool write() {
+        if (!open || ro) return false;
+        mock::nvsWrites++;
+        return true;
+    }
+};
@@ -0,0 +1,135 @@
+#pragma once
+// TFT_eSPI stand-in for [env:native]. Text lands in `text`, fills and pixel
+// operations are counted so render cost can be asserted or benchmarked.
+// TFT_eSprite keeps real pixels, so what a widget drew can be read back.
+#include <Arduino.h>
+#include <vector>
+
+#define TFT_BLACK   0x0000
+#define TFT_WHITE   0xFFFF
+#define TFT_RED     0xF800
+#define TFT_GREEN   0x07E0
+#define TFT_BLUE    0x001F
+#define TFT_YELLOW  0xFFE0
+#define TFT_CYAN    0x07FF
+#define TFT_DARKGREY 0x7BEF
+
+#define TFT_WIDTH  135
+#define TFT_HEIGHT 240
+
+class TFT_eSPI : public Print {
+public:
+    std::string text;
+    int32_t cursorX = 0, cursorY = 0;
+    uint32_t fillScreens = 0;
+    uint32_t pixelsDrawn = 0;
+    uint32_t spritePushes = 0;
+    uint32_t pixelsPushed = 0;  // Sent by pushSprite()
+
+    TFT_eSPI(int16_t w = TFT_WIDTH, int16_t h = TFT_HEIGHT) : w(w), h(h) {}
+    virtual ~TFT_eSPI() {}
+
+    void init(uint8_t tc = 0) { (void)tc; }
+    void begin(uint8_t tc = 0) { init(tc); }
+    void setRotation(uint8_t r) {
+        rotation = r & 3;
+        if (rotation & 1) { int16_t t = w; w = h; h = t; }
+    }
+    int16_t width() const { return w; }
+    int16_t height() const { return h; }
+
+    void fillScreen(uint32_t color) {
+        (void)color;
+        fillScreens++;
+        pixelsDrawn += (uint32_t)w * h;
+    }
+    virtual void fillRect(int32_t x, int32_t y, int32_t rw, int32_t rh, uint32_t color) {
+        (void)x; (void)y; (void)color;
+        pixelsDrawn += (uint32_t)(rw * rh);
+    }
+    virtual void drawPixel(int32_t x, int32_t y, uint32_t color) { (void)x; (void)y; (void)color; pixelsDrawn++; }
+    void drawFastVLine(int32_t x, int32_t y, int32_t len, uint32_t color) { fillRect(x, y, 1, len, color); }
+    void drawFastHLine(int32_t x, int32_t y, int32_t len, uint32_t color) { fillRect(x, y, len, 1, color); }
+
+    void setTextColor(uint16_t fg, uint16_t bg) { (void)fg; (void)bg; }
+    void setTextColor(uint16_t fg) { (void)fg; }
+    void setTextSize(uint8_t s) { (void)s; }
+    void setCursor(int16_t x, int16_t y) { cursorX = x; cursorY = y; }
+
+    using Print::write;
+    size_t write(uint8_t c) override {
+        if (text.size() >= 65536) text.erase(0, 32768); // Keep long benchmark runs bounded
+        text += (char)c;
+        return 1;
+    }
+
+protected:
+    int16_t w, h;
+    uint8_t rotation = 0;
+};
+
+class TFT_eSprite : public TFT_eSPI {
+public:
+    uint32_t scrolls = 0;
+
+    explicit TFT_eSprite(TFT_eSPI* tft) : TFT_eSPI(0, 0), tft(tft) {}
+
+    void setColorDepth(int8_t b) { depth = b; }
+    void* createSprite(int16_t sw, int16_t sh, uint8_t frames = 1) {
+        (void)frames;
+        w = sw;
+        h = sh;
+        pixels.assign((size_t)sw * sh, TFT_BLACK);
+        scrollX = 0; scrollY = 0; scrollW = sw; scrollH = sh;
+        return pixels.data();
+    }
+    void deleteSprite() { pixels.clear(); w = h = 0; }
+    bool created() const { return !pixels.empty(); }
+
+    void fillSprite(uint32_t color) { fillRect(0, 0, w, h, color); }
+    void fillRect(int32_t x, int32_t y, int32_t rw, int32_t rh, uint32_t color) override {
+        for (int32_t j = y; j < y + rh; j++) {
+            for (int32_t i = x; i < x + rw; i++) {
+                drawPixel(i, j, color);
+            }
+        }
+    }
+    void drawPixel(int32_t x, int32_t y, uint32_t color) override {
+        if (x < 0 || y < 0 || x >= w || y >= h) return;
+        pixels[(size_t)y * w + x] = (uint16_t)color;
+        pixelsDrawn++;
+    }
+    uint16_t readPixel(int32_t x, int32_t y) const {
+        return (x < 0 || y < 0 || x >= w || y >= h) ? 0 : pixels[(size_t)y * w + x];
+    }
+
+    void setScrollRect(int32_t x, int32_t y, int32_t sw, int32_t sh, uint16_t color = TFT_BLACK) {
+        scrollX = x; scrollY = y; scrollW = sw; scrollH = sh; scrollFill = color;
+    }
+    // Moves the scroll rectangle's contents; the uncovered area gets the fill
+    // colour. Not counted as drawing: it is a memmove inside the sprite.
+    void scroll(int16_t dx, int16_t dy = 0) {
+        old = pixels; // Reuses its capacity after the first scroll
+        for (int32_t j = scrollY; j < scrollY + scrollH; j++) {
+            for (int32_t i = scrollX; i < scrollX + scrollW; i++) {
+                int32_t si = i - dx, sj = j - dy;
+                bool inside = si >= scrollX && si < scrollX + scrollW && sj >= scrollY && sj < scrollY + scrollH;
+                pixels[(size_t)j * w + i] = inside ? old[(size_t)sj * w + si] : scrollFill;
+            }
+        }
+        scrolls++;
+    }
+
+    void pushSprite(int32_t x, int32_t y) {
+        (void)x; (void)y;
+        tft->spritePushes++;
+        tft->pixelsPushed += (uint32_t)w * h;
+    }
+
+private:
+    TFT_eSPI* tft;
+    std::vector<uint16_t> pixels, old;
+    int8_t depth = 16;
+    int32_t scrollX = 0, scrollY = 0, scrollW = 0, scrollH = 0;
+    uint16_t scrollFill = TFT_BLACK;
+};
@@ -0,0 +1,171 @@
+#pragma once
+// WiFi station API for [env:native]. Nothing ever connects: begin() and
+// config() are recorded, and tests play the Wi-Fi driver by firing events at
+// the handlers registered with onEvent().
+#include <Arduino.h>
+#include <functional>
+#include <vector>
+
+class IPAddress {
+public:
+    IPAddress() : addr{0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : addr{a, b, c, d} {}
+
+    uint8_t operator[](int i) const { return addr[i]; }
+    bool operator==(const IPAddress& o) const { return memcmp(addr, o.addr, 4) == 0; }
+    String toString() const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", addr[0], addr[1], addr[2], addr[3]);
+        return String(buf);
+    }
+
+private:
+    uint8_t addr[4];
+};
+
+typedef enum {
+    ARDUINO_EVENT_WIFI_STA_START = 2,
+    ARDUINO_EVENT_WIFI_STA_CONNECTED = 4,
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED = 5,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP = 7,
+    ARDUINO_EVENT_WIFI_STA_LOST_IP = 8,
+    ARDUINO_EVENT_MAX = 43,
+} arduino_event_id_t;
+
+typedef struct {
+    uint8_t ssid[33];
+    uint8_t ssid_len;
+    uint8_t bssid[6];
+    uint8_t channel;
+    int authmode;
+    uint16_t aid;
+} wifi_event_sta_connected_t;
+
+typedef struct {
+    uint8_t ssid[33];
+    uint8_t ssid_len;
+    uint8_t bssid[6];
+    uint8_t reason;
+    int8_t rssi;
+} wifi_event_sta_disconnected_t;
+
+typedef union {
+    wifi_event_sta_connected_t wifi_sta_connected;
+    wifi_event_sta_disconnected_t wifi_sta_disconnected;
+} arduino_event_info_t;
+
+typedef std::function<void(arduino_event_id_t event, arduino_event_info_t info)> WiFiEventFuncCb;
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6,
+} wl_status_t;
+
+typedef enum {
+    WIFI_PS_NONE,
+    WIFI_PS_MIN_MODEM,
+    WIFI_PS_MAX_MODEM,
+} wifi_ps_type_t;
+
+typedef int wifi_mode_t;
+#define WIFI_OFF 0
+#define WIFI_STA 1
+
+#define WIFI_REASON_AUTH_FAIL      202
+#define WIFI_REASON_BEACON_TIMEOUT 200
+#define WIFI_REASON_NO_AP_FOUND    201
+
+class WiFiClass {
+public:
+    struct Attempt {
+        std::string ssid, password;
+        int32_t channel;
+        bool fast;          // A BSSID was passed
+        uint8_t bssid[6];
+        uint64_t at_us;
+    };
+    std::vector<Attempt> attempts;
+    IPAddress staticIp;
+    bool configured = false;
+    bool autoReconnect = true;
+    bool persist = true;
+    wifi_mode_t wifiMode = WIFI_OFF;
+    int8_t rssi = -60;      // Reported while connected
+    wifi_ps_type_t sleepType = WIFI_PS_MIN_MODEM; // The core's default
+
+    wl_status_t begin(const char* ssid, const char* passphrase = NULL, int32_t channel = 0,
+                      const uint8_t* bssid = NULL, bool connect = true) {
+        Attempt a = {ssid, passphrase ? passphrase : "", channel, bssid != NULL, {0}, mock::now_us};
+        if (bssid) memcpy(a.bssid, bssid, 6);
+        (void)connect;
+        attempts.push_back(a);
+        return state;
+    }
+    bool config(IPAddress local, IPAddress gateway, IPAddress subnet, IPAddress dns = IPAddress()) {
+        (void)gateway; (void)subnet; (void)dns;
+        staticIp = local;
+        configured = true;
+        return true;
+    }
+    bool mode(wifi_mode_t m) { wifiMode = m; return true; }
+    bool setSleep(bool enabled) { return setSleep(enabled ? WIFI_PS_MIN_MODEM : WIFI_PS_NONE); }
+    bool setSleep(wifi_ps_type_t type) { sleepType = type; return true; }
+    wifi_ps_type_t getSleep() { return sleepType; }
+    bool setAutoReconnect(bool on) { autoReconnect = on; return true; }
+    void persistent(bool on) { persist = on; }
+    bool disconnect(bool wifioff = false, bool eraseap = false) {
+        (void)wifioff; (void)eraseap;
+        state = WL_DISCONNECTED;
+        return true;
+    }
+    wl_status_t status() { return state; }
+    IPAddress localIP() { return ip; }
+    int8_t RSSI() { return state == WL_CONNECTED ? rssi : 0; }
+
+    int onEvent(WiFiEventFuncCb cb, arduino_event_id_t event = ARDUINO_EVENT_MAX) {
+        handlers.push_back({cb, event});
+        return (int)handlers.size();
+    }
+
+    // Driver side, for tests
+    void fireConnected(const uint8_t bssid[6], uint8_t channel) {
+        arduino_event_info_t info = {};
+        memcpy(info.wifi_sta_connected.bssid, bssid, 6);
+        info.wifi_sta_connected.channel = channel;
+        fire(ARDUINO_EVENT_WIFI_STA_CONNECTED, info);
+    }
+    void fireGotIp(IPAddress addr) {
+        ip = addr;
+        state = WL_CONNECTED;
+        fire(ARDUINO_EVENT_WIFI_STA_GOT_IP, {});
+    }
+    void fireDisconnected(uint8_t reason) {
+        arduino_event_info_t info = {};
+        info.wifi_sta_disconnected.reason = reason;
+        ip = IPAddress();
+        state = WL_DISCONNECTED;
+        fire(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, info);
+    }
+    void resetMock() { *this = WiFiClass(); }
+
+private:
+    struct Handler {
+        WiFiEventFuncCb cb;
+        arduino_event_id_t event;
+    };
+    std::vector<Handler> handlers;
+    wl_status_t state = WL_DISCONNECTED;
+    IPAddress ip;
+
+    void fire(arduino_event_id_t event, arduino_event_info_t info) {
+        for (const Handler& h : handlers) {
+            if (h.event == ARDUINO_EVENT_MAX || h.event == event) h.cb(event, info);
+        }
+    }
+};
+
+inline WiFiClass WiFi;
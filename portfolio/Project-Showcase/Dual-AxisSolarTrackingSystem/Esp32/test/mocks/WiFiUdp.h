@@ -0,0 +1,44 @@
+#pragma once
+// WiFiUDP for [env:native]: every datagram a sketch sends is recorded with
+// its destination instead of going anywhere.
+#include <WiFi.h>
+#include <vector>
+
+class WiFiUDP {
+public:
+    struct Datagram {
+        IPAddress ip;
+        uint16_t port;
+        std::vector<uint8_t> data;
+    };
+    static inline std::vector<Datagram> sent;
+    static inline bool failSend = false; // endPacket() reports an error
+
+    int beginPacket(IPAddress ip, uint16_t port) {
+        packet = {ip, port, {}};
+        open = true;
+        return 1;
+    }
+    size_t write(const uint8_t* buf, size_t size) {
+        if (!open) return 0;
+        packet.data.insert(packet.data.end(), buf, buf + size);
+        return size;
+    }
+    int endPacket() {
+        if (!open) return 0;
+        open = false;
+        if (failSend) return 0;
+        sent.push_back(packet);
+        return 1;
+    }
+    void stop() { open = false; }
+
+    static void resetMock() {
+        sent.clear();
+        failSend = false;
+    }
+
+private:
+    Datagram packet;
+    bool open = false;
+};
@@ -0,0 +1,87 @@
+#pragma once
+// Scripted I2C bus for [env:native]. Tests queue the bytes a device should
+// answer with; every write and request is logged so drivers can be checked.
+#include <Arduino.h>
+#include <deque>
+#include <vector>
+
+class TwoWire {
+public:
+    struct Transfer {
+        uint8_t addr;
+        std::vector<uint8_t> bytes;
+    };
+
+    std::deque<std::vector<uint8_t>> responses; // Served in order by requestFrom()
+    std::vector<Transfer> writes;               // Completed write transactions
+    uint32_t clock = 100000;
+    int beginCount = 0;
+    int nackNext = 0;                           // Number of upcoming endTransmission() calls to fail
+    uint8_t failCode = 2;                       // ...and what they return (2: address NACK, 5: timeout)
+
+    explicit TwoWire(uint8_t bus_num = 0) : bus(bus_num) {}
+
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0) {
+        (void)sda; (void)scl;
+        if (frequency) clock = frequency;
+        beginCount++;
+        return true;
+    }
+    bool end() { return true; }
+    bool setClock(uint32_t frequency) { clock = frequency; return true; }
+    uint32_t getClock() { return clock; }
+    void setTimeOut(uint16_t) {}
+
+    void beginTransmission(uint8_t address) {
+        pending.addr = address;
+        pending.bytes.clear();
+    }
+    size_t write(uint8_t data) { pending.bytes.push_back(data); return 1; }
+    size_t write(const uint8_t* data, size_t len) {
+        pending.bytes.insert(pending.bytes.end(), data, data + len);
+        return len;
+    }
+    uint8_t endTransmission(bool sendStop = true) {
+        (void)sendStop;
+        if (nackNext > 0) {
+            nackNext--;
+            return failCode; // As reported by the ESP32 core
+        }
+        writes.push_back(pending);
+        return 0;
+    }
+
+    uint8_t requestFrom(uint8_t address, uint8_t quantity, bool sendStop = true) {
+        (void)address; (void)sendStop;
+        rx.clear();
+        rxPos = 0;
+        if (responses.empty()) return 0;
+        rx = responses.front();
+        responses.pop_front();
+        if (rx.size() > quantity) rx.resize(quantity);
+        return (uint8_t)rx.size();
+    }
+    int available() { return (int)(rx.size() - rxPos); }
+    int read() { return rxPos < rx.size() ? rx[rxPos++] : -1; }
+    int peek() { return rxPos < rx.size() ? rx[rxPos] : -1; }
+
+    void queueResponse(std::vector<uint8_t> bytes) { responses.push_back(std::move(bytes)); }
+    void resetMock() {
+        responses.clear();
+        writes.clear();
+        rx.clear();
+        rxPos = 0;
+        nackNext = 0;
+        failCode = 2;
+        beginCount = 0;
+        clock = 100000;
+    }
+
+private:
+    uint8_t bus;
+    Transfer pending;
+    std::vector<uint8_t> rx;
+    size_t rxPos = 0;
+};
+
+inline TwoWire Wire(0);
@@ -0,0 +1,60 @@
+#pragma once
+// Legacy ESP-IDF ADC1 driver API for [env:native]. Configuration calls are
+// recorded per channel so tests can check what a sensor set up.
+#include <Arduino.h>
+#include <cstdint>
+
+typedef int esp_err_t;
+#ifndef ESP_OK
+#define ESP_OK 0
+#endif
+
+typedef enum {
+    ADC_WIDTH_BIT_9 = 0,
+    ADC_WIDTH_BIT_10,
+    ADC_WIDTH_BIT_11,
+    ADC_WIDTH_BIT_12,
+} adc_bits_width_t;
+
+typedef enum {
+    ADC_ATTEN_DB_0 = 0,
+    ADC_ATTEN_DB_2_5,
+    ADC_ATTEN_DB_6,
+    ADC_ATTEN_DB_12,
+} adc_atten_t;
+#define ADC_ATTEN_DB_11 ADC_ATTEN_DB_12
+
+typedef enum {
+    ADC1_CHANNEL_0 = 0, // GPIO36
+    ADC1_CHANNEL_1,     // GPIO37
+    ADC1_CHANNEL_2,     // GPIO38
+    ADC1_CHANNEL_3,     // GPIO39
+    ADC1_CHANNEL_4,     // GPIO32
+    ADC1_CHANNEL_5,     // GPIO33
+    ADC1_CHANNEL_6,     // GPIO34
+    ADC1_CHANNEL_7,     // GPIO35
+    ADC1_CHANNEL_MAX,
+} adc1_channel_t;
+
+namespace mock {
+    inline int adcWidth = -1;
+    inline int adcAtten[ADC1_CHANNEL_MAX] = {-1, -1, -1, -1, -1, -1, -1, -1};
+    inline int adcConfigCalls = 0;
+}
+
+inline esp_err_t adc1_config_width(adc_bits_width_t width) {
+    mock::adcWidth = width;
+    return ESP_OK;
+}
+
+inline esp_err_t adc1_config_channel_atten(adc1_channel_t channel, adc_atten_t atten) {
+    mock::adcAtten[channel] = atten;
+    mock::adcConfigCalls++;
+    return ESP_OK;
+}
+
+// Reads mock::analog[] of the GPIO behind the channel, like analogRead()
+inline int adc1_get_raw(adc1_channel_t channel) {
+    static const int gpio[ADC1_CHANNEL_MAX] = {36, 37, 38, 39, 32, 33, 34, 35};
+    return mock::analog[gpio[channel]];
+}
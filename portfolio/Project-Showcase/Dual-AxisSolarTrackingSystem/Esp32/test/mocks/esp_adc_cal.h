@@ -0,0 +1,7 @@
+#pragma once
+// Calibration API placeholder for [env:native]; the firmware only includes it.
+#include <driver/adc.h>
+
+typedef struct {
+    uint32_t vref;
+} esp_adc_cal_characteristics_t;
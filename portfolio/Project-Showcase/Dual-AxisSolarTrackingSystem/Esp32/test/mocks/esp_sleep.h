@@ -0,0 +1,24 @@
+#pragma once
+// Sleep API for [env:native]. A light sleep advances the mock clock by the
+// armed timer, as the RTC timer would wake the chip.
+#include <Arduino.h>
+
+typedef int esp_err_t;
+#ifndef ESP_OK
+#define ESP_OK 0
+#endif
+
+namespace mock {
+    inline uint64_t sleepTimerUs = 0;
+    inline uint32_t lightSleeps = 0;
+}
+
+inline esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us) {
+    mock::sleepTimerUs = time_in_us;
+    return ESP_OK;
+}
+inline esp_err_t esp_light_sleep_start() {
+    mock::lightSleeps++;
+    mock::advance_us(mock::sleepTimerUs);
+    return ESP_OK;
+}
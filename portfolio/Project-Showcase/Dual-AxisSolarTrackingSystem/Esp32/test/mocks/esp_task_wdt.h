@@ -0,0 +1,23 @@
+#pragma once
+// Task watchdog for [env:native]. Counts calls so tests can see feeding.
+#include "freertos/FreeRTOS.h"
+
+typedef int esp_err_t;
+#ifndef ESP_OK
+#define ESP_OK 0
+#endif
+
+namespace mock {
+    inline uint32_t wdtTimeout = 0;
+    inline int wdtTasks = 0;
+    inline uint32_t wdtResets = 0;
+}
+
+inline esp_err_t esp_task_wdt_init(uint32_t timeout_s, bool panic) {
+    (void)panic;
+    mock::wdtTimeout = timeout_s;
+    return ESP_OK;
+}
+inline esp_err_t esp_task_wdt_add(TaskHandle_t) { mock::wdtTasks++; return ESP_OK; }
+inline esp_err_t esp_task_wdt_delete(TaskHandle_t) { mock::wdtTasks--; return ESP_OK; }
+inline esp_err_t esp_task_wdt_reset() { mock::wdtResets++; return ESP_OK; }
@@ -0,0 +1,6 @@
+#pragma once
+// esp_timer for [env:native]: the 64-bit microsecond clock since boot,
+// read from the same mock clock as micros(), which it does not wrap with.
+#include <Arduino.h>
+
+inline int64_t esp_timer_get_time() { return (int64_t)mock::now_us; }
@@ -0,0 +1,31 @@
+#pragma once
+// FreeRTOS types and tick conversion for [env:native]. One tick is 1 ms,
+// matching CONFIG_FREERTOS_HZ=1000 on the Arduino-ESP32 core.
+#include <cstdint>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdPASS  pdTRUE
+#define pdFAIL  pdFALSE
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS 1
+#define configTICK_RATE_HZ 1000
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+// Critical sections are no-ops: mock tasks never run concurrently.
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define taskENTER_CRITICAL(mux) ((void)(mux))
+#define taskEXIT_CRITICAL(mux) ((void)(mux))
+
+namespace mock {
+    // Virtual time in microseconds since "boot", shared with Arduino.h.
+    inline uint64_t now_us = 0;
+}
@@ -0,0 +1,32 @@
+#pragma once
+// Queue API for [env:native]. Copies items in and out like the real queue,
+// but never blocks: a full queue or an empty one fails at once.
+#include "freertos/FreeRTOS.h"
+#include <cstring>
+#include <deque>
+#include <string>
+
+struct QueueDefinition {
+    std::deque<std::string> items;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+};
+typedef QueueDefinition* QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    return new QueueDefinition{{}, length, itemSize};
+}
+inline void vQueueDelete(QueueHandle_t q) { delete q; }
+
+inline BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t) {
+    if (q->items.size() >= q->length) return pdFALSE;
+    q->items.emplace_back((const char*)item, q->itemSize);
+    return pdTRUE;
+}
+inline BaseType_t xQueueReceive(QueueHandle_t q, void* item, TickType_t) {
+    if (q->items.empty()) return pdFALSE;
+    memcpy(item, q->items.front().data(), q->itemSize);
+    q->items.pop_front();
+    return pdTRUE;
+}
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) { return (UBaseType_t)q->items.size(); }
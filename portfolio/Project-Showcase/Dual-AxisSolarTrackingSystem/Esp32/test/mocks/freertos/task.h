@@ -0,0 +1,51 @@
+#pragma once
+// Task API for [env:native]. Tasks are not run: creation records the entry
+// point so a test can drive one iteration by hand, and delays advance the
+// virtual clock from Arduino.h.
+#include "freertos/FreeRTOS.h"
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace mock {
+    struct Task {
+        TaskFunction_t fn;
+        const char* name;
+        uint32_t stack;
+        void* arg;
+        UBaseType_t prio;
+        BaseType_t core;
+    };
+    inline std::vector<Task> tasks;
+}
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                                          UBaseType_t prio, TaskHandle_t* handle, BaseType_t core) {
+    mock::tasks.push_back({fn, name, stack, arg, prio, core});
+    if (handle) *handle = (TaskHandle_t)(uintptr_t)mock::tasks.size();
+    return pdPASS;
+}
+
+inline BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                              UBaseType_t prio, TaskHandle_t* handle) {
+    return xTaskCreatePinnedToCore(fn, name, stack, arg, prio, handle, tskNO_AFFINITY);
+}
+
+inline void vTaskDelete(TaskHandle_t) {}
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return (TaskHandle_t)1; }
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 1024; }
+inline TickType_t xTaskGetTickCount() { return (TickType_t)(mock::now_us / 1000); }
+inline void vTaskDelay(TickType_t ticks) { mock::now_us += (uint64_t)ticks * 1000; }
+
+// Notifications are counted per task; nothing waits, so a take returns what
+// has been given so far.
+namespace mock {
+    inline std::map<TaskHandle_t, uint32_t> notifications;
+}
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task) { mock::notifications[task]++; return pdPASS; }
+inline uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t) {
+    uint32_t& n = mock::notifications[xTaskGetCurrentTaskHandle()];
+    uint32_t v = n;
+    n = clearOnExit ? 0 : (n ? n - 1 : 0);
+    return v;
+}
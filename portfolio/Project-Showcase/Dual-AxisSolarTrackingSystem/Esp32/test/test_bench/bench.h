@@ -0,0 +1,91 @@
+#pragma once
+// Tiny Google-Benchmark-style harness for the native microbenchmarks.
+// Each kernel is run in growing batches until it has taken at least
+// `minTime`, then the per-iteration wall time (and TSC cycles on x86) is
+// printed in a fixed format that scripts can diff between commits:
+//
+//   bench <name> <ns/op> ns/op <cycles/op> cycles/op <iterations> iters
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC 1
+#endif
+
+namespace bench {
+
+struct Result {
+    double nsPerOp;
+    double cyclesPerOp;
+    uint64_t iterations;
+};
+
+// Keeps the compiler from discarding a value computed by a kernel.
+template <typename T> inline void doNotOptimize(T const& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline uint64_t cycles() {
+#ifdef BENCH_HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+inline Result report(const char* name, std::chrono::nanoseconds elapsed, uint64_t cycles, uint64_t iterations) {
+    Result r;
+    r.iterations = iterations;
+    r.nsPerOp = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    r.cyclesPerOp = (double)cycles / iterations;
+    printf("bench %-32s %10.1f ns/op %10.1f cycles/op %12llu iters\n", name, r.nsPerOp, r.cyclesPerOp,
+           (unsigned long long)r.iterations);
+    return r;
+}
+
+template <typename F>
+Result run(const char* name, F&& kernel, std::chrono::nanoseconds minTime = std::chrono::milliseconds(200)) {
+    using clock = std::chrono::steady_clock;
+    for (int i = 0; i < 16; i++) kernel(); // Warm caches and branch predictors
+
+    uint64_t batch = 1;
+    for (;;) {
+        uint64_t c0 = cycles();
+        auto t0 = clock::now();
+        for (uint64_t i = 0; i < batch; i++) kernel();
+        auto elapsed = clock::now() - t0;
+        uint64_t c1 = cycles();
+
+        if (elapsed >= minTime || batch >= (1ULL << 32)) {
+            return report(name, elapsed, c1 - c0, batch);
+        }
+        batch *= elapsed < minTime / 10 ? 10 : 2;
+    }
+}
+
+// Like run(), for a kernel that fills something up: `reset` is called
+// after every `every` iterations, outside the timed region, so only the
+// kernel itself is in the figure.
+template <typename F, typename R>
+Result runWithReset(const char* name, uint64_t every, F&& kernel, R&& reset,
+                    std::chrono::nanoseconds minTime = std::chrono::milliseconds(200)) {
+    using clock = std::chrono::steady_clock;
+    for (uint64_t i = 0; i < every; i++) kernel();
+    reset();
+
+    std::chrono::nanoseconds elapsed(0);
+    uint64_t spent = 0, iterations = 0;
+    while (elapsed < minTime && iterations < (1ULL << 32)) {
+        uint64_t c0 = cycles();
+        auto t0 = clock::now();
+        for (uint64_t i = 0; i < every; i++) kernel();
+        elapsed += clock::now() - t0;
+        spent += cycles() - c0;
+        iterations += every;
+        reset();
+    }
+    return report(name, elapsed, spent, iterations);
+}
+
+} // namespace bench
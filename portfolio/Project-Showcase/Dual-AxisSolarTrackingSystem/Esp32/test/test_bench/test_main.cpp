@@ -0,0 +1,226 @@
+// Host microbenchmarks for the firmware's hot kernels. Run with
+// `pio test -e native -f test_bench -v` and compare the "bench" lines
+// before and after a change. Every case also sanity-checks its result so a
+// broken kernel cannot post a fast time.
+#include <unity.h>
+#include <Arduino.h>
+#include <Wire.h>
+#include <HTU21DFrame.h>
+#include "HTU.h"
+#include "Lys.h"
+#include "StripChart.h"
+#include <BinLog.h>
+#include "bench.h"
+
+void setUp() {
+    mock::reset();
+    Wire.resetMock();
+    Serial.output.clear();
+}
+
+void tearDown() {}
+
+// CRC check plus fixed conversion of one temperature and one humidity frame,
+// i.e. everything HTU21D::measure() does apart from waiting on the bus.
+void bench_htu21d_crc_and_conversion() {
+    HTU21D htu;
+    const std::vector<uint8_t> t = htuFrame(0x6800);
+    const std::vector<uint8_t> h = htuFrame(0x7C80);
+    bool ok = true;
+    bench::run("htu21d_crc_and_conversion", [&] {
+        Wire.responses.push_back(t);
+        Wire.responses.push_back(h);
+        ok &= htu.measure();
+        Wire.writes.clear();
+        bench::doNotOptimize(htu.getHumidity());
+    });
+    TEST_ASSERT_TRUE(ok);
+}
+
+// The conversion kernels on their own, over a sweep of raw values: the
+// double-precision formulas HTU21D used before, against the integer ones
+// it uses now. On the ESP32 the doubles are emulated in software, so the
+// gap there is far wider than on the host.
+static float doubleTemperature(uint16_t St) {
+    return -46.85 + 175.72 * St / 65536.0;
+}
+
+static float doubleHumidity(uint16_t Srh, float temperature) {
+    double humidity = -6.0 + 125.0 * Srh / 65536.0;
+    humidity += (25.0 - temperature) * -0.15;
+    return humidity < 0.0 ? 0.0 : humidity > 100.0 ? 100.0 : humidity;
+}
+
+void bench_htu21d_convert_double() {
+    uint16_t raw = 0x4000;
+    float h = 0;
+    bench::run("htu21d_convert_double", [&] {
+        raw += 0x0124;
+        float t = doubleTemperature(raw & 0xFFFC);
+        h = doubleHumidity((raw ^ 0x5A5A) & 0xFFFC, t);
+        bench::doNotOptimize(h);
+    });
+    TEST_ASSERT_TRUE(h >= 0 && h <= 100);
+}
+
+void bench_htu21d_convert_fixed() {
+    uint16_t raw = 0x4000;
+    int16_t h = 0;
+    bench::run("htu21d_convert_fixed", [&] {
+        raw += 0x0124;
+        int16_t t = HTU21D::centiCelsius(raw & 0xFFFC);
+        h = HTU21D::centiHumidity((raw ^ 0x5A5A) & 0xFFFC, t);
+        bench::doNotOptimize(h);
+    });
+    TEST_ASSERT_TRUE(h >= 0 && h <= 10000);
+}
+
+// CRC of one reply, bit by bit as before and by table as now
+void bench_htu21d_crc_bitwise() {
+    uint8_t data[2] = {0x68, 0x00};
+    uint8_t crc = 0;
+    bench::run("htu21d_crc_bitwise", [&] {
+        data[1]++;
+        crc = crc8(data[0], data[1]);
+        bench::doNotOptimize(crc);
+    });
+    TEST_ASSERT_EQUAL(HTU21D::crc8(data, 2), crc);
+}
+
+void bench_htu21d_crc_table() {
+    uint8_t data[2] = {0x68, 0x00};
+    uint8_t crc = 0;
+    bench::run("htu21d_crc_table", [&] {
+        data[1]++;
+        crc = HTU21D::crc8(data, 2);
+        bench::doNotOptimize(crc);
+    });
+    TEST_ASSERT_EQUAL(crc8(data[0], data[1]), crc);
+}
+
+// Empties the log ring; the binary encoding is what the drain task pays for
+static size_t drainLog() {
+    static HardwareSerial sink(0);
+    size_t n = binlog.drain(sink, false);
+    sink.output.clear();
+    return n;
+}
+
+// LOG_INFO() of one reading, as readSensorsTask() and sendFrame() log on
+// the hot path: only the producer side, which is all the calling task pays.
+// The ring is emptied untimed every 64 records so no record is dropped.
+void bench_log_write_three_args() {
+    float temperature = 24.54f;
+    uint32_t n = 0;
+    bench::runWithReset(
+        "log_write_three_args", 64,
+        [&] {
+            LOG_INFO("trace %lu temp %.2f n %d", (unsigned long)n, temperature, (int)n);
+            n++;
+        },
+        [] { drainLog(); });
+    TEST_ASSERT_EQUAL(0, binlog.dropped());
+}
+
+// The drain task's share: encoding and framing 64 such records for the
+// UART, queued untimed before each run
+void bench_log_drain_64_records() {
+    static HardwareSerial sink(0);
+    float temperature = 24.54f;
+    uint32_t n = 0;
+    size_t drained = 0;
+    auto fill = [&] {
+        for (int i = 0; i < 64; i++, n++) {
+            LOG_INFO("trace %lu temp %.2f n %d", (unsigned long)n, temperature, (int)n);
+        }
+    };
+    fill();
+    bench::runWithReset(
+        "log_drain_64_records", 1,
+        [&] {
+            drained = binlog.drain(sink, false);
+            sink.output.clear();
+        },
+        fill);
+    drainLog();
+    TEST_ASSERT_EQUAL(64, drained);
+    TEST_ASSERT_EQUAL(0, binlog.dropped());
+}
+
+// DisplayHandler::showData(), the per-sensor TFT text path in loop().
+void bench_display_show_data() {
+    DisplayHandler display;
+    bench::run("display_show_data", [&] {
+        display.showData("Light Intensity", 2048, 1.65f, 0, 30);
+    });
+    const std::string& text = display.screen().text;
+    const std::string line = "Light Intensity: 2048 Voltage: 1.65 V\r\n";
+    TEST_ASSERT_TRUE(text.size() >= line.size());
+    TEST_ASSERT_EQUAL_STRING(line.c_str(), text.c_str() + text.size() - line.size());
+    TEST_ASSERT_EQUAL(30, display.screen().cursorY);
+}
+
+// LightSensor::Sunsearch(), the direction decision made every loop.
+void bench_sunsearch() {
+    DisplayHandler display;
+    LightSensor sensor(32);
+    int right = 900;
+    uint32_t n = 0, wrong = 0;
+    bench::run("sunsearch", [&] {
+        String direction = sensor.Sunsearch(100, right, 300, 200, display);
+        wrong += direction != "Højre";
+        if (++n % 64 == 0) {
+            drainLog();
+        }
+        right ^= 1;
+    });
+    drainLog();
+    TEST_ASSERT_EQUAL(0, wrong);
+    TEST_ASSERT_EQUAL_STRING("Op", sensor.Sunsearch(100, 200, 300, 200, display).c_str());
+    TEST_ASSERT_NOT_EQUAL(std::string::npos, display.screen().text.rfind("Max Intensity: Op\r\nValue: 300\r\n"));
+    TEST_ASSERT_EQUAL(0, binlog.dropped());
+}
+
+// LightSensorArray::sample() plus brightest(), the ADC half of every loop.
+void bench_light_sensor_array_sample() {
+    LightSensorArray<32, 33, 39, 36> sensors;
+    mock::analog[33] = 900;
+    int light[sensors.size];
+    size_t best = 0;
+    bench::run("light_sensor_array_sample", [&] {
+        sensors.sample(light);
+        best = sensors.brightest(light);
+        bench::doNotOptimize(best);
+    });
+    TEST_ASSERT_EQUAL(1, best);
+}
+
+// StripChart::add() on the 90-column, two-series light balance chart: one
+// sprite scroll, one column and one push per loop.
+void bench_strip_chart_add() {
+    TFT_eSPI tft;
+    StripChart<90, 2> chart(tft, 150, 72, 28, -4095, 4095);
+    chart.begin();
+    float balance[2] = {0, 0};
+    bench::run("strip_chart_add", [&] {
+        balance[0] = balance[0] > 4000 ? -4000 : balance[0] + 37;
+        chart.add(balance);
+    });
+    TEST_ASSERT_EQUAL(90, chart.size());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(bench_htu21d_crc_and_conversion);
+    RUN_TEST(bench_htu21d_convert_double);
+    RUN_TEST(bench_htu21d_convert_fixed);
+    RUN_TEST(bench_htu21d_crc_bitwise);
+    RUN_TEST(bench_htu21d_crc_table);
+    RUN_TEST(bench_log_write_three_args);
+    RUN_TEST(bench_log_drain_64_records);
+    RUN_TEST(bench_display_show_data);
+    RUN_TEST(bench_sunsearch);
+    RUN_TEST(bench_light_sensor_array_sample);
+    RUN_TEST(bench_strip_chart_add);
+    return UNITY_END();
+}
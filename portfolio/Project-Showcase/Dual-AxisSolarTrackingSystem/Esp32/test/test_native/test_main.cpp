@@ -0,0 +1,1197 @@
+// Unit tests for the sensor and control code in include/, run on the host
+// through the mocks in test/mocks (`pio test -e native -f test_native`).
+#include <unity.h>
+#include <Arduino.h>
+#include <Wire.h>
+#include <HTU21DFrame.h>
+#include "HTU.h"
+#include "Lys.h"
+#include "Endpoints.h"
+#include "Frame.h"
+#include "Wifi_Config.h"
+#include "Metrics.h"
+#include "PowerManager.h"
+#include "PowerPolicy.h"
+#include "Setpoint.h"
+#include "StripChart.h"
+#include "Supervisor.h"
+#include "Telemetry.h"
+#include <I2CBus.h>
+#include <BinLog.h>
+
+// Everything logged since the last call, as the drain task's text mode prints it
+static std::string logText() {
+    HardwareSerial out(0);
+    binlog.drain(out, true);
+    return out.output;
+}
+
+void setUp() {
+    logText();
+    mock::reset();
+    Wire.resetMock();
+    Serial.output.clear();
+    WiFi.resetMock();
+    WiFiUDP::resetMock();
+    mock::nvs.clear();
+}
+
+void tearDown() {}
+
+void test_htu21d_begin_detects_sensor() {
+    HTU21D htu;
+    Wire.queueResponse({0x02}); // User register after soft reset
+    TEST_ASSERT_TRUE(htu.begin());
+    TEST_ASSERT_EQUAL(RESOLUTION_RH12_T14, htu.getResolution());
+}
+
+void test_htu21d_begin_without_sensor_fails() {
+    HTU21D htu;
+    TEST_ASSERT_FALSE(htu.begin());
+}
+
+void test_htu21d_measure_converts_raw_values() {
+    HTU21D htu;
+    Wire.queueResponse(htuFrame(0x6800)); // 24.54 °C
+    Wire.queueResponse(htuFrame(0x7C80)); // ~54.8 %RH before compensation
+    TEST_ASSERT_TRUE(htu.measure());
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, -46.85f + 175.72f * 0x6800 / 65536.0f, htu.getTemperature());
+    float rh = -6.0f + 125.0f * 0x7C80 / 65536.0f + (25.0f - htu.getTemperature()) * -0.15f;
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, rh, htu.getHumidity());
+}
+
+void test_htu21d_measure_rejects_bad_crc() {
+    HTU21D htu;
+    std::vector<uint8_t> frame = htuFrame(0x6800);
+    frame[2] ^= 0x01;
+    Wire.queueResponse(frame);
+    TEST_ASSERT_FALSE(htu.measure());
+    TEST_ASSERT_TRUE(isnan(htu.getTemperature()));
+}
+
+void test_htu21d_humidity_is_clamped() {
+    HTU21D htu;
+    Wire.queueResponse(htuFrame(0x6800));
+    Wire.queueResponse(htuFrame(0xFFFC));
+    TEST_ASSERT_TRUE(htu.measure());
+    TEST_ASSERT_EQUAL_FLOAT(100.0f, htu.getHumidity());
+}
+
+void test_htu21d_fixed_point_matches_datasheet_formulas() {
+    for (uint32_t raw = 0; raw <= 0xFFFC; raw += 4) {
+        uint8_t b[2] = {(uint8_t)(raw >> 8), (uint8_t)raw};
+        TEST_ASSERT_EQUAL_HEX8(crc8(b[0], b[1]), HTU21D::crc8(b, 2));
+
+        double t = -46.85 + 175.72 * raw / 65536.0;
+        int16_t centiC = HTU21D::centiCelsius((uint16_t)raw);
+        TEST_ASSERT_TRUE(fabs(centiC / 100.0 - t) <= 0.005 + 1e-9);
+
+        // Compensated with the rounded temperature, as the driver does
+        double rh = -6.0 + 125.0 * raw / 65536.0 + (25.0 - centiC / 100.0) * -0.15;
+        rh = rh < 0 ? 0 : rh > 100 ? 100 : rh;
+        TEST_ASSERT_TRUE(fabs(HTU21D::centiHumidity((uint16_t)raw, centiC) / 100.0 - rh) <= 0.01 + 1e-9);
+    }
+}
+
+void test_htu21d_burst_trims_outliers_and_restores_resolution() {
+    HTU21D htu;
+    const uint16_t temps[] = {0x6800, 0x6804, 0x6808, 0xF000, 0x680C, 0x1000, 0x6810, 0x6814};
+    for (uint16_t t : temps) {
+        Wire.queueResponse(htuFrame(t));
+        Wire.queueResponse(htuFrame(0x7C80));
+    }
+    TEST_ASSERT_TRUE(htu.measureBurst(8, RESOLUTION_RH11_T11));
+    // The two outliers are the lowest and highest quarter
+    int32_t sum = 0;
+    for (uint16_t t : {0x6804, 0x6808, 0x680C, 0x6810}) sum += HTU21D::centiCelsius(t);
+    TEST_ASSERT_EQUAL((sum + 2) / 4, htu.getTemperatureCenti());
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, htu.getTemperatureCenti() / 100.0f, htu.getTemperature());
+    TEST_ASSERT_EQUAL(RESOLUTION_RH12_T14, htu.getResolution());
+
+    // User register written for the burst and back: RH11_T11 is 0x83, RH12_T14 0x02
+    std::vector<uint8_t> regs;
+    for (const auto& w : Wire.writes) {
+        if (w.bytes.size() == 2 && w.bytes[0] == 0xE6) regs.push_back(w.bytes[1]);
+    }
+    TEST_ASSERT_EQUAL(2, regs.size());
+    TEST_ASSERT_EQUAL_HEX8(0x83, regs[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x02, regs[1]);
+
+    // Fewer than half the samples read: no result
+    Wire.resetMock();
+    Wire.queueResponse(htuFrame(0x6800));
+    Wire.queueResponse(htuFrame(0x7C80));
+    TEST_ASSERT_FALSE(htu.measureBurst(4, RESOLUTION_RH12_T14));
+    TEST_ASSERT_EQUAL(HTU21D_INVALID, htu.getTemperatureCenti());
+    TEST_ASSERT_TRUE(isnan(htu.getHumidity()));
+}
+
+void test_temperature_endpoint_reports_missing_sensor() {
+    // `sensor` has not been begun, so it has no sensor to read.
+    AsyncWebServerRequest request("/temperature");
+    handleTemperature(&request);
+    TEST_ASSERT_EQUAL(500, request.responseCode);
+}
+
+static void resetAdc() {
+    mock::adcWidth = -1;
+    for (int c = 0; c < ADC1_CHANNEL_MAX; c++) mock::adcAtten[c] = -1;
+    mock::adcConfigCalls = 0;
+}
+
+void test_light_sensor_array_configures_each_channel_once() {
+    resetAdc();
+    LightSensorArray<32, 33, 39, 36> sensors;
+    sensors.begin();
+    TEST_ASSERT_EQUAL(ADC_WIDTH_BIT_12, mock::adcWidth);
+    TEST_ASSERT_EQUAL(4, mock::adcConfigCalls);
+    TEST_ASSERT_EQUAL(ADC_ATTEN_DB_12, mock::adcAtten[ADC1_CHANNEL_4]); // GPIO32
+    TEST_ASSERT_EQUAL(ADC_ATTEN_DB_12, mock::adcAtten[ADC1_CHANNEL_5]); // GPIO33
+    TEST_ASSERT_EQUAL(ADC_ATTEN_DB_12, mock::adcAtten[ADC1_CHANNEL_3]); // GPIO39
+    TEST_ASSERT_EQUAL(ADC_ATTEN_DB_12, mock::adcAtten[ADC1_CHANNEL_0]); // GPIO36
+    TEST_ASSERT_EQUAL(-1, mock::adcAtten[ADC1_CHANNEL_1]);
+}
+
+void test_light_sensor_array_samples_in_pin_order() {
+    static_assert(adc1ChannelOf(39) == 3 && adc1ChannelOf(35) == 7, "GPIO to ADC1 mapping");
+    static_assert(adc1ChannelOf(25) < 0 && adc1ChannelOf(4) < 0, "ADC2 and plain GPIOs have no ADC1 channel");
+
+    LightSensorArray<32, 33, 39, 36> sensors;
+    mock::analog[32] = 100;
+    mock::analog[33] = 900;
+    mock::analog[39] = 300;
+    mock::analog[36] = 200;
+    int light[sensors.size];
+    sensors.sample(light);
+    const int expected[] = {100, 900, 300, 200};
+    TEST_ASSERT_EQUAL_MEMORY(expected, light, sizeof(expected));
+    TEST_ASSERT_EQUAL(1, sensors.brightest(light));
+}
+
+void test_light_sensor_array_of_eight() {
+    resetAdc();
+    LightSensorArray<36, 37, 38, 39, 32, 33, 34, 35> shading;
+    shading.begin();
+    TEST_ASSERT_EQUAL(8, mock::adcConfigCalls);
+    for (int c = 0; c < ADC1_CHANNEL_MAX; c++) TEST_ASSERT_EQUAL(ADC_ATTEN_DB_12, mock::adcAtten[c]);
+
+    for (int pin = 32; pin <= 39; pin++) mock::analog[pin] = pin;
+    mock::analog[34] = 4000;
+    int light[8];
+    shading.sample(light);
+    TEST_ASSERT_EQUAL(36, light[0]);
+    TEST_ASSERT_EQUAL(35, light[7]);
+    TEST_ASSERT_EQUAL(6, shading.brightest(light));
+}
+
+void test_light_sensor_logs_intensity() {
+    DisplayHandler display;
+    LightSensor sensor(33);
+    mock::analog[33] = 3500;
+    sensor.logLightIntensity(display, 0, 30);
+    TEST_ASSERT_NOT_EQUAL(std::string::npos, logText().find("High light intensity - solar panels adjusted optimally. 3500"));
+}
+
+void test_sunsearch_picks_brightest_direction() {
+    DisplayHandler display;
+    LightSensor sensor(32);
+    sensor.Sunsearch(100, 900, 300, 200, display);
+    TEST_ASSERT_NOT_EQUAL(std::string::npos, logText().find("direction: Højre with value: 900"));
+}
+
+void test_send_frame_carries_trace_stamps() {
+    HardwareSerial link(1);
+    mock::now_us = 5000;
+    sendFrame(link, "Op", 7, 4200);
+    TEST_ASSERT_EQUAL_STRING("Op 7 4200 5000\n", link.output.c_str());
+    link.output.clear();
+    sendFrame(link, "Ned", 8, 4300, 3120);
+    TEST_ASSERT_EQUAL_STRING("Ned 8 4300 5000 3120\n", link.output.c_str());
+    TEST_ASSERT_NOT_EQUAL(std::string::npos, logText().find("I trace 7 cap 4200 tx 5000\n"));
+    TEST_ASSERT_EQUAL_STRING("", Serial.output.c_str()); // Nothing written on the caller's task
+}
+
+void test_index_page_posts_setpoint() {
+    TEST_ASSERT_NOT_NULL(strstr(index_html, "fetch(\"/setpoint\""));
+}
+
+void test_i2c_bus_starts_in_fast_mode() {
+    I2CBus bus(Wire);
+    TEST_ASSERT_TRUE(bus.begin(21, 22));
+    TEST_ASSERT_EQUAL(400000, Wire.clock);
+    TEST_ASSERT_EQUAL(1, Wire.beginCount);
+}
+
+void test_i2c_bus_write_then_read_uses_one_transaction() {
+    I2CBus bus(Wire);
+    bus.begin(21, 22);
+    Wire.queueResponse({0x02});
+    uint8_t cmd = 0xE7, reg = 0;
+    TEST_ASSERT_EQUAL(I2C_OK, bus.transfer(0x40, &cmd, 1, &reg, 1));
+    TEST_ASSERT_EQUAL(0x02, reg);
+    TEST_ASSERT_EQUAL(1, Wire.writes.size());
+    TEST_ASSERT_EQUAL(0xE7, Wire.writes[0].bytes[0]);
+    TEST_ASSERT_EQUAL(1, bus.stats().transactions);
+}
+
+void test_i2c_bus_counts_errors_and_latency() {
+    I2CBus bus(Wire);
+    bus.begin(21, 22);
+    uint8_t cmd = 0xF3, data[3];
+    Wire.nackNext = 1;
+    TEST_ASSERT_EQUAL(I2C_NACK_ADDR, bus.write(0x40, &cmd, 1));
+    mock::now_us = 1000;
+    TEST_ASSERT_EQUAL(I2C_SHORT_READ, bus.read(0x40, data, 3)); // Nothing queued: no bytes back
+
+    I2CStats s = bus.stats();
+    TEST_ASSERT_EQUAL(2, s.transactions);
+    TEST_ASSERT_EQUAL(1, s.errors[I2C_NACK_ADDR]);
+    TEST_ASSERT_EQUAL(1, s.errors[I2C_SHORT_READ]);
+    TEST_ASSERT_EQUAL(0, s.recoveries);
+    TEST_ASSERT_EQUAL(2, s.latencyBuckets[0]);
+    logText();
+    bus.logStats();
+    std::string log = logText();
+    TEST_ASSERT_NOT_EQUAL(std::string::npos, log.find("W i2c errors nack_addr 1"));
+    TEST_ASSERT_EQUAL(std::string::npos, Serial.output.find("i2c")); // Nothing printed on the caller's task
+}
+
+void test_i2c_bus_timeout_clocks_a_stuck_slave_free() {
+    I2CBus bus(Wire);
+    bus.begin(21, 22);
+    mock::digital[21] = LOW; // SDA held low by a slave
+    Wire.nackNext = 1;
+    Wire.failCode = I2C_TIMEOUT;
+    uint8_t cmd = 0xF3;
+    TEST_ASSERT_EQUAL(I2C_TIMEOUT, bus.write(0x40, &cmd, 1));
+
+    int clocks = 0;
+    for (auto& w : mock::digitalWrites) clocks += w.first == 22 && w.second == LOW;
+    TEST_ASSERT_EQUAL(9, clocks);
+    TEST_ASSERT_EQUAL(2, Wire.beginCount); // Restarted after the recovery
+    TEST_ASSERT_EQUAL(1, bus.stats().recoveries);
+}
+
+static const uint8_t apBssid[6] = {0x02, 0x11, 0x22, 0x33, 0x44, 0x55};
+
+void test_wifi_begin_returns_without_waiting() {
+    DisplayHandler display;
+    WifiLink link;
+    link.begin("ap", "secret");
+    link.poll(display);
+    TEST_ASSERT_EQUAL(0, mock::now_us);
+    TEST_ASSERT_EQUAL(1, WiFi.attempts.size());
+    TEST_ASSERT_FALSE(WiFi.attempts[0].fast);
+    TEST_ASSERT_FALSE(WiFi.autoReconnect);
+    TEST_ASSERT_FALSE(WiFi.configured);
+}
+
+void test_wifi_static_ip_is_configured_before_connecting() {
+    WifiStaticIp fixed = {IPAddress(172, 20, 10, 5), IPAddress(172, 20, 10, 1), IPAddress(255, 255, 255, 240),
+                          IPAddress(172, 20, 10, 1)};
+    WifiLink link;
+    link.begin("ap", "secret", &fixed);
+    TEST_ASSERT_TRUE(WiFi.configured);
+    TEST_ASSERT_TRUE(WiFi.staticIp == IPAddress(172, 20, 10, 5));
+}
+
+void test_wifi_caches_ap_for_fast_reconnect_on_next_boot() {
+    DisplayHandler display;
+    {
+        WifiLink link;
+        link.begin("ap", "secret");
+        WiFi.fireConnected(apBssid, 11);
+        WiFi.fireGotIp(IPAddress(172, 20, 10, 5));
+        link.poll(display);
+        TEST_ASSERT_TRUE(link.connected());
+        link.poll(display); // Unchanged AP: no second flash write
+    }
+    uint32_t writes = mock::nvsWrites;
+
+    WiFi.resetMock(); // Reboot
+    WifiLink link;
+    link.begin("ap", "secret");
+    TEST_ASSERT_EQUAL(1, WiFi.attempts.size());
+    TEST_ASSERT_TRUE(WiFi.attempts[0].fast);
+    TEST_ASSERT_EQUAL(11, WiFi.attempts[0].channel);
+    TEST_ASSERT_EQUAL_MEMORY(apBssid, WiFi.attempts[0].bssid, 6);
+    WiFi.fireConnected(apBssid, 11);
+    WiFi.fireGotIp(IPAddress(172, 20, 10, 5));
+    link.poll(display);
+    TEST_ASSERT_EQUAL(writes, mock::nvsWrites);
+}
+
+void test_wifi_failed_fast_attempt_drops_cache_and_backs_off() {
+    DisplayHandler display;
+    Preferences prefs;
+    prefs.begin("wifi");
+    prefs.putString("ssid", "ap");
+    prefs.putBytes("bssid", apBssid, 6);
+    prefs.putUChar("chan", 6);
+    prefs.end();
+
+    WifiLink link;
+    link.begin("ap", "secret");
+    TEST_ASSERT_TRUE(WiFi.attempts[0].fast);
+    WiFi.fireDisconnected(WIFI_REASON_NO_AP_FOUND);
+    link.poll(display);
+    TEST_ASSERT_TRUE(mock::nvs["wifi"].empty());
+
+    delay(WIFI_BACKOFF_MIN_MS - 1);
+    link.poll(display);
+    TEST_ASSERT_EQUAL(1, WiFi.attempts.size());
+    delay(1);
+    link.poll(display);
+    TEST_ASSERT_EQUAL(2, WiFi.attempts.size());
+    TEST_ASSERT_FALSE(WiFi.attempts[1].fast);
+
+    // Second failure waits twice as long
+    WiFi.fireDisconnected(WIFI_REASON_NO_AP_FOUND);
+    link.poll(display);
+    delay(2 * WIFI_BACKOFF_MIN_MS - 1);
+    link.poll(display);
+    TEST_ASSERT_EQUAL(2, WiFi.attempts.size());
+    delay(1);
+    link.poll(display);
+    TEST_ASSERT_EQUAL(3, WiFi.attempts.size());
+}
+
+void test_wifi_reconnects_after_losing_the_ap() {
+    DisplayHandler display;
+    WifiLink link;
+    link.begin("ap", "secret");
+    WiFi.fireConnected(apBssid, 1);
+    WiFi.fireGotIp(IPAddress(10, 0, 0, 2));
+    link.poll(display);
+
+    WiFi.fireDisconnected(WIFI_REASON_BEACON_TIMEOUT);
+    link.poll(display);
+    TEST_ASSERT_FALSE(link.connected());
+    delay(WIFI_BACKOFF_MIN_MS);
+    link.poll(display);
+    TEST_ASSERT_EQUAL(2, WiFi.attempts.size());
+    TEST_ASSERT_TRUE(WiFi.attempts[1].fast); // The AP that just worked is kept
+}
+
+void test_wifi_attempt_without_events_times_out() {
+    DisplayHandler display;
+    WifiLink link;
+    link.begin("ap", "secret");
+    delay(WIFI_ATTEMPT_TIMEOUT_MS);
+    link.poll(display);
+    delay(WIFI_BACKOFF_MIN_MS);
+    link.poll(display);
+    TEST_ASSERT_EQUAL(2, WiFi.attempts.size());
+}
+
+void test_boot_timeline_serving_needs_listen_and_address() {
+    BootTimeline boot;
+    mock::now_us = 2000;
+    boot.mark(BOOT_HTTP_LISTEN);
+    mock::now_us = 350000;
+    boot.mark(BOOT_FIRST_SAMPLE);
+    boot.report();
+    TEST_ASSERT_EQUAL(0, boot.at(BOOT_SERVING));
+    TEST_ASSERT_NOT_EQUAL(std::string::npos, logText().find("boot first_sample 350 ms"));
+
+    mock::now_us = 2400000;
+    boot.mark(BOOT_WIFI_UP);
+    mock::now_us = 9000000;
+    boot.mark(BOOT_WIFI_UP); // Reconnects do not move the boot stamp
+    boot.report();
+    TEST_ASSERT_EQUAL(2400000, boot.at(BOOT_SERVING));
+    TEST_ASSERT_EQUAL_STRING("9.000 I boot wifi_up 2400 ms\n9.000 I boot serving 2400 ms\n", logText().c_str());
+}
+
+void test_binlog_text_mode_formats_record() {
+    mock::now_us = 61234567;
+    LOG_WARN("x %d y %s z %.1f u %lu", -5, "ab", 2.5f, 4000000000UL);
+    TEST_ASSERT_EQUAL_STRING("61.234 W x -5 y ab z 2.5 u 4000000000\n", logText().c_str());
+}
+
+static uint8_t logCrc(const uint8_t* p, size_t len) {
+    uint8_t crc = 0;
+    while (len--) {
+        crc ^= *p++;
+        for (int b = 0; b < 8; b++) crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : (crc << 1);
+    }
+    return crc;
+}
+
+void test_binlog_binary_frames_send_definition_once() {
+    HardwareSerial out(0);
+    for (int i = 0; i < 2; i++) {
+        mock::now_us = 1000 + i;
+        LOG_INFO("tick %u", (unsigned)i);
+    }
+    TEST_ASSERT_EQUAL(2, binlog.drain(out, false));
+
+    const uint8_t* p = (const uint8_t*)out.output.data();
+    size_t left = out.output.size();
+    int defines = 0, records = 0;
+    uint16_t defId = 0;
+    while (left) {
+        TEST_ASSERT_TRUE(p[0] == LOG_MAGIC_RECORD || p[0] == LOG_MAGIC_DEFINE);
+        size_t len = p[1];
+        TEST_ASSERT_TRUE(left >= len + 3);
+        TEST_ASSERT_EQUAL(logCrc(p + 1, len + 1), p[len + 2]);
+        uint16_t id = p[2] | p[3] << 8;
+        if (p[0] == LOG_MAGIC_DEFINE) {
+            defines++;
+            defId = id;
+            TEST_ASSERT_EQUAL(LOG_LEVEL_INFO, p[4]);
+            TEST_ASSERT_EQUAL(1, p[5]);
+            TEST_ASSERT_EQUAL('u', p[6]);
+            TEST_ASSERT_EQUAL_MEMORY("tick %u", p + 7, len - 5);
+        } else {
+            TEST_ASSERT_EQUAL(defId, id);
+            TEST_ASSERT_EQUAL(2 + 4 + 4, len);
+            uint32_t us, arg;
+            memcpy(&us, p + 4, 4);
+            memcpy(&arg, p + 8, 4);
+            TEST_ASSERT_EQUAL(1000 + records, us);
+            TEST_ASSERT_EQUAL(records, arg);
+            records++;
+        }
+        p += len + 3;
+        left -= len + 3;
+    }
+    TEST_ASSERT_EQUAL(1, defines);
+    TEST_ASSERT_EQUAL(2, records);
+    TEST_ASSERT_NOT_EQUAL(0, defId);
+
+    // A decoder that attached late gets the definition again
+    binlog.reannounce();
+    LOG_INFO("tick %u", 9u);
+    out.output.clear();
+    binlog.drain(out, false);
+    TEST_ASSERT_EQUAL(LOG_MAGIC_DEFINE, (uint8_t)out.output[0]);
+}
+
+void test_binlog_full_ring_counts_drops() {
+    uint32_t before = binlog.dropped();
+    for (int i = 0; i < LOG_SLOTS + 5; i++) {
+        LOG_DEBUG("fill %d", i);
+    }
+    TEST_ASSERT_EQUAL(before + 5, binlog.dropped());
+
+    std::string text = logText();
+    TEST_ASSERT_EQUAL(0, text.find("0.000 W log: 5 records dropped\n"));
+    TEST_ASSERT_NOT_EQUAL(std::string::npos, text.find("D fill 127\n"));
+    TEST_ASSERT_EQUAL(std::string::npos, text.find("fill 128"));
+}
+
+void test_binlog_long_string_is_truncated() {
+    LOG_ERROR("%s!", "abcdefghijklmnopqrstuvwxyz0123456789");
+    TEST_ASSERT_EQUAL_STRING("0.000 E abcdefghijklmnopqrstuvwxyz012345678!\n", logText().c_str());
+}
+
+static bool contains(const String& body, const char* line) {
+    return strstr(body.c_str(), line) != nullptr;
+}
+
+void test_metrics_period_and_jitter_histograms() {
+    Metrics m;
+    mock::now_us = 10000000;
+    m.loopPeriod.tick();
+    mock::now_us += 1000000;
+    m.loopPeriod.tick();
+    mock::now_us += 1030000; // 30 ms late
+    m.loopPeriod.tick();
+
+    String body;
+    m.render(body);
+    TEST_ASSERT_TRUE(contains(body, "# TYPE tracker_period_seconds histogram\n"));
+    TEST_ASSERT_TRUE(contains(body, "tracker_period_seconds_bucket{loop=\"loop\",le=\"1\"} 1\n"));
+    TEST_ASSERT_TRUE(contains(body, "tracker_period_seconds_bucket{loop=\"loop\",le=\"2.5\"} 2\n"));
+    TEST_ASSERT_TRUE(contains(body, "tracker_period_seconds_sum{loop=\"loop\"} 2.030000\n"));
+    TEST_ASSERT_TRUE(contains(body, "tracker_jitter_seconds_bucket{loop=\"loop\",le=\"0.0001\"} 1\n"));
+    TEST_ASSERT_TRUE(contains(body, "tracker_jitter_seconds_bucket{loop=\"loop\",le=\"0.025\"} 1\n"));
+    TEST_ASSERT_TRUE(contains(body, "tracker_jitter_seconds_bucket{loop=\"loop\",le=\"0.05\"} 2\n"));
+    TEST_ASSERT_TRUE(contains(body, "tracker_jitter_seconds_count{loop=\"sensor\"} 0\n"));
+}
+
+void test_metrics_uptime_does_not_wrap_with_micros() {
+    Supervisor sup;
+    int id = sup.watch("sensor", 1000, 100);
+    mock::now_us = 5000000000ULL; // 83 min, micros() has wrapped once
+    sup.begin(id);
+    delay(150);
+    sup.end(id);
+    TEST_ASSERT_EQUAL(1, sup.violations(id, DEADLINE_BUDGET));
+    TEST_ASSERT_TRUE(sup.lastViolation(id).atUs == 5000150000LL);
+
+    Metrics m;
+    String body;
+    m.render(body);
+    TEST_ASSERT_TRUE(contains(body, "tracker_uptime_seconds 5000.150\n"));
+}
+
+void test_metrics_count_requests_per_route() {
+    Metrics m;
+    AsyncWebServer server(80);
+    server.on("/slow", HTTP_GET, m.instrument("/slow", [](AsyncWebServerRequest* request) {
+        delay(3);
+        request->send(200, "text/plain", "ok");
+    }));
+    server.on("/metrics", HTTP_GET, m.instrument("/metrics", [&m](AsyncWebServerRequest* request) {
+        String body;
+        m.render(body);
+        request->send(200, "text/plain; version=0.0.4", body);
+    }));
+    for (int i = 0; i < 2; i++) {
+        AsyncWebServerRequest request("/slow");
+        server.handle(&request);
+        TEST_ASSERT_EQUAL_STRING("ok", request.responseBody.c_str());
+    }
+
+    AsyncWebServerRequest scrape("/metrics");
+    server.handle(&scrape);
+    TEST_ASSERT_EQUAL(200, scrape.responseCode);
+    TEST_ASSERT_TRUE(contains(scrape.responseBody, "tracker_http_handler_seconds_bucket{route=\"/slow\",le=\"0.0025\"} 0\n"));
+    TEST_ASSERT_TRUE(contains(scrape.responseBody, "tracker_http_handler_seconds_bucket{route=\"/slow\",le=\"0.005\"} 2\n"));
+    TEST_ASSERT_TRUE(contains(scrape.responseBody, "tracker_http_handler_seconds_count{route=\"/slow\"} 2\n"));
+    TEST_ASSERT_TRUE(contains(scrape.responseBody, "tracker_http_handler_seconds_count{route=\"/metrics\"} 0\n"));
+}
+
+void test_metrics_report_heap_wifi_and_i2c() {
+    uint8_t cmd = 0xE7;
+    Wire.nackNext = 1;
+    i2cBus.write(0x40, &cmd, 1); // The global bus the route reports on
+    mock::heapMaxAlloc = 90000;
+    WiFi.fireGotIp(IPAddress(10, 0, 0, 5));
+
+    String body;
+    metrics.render(body);
+    TEST_ASSERT_TRUE(contains(body, "tracker_heap_largest_block_bytes 90000\n"));
+    TEST_ASSERT_TRUE(contains(body, "tracker_wifi_connected 1\n"));
+    TEST_ASSERT_TRUE(contains(body, "tracker_wifi_rssi_dbm -60\n"));
+    TEST_ASSERT_TRUE(contains(body, "tracker_i2c_errors_total{status=\"nack_addr\"} "));
+    TEST_ASSERT_TRUE(contains(body, "tracker_i2c_latency_seconds_bucket{le=\"+Inf\"} "));
+    TEST_ASSERT_FALSE(contains(body, "tracker_i2c_errors_total{status=\"nack_addr\"} 0\n"));
+}
+
+// Takes nothing, like a UART whose TX buffer stays full
+class StuckLink : public Print {
+public:
+    size_t write(uint8_t) override { return 0; }
+    size_t write(const uint8_t*, size_t) override { return 0; }
+};
+
+void test_send_frame_counts_sent_and_dropped_frames() {
+    uint32_t sent = metrics.uartFramesSent, dropped = metrics.uartFramesDropped;
+    HardwareSerial link(1);
+    StuckLink stuck;
+    sendFrame(link, "Op", 1, 0);
+    sendFrame(stuck, "Op", 2, 0);
+    TEST_ASSERT_EQUAL(sent + 1, metrics.uartFramesSent.load());
+    TEST_ASSERT_EQUAL(dropped + 1, metrics.uartFramesDropped.load());
+}
+
+void test_supervisor_budget_overrun_blames_slowest_stage() {
+    Supervisor sup;
+    int id = sup.watch("sensor", 1000, 100);
+    mock::now_us = 5000000;
+    sup.begin(id);
+    sup.stage(id, "i2c");
+    delay(10);
+    sup.stage(id, "display");
+    delay(150);
+    sup.end(id);
+
+    TEST_ASSERT_EQUAL(1, sup.cycles(id));
+    TEST_ASSERT_EQUAL(1, sup.violations(id, DEADLINE_BUDGET));
+    DeadlineViolation v = sup.lastViolation(id);
+    TEST_ASSERT_EQUAL(DEADLINE_BUDGET, v.kind);
+    TEST_ASSERT_EQUAL_STRING("display", v.stage);
+    TEST_ASSERT_EQUAL(160000, v.us);
+    TEST_ASSERT_EQUAL(5160000, v.atUs);
+    TEST_ASSERT_NOT_EQUAL(std::string::npos, logText().find("5.160 W deadline sensor budget 160000 us in display\n"));
+
+    // Within budget: counted, not reported
+    sup.begin(id);
+    delay(50);
+    sup.end(id);
+    TEST_ASSERT_EQUAL(2, sup.cycles(id));
+    TEST_ASSERT_EQUAL(1, sup.violations(id, DEADLINE_BUDGET));
+}
+
+void test_supervisor_reports_stall_and_starves_watchdog() {
+    Supervisor sup;
+    int id = sup.watch("sensor", 1000, 100);
+    mock::now_us = 1000;
+    sup.begin(id);
+    sup.stage(id, "i2c");
+    delay(300);
+    TEST_ASSERT_TRUE(sup.check());
+    TEST_ASSERT_EQUAL(1, sup.violations(id, DEADLINE_STALL));
+    TEST_ASSERT_EQUAL_STRING("i2c", sup.lastViolation(id).stage);
+    TEST_ASSERT_TRUE(sup.check()); // Reported once per cycle
+
+    delay(SUPERVISOR_HANG_PERIODS * 1000);
+    TEST_ASSERT_FALSE(sup.check());
+
+    // The task comes back: the stall is not counted again as an overrun
+    sup.end(id);
+    TEST_ASSERT_EQUAL(1, sup.violations(id, DEADLINE_STALL));
+    TEST_ASSERT_EQUAL(0, sup.violations(id, DEADLINE_BUDGET));
+    TEST_ASSERT_TRUE(sup.check());
+}
+
+void test_supervisor_late_start_and_silent_task() {
+    Supervisor sup;
+    int id = sup.watch("loop", 1000, 200);
+    mock::now_us = 1000;
+    sup.begin(id);
+    sup.end(id);
+    delay(1150);
+    sup.begin(id); // Within period + budget
+    sup.end(id);
+    delay(1400);
+    sup.begin(id);
+    sup.end(id);
+    TEST_ASSERT_EQUAL(1, sup.violations(id, DEADLINE_LATE));
+    TEST_ASSERT_EQUAL(400000, sup.lastViolation(id).us);
+
+    delay(SUPERVISOR_HANG_PERIODS * 1000 + 1);
+    TEST_ASSERT_FALSE(sup.check()); // Never started another cycle
+}
+
+void test_telemetry_datagram_layout() {
+    Telemetry t;
+    t.begin(IPAddress(239, 255, 42, 1), 5005, 1000);
+    t.setClimate(21.5f, 40.25f);
+    WiFi.fireGotIp(IPAddress(10, 0, 0, 5));
+    mock::now_us = 70000000;
+    int light[4] = {100, 4095, 2000, 0};
+    TEST_ASSERT_TRUE(t.publish(light, 4, 1));
+
+    TEST_ASSERT_EQUAL(1, WiFiUDP::sent.size());
+    const WiFiUDP::Datagram& d = WiFiUDP::sent[0];
+    TEST_ASSERT_TRUE(d.ip == IPAddress(239, 255, 42, 1));
+    TEST_ASSERT_EQUAL(5005, d.port);
+    TEST_ASSERT_EQUAL(TELEMETRY_SIZE, d.data.size());
+    const uint8_t expected[TELEMETRY_SIZE] = {
+        0x54, 0x53, 1, 4,               // Magic, version, four sensors
+        0x3a, 0x4c, 0x3b, 0x2a,         // Last four MAC bytes
+        0, 0, 0, 0,                     // seq 0
+        0x70, 0x11, 0x01, 0x00,         // 70000 ms
+        0x66, 0x08, 0xb9, 0x0f,         // 2150, 4025
+        100, 0, 0xff, 0x0f, 0xd0, 0x07, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        1, (uint8_t)-60, 0, 0,
+    };
+    TEST_ASSERT_EQUAL_MEMORY(expected, d.data.data(), TELEMETRY_SIZE);
+}
+
+void test_telemetry_missing_sensor_and_many_lights() {
+    Telemetry t;
+    t.begin(IPAddress(239, 255, 42, 1));
+    t.setClimate(NAN, NAN);
+    int light[10] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    uint8_t buf[TELEMETRY_SIZE];
+    t.encode(buf, light, 10, 9, -70, 0);
+    TEST_ASSERT_EQUAL(TELEMETRY_MAX_LIGHT, buf[3]);
+    TEST_ASSERT_EQUAL(0x00, buf[16]);
+    TEST_ASSERT_EQUAL(0x80, buf[17]); // INT16_MIN
+    TEST_ASSERT_EQUAL(0xff, buf[18]);
+    TEST_ASSERT_EQUAL(0xff, buf[19]);
+    TEST_ASSERT_EQUAL(8, buf[34]);    // light[7]
+}
+
+void test_telemetry_is_rate_limited_and_needs_wifi() {
+    Telemetry t;
+    t.begin(IPAddress(239, 255, 42, 1), 5005, 500);
+    int light[4] = {0, 0, 0, 0};
+    TEST_ASSERT_FALSE(t.publish(light, 4, 0)); // No address yet
+    WiFi.fireGotIp(IPAddress(10, 0, 0, 5));
+
+    uint32_t sent = metrics.telemetrySent;
+    for (int i = 0; i < 20; i++) {
+        t.publish(light, 4, 0);
+        delay(100);
+    }
+    TEST_ASSERT_EQUAL(4, WiFiUDP::sent.size()); // 0, 500, 1000, 1500 ms
+    TEST_ASSERT_EQUAL(sent + 4, metrics.telemetrySent);
+    TEST_ASSERT_EQUAL(3, WiFiUDP::sent[3].data[8]);
+
+    // A refused datagram still uses up its sequence number
+    WiFiUDP::failSend = true;
+    uint32_t failed = metrics.telemetryFailed;
+    TEST_ASSERT_FALSE(t.publish(light, 4, 0));
+    TEST_ASSERT_EQUAL(failed + 1, metrics.telemetryFailed);
+    TEST_ASSERT_EQUAL(5, t.sequence());
+
+    WiFi.fireDisconnected(WIFI_REASON_BEACON_TIMEOUT);
+    WiFiUDP::failSend = false;
+    delay(1000);
+    TEST_ASSERT_FALSE(t.publish(light, 4, 0));
+    TEST_ASSERT_EQUAL(4, WiFiUDP::sent.size());
+}
+
+void test_strip_chart_scrolls_and_draws_only_the_newest_column() {
+    TFT_eSPI tft;
+    StripChart<8> chart(tft, 150, 72, 10, 0, 9);
+    TEST_ASSERT_TRUE(chart.begin());
+    const TFT_eSprite& px = chart.pixels();
+    TEST_ASSERT_EQUAL(1, tft.spritePushes);
+
+    chart.add(0);
+    chart.add(9);
+    TEST_ASSERT_EQUAL(TFT_YELLOW, px.readPixel(6, 9));
+    for (int row = 0; row < 10; row++) {
+        TEST_ASSERT_EQUAL(TFT_YELLOW, px.readPixel(7, row)); // Joined to the previous point
+    }
+
+    uint32_t drawn = px.pixelsDrawn;
+    chart.add(4);
+    TEST_ASSERT_EQUAL(TFT_YELLOW, px.readPixel(5, 9)); // Scrolled one column left
+    TEST_ASSERT_EQUAL(TFT_YELLOW, px.readPixel(6, 0));
+    TEST_ASSERT_EQUAL(TFT_YELLOW, px.readPixel(7, 5));
+    TEST_ASSERT_EQUAL(TFT_BLACK, px.readPixel(7, 6));
+    TEST_ASSERT_EQUAL(6, px.pixelsDrawn - drawn);    // Rows 0-5 of one column, down from 9
+    TEST_ASSERT_EQUAL(4, tft.spritePushes);
+    TEST_ASSERT_EQUAL(4 * 8 * 10, tft.pixelsPushed);
+    TEST_ASSERT_EQUAL(0, tft.fillScreens);
+}
+
+void test_strip_chart_cost_does_not_grow_with_history() {
+    TFT_eSPI tft;
+    StripChart<90, 2> chart(tft, 150, 72, 28, -4095, 4095);
+    chart.begin();
+    const TFT_eSprite& px = chart.pixels();
+    float flat[2] = {1000, -1000};
+    for (int i = 0; i < 500; i++) {
+        chart.add(flat);
+    }
+    uint32_t drawn = px.pixelsDrawn;
+    chart.add(flat);
+    TEST_ASSERT_EQUAL(3, px.pixelsDrawn - drawn); // Zero line and one point per series
+    TEST_ASSERT_EQUAL(90, chart.size());
+    TEST_ASSERT_EQUAL(TFT_DARKGREY, px.readPixel(89, 14));
+}
+
+void test_strip_chart_redraw_matches_incremental_drawing() {
+    TFT_eSPI tft;
+    StripChart<16> chart(tft, 0, 0, 12, -10, 10);
+    chart.begin();
+    const float samples[] = {0, 3, NAN, -4, 25, 8, -30, 1, 1, 2};
+    for (float v : samples) {
+        chart.add(v);
+    }
+    const TFT_eSprite& px = chart.pixels();
+    std::vector<uint16_t> incremental;
+    for (int row = 0; row < 12; row++) {
+        for (int col = 0; col < 16; col++) {
+            incremental.push_back(px.readPixel(col, row));
+        }
+    }
+    for (int row = 0; row < 12; row++) {
+        TEST_ASSERT_TRUE(px.readPixel(8, row) != TFT_YELLOW); // The NAN is a gap
+    }
+    chart.redraw();
+    for (int row = 0; row < 12; row++) {
+        for (int col = 0; col < 16; col++) {
+            TEST_ASSERT_EQUAL(incremental[row * 16 + col], px.readPixel(col, row));
+        }
+    }
+}
+
+// The form as the page posts it
+static void postSetpoint(SetpointLink& link, AsyncWebServerRequest& r, const char* sp, const char* lo,
+                         const char* hi) {
+    r.addParam("setpoint", sp, true);
+    r.addParam("maxLimit", hi, true);
+    r.addParam("minLimit", lo, true);
+    link.handlePost(&r);
+}
+
+void test_setpoint_post_validates_and_forwards_at_once() {
+    SetpointLink link;
+    HardwareSerial rp(1);
+    link.begin();
+    link.poll(rp);
+    TEST_ASSERT_EQUAL_STRING("SET 1 90 0 90\n", rp.output.c_str()); // The boot config
+    rp.output.clear();
+
+    const char* bad[][3] = {{"abc", "", ""}, {"200", "", ""}, {"45", "50", ""}, {"45", "", "40"}, {"", "", ""}};
+    for (auto& b : bad) {
+        AsyncWebServerRequest r("/setpoint", HTTP_POST);
+        postSetpoint(link, r, b[0], b[1], b[2]);
+        TEST_ASSERT_EQUAL(400, r.responseCode);
+    }
+    AsyncWebServerRequest r("/setpoint", HTTP_POST);
+    postSetpoint(link, r, "45", "10", "");
+    TEST_ASSERT_EQUAL(200, r.responseCode);
+    TEST_ASSERT_EQUAL_STRING("45 [10, 90]", r.responseBody.c_str());
+    TEST_ASSERT_EQUAL(45, link.current().setpoint);
+    TEST_ASSERT_EQUAL(0, rp.output.size()); // Nothing from the TCP task itself
+    link.poll(rp);
+    TEST_ASSERT_EQUAL_STRING("SET 2 45 10 90\n", rp.output.c_str());
+}
+
+void test_setpoint_ack_measures_latency_and_resends() {
+    SetpointLink link;
+    HardwareSerial rp(1);
+    link.begin();
+    link.poll(rp);
+    rp.input = "ACK 1 90 0 90 800\n";
+    link.poll(rp);
+    rp.output.clear();
+
+    uint32_t resends = metrics.setpointResends, count = metrics.setpointLatency.count;
+    SetpointConfig c = {30, 0, 60};
+    link.apply(c);
+    link.poll(rp);
+    delay(SETPOINT_ACK_TIMEOUT_MS - 1);
+    link.poll(rp);
+    TEST_ASSERT_EQUAL_STRING("SET 2 30 0 60\n", rp.output.c_str());
+    delay(1);
+    link.poll(rp);
+    TEST_ASSERT_EQUAL_STRING("SET 2 30 0 60\nSET 2 30 0 60\n", rp.output.c_str());
+    TEST_ASSERT_EQUAL(resends + 1, metrics.setpointResends);
+    TEST_ASSERT_FALSE(link.acked());
+
+    delay(20);
+    rp.input = "ACK 1 90 0 90 800\nACK 2 30 0 60 1500\n"; // Late ack of the old edit first
+    link.poll(rp);
+    TEST_ASSERT_TRUE(link.acked());
+    TEST_ASSERT_EQUAL((SETPOINT_ACK_TIMEOUT_MS + 20) * 1000, link.latencyUs());
+    TEST_ASSERT_EQUAL(count + 1, metrics.setpointLatency.count);
+
+    // Without any ack it gives up after the last resend
+    uint32_t unacked = metrics.setpointUnacked;
+    c.setpoint = 31;
+    link.apply(c);
+    for (int i = 0; i < 20; i++) {
+        link.poll(rp);
+        delay(SETPOINT_ACK_TIMEOUT_MS);
+    }
+    TEST_ASSERT_EQUAL(unacked + 1, metrics.setpointUnacked);
+    size_t sent = 0;
+    for (size_t at = 0; (at = rp.output.find("SET 3 ", at)) != std::string::npos; at++) {
+        sent++;
+    }
+    TEST_ASSERT_EQUAL(1 + SETPOINT_RESENDS, sent);
+}
+
+void test_setpoint_nak_stops_resends_and_counts_rejection() {
+    SetpointLink link;
+    HardwareSerial rp(1);
+    link.begin();
+    link.poll(rp);
+    rp.input = "ACK 1 90 0 90 800\n";
+    link.poll(rp);
+    rp.output.clear();
+
+    uint32_t rejected = metrics.setpointRejected, resends = metrics.setpointResends;
+    SetpointConfig c = {30, 0, 60};
+    link.apply(c);
+    link.poll(rp);
+    rp.input = "NAK 1 90 0 90\nNAK 2 90 0 90\nNAK 2 90 0 90\n"; // Stale, then repeated
+    link.poll(rp);
+    for (int i = 0; i < 5; i++) {
+        delay(SETPOINT_ACK_TIMEOUT_MS);
+        link.poll(rp);
+    }
+    TEST_ASSERT_EQUAL_STRING("SET 2 30 0 60\n", rp.output.c_str());
+    TEST_ASSERT_EQUAL(rejected + 1, metrics.setpointRejected);
+    TEST_ASSERT_EQUAL(resends, metrics.setpointResends);
+    TEST_ASSERT_FALSE(link.acked());
+    TEST_ASSERT_NOT_EQUAL(std::string::npos, logText().find("setpoint 2 rejected, controller keeps 90 [0, 90]\n"));
+
+    String body;
+    metrics.render(body);
+    TEST_ASSERT_TRUE(contains(body, "tracker_setpoint_rejected_total "));
+}
+
+void test_setpoint_burst_of_edits_costs_one_flash_write() {
+    HardwareSerial rp(1);
+    {
+        SetpointLink link;
+        link.begin();
+        uint32_t writes = mock::nvsWrites;
+        for (int sp = 10; sp < 20; sp++) {
+            SetpointConfig c = {(int16_t)sp, 0, 90};
+            link.apply(c);
+            link.poll(rp);
+            delay(200);
+        }
+        TEST_ASSERT_EQUAL(writes, mock::nvsWrites);
+        delay(SETPOINT_SAVE_QUIET_MS);
+        link.poll(rp);
+        link.poll(rp);
+        TEST_ASSERT_EQUAL(writes + 1, mock::nvsWrites);
+
+        // Edits that never settle are still saved every SETPOINT_SAVE_MAX_MS
+        for (int i = 0; i < 30; i++) {
+            SetpointConfig c = {(int16_t)(40 + i % 2), 0, 90};
+            link.apply(c);
+            link.poll(rp);
+            delay(SETPOINT_SAVE_MAX_MS / 20);
+        }
+        TEST_ASSERT_EQUAL(writes + 2, mock::nvsWrites);
+    }
+
+    SetpointLink rebooted;
+    rebooted.begin();
+    TEST_ASSERT_EQUAL(0, rebooted.current().minLimit);
+    TEST_ASSERT_EQUAL(90, rebooted.current().maxLimit);
+    TEST_ASSERT_TRUE(rebooted.current().setpoint == 40 || rebooted.current().setpoint == 41);
+}
+
+void test_admission_caps_connections_with_retry_after() {
+    Admission gate(2);
+    AsyncWebServer server(80);
+    server.on("/", HTTP_GET, gate.guard([](AsyncWebServerRequest* request) {
+        request->send(200, "text/plain", "ok");
+    }));
+    AsyncWebServerRequest a("/"), b("/"), c("/");
+    server.handle(&a);
+    server.handle(&b);
+    server.handle(&c);
+    TEST_ASSERT_EQUAL(200, a.responseCode);
+    TEST_ASSERT_EQUAL(200, b.responseCode);
+    TEST_ASSERT_EQUAL(503, c.responseCode);
+    TEST_ASSERT_EQUAL_STRING("1", c.header("Retry-After").c_str());
+    TEST_ASSERT_EQUAL(2, gate.inFlight());
+
+    // A slot comes back when its client disconnects; rejected ones held none
+    c.disconnect();
+    TEST_ASSERT_EQUAL(2, gate.inFlight());
+    a.disconnect();
+    AsyncWebServerRequest d("/");
+    server.handle(&d);
+    TEST_ASSERT_EQUAL(200, d.responseCode);
+    b.disconnect();
+    d.disconnect();
+    TEST_ASSERT_EQUAL(0, gate.inFlight());
+    TEST_ASSERT_EQUAL(2, gate.peakInFlight());
+    TEST_ASSERT_EQUAL(3, gate.admitted.load());
+    TEST_ASSERT_EQUAL(1, gate.rejected.load());
+}
+
+void test_sample_body_is_formatted_once_per_sample() {
+    SampleBody body("text/plain", "no sample");
+    AsyncWebServerRequest early("/temperature");
+    body.serve(&early);
+    TEST_ASSERT_EQUAL(500, early.responseCode);
+    TEST_ASSERT_EQUAL_STRING("no sample", early.responseBody.c_str());
+
+    uint32_t published = admission.bodiesPublished, shared = admission.bodiesShared;
+    String text("21.50 and a body longer than one 16 byte chunk of the mock");
+    body.publish(200, text);
+    for (int i = 0; i < 3; i++) {
+        AsyncWebServerRequest request("/temperature");
+        body.serve(&request);
+        TEST_ASSERT_EQUAL(200, request.responseCode);
+        TEST_ASSERT_EQUAL_STRING("text/plain", request.responseType.c_str());
+        TEST_ASSERT_EQUAL_STRING(text.c_str(), request.responseBody.c_str());
+    }
+    TEST_ASSERT_EQUAL(published + 1, admission.bodiesPublished.load());
+    TEST_ASSERT_EQUAL(shared + 3, admission.bodiesShared.load());
+    TEST_ASSERT_EQUAL(1, body.users()); // Responses gave their reference back once sent
+
+    body.publish(500, "Failed to read temperature");
+    AsyncWebServerRequest late("/temperature");
+    body.serve(&late);
+    TEST_ASSERT_EQUAL(500, late.responseCode);
+    TEST_ASSERT_EQUAL_STRING("Failed to read temperature", late.responseBody.c_str());
+}
+
+void test_metrics_report_admission() {
+    Metrics m;
+    uint32_t rejected = admission.rejected;
+    AsyncWebServer server(80);
+    server.on("/metrics", HTTP_GET, admission.guard([&m](AsyncWebServerRequest* request) {
+        String body;
+        m.render(body);
+        request->send(200, "text/plain; version=0.0.4", body);
+    }));
+    AsyncWebServerRequest scrape("/metrics");
+    server.handle(&scrape);
+    char line[64];
+    TEST_ASSERT_TRUE(contains(scrape.responseBody, "tracker_http_in_flight 1\n"));
+    snprintf(line, sizeof(line), "tracker_http_in_flight_limit %d\n", HTTP_MAX_CONNECTIONS);
+    TEST_ASSERT_TRUE(contains(scrape.responseBody, line));
+    snprintf(line, sizeof(line), "tracker_http_rejected_total %lu\n", (unsigned long)rejected);
+    TEST_ASSERT_TRUE(contains(scrape.responseBody, line));
+    TEST_ASSERT_TRUE(contains(scrape.responseBody, "tracker_http_bodies_shared_total "));
+}
+
+void test_power_policy_follows_the_rate_of_change() {
+    PowerPolicy policy;
+    int light[4] = {1000, 1000, 1000, 1000};
+    uint32_t t = 0;
+    TEST_ASSERT_EQUAL(POWER_TRACKING, policy.update(t, light, 4)); // Until the light is seen to settle
+    while (policy.mode() == POWER_TRACKING && t < 600000) {
+        t += policy.intervalMs();
+        policy.update(t, light, 4);
+    }
+    TEST_ASSERT_EQUAL(POWER_STEADY, policy.mode());
+    TEST_ASSERT_TRUE(t > 30000 && t < 60000);
+    TEST_ASSERT_EQUAL(POWER_STEADY_MS, policy.intervalMs());
+
+    // A cloud: one channel drops by 1000 counts within a steady interval
+    light[1] = 0;
+    t += policy.intervalMs();
+    TEST_ASSERT_EQUAL(POWER_TRACKING, policy.update(t, light, 4));
+    TEST_ASSERT_EQUAL(POWER_TRACKING_MS, policy.intervalMs());
+    // Slightly noisy afterwards: tracking holds on while the estimate decays
+    PowerMode m = POWER_TRACKING;
+    int steps = 0;
+    while (m == POWER_TRACKING && steps < 1000) {
+        light[0] ^= 1;
+        t += policy.intervalMs();
+        m = policy.update(t, light, 4);
+        steps++;
+    }
+    TEST_ASSERT_EQUAL(POWER_STEADY, m);
+    TEST_ASSERT_TRUE(steps * POWER_TRACKING_MS > 60000);
+
+    // Dark for less than the hold time is not yet night
+    int dark[4] = {20, 30, 10, 50};
+    uint32_t dusk = t + policy.intervalMs();
+    for (t = dusk; t - dusk < POWER_NIGHT_HOLD_MS; t += policy.intervalMs()) {
+        TEST_ASSERT_NOT_EQUAL(POWER_NIGHT, policy.update(t, dark, 4));
+    }
+    TEST_ASSERT_EQUAL(POWER_NIGHT, policy.update(t, dark, 4));
+    TEST_ASSERT_EQUAL(POWER_NIGHT_MS, policy.intervalMs());
+    // Between the night and dawn levels: still night
+    int grey[4] = {150, 150, 150, 150};
+    t += policy.intervalMs();
+    TEST_ASSERT_EQUAL(POWER_NIGHT, policy.update(t, grey, 4));
+    t += policy.intervalMs();
+    TEST_ASSERT_EQUAL(POWER_TRACKING, policy.update(t, light, 4));
+}
+
+void test_energy_model_estimates_a_day() {
+    // A clear day from 06:00 to 20:00 seen every 10 s, with a cloud passing
+    // around noon; the sun moves from the left channel to the right one
+    const uint32_t step = 10000;
+    const size_t rows = 86400000 / step + 1;
+    std::vector<uint32_t> ms(rows);
+    std::vector<int> light(rows * 4);
+    for (size_t r = 0; r < rows; r++) {
+        ms[r] = r * step;
+        double h = r * step / 3600000.0;
+        double sun = h >= 6 && h < 20 ? sin(M_PI * (h - 6) / 14) : 0;
+        double cloud = h >= 12 && h < 12.25 && (r / 3) % 2 ? 0.3 : 1;
+        double az = (h - 6) / 14;
+        int base = 20 + (int)(3000 * sun * cloud);
+        light[r * 4 + 0] = (int)(base * (1.2 - 0.4 * az));
+        light[r * 4 + 1] = (int)(base * (0.8 + 0.4 * az));
+        light[r * 4 + 2] = base;
+        light[r * 4 + 3] = (int)(base * 0.9);
+    }
+    EnergyEstimate e = EnergyModel::estimate(ms.data(), light.data(), rows, 4);
+    uint32_t total = e.msInMode[POWER_TRACKING] + e.msInMode[POWER_STEADY] + e.msInMode[POWER_NIGHT];
+    TEST_ASSERT_EQUAL(86400000, total);
+    // Night from shortly after 20:00 (and after 00:10) until the light is back
+    TEST_ASSERT_TRUE(e.msInMode[POWER_NIGHT] > 9 * 3600000u && e.msInMode[POWER_NIGHT] < 10 * 3600000u);
+    TEST_ASSERT_TRUE(e.msInMode[POWER_TRACKING] >= 15 * 60000u); // The cloud
+    TEST_ASSERT_TRUE(e.msInMode[POWER_STEADY] > 12 * 3600000u);
+    TEST_ASSERT_TRUE(e.mAhPerDay > 0);
+    TEST_ASSERT_TRUE(e.mAhPerDay < e.baselineMAhPerDay / 2);
+    // 1 s loop with Wi-Fi on around the clock, from the default profile
+    float baseline = 24 * (0.04f * 120 + 0.96f * 95);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, baseline, e.baselineMAhPerDay);
+}
+
+void test_power_manager_light_sleeps_at_night() {
+    static int id = supervisor.watch("power", 1000, 250);
+    mock::cpuMhz = 240;
+    mock::lightSleeps = 0;
+    HardwareSerial link(1);
+    PowerManager pm;
+    pm.begin(link, id);
+    TEST_ASSERT_EQUAL(240, getCpuFrequencyMhz());
+    TEST_ASSERT_EQUAL(WIFI_PS_MIN_MODEM, WiFi.getSleep());
+
+    int dark[4] = {0, 0, 0, 0};
+    uint32_t ms = 0;
+    for (int i = 0; i < 1000 && pm.current() != POWER_NIGHT; i++) {
+        supervisor.begin(id);
+        ms = pm.plan(dark, 4);
+        supervisor.end(id);
+        pm.wait(ms);
+    }
+    TEST_ASSERT_EQUAL(POWER_NIGHT, pm.current());
+    TEST_ASSERT_EQUAL(80, getCpuFrequencyMhz());
+    TEST_ASSERT_EQUAL(WIFI_PS_MAX_MODEM, WiFi.getSleep());
+    TEST_ASSERT_EQUAL(1, mock::lightSleeps); // Only the first night interval; delay() before it
+
+    uint32_t late = supervisor.violations(id, DEADLINE_LATE);
+    for (int i = 0; i < 3; i++) {
+        supervisor.begin(id);
+        ms = pm.plan(dark, 4);
+        supervisor.end(id);
+        pm.wait(ms);
+        TEST_ASSERT_TRUE(supervisor.check()); // The other watched tasks slept too
+    }
+    TEST_ASSERT_EQUAL(POWER_NIGHT_MS, ms);
+    TEST_ASSERT_EQUAL(4, mock::lightSleeps);
+    TEST_ASSERT_EQUAL(4, pm.lightSleeps());
+    TEST_ASSERT_EQUAL(4 * POWER_NIGHT_MS, pm.lightSleepMs());
+    supervisor.begin(id);
+    supervisor.end(id);
+    TEST_ASSERT_EQUAL(late, supervisor.violations(id, DEADLINE_LATE));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_htu21d_begin_detects_sensor);
+    RUN_TEST(test_htu21d_begin_without_sensor_fails);
+    RUN_TEST(test_htu21d_measure_converts_raw_values);
+    RUN_TEST(test_htu21d_measure_rejects_bad_crc);
+    RUN_TEST(test_htu21d_humidity_is_clamped);
+    RUN_TEST(test_htu21d_fixed_point_matches_datasheet_formulas);
+    RUN_TEST(test_htu21d_burst_trims_outliers_and_restores_resolution);
+    RUN_TEST(test_temperature_endpoint_reports_missing_sensor);
+    RUN_TEST(test_light_sensor_array_configures_each_channel_once);
+    RUN_TEST(test_light_sensor_array_samples_in_pin_order);
+    RUN_TEST(test_light_sensor_array_of_eight);
+    RUN_TEST(test_light_sensor_logs_intensity);
+    RUN_TEST(test_sunsearch_picks_brightest_direction);
+    RUN_TEST(test_send_frame_carries_trace_stamps);
+    RUN_TEST(test_index_page_posts_setpoint);
+    RUN_TEST(test_i2c_bus_starts_in_fast_mode);
+    RUN_TEST(test_i2c_bus_write_then_read_uses_one_transaction);
+    RUN_TEST(test_i2c_bus_counts_errors_and_latency);
+    RUN_TEST(test_i2c_bus_timeout_clocks_a_stuck_slave_free);
+    RUN_TEST(test_wifi_begin_returns_without_waiting);
+    RUN_TEST(test_wifi_static_ip_is_configured_before_connecting);
+    RUN_TEST(test_wifi_caches_ap_for_fast_reconnect_on_next_boot);
+    RUN_TEST(test_wifi_failed_fast_attempt_drops_cache_and_backs_off);
+    RUN_TEST(test_wifi_reconnects_after_losing_the_ap);
+    RUN_TEST(test_wifi_attempt_without_events_times_out);
+    RUN_TEST(test_boot_timeline_serving_needs_listen_and_address);
+    RUN_TEST(test_binlog_text_mode_formats_record);
+    RUN_TEST(test_binlog_binary_frames_send_definition_once);
+    RUN_TEST(test_binlog_full_ring_counts_drops);
+    RUN_TEST(test_binlog_long_string_is_truncated);
+    RUN_TEST(test_metrics_period_and_jitter_histograms);
+    RUN_TEST(test_metrics_uptime_does_not_wrap_with_micros);
+    RUN_TEST(test_metrics_count_requests_per_route);
+    RUN_TEST(test_metrics_report_heap_wifi_and_i2c);
+    RUN_TEST(test_send_frame_counts_sent_and_dropped_frames);
+    RUN_TEST(test_supervisor_budget_overrun_blames_slowest_stage);
+    RUN_TEST(test_supervisor_reports_stall_and_starves_watchdog);
+    RUN_TEST(test_supervisor_late_start_and_silent_task);
+    RUN_TEST(test_telemetry_datagram_layout);
+    RUN_TEST(test_telemetry_missing_sensor_and_many_lights);
+    RUN_TEST(test_telemetry_is_rate_limited_and_needs_wifi);
+    RUN_TEST(test_strip_chart_scrolls_and_draws_only_the_newest_column);
+    RUN_TEST(test_strip_chart_cost_does_not_grow_with_history);
+    RUN_TEST(test_strip_chart_redraw_matches_incremental_drawing);
+    RUN_TEST(test_setpoint_post_validates_and_forwards_at_once);
+    RUN_TEST(test_setpoint_ack_measures_latency_and_resends);
+    RUN_TEST(test_setpoint_nak_stops_resends_and_counts_rejection);
+    RUN_TEST(test_setpoint_burst_of_edits_costs_one_flash_write);
+    RUN_TEST(test_admission_caps_connections_with_retry_after);
+    RUN_TEST(test_sample_body_is_formatted_once_per_sample);
+    RUN_TEST(test_metrics_report_admission);
+    RUN_TEST(test_power_policy_follows_the_rate_of_change);
+    RUN_TEST(test_energy_model_estimates_a_day);
+    RUN_TEST(test_power_manager_light_sleeps_at_night);
+    return UNITY_END();
+}
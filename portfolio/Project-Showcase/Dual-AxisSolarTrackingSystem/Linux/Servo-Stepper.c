@@ -1,4 +1,4 @@
-    #include <linux/gpio.h>
+    #include <linux/gpio/consumer.h>
     #include <linux/fs.h>
     #include <linux/cdev.h>
     #include <linux/device.h>
@@ -7,40 +7,388 @@
     #include <linux/of.h>
     #include <linux/platform_device.h>
     #include <linux/delay.h>
-    #include <linux/of_gpio.h>
-
-    #define MAX_DEVICES 5
-
-    static int servo_gpio;
-    static int stepper_gpio_base;
+    #include <linux/ktime.h>
+    #include <linux/hrtimer.h>
+    #include <linux/kfifo.h>
+    #include <linux/spinlock.h>
+    #include <linux/wait.h>
+    #include <linux/debugfs.h>
+    #include <linux/seq_file.h>
+    #include <linux/idr.h>
+    #include <linux/kref.h>
+    #include <linux/mutex.h>
+    #include <linux/slab.h>
+    #include <linux/version.h>
+    #include <linux/poll.h>
+    #include <linux/mm.h>
+
+    #define CREATE_TRACE_POINTS
+    #include "servo_stepper_trace.h"
+    #include "plat_drv_status.h"
+
+    // Every plat_drv node in the device tree is one tracker with its own
+    // servo and stepper. Tracker n gets minors 2n (servo, /dev/plat_drv<2n>)
+    // and 2n+1 (stepper, /dev/plat_drv<2n+1>), so the first tracker keeps
+    // the /dev/plat_drv0 and /dev/plat_drv1 nodes the controller uses.
+    #define MAX_TRACKERS 32
+
+    #define QUEUE_LEN 16 // Commands per axis, must be a power of two
+    #define STEP_PERIOD_NS (2 * NSEC_PER_MSEC)
+    #define STEP_RATE (NSEC_PER_SEC / STEP_PERIOD_NS)
+    #define SERVO_PERIOD_NS (20 * NSEC_PER_MSEC)
+    #define LATE_BUCKETS 16 // Lateness histogram, log2 microseconds
+
+    // The Pi runs 5.4; the gpio-sim test suite (test/kernel) builds the
+    // module for a current x86 kernel as well
+    #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 4, 0)
+    #define plat_drv_class_create(name) class_create(name)
+    #else
+    #define plat_drv_class_create(name) class_create(THIS_MODULE, name)
+    #endif
+    #if LINUX_VERSION_CODE < KERNEL_VERSION(6, 3, 0)
+    #define vm_flags_clear(vma, flags) ((vma)->vm_flags &= ~(flags))
+    #endif
 
     static dev_t devno;
     static struct class *gpio_class;
-    static struct cdev gpio_cdev[MAX_DEVICES];
+    static struct dentry *debug_root;
 
-    static int servo_angle = 0;
+    // Trackers by id; the lock orders open() against remove()
+    static DEFINE_MUTEX(trackers_lock);
+    static DEFINE_IDR(trackers);
 
     static const int step_sequence[4][4] = {
-        {1, 0, 0, 1}, 
-        {1, 1, 0, 0}, 
-        {0, 1, 1, 0}, 
+        {1, 0, 0, 1},
+        {1, 1, 0, 0},
+        {0, 1, 1, 0},
         {0, 0, 1, 1}
     };
 
+    // Motion queue. write() only queues a command; the edges are produced by
+    // one hrtimer per axis, so a move no longer busy-waits in the syscall and
+    // the timing of every edge can be measured against when it was due.
+    enum axis_id { AXIS_SERVO, AXIS_STEPPER, NUM_AXES };
+
+    struct motion_cmd {
+        int value;          // Servo angle, or stepper steps (negative = backward)
+        unsigned int trace; // Trace id of the frame behind it, 0 if none; put in the tracepoints for tracelat
+        u32 seq;
+    };
+
+    struct axis_stats {
+        u64 steps;          // Step edges (stepper) or PWM periods (servo) emitted
+        u64 commands;       // Commands accepted by write()
+        u32 queue_hwm;      // Deepest the queue has been, move in progress included
+        s64 late_min, late_max, late_sum; // Timer lateness in ns
+        u64 late_count;
+        u32 late_hist[LATE_BUCKETS];
+    };
+
+    struct tracker;
+
+    struct axis {
+        enum axis_id id;
+        struct tracker *trk;
+        spinlock_t lock;
+        DECLARE_KFIFO(queue, struct motion_cmd, QUEUE_LEN);
+        struct hrtimer timer;
+        wait_queue_head_t wq;   // Woken whenever a move finishes
+        bool busy;
+        bool gone;              // Device removed, refuse new commands
+        struct motion_cmd cur;  // Move in progress
+        int step;               // Stepper: next step; servo: 0 rise, 1 fall, 2 end of period
+        ktime_t started;        // First edge of the move in progress
+        u32 width_ns;           // Servo: pulse width actually emitted
+        u32 queued_seq, done_seq; // 32 bits so they can be read untorn on ARM
+        struct axis_stats stats;
+    };
+
+    // One tracker. Freed when the device is removed and the last open file
+    // (or mapping of the status page) on it is closed, whichever comes last.
+    struct tracker {
+        struct kref ref;
+        int id;
+        struct gpio_desc *servo_gpio;
+        struct gpio_desc *stepper_gpio[4];
+        int servo_angle;
+        struct cdev *cdev;
+        struct dentry *debug_dir;
+        struct axis axes[NUM_AXES];
+        spinlock_t status_lock;          // Serialises the writers of status
+        struct plat_drv_status *status;  // One page, see plat_drv_status.h
+    };
+
+    static void tracker_release(struct kref *ref) {
+        struct tracker *trk = container_of(ref, struct tracker, ref);
+
+        free_page((unsigned long)trk->status);
+        kfree(trk);
+    }
+
+    // Status page updates: both axes write to the page, from their timers
+    // and from write(), so writers take status_lock (inside ax->lock) and
+    // bump the sequence counter around the change for lock-free readers
+    static struct plat_drv_status *status_begin(struct tracker *trk, unsigned long *flags) {
+        struct plat_drv_status *st = trk->status;
+
+        spin_lock_irqsave(&trk->status_lock, *flags);
+        WRITE_ONCE(st->seq, st->seq + 1);
+        smp_wmb();
+        return st;
+    }
+
+    static void status_end(struct tracker *trk, unsigned long flags) {
+        struct plat_drv_status *st = trk->status;
+
+        st->updated_ns = ktime_get_ns();
+        smp_wmb();
+        WRITE_ONCE(st->seq, st->seq + 1);
+        spin_unlock_irqrestore(&trk->status_lock, flags);
+    }
+
+    // Queue depth and sequence numbers of an axis; called with ax->lock held
+    static void status_queue(struct axis *ax) {
+        unsigned long flags;
+        struct plat_drv_status *st = status_begin(ax->trk, &flags);
+        struct plat_drv_axis_status *as = &st->axis[ax->id];
+
+        as->queue_depth = kfifo_len(&ax->queue) + ax->busy;
+        as->queued_seq = ax->queued_seq;
+        as->done_seq = ax->done_seq;
+        if (!ax->busy) {
+            as->velocity = 0;
+        }
+        status_end(ax->trk, flags);
+    }
+
+    // Called with ax->lock held
+    static void record_lateness(struct axis *ax, s64 late) {
+        struct axis_stats *s = &ax->stats;
+        u64 us = late > 0 ? div_u64(late, NSEC_PER_USEC) : 0;
+        int bucket = min(fls64(us), LATE_BUCKETS - 1);
+
+        if (!s->late_count || late < s->late_min) {
+            s->late_min = late;
+        }
+        if (!s->late_count || late > s->late_max) {
+            s->late_max = late;
+        }
+        s->late_sum += late;
+        s->late_count++;
+        s->late_hist[bucket]++;
+
+        // A stepper edge a whole step period late means the motor may have
+        // lost the step; a late servo pulse only delays the angle
+        if (ax->id == AXIS_STEPPER && late >= STEP_PERIOD_NS &&
+            !(READ_ONCE(ax->trk->status->faults) & PLAT_DRV_FAULT_LATE)) {
+            unsigned long flags;
+
+            status_begin(ax->trk, &flags)->faults |= PLAT_DRV_FAULT_LATE;
+            status_end(ax->trk, flags);
+            wake_up_all(&ax->wq);
+        }
+    }
+
+    // Take the next command off the queue; called with ax->lock held
+    static bool start_next(struct axis *ax) {
+        ax->busy = kfifo_get(&ax->queue, &ax->cur);
+        ax->step = 0;
+        return ax->busy;
+    }
+
+    // Retire the move in progress and return whether the timer should run on
+    // for the next one; called with ax->lock held
+    static bool finish_move(struct axis *ax, ktime_t now) {
+        bool again;
+
+        trace_plat_drv_move_done(ax->trk->id, ax->id, ax->cur.value, ax->cur.trace,
+                                 ktime_to_ns(ktime_sub(now, ax->started)));
+        ax->done_seq = ax->cur.seq;
+        again = start_next(ax);
+        status_queue(ax);
+        wake_up_all(&ax->wq); // After start_next() so waiters also see the freed slot
+
+        if (again) {
+            hrtimer_set_expires(&ax->timer, now);
+        }
+        return again;
+    }
+
+    static bool servo_tick(struct axis *ax, ktime_t now, s64 late) {
+        struct tracker *trk = ax->trk;
+        int duty_cycle = 500 + (ax->cur.value * 2000) / 180;
+        unsigned long flags;
+
+        switch (ax->step++) {
+        case 0:
+            gpiod_set_raw_value(trk->servo_gpio, 1);
+            ax->started = now;
+            hrtimer_set_expires(&ax->timer, ktime_add_us(now, duty_cycle));
+            return true;
+        case 1:
+            gpiod_set_raw_value(trk->servo_gpio, 0);
+            ax->width_ns = ktime_to_ns(ktime_sub(now, ax->started));
+            hrtimer_set_expires(&ax->timer, ktime_add_ns(ax->started, SERVO_PERIOD_NS));
+            return true;
+        default:
+            ax->stats.steps++;
+            trace_plat_drv_pwm_period(trk->id, ax->cur.value, ax->width_ns,
+                                      ktime_to_ns(ktime_sub(now, ax->started)), late);
+            trk->servo_angle = ax->cur.value;
+            status_begin(trk, &flags)->axis[AXIS_SERVO].position = ax->cur.value;
+            status_end(trk, flags);
+            return finish_move(ax, now);
+        }
+    }
+
+    static void stepper_release(struct tracker *trk) {
+        for (int j = 0; j < 4; j++) {
+            gpiod_set_raw_value(trk->stepper_gpio[j], 0);
+        }
+    }
+
+    static bool stepper_tick(struct axis *ax, ktime_t now, s64 late) {
+        struct tracker *trk = ax->trk;
+        int i = ax->step, idx;
+        unsigned int phase = 0;
+        unsigned long flags;
+        struct plat_drv_axis_status *as;
+
+        if (i >= abs(ax->cur.value)) {
+            stepper_release(trk);
+            return finish_move(ax, now);
+        }
+
+        idx = ax->cur.value > 0 ? i % 4 : (3 - (i % 4));
+        for (int j = 0; j < 4; j++) {
+            gpiod_set_raw_value(trk->stepper_gpio[j], step_sequence[idx][j]);
+            phase = phase << 1 | step_sequence[idx][j];
+        }
+        if (i == 0) {
+            ax->started = now;
+        }
+        trace_plat_drv_step(trk->id, i, phase, late, ax->cur.trace);
+        ax->stats.steps++;
+        ax->step++;
+
+        as = &status_begin(trk, &flags)->axis[AXIS_STEPPER];
+        as->position += ax->cur.value > 0 ? 1 : -1;
+        as->velocity = ax->cur.value > 0 ? STEP_RATE : -STEP_RATE;
+        status_end(trk, flags);
+
+        // Stay on the 2 ms grid; a late edge does not push the later ones back
+        hrtimer_forward(&ax->timer, now, ns_to_ktime(STEP_PERIOD_NS));
+        return true;
+    }
+
+    static enum hrtimer_restart axis_timer(struct hrtimer *timer) {
+        struct axis *ax = container_of(timer, struct axis, timer);
+        ktime_t now = ktime_get();
+        s64 late = ktime_to_ns(ktime_sub(now, hrtimer_get_expires(timer)));
+        bool again;
+
+        spin_lock(&ax->lock);
+        record_lateness(ax, late);
+        again = ax->id == AXIS_SERVO ? servo_tick(ax, now, late) : stepper_tick(ax, now, late);
+        spin_unlock(&ax->lock);
+
+        return again ? HRTIMER_RESTART : HRTIMER_NORESTART;
+    }
+
+    // A command was queued; called with ax->lock held
+    static void status_queued(struct axis *ax, int value) {
+        unsigned long flags;
+        struct plat_drv_status *st = status_begin(ax->trk, &flags);
+        struct plat_drv_axis_status *as = &st->axis[ax->id];
+
+        if (ax->id == AXIS_SERVO) {
+            as->target = value;
+        } else {
+            as->target += value;
+        }
+        as->queue_depth = kfifo_len(&ax->queue) + ax->busy;
+        as->queued_seq = ax->queued_seq;
+        status_end(ax->trk, flags);
+    }
+
+    // Queue a command and start the axis if it is idle. Returns -EAGAIN when
+    // the queue is full and -ENODEV once the tracker has been removed.
+    static int queue_move(struct axis *ax, int value, unsigned int trace, u32 *seq) {
+        struct motion_cmd cmd = { .value = value, .trace = trace };
+        unsigned long flags;
+        unsigned int depth;
+
+        spin_lock_irqsave(&ax->lock, flags);
+        if (ax->gone) {
+            spin_unlock_irqrestore(&ax->lock, flags);
+            return -ENODEV;
+        }
+        if (kfifo_is_full(&ax->queue)) {
+            spin_unlock_irqrestore(&ax->lock, flags);
+            return -EAGAIN;
+        }
+        cmd.seq = ++ax->queued_seq;
+        kfifo_put(&ax->queue, cmd);
+
+        depth = kfifo_len(&ax->queue) + ax->busy;
+        ax->stats.commands++;
+        if (depth > ax->stats.queue_hwm) {
+            ax->stats.queue_hwm = depth;
+        }
+        trace_plat_drv_command(ax->trk->id, ax->id, value, trace, depth);
+
+        if (!ax->busy && start_next(ax)) {
+            hrtimer_start(&ax->timer, ktime_get(), HRTIMER_MODE_ABS);
+        }
+        status_queued(ax, value);
+        spin_unlock_irqrestore(&ax->lock, flags);
+
+        *seq = cmd.seq;
+        return 0;
+    }
+
+    static int gpio_open(struct inode *inode, struct file *filep) {
+        unsigned int minor = iminor(inode);
+        struct tracker *trk;
+
+        mutex_lock(&trackers_lock);
+        trk = idr_find(&trackers, minor / NUM_AXES);
+        if (trk) {
+            kref_get(&trk->ref);
+        }
+        mutex_unlock(&trackers_lock);
+        if (!trk) {
+            return -ENODEV;
+        }
+
+        filep->private_data = &trk->axes[minor % NUM_AXES];
+        return 0;
+    }
+
+    static int gpio_release(struct inode *inode, struct file *filep) {
+        struct axis *ax = filep->private_data;
+
+        kref_put(&ax->trk->ref, tracker_release);
+        return 0;
+    }
+
     static ssize_t gpio_write(struct file *filep, const char __user *ubuf, size_t count, loff_t *f_pos) {
+        struct axis *ax = filep->private_data;
         char kbuf[32];
-        char *temp_kbuf, *cmd, *steps_str;
-        int minor = MINOR(filep->f_inode->i_rdev);
-        int value;
+        char *temp_kbuf, *cmd, *steps_str, *trace_str;
+        size_t len = min(count, sizeof(kbuf) - 1);
+        unsigned int trace = 0;
+        int value, err;
+        u32 seq;
 
-        if (copy_from_user(kbuf, ubuf, min(count, sizeof(kbuf) - 1))) {
+        if (copy_from_user(kbuf, ubuf, len)) {
             return -EFAULT;
         }
-        kbuf[count] = '\0';
+        kbuf[len] = '\0';
         temp_kbuf = kbuf;
 
-        if (minor == 0) { 
-            if (kstrtoint(kbuf, 10, &value)) {
+        if (ax->id == AXIS_SERVO) {
+            if (sscanf(kbuf, "%d %u", &value, &trace) < 1) {
                 pr_err("Invalid servo angle\n");
                 return -EINVAL;
             }
@@ -48,207 +396,437 @@
                 pr_err("Servo angle out of range (0-180)\n");
                 return -EINVAL;
             }
-
-            int duty_cycle = 500 + (value * 2000) / 180;
-            gpio_set_value(servo_gpio, 1);
-            udelay(duty_cycle);
-            gpio_set_value(servo_gpio, 0);
-            udelay(20000 - duty_cycle);
-        } else if (minor == 1) { 
+        } else {
             cmd = strsep(&temp_kbuf, " ");
             steps_str = strsep(&temp_kbuf, " ");
-            int steps, clockwise;
+            trace_str = strsep(&temp_kbuf, " ");
+            int steps;
 
-            if (!cmd || !steps_str || kstrtoint(steps_str, 10, &steps)) {
+            if (!cmd || !steps_str || kstrtoint(steps_str, 10, &steps) || steps < 0) {
                 pr_err("Invalid stepper command\n");
                 return -EINVAL;
             }
-            clockwise = strcmp(cmd, "forward") == 0;
+            if (trace_str && kstrtouint(trace_str, 10, &trace)) {
+                trace = 0;
+            }
+            value = strcmp(cmd, "forward") == 0 ? steps : -steps;
+        }
 
-            for (int i = 0; i < steps; i++) {
-                int idx = clockwise ? i % 4 : (3 - (i % 4));
-                for (int j = 0; j < 4; j++) {
-                    gpio_set_value(stepper_gpio_base + j, step_sequence[idx][j]);
-                }
-                msleep(2);
+        // Blocking writers keep the old semantics and return once their move
+        // is done; O_NONBLOCK writers just queue and get -EAGAIN when full
+        while ((err = queue_move(ax, value, trace, &seq)) == -EAGAIN) {
+            if (filep->f_flags & O_NONBLOCK) {
+                return err;
             }
-            for (int i = 0; i < 4; i++) {
-                gpio_set_value(stepper_gpio_base + i, 0);
+            if (wait_event_interruptible(ax->wq, !kfifo_is_full(&ax->queue) || READ_ONCE(ax->gone))) {
+                return -ERESTARTSYS;
             }
         }
+        if (err) {
+            return err;
+        }
+        if (!(filep->f_flags & O_NONBLOCK)) {
+            // The command stands even if a signal cuts the wait short
+            wait_event_interruptible(ax->wq, (s32)(READ_ONCE(ax->done_seq) - seq) >= 0);
+        }
 
         return count;
     }
 
     static ssize_t gpio_read(struct file *filep, char __user *buf, size_t count, loff_t *f_pos) {
+        struct axis *ax = filep->private_data;
         char kbuf[32];
-        int len, minor = MINOR(filep->f_inode->i_rdev);
+        int len;
 
-        if (minor == 0) {
-            len = snprintf(kbuf, sizeof(kbuf), "Servo angle: %d\n", servo_angle);
-        } else if (minor == 1) {
-            len = snprintf(kbuf, sizeof(kbuf), "Stepper motor ready\n");
+        if (ax->id == AXIS_SERVO) {
+            len = snprintf(kbuf, sizeof(kbuf), "Servo angle: %d\n", READ_ONCE(ax->trk->servo_angle));
         } else {
-            return -EINVAL;
+            len = snprintf(kbuf, sizeof(kbuf), "Stepper motor ready\n");
         }
 
-        if (copy_to_user(buf, kbuf, len)) {
-            return -EFAULT;
+        return simple_read_from_buffer(buf, count, f_pos, kbuf, len);
+    }
+
+    // See plat_drv_status.h for what the events mean
+    static __poll_t gpio_poll(struct file *filep, poll_table *wait) {
+        struct axis *ax = filep->private_data;
+        __poll_t mask = 0;
+        unsigned long flags;
+
+        poll_wait(filep, &ax->wq, wait);
+
+        spin_lock_irqsave(&ax->lock, flags);
+        if (ax->gone) {
+            mask |= EPOLLHUP | EPOLLERR;
+        } else {
+            if (!ax->busy) {
+                mask |= EPOLLIN | EPOLLRDNORM;
+            }
+            if (!kfifo_is_full(&ax->queue)) {
+                mask |= EPOLLOUT | EPOLLWRNORM;
+            }
         }
+        if (READ_ONCE(ax->trk->status->faults)) {
+            mask |= EPOLLPRI;
+        }
+        spin_unlock_irqrestore(&ax->lock, flags);
+        return mask;
+    }
 
-        return len;
+    // The status page, read-only; the mapping keeps the file and so the
+    // tracker alive
+    static int gpio_mmap(struct file *filep, struct vm_area_struct *vma) {
+        struct axis *ax = filep->private_data;
+
+        if (vma->vm_pgoff || vma->vm_end - vma->vm_start != PAGE_SIZE) {
+            return -EINVAL;
+        }
+        if (vma->vm_flags & VM_WRITE) {
+            return -EPERM;
+        }
+        vm_flags_clear(vma, VM_MAYWRITE);
+        return remap_pfn_range(vma, vma->vm_start, virt_to_phys(ax->trk->status) >> PAGE_SHIFT, PAGE_SIZE,
+                               vma->vm_page_prot);
     }
-        
+
     static const struct file_operations gpio_fops = {
         .owner = THIS_MODULE,
+        .open = gpio_open,
+        .release = gpio_release,
         .write = gpio_write,
         .read = gpio_read,
+        .poll = gpio_poll,
+        .mmap = gpio_mmap,
     };
 
-    // Probe function
-    static int plat_drv_probe(struct platform_device *pdev) {
-        dev_t curr_devno;
-        int err;
+    // debugfs: /sys/kernel/debug/plat_drv/tracker<n>/{servo,stepper}/{stats,lateness,reset}
+    static void snapshot_stats(struct axis *ax, struct axis_stats *s, unsigned int *depth) {
+        unsigned long flags;
 
-        servo_gpio = of_get_named_gpio(pdev->dev.of_node, "servo-gpio", 0);
-        if (!gpio_is_valid(servo_gpio)) {
-            pr_err("Invalid servo GPIO\n");
-            return -EINVAL;
+        spin_lock_irqsave(&ax->lock, flags);
+        *s = ax->stats;
+        *depth = kfifo_len(&ax->queue) + ax->busy;
+        spin_unlock_irqrestore(&ax->lock, flags);
+    }
+
+    static int stats_show(struct seq_file *m, void *unused) {
+        struct axis_stats s;
+        unsigned int depth;
+
+        snapshot_stats(m->private, &s, &depth);
+        seq_printf(m, "steps %llu\n", s.steps);
+        seq_printf(m, "commands %llu\n", s.commands);
+        seq_printf(m, "queue_depth %u\n", depth);
+        seq_printf(m, "queue_hwm %u\n", s.queue_hwm);
+        return 0;
+    }
+    DEFINE_SHOW_ATTRIBUTE(stats);
+
+    static int lateness_show(struct seq_file *m, void *unused) {
+        struct axis_stats s;
+        unsigned int depth;
+
+        snapshot_stats(m->private, &s, &depth);
+        seq_printf(m, "count %llu\n", s.late_count);
+        seq_printf(m, "min_ns %lld\n", s.late_count ? s.late_min : 0);
+        seq_printf(m, "avg_ns %lld\n", s.late_count ? div64_s64(s.late_sum, s.late_count) : 0);
+        seq_printf(m, "max_ns %lld\n", s.late_count ? s.late_max : 0);
+        for (int b = 0; b < LATE_BUCKETS; b++) {
+            if (b == LATE_BUCKETS - 1) {
+                seq_printf(m, "%6u us -        %u\n", 1u << (b - 1), s.late_hist[b]);
+            } else {
+                seq_printf(m, "%6u us - %6u %u\n", b ? 1u << (b - 1) : 0, 1u << b, s.late_hist[b]);
+            }
         }
+        return 0;
+    }
+    DEFINE_SHOW_ATTRIBUTE(lateness);
 
-        stepper_gpio_base = of_get_named_gpio(pdev->dev.of_node, "stepper-gpio-base", 0);
-        if (!gpio_is_valid(stepper_gpio_base)) {
-            pr_err("Invalid stepper GPIO base\n");
-            return -EINVAL;
+    // Any write clears the counters, e.g. before a measurement run
+    static ssize_t reset_write(struct file *filep, const char __user *ubuf, size_t count, loff_t *f_pos) {
+        struct axis *ax = filep->private_data;
+        unsigned long flags;
+
+        spin_lock_irqsave(&ax->lock, flags);
+        memset(&ax->stats, 0, sizeof(ax->stats));
+        spin_unlock_irqrestore(&ax->lock, flags);
+
+        status_begin(ax->trk, &flags)->faults &= ~PLAT_DRV_FAULT_LATE;
+        status_end(ax->trk, flags);
+        return count;
+    }
+
+    static const struct file_operations reset_fops = {
+        .owner = THIS_MODULE,
+        .open = simple_open,
+        .write = reset_write,
+    };
+
+    static void axes_init(struct tracker *trk) {
+        for (int i = 0; i < NUM_AXES; i++) {
+            struct axis *ax = &trk->axes[i];
+
+            ax->id = i;
+            ax->trk = trk;
+            spin_lock_init(&ax->lock);
+            INIT_KFIFO(ax->queue);
+            init_waitqueue_head(&ax->wq);
+    #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 13, 0)
+            hrtimer_setup(&ax->timer, axis_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+    #else
+            hrtimer_init(&ax->timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+            ax->timer.function = axis_timer;
+    #endif
         }
+    }
 
-        pr_info("Probing GPIO Driver\n");
+    // Stop the motion engines and release anyone waiting on them
+    static void axes_shutdown(struct tracker *trk) {
+        unsigned long flags;
 
-        // Allocate character devices
-        err = alloc_chrdev_region(&devno, 0, MAX_DEVICES, "plat_drv");
-        if (err) {
-            pr_err("Failed to allocate chrdev region\n");
-            return err;
+        status_begin(trk, &flags)->faults |= PLAT_DRV_FAULT_REMOVED;
+        status_end(trk, flags);
+
+        for (int i = 0; i < NUM_AXES; i++) {
+            struct axis *ax = &trk->axes[i];
+
+            spin_lock_irqsave(&ax->lock, flags);
+            ax->gone = true;
+            spin_unlock_irqrestore(&ax->lock, flags);
+
+            hrtimer_cancel(&ax->timer);
+
+            // Whatever was still queued will never run
+            spin_lock_irqsave(&ax->lock, flags);
+            ax->busy = false;
+            kfifo_reset(&ax->queue);
+            ax->done_seq = ax->queued_seq;
+            status_queue(ax);
+            spin_unlock_irqrestore(&ax->lock, flags);
+            wake_up_all(&ax->wq);
         }
+        gpiod_set_raw_value(trk->servo_gpio, 0);
+        stepper_release(trk);
+    }
 
-        gpio_class = class_create(THIS_MODULE, "plat_drv_class");
-        if (IS_ERR(gpio_class)) {
-            unregister_chrdev_region(devno, MAX_DEVICES);
-            return PTR_ERR(gpio_class);
+    static void axes_debugfs_create(struct tracker *trk) {
+        static const char *const names[NUM_AXES] = { "servo", "stepper" };
+        char name[16];
+
+        snprintf(name, sizeof(name), "tracker%d", trk->id);
+        trk->debug_dir = debugfs_create_dir(name, debug_root);
+        for (int i = 0; i < NUM_AXES; i++) {
+            struct dentry *dir = debugfs_create_dir(names[i], trk->debug_dir);
+
+            debugfs_create_file("stats", 0444, dir, &trk->axes[i], &stats_fops);
+            debugfs_create_file("lateness", 0444, dir, &trk->axes[i], &lateness_fops);
+            debugfs_create_file("reset", 0200, dir, &trk->axes[i], &reset_fops);
         }
+    }
 
-        // Create /dev/plat_drv0 for servo motor
-        curr_devno = MKDEV(MAJOR(devno), 0);
-        cdev_init(&gpio_cdev[0], &gpio_fops);
-        cdev_add(&gpio_cdev[0], curr_devno, 1);
-        device_create(gpio_class, NULL, curr_devno, NULL, "plat_drv0");
-
-        // Create /dev/plat_drv1 for stepper pin 1
-        curr_devno = MKDEV(MAJOR(devno), 1);
-        cdev_init(&gpio_cdev[1], &gpio_fops);
-        cdev_add(&gpio_cdev[1], curr_devno, 1);
-        device_create(gpio_class, NULL, curr_devno, NULL, "plat_drv1");
-
-        // Create /dev/plat_drv2 for stepper pin 2
-        curr_devno = MKDEV(MAJOR(devno), 2);
-        cdev_init(&gpio_cdev[2], &gpio_fops);
-        cdev_add(&gpio_cdev[2], curr_devno, 1);
-        device_create(gpio_class, NULL, curr_devno, NULL, "plat_drv2");
-
-        // Create /dev/plat_drv3 for stepper pin 3
-        curr_devno = MKDEV(MAJOR(devno), 3);
-        cdev_init(&gpio_cdev[3], &gpio_fops);
-        cdev_add(&gpio_cdev[3], curr_devno, 1);
-        device_create(gpio_class, NULL, curr_devno, NULL, "plat_drv3");
-
-        // Create /dev/plat_drv4 for stepper pin 4
-        curr_devno = MKDEV(MAJOR(devno), 4);
-        cdev_init(&gpio_cdev[4], &gpio_fops);
-        cdev_add(&gpio_cdev[4], curr_devno, 1);
-        device_create(gpio_class, NULL, curr_devno, NULL, "plat_drv4");
-
-        // Request GPIOs for servo motor
-        err = gpio_request_one(SERVO_GPIO, GPIOF_OUT_INIT_LOW, "Servo GPIO");
-        if (err) {
-            pr_err("Failed to request Servo GPIO\n");
-            goto cleanup_servo;
+    // The lines are driven by physical level, as the driver always has and as
+    // the userspace gpiod backend does: the overlay's flags (<&gpio N 1>,
+    // active low) are ignored rather than inverting every output
+    static struct gpio_desc *request_output(struct device *dev, unsigned int idx) {
+        struct gpio_desc *desc = devm_gpiod_get_index(dev, NULL, idx, GPIOD_ASIS);
+        int err;
+
+        if (IS_ERR(desc)) {
+            return desc;
         }
+        err = gpiod_direction_output_raw(desc, 0);
+        return err ? ERR_PTR(err) : desc;
+    }
 
-        // Request GPIOs for stepper motor pins
-        err = gpio_request_one(STEPPER_GPIO_BASE + 0, GPIOF_OUT_INIT_LOW, "Stepper GPIO 1");
-        if (err) {
-            pr_err("Failed to request Stepper GPIO 1\n");
-            goto cleanup_stepper1;
+    // Probe function, once per plat_drv node (or platform device with a GPIO
+    // lookup table, as registered by test/kernel/plat_drv_sim.c)
+    static int plat_drv_probe(struct platform_device *pdev) {
+        struct tracker *trk;
+        int err;
+
+        trk = kzalloc(sizeof(*trk), GFP_KERNEL);
+        if (!trk) {
+            return -ENOMEM;
+        }
+        kref_init(&trk->ref);
+        spin_lock_init(&trk->status_lock);
+        trk->status = (struct plat_drv_status *)get_zeroed_page(GFP_KERNEL);
+        if (!trk->status) {
+            kfree(trk);
+            return -ENOMEM;
+        }
+        trk->status->version = PLAT_DRV_STATUS_VERSION;
+
+        // gpios = <servo>, <stepper pin 1> ... <stepper pin 4>; devm releases
+        // them after plat_drv_remove()
+        trk->servo_gpio = request_output(&pdev->dev, 0);
+        if (IS_ERR(trk->servo_gpio)) {
+            dev_err(&pdev->dev, "Failed to request Servo GPIO\n");
+            err = PTR_ERR(trk->servo_gpio);
+            goto err_free;
+        }
+        for (int i = 0; i < 4; i++) {
+            trk->stepper_gpio[i] = request_output(&pdev->dev, i + 1);
+            if (IS_ERR(trk->stepper_gpio[i])) {
+                dev_err(&pdev->dev, "Failed to request Stepper GPIO %d\n", i + 1);
+                err = PTR_ERR(trk->stepper_gpio[i]);
+                goto err_free;
+            }
         }
 
-        err = gpio_request_one(STEPPER_GPIO_BASE + 1, GPIOF_OUT_INIT_LOW, "Stepper GPIO 2");
-        if (err) {
-            pr_err("Failed to request Stepper GPIO 2\n");
-            goto cleanup_stepper2;
+        // The lines are driven from hrtimer callbacks, so they must not sleep
+        // (which rules out e.g. I2C expanders and gpio-sim)
+        for (int i = 0; i < 4; i++) {
+            if (gpiod_cansleep(trk->servo_gpio) || gpiod_cansleep(trk->stepper_gpio[i])) {
+                dev_err(&pdev->dev, "GPIOs on a sleeping controller are not supported\n");
+                err = -EINVAL;
+                goto err_free;
+            }
         }
 
-        err = gpio_request_one(STEPPER_GPIO_BASE + 2, GPIOF_OUT_INIT_LOW, "Stepper GPIO 3");
-        if (err) {
-            pr_err("Failed to request Stepper GPIO 3\n");
-            goto cleanup_stepper3;
+        axes_init(trk);
+
+        mutex_lock(&trackers_lock);
+        trk->id = idr_alloc(&trackers, trk, 0, MAX_TRACKERS, GFP_KERNEL);
+        mutex_unlock(&trackers_lock);
+        if (trk->id < 0) {
+            dev_err(&pdev->dev, "Too many trackers\n");
+            err = trk->id;
+            goto err_free;
         }
 
-        err = gpio_request_one(STEPPER_GPIO_BASE + 3, GPIOF_OUT_INIT_LOW, "Stepper GPIO 4");
+        // One cdev for both minors of the tracker. It is allocated on its own
+        // because it may outlive the tracker while the device is torn down.
+        trk->cdev = cdev_alloc();
+        if (!trk->cdev) {
+            err = -ENOMEM;
+            goto err_idr;
+        }
+        trk->cdev->owner = THIS_MODULE;
+        trk->cdev->ops = &gpio_fops;
+        err = cdev_add(trk->cdev, MKDEV(MAJOR(devno), trk->id * NUM_AXES), NUM_AXES);
         if (err) {
-            pr_err("Failed to request Stepper GPIO 4\n");
-            goto cleanup_stepper4;
+            kobject_put(&trk->cdev->kobj);
+            goto err_idr;
         }
 
-        pr_info("GPIO Driver successfully probed\n");
+        // /dev/plat_drv<2n> for the servo, /dev/plat_drv<2n+1> for the stepper
+        for (int i = 0; i < NUM_AXES; i++) {
+            int minor = trk->id * NUM_AXES + i;
+            struct device *dev = device_create(gpio_class, &pdev->dev, MKDEV(MAJOR(devno), minor), trk,
+                                               "plat_drv%d", minor);
+            if (IS_ERR(dev)) {
+                err = PTR_ERR(dev);
+                while (i--) {
+                    device_destroy(gpio_class, MKDEV(MAJOR(devno), trk->id * NUM_AXES + i));
+                }
+                cdev_del(trk->cdev);
+                goto err_idr;
+            }
+        }
+
+        axes_debugfs_create(trk);
+        platform_set_drvdata(pdev, trk);
+
+        dev_info(&pdev->dev, "Tracker %d: servo /dev/plat_drv%d, stepper /dev/plat_drv%d\n", trk->id,
+                 trk->id * NUM_AXES + AXIS_SERVO, trk->id * NUM_AXES + AXIS_STEPPER);
         return 0;
 
     // Cleanup in case of errors
-    cleanup_stepper4:
-        gpio_free(STEPPER_GPIO_BASE + 2);
-    cleanup_stepper3:
-        gpio_free(STEPPER_GPIO_BASE + 1);
-    cleanup_stepper2:
-        gpio_free(STEPPER_GPIO_BASE + 0);
-    cleanup_stepper1:
-        gpio_free(SERVO_GPIO);
-    cleanup_servo:
-        for (int i = 0; i <= 4; i++) {
-            device_destroy(gpio_class, MKDEV(MAJOR(devno), i));
-            cdev_del(&gpio_cdev[i]);
-        }
-        class_destroy(gpio_class);
-        unregister_chrdev_region(devno, MAX_DEVICES);
+    err_idr:
+        mutex_lock(&trackers_lock);
+        idr_remove(&trackers, trk->id);
+        mutex_unlock(&trackers_lock);
+    err_free:
+        tracker_release(&trk->ref);
         return err;
     }
 
-    static int plat_drv_remove(struct platform_device *pdev) {
-        pr_info("Removing GPIO Driver\n");
+    static void plat_drv_remove_tracker(struct platform_device *pdev) {
+        struct tracker *trk = platform_get_drvdata(pdev);
 
-        // Destroy devices and free GPIOs
-        for (int i = 0; i < MAX_DEVICES; i++) {
-            device_destroy(gpio_class, MKDEV(MAJOR(devno), i));
-            cdev_del(&gpio_cdev[i]);
-        }
-        class_destroy(gpio_class);
-        unregister_chrdev_region(devno, MAX_DEVICES);
+        dev_info(&pdev->dev, "Removing tracker %d\n", trk->id);
 
-        gpio_free(SERVO_GPIO);
-        for (int i = 0; i < 4; i++) {
-            gpio_free(STEPPER_GPIO_BASE + i);
+        // No new opens; files already open keep the tracker alive but get
+        // -ENODEV from write()
+        mutex_lock(&trackers_lock);
+        idr_remove(&trackers, trk->id);
+        mutex_unlock(&trackers_lock);
+
+        for (int i = 0; i < NUM_AXES; i++) {
+            device_destroy(gpio_class, MKDEV(MAJOR(devno), trk->id * NUM_AXES + i));
         }
+        cdev_del(trk->cdev);
+        debugfs_remove_recursive(trk->debug_dir);
 
+        axes_shutdown(trk);
+        kref_put(&trk->ref, tracker_release);
+    }
+
+    #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 11, 0)
+    static void plat_drv_remove(struct platform_device *pdev) {
+        plat_drv_remove_tracker(pdev);
+    }
+    #else
+    static int plat_drv_remove(struct platform_device *pdev) {
+        plat_drv_remove_tracker(pdev);
         return 0;
     }
+    #endif
+
+    static const struct of_device_id plat_drv_of_match[] = {
+        { .compatible = "mygpio,plat_drv" },
+        { }
+    };
+    MODULE_DEVICE_TABLE(of, plat_drv_of_match);
 
     static struct platform_driver plat_drv_driver = {
         .probe = plat_drv_probe,
         .remove = plat_drv_remove,
         .driver = {
             .name = "plat_drv",
+            .of_match_table = plat_drv_of_match,
         },
     };
 
-    module_platform_driver(plat_drv_driver);
+    // The chrdev region, class and debugfs root are shared by all trackers
+    static int __init plat_drv_init(void) {
+        int err;
+
+        err = alloc_chrdev_region(&devno, 0, MAX_TRACKERS * NUM_AXES, "plat_drv");
+        if (err) {
+            pr_err("Failed to allocate chrdev region\n");
+            return err;
+        }
+
+        gpio_class = plat_drv_class_create("plat_drv_class");
+        if (IS_ERR(gpio_class)) {
+            unregister_chrdev_region(devno, MAX_TRACKERS * NUM_AXES);
+            return PTR_ERR(gpio_class);
+        }
+
+        debug_root = debugfs_create_dir("plat_drv", NULL);
+
+        err = platform_driver_register(&plat_drv_driver);
+        if (err) {
+            debugfs_remove_recursive(debug_root);
+            class_destroy(gpio_class);
+            unregister_chrdev_region(devno, MAX_TRACKERS * NUM_AXES);
+            return err;
+        }
+        return 0;
+    }
+
+    static void __exit plat_drv_exit(void) {
+        platform_driver_unregister(&plat_drv_driver);
+        debugfs_remove_recursive(debug_root);
+        class_destroy(gpio_class);
+        unregister_chrdev_region(devno, MAX_TRACKERS * NUM_AXES);
+        idr_destroy(&trackers);
+    }
+
+    module_init(plat_drv_init);
+    module_exit(plat_drv_exit);
     MODULE_LICENSE("GPL");
     MODULE_AUTHOR("Yahya :)");
     MODULE_DESCRIPTION("GPIO Driver for Servo and Stepper Motor Control");
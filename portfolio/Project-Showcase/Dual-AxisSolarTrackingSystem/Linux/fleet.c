@@ -0,0 +1,734 @@
+// fleet - drive a field of solar trackers from one process.
+//
+//   fleet [-r rate-hz] [-o] [-v] <config>
+//   fleet -B [-r rate-hz] [-T seconds] [-N max-trackers] [-c cpu]
+//
+// The config lists one tracker per line; blank lines and # comments are
+// ignored, "-" means no telemetry log:
+//
+//   # name  serial        motor             telemetry-dir
+//   east    /dev/ttyUSB0  plat_drv:0,async  /var/log/solartracker/east
+//   west    /dev/ttyUSB1  plat_drv:1,async  -
+//
+// All serial ports are read from one epoll loop. A tracker only keeps its
+// newest frame. A shared timer wheel gives every tracker a control tick at
+// the control rate (default 10 Hz, like the 100 ms delay of the single
+// tracker controller), and on that tick a fresh frame is turned into a
+// motion command unless the previous move is still running. Ticks of
+// different trackers are spread over the period so every wheel tick has
+// about the same amount of work. Motor backends must not block the loop,
+// hence plat_drv's ",async".
+//
+// A serial port that hangs up is reopened once a second. With -o the
+// process instead exits once every port has closed and the last frames
+// have been acted on, which is what replays and tests want.
+//
+// -B benchmarks the loop: simulated trackers are fed through pipes by a
+// generator thread at the control rate, the loop is pinned to one CPU and
+// the number of trackers doubles until the loop no longer keeps up.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/timerfd.h>
+
+#include "motor.h"
+#include "tlog.h"
+#include "twheel.h"
+
+#define TICK_NS 1000000ull  // Timer wheel granularity
+#define WHEEL_SLOTS 4096    // 4 s per revolution, longer than any control period
+#define REOPEN_NS 1000000000ull
+#define TIMER_TAG UINT32_MAX
+
+// How long a command keeps the tracker busy; mirrors the Servo-Stepper driver
+#define STEPPER_STEPS 50
+#define STEPPER_MOVE_NS (STEPPER_STEPS * 2000000ull)
+#define SERVO_MOVE_NS 20000000ull
+
+// Tick lateness histogram: 10 us buckets up to 10 ms, then one overflow bucket
+#define LATE_BUCKET_NS 10000
+#define LATE_BUCKETS 1001
+
+enum direction {
+    DIR_NONE,
+    DIR_LEFT,  // "Venstre"
+    DIR_RIGHT, // "Højre"
+    DIR_UP,    // "Op"
+    DIR_DOWN,  // "Ned"
+};
+
+// Per-tracker state touched on every frame and tick, kept small so a large
+// field stays cache-friendly
+struct tracker {
+    int fd;              // Serial source, -1 while closed
+    uint8_t moving;      // A move is in progress (see tracker_busy())
+    uint8_t fresh;       // A frame arrived since the last decision
+    uint8_t direction;   // enum direction of the newest frame
+    uint8_t line_len;    // Bytes in line[]; LINE_SKIP while dropping an over-long line
+    uint32_t trace;      // Trace id of the newest frame
+    uint64_t busy_until; // Estimated end of the move
+    char line[48];       // Partial line
+};
+
+#define LINE_SKIP 0xff
+
+// Everything else about a tracker
+struct tracker_conf {
+    char name[32];
+    char *serial;        // NULL: not reopened (benchmark pipes)
+    struct motor_backend *motor;
+    struct tlog log;
+    int logging;
+    int open_failed;     // Reported the last open error already
+    uint64_t next_open;
+    uint32_t frames, commands, overruns;
+};
+
+struct fleet {
+    uint32_t n;
+    struct tracker *trk;
+    struct tracker_conf *conf;
+    struct twheel wheel;
+    uint64_t period_ns;
+    int epfd, timerfd;
+    uint32_t open;       // Trackers with an open serial source
+    int once, verbose;
+
+    uint64_t ticks, missed, frames, commands, overruns;
+    uint32_t late_hist[LATE_BUCKETS];
+    uint64_t late_max;
+};
+
+static volatile sig_atomic_t stop;
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+// First word of a frame, as sent by the ESP32, plus its optional trace id
+static enum direction parse_frame(const char *line, size_t len, uint32_t *trace) {
+    size_t word = strcspn(line, " ,\t\r\n");
+    enum direction dir = DIR_NONE;
+
+    if (word == 7 && memcmp(line, "Venstre", 7) == 0) {
+        dir = DIR_LEFT;
+    } else if (word == 6 && memcmp(line, "Højre", 6) == 0) {
+        dir = DIR_RIGHT;
+    } else if (word == 2 && memcmp(line, "Op", 2) == 0) {
+        dir = DIR_UP;
+    } else if (word == 3 && memcmp(line, "Ned", 3) == 0) {
+        dir = DIR_DOWN;
+    }
+    *trace = word < len ? (uint32_t)strtoul(line + word, NULL, 10) : 0;
+    return dir;
+}
+
+static void tracker_line(struct fleet *f, uint32_t id, const char *line, size_t len) {
+    struct tracker *t = &f->trk[id];
+    struct tracker_conf *c = &f->conf[id];
+    char text[sizeof(t->line) + 1];
+
+    memcpy(text, line, len);
+    text[len] = '\0';
+    if (c->logging) {
+        tlog_append_frame(&c->log, text);
+    }
+    if (t->fresh) {
+        c->overruns++;
+        f->overruns++;
+    }
+    t->direction = parse_frame(text, len, &t->trace);
+    t->fresh = 1;
+    c->frames++;
+    f->frames++;
+}
+
+static void tracker_close(struct fleet *f, uint32_t id, uint64_t now) {
+    struct tracker *t = &f->trk[id];
+
+    close(t->fd); // Also drops it from the epoll set
+    t->fd = -1;
+    t->line_len = 0;
+    f->conf[id].next_open = now + REOPEN_NS;
+    f->open--;
+}
+
+static int tracker_attach(struct fleet *f, uint32_t id, int fd) {
+    struct epoll_event ev = { .events = EPOLLIN, .data.u32 = id };
+
+    if (epoll_ctl(f->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        perror("Error adding serial source to epoll");
+        close(fd);
+        return -1;
+    }
+    f->trk[id].fd = fd;
+    f->open++;
+    return 0;
+}
+
+static void tracker_open(struct fleet *f, uint32_t id) {
+    struct tracker_conf *c = &f->conf[id];
+    int fd = open(c->serial, O_RDONLY | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+
+    if (fd < 0) {
+        if (!c->open_failed) {
+            fprintf(stderr, "%s: cannot open %s: %s\n", c->name, c->serial, strerror(errno));
+        }
+        c->open_failed = 1;
+        c->next_open = monotonic_ns() + REOPEN_NS;
+        return;
+    }
+    if (c->open_failed) {
+        fprintf(stderr, "%s: %s reopened\n", c->name, c->serial);
+    }
+    c->open_failed = 0;
+    tracker_attach(f, id, fd);
+}
+
+// Drain a readable serial source, splitting it into lines
+static void tracker_input(struct fleet *f, uint32_t id) {
+    struct tracker *t = &f->trk[id];
+    char buf[1024];
+
+    for (;;) {
+        ssize_t n = read(t->fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && errno == EAGAIN) {
+            return;
+        }
+        if (n <= 0) {
+            if (n < 0 || !f->once) {
+                fprintf(stderr, "%s: serial source closed\n", f->conf[id].name);
+            }
+            tracker_close(f, id, monotonic_ns());
+            return;
+        }
+
+        for (ssize_t i = 0; i < n; i++) {
+            char c = buf[i];
+            if (c == '\n') {
+                if (t->line_len != LINE_SKIP) {
+                    tracker_line(f, id, t->line, t->line_len);
+                }
+                t->line_len = 0;
+            } else if (t->line_len == LINE_SKIP) {
+                continue;
+            } else if (t->line_len < sizeof(t->line)) {
+                t->line[t->line_len++] = c;
+            } else {
+                t->line_len = LINE_SKIP; // Not a frame; drop up to the newline
+            }
+        }
+    }
+}
+
+// Turn the newest frame into a motion command
+static void tracker_decide(struct fleet *f, uint32_t id, uint64_t now) {
+    static const char *const names[] = { "Unknown", "Left", "Right", "Up", "Down" };
+    struct tracker *t = &f->trk[id];
+    struct tracker_conf *c = &f->conf[id];
+    struct motor_backend *m = c->motor;
+    uint64_t busy = 0;
+
+    t->fresh = 0;
+    m->frame = c->frames - 1;
+    m->trace = t->trace;
+    m->issued_ns = 0;
+
+    switch (t->direction) {
+    case DIR_LEFT:
+    case DIR_RIGHT: {
+        int clockwise = t->direction == DIR_RIGHT;
+        if (c->logging) {
+            tlog_append_command(&c->log, TLOG_AXIS_STEPPER, clockwise, STEPPER_STEPS);
+        }
+        m->step(m, STEPPER_STEPS, clockwise);
+        busy = STEPPER_MOVE_NS;
+        break;
+    }
+    case DIR_UP:
+    case DIR_DOWN: {
+        int angle = t->direction == DIR_UP ? 90 : 0;
+        if (c->logging) {
+            tlog_append_command(&c->log, TLOG_AXIS_SERVO, 0, angle);
+        }
+        m->servo(m, angle);
+        busy = SERVO_MOVE_NS;
+        break;
+    }
+    default:
+        break;
+    }
+    if (f->verbose) {
+        printf("%s: Sun direction: %s\n", c->name, names[t->direction]);
+    }
+    if (busy) {
+        t->moving = 1;
+        t->busy_until = now + busy;
+        c->commands++;
+        f->commands++;
+    }
+}
+
+// Whether the last move is still running: read from the driver's status
+// page when the backend has one, estimated from the command otherwise
+static int tracker_busy(struct fleet *f, uint32_t id, uint64_t now) {
+    struct motor_backend *m = f->conf[id].motor;
+    int busy = m->busy ? m->busy(m) : -1;
+
+    return busy >= 0 ? busy : now < f->trk[id].busy_until;
+}
+
+// Control tick of one tracker, run from the timer wheel
+static void tracker_tick(void *ctx, uint32_t id, uint64_t due, uint64_t now) {
+    struct fleet *f = ctx;
+    struct tracker *t = &f->trk[id];
+    uint64_t late = now - due, next;
+
+    f->ticks++;
+    f->late_hist[late / LATE_BUCKET_NS < LATE_BUCKETS ? late / LATE_BUCKET_NS : LATE_BUCKETS - 1]++;
+    if (late > f->late_max) {
+        f->late_max = late;
+    }
+
+    if (t->fd < 0 && f->conf[id].serial && !f->once && now >= f->conf[id].next_open) {
+        tracker_open(f, id);
+    }
+    if (t->moving && !tracker_busy(f, id, now)) {
+        t->moving = 0;
+    }
+    if (!t->moving && t->fresh) {
+        tracker_decide(f, id, now);
+    }
+
+    // Stay on the tracker's own grid; ticks the loop was too late for are
+    // skipped, not bunched up
+    next = due + f->period_ns;
+    if (next <= now) {
+        uint64_t behind = (now - due) / f->period_ns;
+        f->missed += behind;
+        next = due + (behind + 1) * f->period_ns;
+    }
+    twheel_schedule(&f->wheel, id, next);
+}
+
+static int fleet_init(struct fleet *f, uint32_t n, uint64_t period_ns) {
+    struct epoll_event ev = { .events = EPOLLIN, .data.u32 = TIMER_TAG };
+    uint64_t now = monotonic_ns();
+    uint64_t first = (now / TICK_NS + 1) * TICK_NS;
+    // Wake on wheel tick boundaries, where timers become due
+    struct itimerspec its = {
+        .it_interval = { 0, TICK_NS },
+        .it_value = { first / 1000000000ull, first % 1000000000ull },
+    };
+
+    memset(f, 0, sizeof(*f));
+    f->n = n;
+    f->period_ns = period_ns;
+    f->trk = calloc(n, sizeof(*f->trk));
+    f->conf = calloc(n, sizeof(*f->conf));
+    if (!f->trk || !f->conf || twheel_init(&f->wheel, n, WHEEL_SLOTS, TICK_NS, now) < 0) {
+        perror("Error allocating trackers");
+        return -1;
+    }
+
+    f->epfd = epoll_create1(EPOLL_CLOEXEC);
+    f->timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (f->epfd < 0 || f->timerfd < 0 || timerfd_settime(f->timerfd, TFD_TIMER_ABSTIME, &its, NULL) < 0 ||
+        epoll_ctl(f->epfd, EPOLL_CTL_ADD, f->timerfd, &ev) < 0) {
+        perror("Error setting up event loop");
+        return -1;
+    }
+
+    // Spread the first ticks evenly over one period
+    for (uint32_t i = 0; i < n; i++) {
+        f->trk[i].fd = -1;
+        twheel_schedule(&f->wheel, i, now + f->period_ns * i / n + TICK_NS);
+    }
+    return 0;
+}
+
+static void fleet_free(struct fleet *f) {
+    for (uint32_t i = 0; i < f->n; i++) {
+        if (f->trk[i].fd >= 0) {
+            close(f->trk[i].fd);
+        }
+        if (f->conf[i].logging) {
+            tlog_close(&f->conf[i].log);
+        }
+        free(f->conf[i].serial);
+    }
+    close(f->timerfd);
+    close(f->epfd);
+    twheel_free(&f->wheel);
+    free(f->trk);
+    free(f->conf);
+}
+
+// Nothing left to do for -o: every source closed and every frame acted on
+static int fleet_drained(const struct fleet *f) {
+    if (f->open) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < f->n; i++) {
+        if (f->trk[i].fresh) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Run the loop until a signal, `until_ns` (0: no limit) or, with -o, drained
+static void fleet_run(struct fleet *f, uint64_t until_ns) {
+    struct epoll_event events[64];
+
+    while (!stop) {
+        int n = epoll_wait(f->epfd, events, 64, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Error waiting for events");
+            return;
+        }
+
+        for (int i = 0; i < n; i++) {
+            uint32_t id = events[i].data.u32;
+            if (id == TIMER_TAG) {
+                uint64_t expirations;
+                if (read(f->timerfd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+                    perror("Error reading timer");
+                }
+                twheel_advance(&f->wheel, monotonic_ns(), tracker_tick, f);
+            } else if (f->trk[id].fd >= 0) {
+                tracker_input(f, id);
+            }
+        }
+
+        if (until_ns && monotonic_ns() >= until_ns) {
+            return;
+        }
+        if (f->once && fleet_drained(f)) {
+            return;
+        }
+    }
+}
+
+static double late_percentile_us(const struct fleet *f, double p) {
+    uint64_t target = (uint64_t)(p * f->ticks), seen = 0;
+
+    for (int b = 0; b < LATE_BUCKETS; b++) {
+        seen += f->late_hist[b];
+        if (seen > target) {
+            return (b + 1) * LATE_BUCKET_NS / 1000.0;
+        }
+    }
+    return f->late_max / 1000.0;
+}
+
+static int load_config(struct fleet *f, const char *path, uint64_t period_ns) {
+    FILE *in = fopen(path, "r");
+    char line[1024];
+    uint32_t n = 0, id = 0;
+
+    if (!in) {
+        perror("Error opening fleet config");
+        return -1;
+    }
+    while (fgets(line, sizeof(line), in)) {
+        char word[2];
+        if (sscanf(line, " %1s", word) == 1 && word[0] != '#') {
+            n++;
+        }
+    }
+    if (!n) {
+        fprintf(stderr, "Error: no trackers in %s\n", path);
+        fclose(in);
+        return -1;
+    }
+    if (fleet_init(f, n, period_ns) < 0) {
+        fclose(in);
+        return -1;
+    }
+
+    rewind(in);
+    for (int lineNo = 1; fgets(line, sizeof(line), in); lineNo++) {
+        char name[32], serial[256], motorSpec[128], logDir[256] = "-";
+        struct tracker_conf *c = &f->conf[id];
+        int fields = sscanf(line, " %31s %255s %127s %255s", name, serial, motorSpec, logDir);
+
+        if (fields < 1 || name[0] == '#') {
+            continue;
+        }
+        if (fields < 3) {
+            fprintf(stderr, "%s:%d: expected <name> <serial> <motor> [telemetry-dir]\n", path, lineNo);
+            fclose(in);
+            return -1;
+        }
+
+        snprintf(c->name, sizeof(c->name), "%s", name);
+        c->serial = strdup(serial);
+        c->motor = motor_open(motorSpec);
+        if (!c->serial || !c->motor) {
+            fclose(in);
+            return -1;
+        }
+        if (strcmp(logDir, "-") != 0) {
+            c->logging = tlog_open(&c->log, logDir, 0, 0) == 0;
+            if (!c->logging) {
+                fprintf(stderr, "Warning: %s: telemetry log disabled\n", name);
+            }
+        }
+        tracker_open(f, id);
+        id++;
+    }
+    fclose(in);
+    return 0;
+}
+
+static void print_summary(const struct fleet *f) {
+    fprintf(stderr, "%-16s %10s %10s %10s\n", "tracker", "frames", "commands", "overruns");
+    for (uint32_t i = 0; i < f->n; i++) {
+        const struct tracker_conf *c = &f->conf[i];
+        fprintf(stderr, "%-16s %10u %10u %10u\n", c->name, c->frames, c->commands, c->overruns);
+    }
+    fprintf(stderr, "ticks %llu missed %llu, tick lateness p50 %.0f us p99 %.0f us max %.0f us\n",
+            (unsigned long long)f->ticks, (unsigned long long)f->missed, late_percentile_us(f, 0.5),
+            late_percentile_us(f, 0.99), f->late_max / 1000.0);
+}
+
+// Benchmark
+
+struct generator {
+    int *fds;
+    uint32_t n;
+    uint64_t period_ns, until_ns;
+    int cpu;
+};
+
+static void pin_to_cpu(int cpu) {
+    cpu_set_t set;
+
+    if (cpu < 0) {
+        return;
+    }
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+        perror("Warning: cannot pin to CPU");
+    }
+}
+
+// Play N ESP32s: one frame per tracker per period, directions rotating
+static void *generate(void *arg) {
+    static const char *const dirs[] = { "Venstre", "Højre", "Op", "Ned" };
+    struct generator *g = arg;
+    struct timespec next;
+    uint32_t round = 0;
+    char frame[64];
+
+    pin_to_cpu(g->cpu);
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for (;;) {
+        uint64_t now = monotonic_ns();
+        if (now >= g->until_ns) {
+            break;
+        }
+        for (uint32_t i = 0; i < g->n; i++) {
+            int len = snprintf(frame, sizeof(frame), "%s %u %llu %llu\n", dirs[(i + round) % 4],
+                               round * g->n + i + 1, (unsigned long long)now / 1000,
+                               (unsigned long long)now / 1000);
+            if (write(g->fds[i], frame, len) < 0 && errno != EAGAIN) {
+                perror("Error feeding tracker");
+                return NULL;
+            }
+        }
+        round++;
+        next.tv_nsec += g->period_ns;
+        while (next.tv_nsec >= 1000000000) {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+    return NULL;
+}
+
+static uint64_t thread_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int bench(double rate, double secs, uint32_t maxTrackers, int cpu) {
+    uint64_t period = (uint64_t)(1e9 / rate), best = 0;
+    struct rlimit rl;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+
+    // Two descriptors per simulated tracker
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+        if (rl.rlim_cur != RLIM_INFINITY && maxTrackers > (rl.rlim_cur - 16) / 2) {
+            maxTrackers = (rl.rlim_cur - 16) / 2;
+        }
+    }
+    // Every simulated tracker shares one recording stub writing to /dev/null
+    struct motor_backend *sink = motor_open("trace:/dev/null");
+    if (!sink) {
+        return 1;
+    }
+
+    printf("control rate %.1f Hz, %.1f s per run, loop on CPU %d\n", rate, secs, cpu);
+    printf("%8s %10s %10s %10s %8s %8s %8s %8s %8s\n", "trackers", "ticks/s", "frames/s", "cmds/s", "cpu %",
+           "p50 us", "p99 us", "max us", "missed");
+
+    for (uint32_t n = 1; n <= maxTrackers && !stop; n *= 2) {
+        struct fleet f;
+        struct generator g = { .n = n, .period_ns = period, .cpu = ncpu > 1 ? (cpu + 1) % ncpu : -1 };
+        pthread_t thread;
+
+        if (fleet_init(&f, n, period) < 0) {
+            return 1;
+        }
+        f.once = 1;
+        g.fds = calloc(n, sizeof(*g.fds));
+        for (uint32_t i = 0; i < n; i++) {
+            int p[2];
+            if (pipe2(p, O_CLOEXEC) < 0) {
+                perror("Error creating pipe");
+                return 1;
+            }
+            fcntl(p[0], F_SETFL, O_NONBLOCK);
+            snprintf(f.conf[i].name, sizeof(f.conf[i].name), "sim%u", i);
+            f.conf[i].motor = sink;
+            tracker_attach(&f, i, p[0]);
+            g.fds[i] = p[1];
+        }
+
+        pin_to_cpu(cpu);
+        uint64_t start = monotonic_ns(), cpuStart = thread_cpu_ns();
+        g.until_ns = start + (uint64_t)(secs * 1e9);
+        pthread_create(&thread, NULL, generate, &g);
+        fleet_run(&f, g.until_ns);
+        uint64_t wall = monotonic_ns() - start, used = thread_cpu_ns() - cpuStart;
+        pthread_join(thread, NULL);
+
+        double s = wall / 1e9;
+        double p99 = late_percentile_us(&f, 0.99);
+        int keepsUp = !f.missed && p99 * 1000 < period / 10;
+        printf("%8u %10.0f %10.0f %10.0f %8.1f %8.0f %8.0f %8.0f %8llu%s\n", n, f.ticks / s, f.frames / s,
+               f.commands / s, 100.0 * used / wall, late_percentile_us(&f, 0.5), p99, f.late_max / 1000.0,
+               (unsigned long long)f.missed, keepsUp ? "" : "  <- falling behind");
+        fflush(stdout);
+        if (f.frames < 0.9 * n * rate * s) {
+            printf("         (generator delivered only %.0f%% of the frames)\n", 100.0 * f.frames / (n * rate * s));
+        }
+
+        for (uint32_t i = 0; i < n; i++) {
+            close(g.fds[i]);
+        }
+        free(g.fds);
+        fleet_free(&f);
+        if (!keepsUp) {
+            break;
+        }
+        best = n;
+    }
+
+    motor_close(sink);
+    printf("one core keeps up with %llu trackers at %.1f Hz\n", (unsigned long long)best, rate);
+    return 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-r rate-hz] [-o] [-v] <config>\n", prog);
+    fprintf(stderr, "       %s -B [-r rate-hz] [-T seconds] [-N max-trackers] [-c cpu]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    double rate = 10.0, secs = 3.0;
+    uint32_t maxTrackers = 65536;
+    int benchmark = 0, once = 0, verbose = 0, cpu = 0, opt;
+    struct sigaction sa = { .sa_handler = on_signal };
+
+    while ((opt = getopt(argc, argv, "r:ovBT:N:c:")) != -1) {
+        switch (opt) {
+        case 'r':
+            rate = atof(optarg);
+            break;
+        case 'o':
+            once = 1;
+            break;
+        case 'v':
+            verbose = 1;
+            break;
+        case 'B':
+            benchmark = 1;
+            break;
+        case 'T':
+            secs = atof(optarg);
+            break;
+        case 'N':
+            maxTrackers = strtoul(optarg, NULL, 10);
+            break;
+        case 'c':
+            cpu = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (rate <= 0 || (!benchmark && optind >= argc)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    // No SA_RESTART, so a signal also ends epoll_wait()
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    if (benchmark) {
+        return bench(rate, secs, maxTrackers, cpu);
+    }
+
+    struct fleet f;
+    if (load_config(&f, argv[optind], (uint64_t)(1e9 / rate)) < 0) {
+        return 1;
+    }
+    f.once = once;
+    f.verbose = verbose;
+    if (verbose) {
+        setvbuf(stdout, NULL, _IOLBF, 0);
+    }
+
+    fleet_run(&f, 0);
+    print_summary(&f);
+
+    for (uint32_t i = 0; i < f.n; i++) {
+        motor_close(f.conf[i].motor);
+    }
+    fleet_free(&f);
+    return 0;
+}
@@ -0,0 +1,225 @@
+// gpiobench - step rate of the userspace GPIO path versus the kernel module.
+//
+//   gpiobench [-c chip] [-l servo,pin1,pin2,pin3,pin4] [-n steps] [-d plat_drv-stepper-node]
+//
+// Runs on real pins or on a gpio-sim chip (see test/gpiosim/run.sh):
+//
+//   gpiod raw          back-to-back phase changes, one GPIO_V2_LINE_SET_VALUES
+//                      ioctl each: the fastest the userspace path can step
+//   gpiod paced        phase changes on a 2 ms absolute-deadline grid like the
+//                      gpiod motor backend; interval spread shows the jitter
+//   plat_drv paced     (with -d) one "forward <n>" command to the kernel
+//                      module. The driver steps on its fixed 2 ms grid, so
+//                      this is the paced rate, to compare with "gpiod paced"
+//                      over the same number of steps, not with "gpiod raw"
+//   plat_drv command   round trip of empty commands
+//
+// The first phases written on the raw path are read back, so a wrong pin
+// order or a chip that ignores the request makes the run fail.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "gpioline.h"
+
+#define STEP_PERIOD_NS 2000000ull
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Print one result row from per-step times in nanoseconds (sorted in place)
+static void report(const char *name, uint64_t *v, size_t n, uint64_t elapsed) {
+    if (!n) {
+        return;
+    }
+    qsort(v, n, sizeof(*v), cmp_u64);
+    printf("%-16s %8zu %12.0f %10.1f %10.1f %10.1f %10.1f\n", name, n, n * 1e9 / elapsed, v[0] / 1000.0,
+           v[n / 2] / 1000.0, v[(size_t)(n * 0.99)] / 1000.0, v[n - 1] / 1000.0);
+}
+
+static int bench_raw(int fd, uint64_t *v, size_t steps) {
+    uint64_t start = monotonic_ns(), last = start;
+
+    for (size_t i = 0; i < steps; i++) {
+        uint64_t phase = gpioline_stepper_phase(i, 1), now;
+        if (gpioline_set(fd, phase, 0xf) < 0) {
+            perror("Error setting stepper lines");
+            return -1;
+        }
+        if (i < 8) {
+            uint64_t bits;
+            if (gpioline_get(fd, &bits, 0xf) < 0 || bits != phase) {
+                fprintf(stderr, "Error: step %zu wrote %#llx, read back %#llx\n", i, (unsigned long long)phase,
+                        (unsigned long long)bits);
+                return -1;
+            }
+        }
+        now = monotonic_ns();
+        v[i] = now - last;
+        last = now;
+    }
+    report("gpiod raw", v, steps, last - start);
+    return 0;
+}
+
+static int bench_paced(int fd, uint64_t *v, size_t steps) {
+    uint64_t start = monotonic_ns(), last = start;
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    for (size_t i = 0; i < steps; i++) {
+        uint64_t now;
+        if (gpioline_set(fd, gpioline_stepper_phase(i, 1), 0xf) < 0) {
+            perror("Error setting stepper lines");
+            return -1;
+        }
+        now = monotonic_ns();
+        v[i] = now - last;
+        last = now;
+
+        t.tv_nsec += STEP_PERIOD_NS;
+        while (t.tv_nsec >= 1000000000) {
+            t.tv_nsec -= 1000000000;
+            t.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL);
+    }
+    // The first interval only measures the first ioctl; drop it
+    report("gpiod paced", v + 1, steps - 1, last - start);
+    return 0;
+}
+
+// Both gpiod rows on lines 1-4 of `pins`; 1 if a row failed, -1 if the
+// lines could not be had
+static int bench_gpiod(const char *chip, const unsigned int *pins, uint64_t *v, size_t steps) {
+    int chipFd = gpioline_open_chip(chip), fd, err = 0;
+
+    if (chipFd < 0) {
+        perror("Error opening GPIO chip");
+        return -1;
+    }
+    fd = gpioline_request(chipFd, &pins[1], 4, "gpiobench");
+    close(chipFd);
+    if (fd < 0) {
+        perror("Error requesting stepper lines");
+        return -1;
+    }
+    err |= bench_raw(fd, v, steps);
+    err |= bench_paced(fd, v, steps < 2000 ? steps : 2000);
+    gpioline_set(fd, 0, 0xf);
+    close(fd);
+    return err ? 1 : 0;
+}
+
+static int bench_module(const char *node, uint64_t *v, size_t steps) {
+    char cmd[32];
+    int fd = open(node, O_WRONLY | O_CLOEXEC);
+    uint64_t start, elapsed;
+    size_t rounds = steps < 200 ? steps : 200;
+
+    if (fd < 0) {
+        perror("Error opening plat_drv node");
+        return -1;
+    }
+
+    // The driver blocks the writer until the move is done; it runs at the
+    // driver's step period, however fast the GPIO path is
+    int len = snprintf(cmd, sizeof(cmd), "forward %zu", steps);
+    start = monotonic_ns();
+    if (write(fd, cmd, len) < 0) {
+        perror("Error writing to plat_drv node");
+        close(fd);
+        return -1;
+    }
+    elapsed = monotonic_ns() - start;
+    v[0] = elapsed / steps; // Reported as one average step
+    report("plat_drv paced", v, 1, elapsed / steps);
+
+    // Empty moves: syscall, queue and one hrtimer expiry
+    start = monotonic_ns();
+    for (size_t i = 0; i < rounds; i++) {
+        uint64_t t0 = monotonic_ns();
+        if (write(fd, "forward 0", 9) < 0) {
+            perror("Error writing to plat_drv node");
+            break;
+        }
+        v[i] = monotonic_ns() - t0;
+    }
+    report("plat_drv command", v, rounds, monotonic_ns() - start);
+    close(fd);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *chip = "gpiochip0", *module = NULL;
+    unsigned int pins[5] = { 18, 22, 23, 24, 25 };
+    size_t steps = 5000;
+    int opt, err = 0;
+
+    while ((opt = getopt(argc, argv, "c:l:n:d:")) != -1) {
+        switch (opt) {
+        case 'c':
+            chip = optarg;
+            break;
+        case 'l':
+            if (sscanf(optarg, "%u,%u,%u,%u,%u", &pins[0], &pins[1], &pins[2], &pins[3], &pins[4]) != 5) {
+                goto usage;
+            }
+            break;
+        case 'n':
+            steps = strtoul(optarg, NULL, 10);
+            break;
+        case 'd':
+            module = optarg;
+            break;
+        default:
+            goto usage;
+        }
+    }
+    if (steps < 2) {
+        goto usage;
+    }
+
+    uint64_t *v = calloc(steps, sizeof(*v));
+    if (!v) {
+        perror("Error allocating memory");
+        return 1;
+    }
+
+    printf("%-16s %8s %12s %10s %10s %10s %10s\n", "path", "steps", "steps/s", "min us", "p50 us", "p99 us",
+           "max us");
+    if (!GPIOLINE_V2) {
+        fprintf(stderr, "Skipping the gpiod rows, built without the GPIO v2 uAPI (5.10+ kernel headers)\n");
+    } else {
+        int rows = bench_gpiod(chip, pins, v, steps);
+        if (rows < 0) {
+            free(v);
+            return 1;
+        }
+        err |= rows;
+    }
+    if (module) {
+        err |= bench_module(module, v, steps < 2000 ? steps : 2000);
+    }
+
+    free(v);
+    return err ? 1 : 0;
+
+usage:
+    fprintf(stderr, "Usage: %s [-c chip] [-l servo,pin1,pin2,pin3,pin4] [-n steps] [-d plat_drv-stepper-node]\n",
+            argv[0]);
+    return 2;
+}
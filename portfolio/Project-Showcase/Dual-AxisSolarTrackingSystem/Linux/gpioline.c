@@ -0,0 +1,85 @@
+#include "gpioline.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+int gpioline_open_chip(const char *chip) {
+    char path[64];
+
+    if (strchr(chip, '/')) {
+        snprintf(path, sizeof(path), "%s", chip);
+    } else {
+        snprintf(path, sizeof(path), "/dev/%s", chip);
+    }
+    return open(path, O_RDWR | O_CLOEXEC);
+}
+
+#if GPIOLINE_V2
+int gpioline_request(int chip, const unsigned int *offsets, unsigned int n, const char *consumer) {
+    struct gpio_v2_line_request req;
+
+    memset(&req, 0, sizeof(req));
+    for (unsigned int i = 0; i < n; i++) {
+        req.offsets[i] = offsets[i];
+    }
+    req.num_lines = n;
+    snprintf(req.consumer, sizeof(req.consumer), "%s", consumer);
+    req.config.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+    req.config.num_attrs = 1;
+    req.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+    req.config.attrs[0].attr.values = 0;
+    req.config.attrs[0].mask = n < 64 ? (1ull << n) - 1 : ~0ull;
+
+    if (ioctl(chip, GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
+        return -1;
+    }
+    return req.fd;
+}
+
+int gpioline_set(int fd, uint64_t bits, uint64_t mask) {
+    struct gpio_v2_line_values values = { .bits = bits, .mask = mask };
+    return ioctl(fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &values);
+}
+
+int gpioline_get(int fd, uint64_t *bits, uint64_t mask) {
+    struct gpio_v2_line_values values = { .mask = mask };
+
+    if (ioctl(fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &values) < 0) {
+        return -1;
+    }
+    *bits = values.bits;
+    return 0;
+}
+
+#else
+
+int gpioline_request(int chip, const unsigned int *offsets, unsigned int n, const char *consumer) {
+    (void)chip;
+    (void)offsets;
+    (void)n;
+    (void)consumer;
+    errno = ENOSYS;
+    return -1;
+}
+
+int gpioline_set(int fd, uint64_t bits, uint64_t mask) {
+    (void)fd;
+    (void)bits;
+    (void)mask;
+    errno = ENOSYS;
+    return -1;
+}
+
+int gpioline_get(int fd, uint64_t *bits, uint64_t mask) {
+    (void)fd;
+    (void)bits;
+    (void)mask;
+    errno = ENOSYS;
+    return -1;
+}
+
+#endif
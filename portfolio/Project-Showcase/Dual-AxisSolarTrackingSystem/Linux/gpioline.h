@@ -0,0 +1,37 @@
+#ifndef GPIOLINE_H
+#define GPIOLINE_H
+
+#include <stdint.h>
+#include <linux/gpio.h>
+
+// Thin wrappers around the GPIO character device uAPI v2 (/dev/gpiochipN),
+// shared by the gpiod motor backend and gpiobench. No libgpiod needed.
+//
+// The v2 uAPI came with 5.10. Built against older kernel headers, such as
+// the Pi's rpi-5.4.83, GPIOLINE_V2 is 0 and every call but
+// gpioline_open_chip() fails with ENOSYS.
+#ifdef GPIO_V2_GET_LINE_IOCTL
+#define GPIOLINE_V2 1
+#else
+#define GPIOLINE_V2 0
+#endif
+
+// Request `n` lines of an open chip as outputs, initially low. Returns the
+// line request fd, or -1 with errno set.
+int gpioline_request(int chip, const unsigned int *offsets, unsigned int n, const char *consumer);
+
+// Set/read the lines selected by `mask`; bit i is the i-th requested line
+int gpioline_set(int fd, uint64_t bits, uint64_t mask);
+int gpioline_get(int fd, uint64_t *bits, uint64_t mask);
+
+// Open "/dev/gpiochipN" given "gpiochipN" or a path
+int gpioline_open_chip(const char *chip);
+
+// Coil levels of the stepper for step `i`, bit j = stepper pin j+1; the
+// same full-step sequence as the Servo-Stepper driver
+static inline uint64_t gpioline_stepper_phase(int i, int clockwise) {
+    static const uint8_t phases[4] = { 0x9, 0x3, 0x6, 0xc };
+    return phases[clockwise ? i % 4 : 3 - i % 4];
+}
+
+#endif
@@ -0,0 +1,337 @@
+// logdecode - turn the ESP32's binary log stream back into text.
+//
+//   logdecode [-b baud] [-r] [device|file]
+//
+// Reads the debug serial port (a tty is switched to raw mode at -b baud),
+// a capture file, or stdin, and prints one line per log record:
+//
+//   <seconds>.<ms> <level> <message>
+//
+// -r prints the message alone. The firmware side is Esp32/lib/BinLog; see
+// BinLog.h for the frame layout. Records refer to their call site by id and
+// the definition (level, argument types, format string) is sent before a
+// site's first record and once a minute after that, so a decoder started
+// late prints "#<id>" placeholders for at most a minute. Bytes that are not
+// part of a valid frame (ROM boot messages, plain Serial.print output) are
+// passed through unchanged.
+//
+// The output keeps the "trace <id> cap <us> tx <us>" lines tracelat -e
+// expects:  logdecode /dev/ttyUSB0 | tee esp32.log
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define MAGIC_RECORD 0xA5
+#define MAGIC_DEFINE 0xA6
+#define MAX_SITES 65536
+#define MAX_STRING 255
+
+struct site {
+    char level;
+    char *types;
+    char *fmt;
+};
+
+static struct site *sites[MAX_SITES];
+static int raw_output = 0;
+static int mid_line = 0;          // Passed-through text without its newline yet
+static uint64_t epoch_us = 0;     // Unwrapped high part of the ESP32 micros()
+static uint32_t last_us = 0;
+
+static uint8_t crc8(const uint8_t *data, size_t len) {
+    uint8_t crc = 0;
+    while (len--) {
+        crc ^= *data++;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+static speed_t baud_to_speed(int baud) {
+    switch (baud) {
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    default: return B115200;
+    }
+}
+
+// Same expansion as logFormat() in BinLog.cpp: every conversion is handed
+// to snprintf on its own, widened to match how the argument was stored.
+static void format_record(char *out, size_t cap, const char *fmt, const char *types, const uint8_t *args,
+                          size_t len) {
+    const uint8_t *end = args + len;
+    size_t n = 0;
+
+    while (*fmt && n + 1 < cap) {
+        if (*fmt != '%') {
+            out[n++] = *fmt++;
+            continue;
+        }
+        if (fmt[1] == '%') {
+            out[n++] = '%';
+            fmt += 2;
+            continue;
+        }
+
+        char spec[24];
+        size_t k = 0;
+        spec[k++] = *fmt++;
+        while (*fmt && strchr("-+ #0123456789.", *fmt) && k < sizeof(spec) - 4) {
+            spec[k++] = *fmt++;
+        }
+        while (*fmt && strchr("hlLqjzt", *fmt)) {
+            fmt++;
+        }
+        char conv = *fmt ? *fmt++ : 's';
+
+        char type = *types ? *types++ : 0;
+        long long i = 0;
+        double f = 0;
+        char s[MAX_STRING + 1] = "";
+        if (type == 's' && args < end) {
+            size_t sl = *args++;
+            if (sl > (size_t)(end - args)) {
+                sl = end - args;
+            }
+            memcpy(s, args, sl);
+            s[sl] = '\0';
+            args += sl;
+        } else if (type && end - args >= 4) {
+            if (type == 'f') {
+                float v;
+                memcpy(&v, args, 4);
+                i = (long long)v;
+                f = v;
+            } else if (type == 'u') {
+                uint32_t v;
+                memcpy(&v, args, 4);
+                i = v;
+                f = v;
+            } else {
+                int32_t v;
+                memcpy(&v, args, 4);
+                i = v;
+                f = v;
+            }
+            args += 4;
+        }
+
+        int w;
+        if (strchr("diouxX", conv)) {
+            spec[k++] = 'l';
+            spec[k++] = 'l';
+            spec[k++] = conv;
+            spec[k] = '\0';
+            w = snprintf(out + n, cap - n, spec, i);
+        } else if (conv == 'c') {
+            spec[k++] = 'c';
+            spec[k] = '\0';
+            w = snprintf(out + n, cap - n, spec, (int)i);
+        } else if (strchr("fFeEgGaA", conv)) {
+            spec[k++] = conv;
+            spec[k] = '\0';
+            w = snprintf(out + n, cap - n, spec, f);
+        } else {
+            spec[k++] = 's';
+            spec[k] = '\0';
+            w = snprintf(out + n, cap - n, spec, s);
+        }
+        if (w > 0) {
+            n += (size_t)w < cap - n ? (size_t)w : cap - n - 1;
+        }
+    }
+    out[n] = '\0';
+}
+
+static void define_site(const uint8_t *p, size_t len) {
+    if (len < 4 || (size_t)p[3] + 4 > len) {
+        return;
+    }
+    uint16_t id = p[0] | p[1] << 8;
+    size_t ntypes = p[3];
+    struct site *s = sites[id];
+    if (!s) {
+        s = calloc(1, sizeof(*s));
+        if (!s) {
+            perror("Error allocating memory");
+            exit(1);
+        }
+        sites[id] = s;
+    }
+    free(s->types);
+    free(s->fmt);
+    s->level = p[2] <= 4 ? "-EWID"[p[2]] : '?';
+    s->types = strndup((const char *)p + 4, ntypes);
+    s->fmt = strndup((const char *)p + 4 + ntypes, len - 4 - ntypes);
+    if (!s->types || !s->fmt) {
+        perror("Error allocating memory");
+        exit(1);
+    }
+}
+
+static void print_record(const uint8_t *p, size_t len) {
+    if (len < 6) {
+        return;
+    }
+    uint16_t id = p[0] | p[1] << 8;
+    uint32_t us;
+    memcpy(&us, p + 2, 4);
+    const uint8_t *args = p + 6;
+    size_t nargs = len - 6;
+
+    // micros() wraps every 71 minutes. A reboot is a jump back as well, and
+    // two tasks logging at once can land a few microseconds out of order.
+    if (us < last_us && last_us - us > 0x80000000u) {
+        epoch_us += 1ull << 32;
+        last_us = us;
+    } else if (us < last_us && last_us - us > 1000000) {
+        epoch_us = 0;
+        last_us = us;
+    } else if (us > last_us) {
+        last_us = us;
+    }
+    uint64_t t = epoch_us + us;
+
+    char msg[512];
+    char level = 'W';
+    struct site *s = id ? sites[id] : NULL;
+    if (!id) {
+        uint32_t lost = 0;
+        memcpy(&lost, args, nargs < 4 ? nargs : 4);
+        snprintf(msg, sizeof(msg), "log: %lu records dropped", (unsigned long)lost);
+    } else if (s) {
+        level = s->level;
+        format_record(msg, sizeof(msg), s->fmt, s->types, args, nargs);
+    } else {
+        level = '?';
+        snprintf(msg, sizeof(msg), "#%u (definition not seen yet)", id);
+    }
+
+    if (mid_line) {
+        putchar('\n');
+        mid_line = 0;
+    }
+    if (raw_output) {
+        printf("%s\n", msg);
+    } else {
+        printf("%llu.%03llu %c %s\n", (unsigned long long)(t / 1000000), (unsigned long long)(t / 1000 % 1000),
+               level, msg);
+    }
+}
+
+static void pass_through(uint8_t c) {
+    putchar(c);
+    mid_line = c != '\n';
+}
+
+// Decodes what it can from buf and returns the number of bytes consumed. A
+// frame that is not complete yet is left for the next call unless at_eof.
+static size_t decode(const uint8_t *buf, size_t n, int at_eof) {
+    size_t i = 0;
+
+    while (i < n) {
+        uint8_t c = buf[i];
+        if (c != MAGIC_RECORD && c != MAGIC_DEFINE) {
+            pass_through(c);
+            i++;
+            continue;
+        }
+        if (n - i < 2 || n - i < (size_t)buf[i + 1] + 3) {
+            if (!at_eof) {
+                break;
+            }
+            pass_through(c);
+            i++;
+            continue;
+        }
+        size_t len = buf[i + 1];
+        if (crc8(buf + i + 1, len + 1) != buf[i + 2 + len]) {
+            pass_through(c); // 0xA5 is also a UTF-8 continuation byte
+            i++;
+            continue;
+        }
+        if (c == MAGIC_DEFINE) {
+            define_site(buf + i + 2, len);
+        } else {
+            print_record(buf + i + 2, len);
+        }
+        i += len + 3;
+    }
+    fflush(stdout);
+    return i;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [-b baud] [-r] [device|file]\n", name);
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    int baud = 115200, opt;
+
+    while ((opt = getopt(argc, argv, "b:r")) != -1) {
+        switch (opt) {
+        case 'b':
+            baud = atoi(optarg);
+            break;
+        case 'r':
+            raw_output = 1;
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (argc - optind > 1) {
+        usage(argv[0]);
+    }
+
+    int fd = STDIN_FILENO;
+    if (optind < argc) {
+        fd = open(argv[optind], O_RDONLY | O_NOCTTY);
+        if (fd < 0) {
+            perror("Error opening input");
+            return 1;
+        }
+    }
+    if (isatty(fd)) {
+        struct termios tio;
+        if (tcgetattr(fd, &tio) == 0) {
+            cfmakeraw(&tio);
+            cfsetspeed(&tio, baud_to_speed(baud));
+            if (tcsetattr(fd, TCSANOW, &tio) < 0) {
+                perror("Error configuring serial port");
+            }
+        }
+    }
+
+    // Room for a partial frame (at most 258 bytes) in front of each read
+    uint8_t buf[4096];
+    size_t have = 0;
+    for (;;) {
+        ssize_t r = read(fd, buf + have, sizeof(buf) - have);
+        if (r < 0) {
+            perror("Error reading input");
+            return 1;
+        }
+        if (r == 0) {
+            decode(buf, have, 1);
+            break;
+        }
+        have += r;
+        size_t used = decode(buf, have, 0);
+        memmove(buf, buf + used, have - used);
+        have -= used;
+    }
+    return 0;
+}
@@ -2,127 +2,432 @@
 #include <stdlib.h>
 #include <string.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
 #include <unistd.h>
 
-// Device files for servo and stepper motor pins
-#define SERVO_DEV "/dev/plat_drv0"
-#define STEPPER_DEV1 "/dev/plat_drv1"
-#define STEPPER_DEV2 "/dev/plat_drv2"
-#define STEPPER_DEV3 "/dev/plat_drv3"
-#define STEPPER_DEV4 "/dev/plat_drv4"
-
-// Stepper motor sequence
-const int stepSequence[4][4] = {
-    {1, 0, 0, 1},
-    {1, 1, 0, 0},
-    {0, 1, 1, 0},
-    {0, 0, 1, 1}
+#include "motor.h"
+#include "rt.h"
+#include "spsc.h"
+#include "tlog.h"
+
+// Serial port the ESP32 is connected to
+#define SERIAL_DEV "/dev/ttyS0"
+
+// Default directory for the binary telemetry log (see tlog.h)
+#define TLOG_DIR "/var/log/solartracker"
+
+// Parsed frames waiting for the actuation thread; more than enough, since
+// it normally only wants the newest
+#define FRAME_SLOTS 64
+
+// Telemetry log of received frames and issued motion commands. Frames are
+// logged by the ingest thread and commands by the actuation thread; the
+// lock inherits priority so a real-time actuation thread is not held up.
+static struct tlog telemetry;
+static int telemetry_enabled = 0;
+static pthread_mutex_t telemetryLock;
+
+// Backend that actually moves the motors (see motor.h)
+static struct motor_backend *motor;
+
+// Servo setpoint and limits from the ESP32's /setpoint page, in degrees.
+// The servo is moved to the setpoint when one arrives; "Op" and "Ned" then
+// move it to the upper and lower limit. The defaults keep the old 90/0.
+struct setpoint {
+    uint32_t id;
+    int angle;
+    int minLimit;
+    int maxLimit;
+};
+
+// Frame received from the ESP32:
+//   <direction> [<trace id> <capture us> <tx us>]
+// or a setpoint, acknowledged once the servo command is issued:
+//   SET <id> <setpoint> <min> <max>   ->   ACK <id> <setpoint> <min> <max> <us>
+// A setpoint outside its own limits is refused with the config kept instead:
+//                                     ->   NAK <id> <setpoint> <min> <max>
+struct sensor_frame {
+    char direction[32];
+    uint32_t traceId;
+    uint32_t captureUs; // ESP32 micros() when the light sensors were read
+    uint32_t txUs;      // ESP32 micros() when the frame was sent
+    int traced;
+    uint32_t seq;       // Frame number on the serial line
+    uint64_t rxNs;      // CLOCK_MONOTONIC when the line was read
+    int isSetpoint;
+    struct setpoint setpoint;
 };
 
+// Frame the actuation thread is acting on
+static struct sensor_frame frame = { .direction = "Unknown" };
+
+// Serial ingest hands frames to actuation through a lock-free ring, so a
+// long move never stops the serial line from being read. Actuation takes
+// the newest frame and skips the rest, unless -q asks for every frame in
+// order (deterministic replays).
+static struct spsc_ring frames;
+static int inOrder;
+static int delayMs = 100;
+static int rtCpu = -1, rtPriority = RT_DEFAULT_PRIORITY;
+
+// Per-frame latency trace (-t), read by tracelat
+static FILE *traceOut;
+
+// Limits in force, owned by the actuation thread
+static struct setpoint limits = { .angle = 90, .minLimit = 0, .maxLimit = 90 };
+
+// Newest setpoint not yet applied, so one is not lost when actuation skips
+// to the newest frame
+static pthread_mutex_t setpointLock = PTHREAD_MUTEX_INITIALIZER;
+static struct sensor_frame pendingSetpoint;
+static int setpointPending;
+
+// Write side of the serial port for acknowledgements, -1 if read-only
+static int serialOut = -1;
+
 // Function to move servo motor to a specific angle
 void moveServo(int angle) {
-    char buffer[32];
-    int fd = open(SERVO_DEV, O_WRONLY);
-    if (fd < 0) {
-        perror("Error opening servo device");
-        return;
+    if (telemetry_enabled) {
+        pthread_mutex_lock(&telemetryLock);
+        tlog_append_command(&telemetry, TLOG_AXIS_SERVO, 0, angle);
+        pthread_mutex_unlock(&telemetryLock);
     }
+    motor->servo(motor, angle);
+}
 
-    // Write angle to servo device
-    snprintf(buffer, sizeof(buffer), "%d", angle);
-    if (write(fd, buffer, strlen(buffer)) < 0) {
-        perror("Error writing to servo device");
+// Function to rotate stepper motor
+void rotateStepper(int steps, int clockwise) {
+    if (telemetry_enabled) {
+        pthread_mutex_lock(&telemetryLock);
+        tlog_append_command(&telemetry, TLOG_AXIS_STEPPER, clockwise, steps);
+        pthread_mutex_unlock(&telemetryLock);
     }
-
-    close(fd);
+    motor->step(motor, steps, clockwise);
 }
 
-// Function to write stepper motor pin values
-void writeStepperPin(const char *device, int value) {
-    char buffer[2];
-    int fd = open(device, O_WRONLY);
-    if (fd < 0) {
-        perror("Error opening stepper device");
+// Function to parse sensor data
+// The ESP32 sends the direction of the brightest light sensor
+// ("Venstre", "Højre", "Op" or "Ned") as the first word of each line,
+// optionally followed by the frame's trace id and timestamps and the
+// brightest reading (kept in the telemetry log for trackstats).
+void parseSensorData(const char *data, struct sensor_frame *f) {
+    struct setpoint *sp = &f->setpoint;
+    if (sscanf(data, "SET %u %d %d %d", &sp->id, &sp->angle, &sp->minLimit, &sp->maxLimit) == 4) {
+        f->isSetpoint = 1;
+        strcpy(f->direction, "SET");
         return;
     }
 
-    // Write value (0 or 1) to the stepper pin
-    snprintf(buffer, sizeof(buffer), "%d", value);
-    if (write(fd, buffer, strlen(buffer)) < 0) {
-        perror("Error writing to stepper device");
+    size_t len = strcspn(data, " ,\t\r\n");
+    if (len >= sizeof(f->direction)) {
+        len = sizeof(f->direction) - 1;
     }
+    memcpy(f->direction, data, len);
+    f->direction[len] = '\0';
 
-    close(fd);
+    f->traced = sscanf(data + len, "%u %u %u", &f->traceId, &f->captureUs, &f->txUs) == 3;
+    if (!f->traced) {
+        f->traceId = 0;
+    }
 }
 
-// Function to reset stepper motor pins
-void resetStepper() {
-    writeStepperPin(STEPPER_DEV1, 0);
-    writeStepperPin(STEPPER_DEV2, 0);
-    writeStepperPin(STEPPER_DEV3, 0);
-    writeStepperPin(STEPPER_DEV4, 0);
+// Function to determine sun direction based on sensor data
+const char *determineSunDirection() {
+    return frame.direction;
 }
 
-// Function to rotate stepper motor
-void rotateStepper(int steps, int clockwise) {
-    for (int i = 0; i < steps; i++) {
-        int stepIndex = clockwise ? i % 4 : (3 - (i % 4));
-        writeStepperPin(STEPPER_DEV1, stepSequence[stepIndex][0]);
-        writeStepperPin(STEPPER_DEV2, stepSequence[stepIndex][1]);
-        writeStepperPin(STEPPER_DEV3, stepSequence[stepIndex][2]);
-        writeStepperPin(STEPPER_DEV4, stepSequence[stepIndex][3]);
-        usleep(2000); // Step delay in microseconds
-    }
-    resetStepper();
+// Write one trace record: ESP32 stamps from the frame, then CLOCK_MONOTONIC
+// nanoseconds for receive, decision and command hand-off (0 if no command)
+// The decide stamp is taken when actuation picks the frame up, so rx ->
+// decide is how old the sensor data was when it was acted on.
+static void traceFrame(uint64_t rxNs, uint64_t decideNs, uint64_t issuedNs) {
+    if (!traceOut || !frame.traced) {
+        return;
+    }
+    fprintf(traceOut, "trace %u cap %u tx %u rx %llu decide %llu write %llu\n", frame.traceId, frame.captureUs,
+            frame.txUs, (unsigned long long)rxNs, (unsigned long long)decideNs, (unsigned long long)issuedNs);
 }
 
-// Function to parse sensor data (dummy placeholder)
-void parseSensorData(const char *data) {
-    // Placeholder for sensor data parsing logic
+// Move the servo to a new setpoint and acknowledge it. A setpoint resent
+// because its ack was lost is only acknowledged again; a bad one is refused.
+static void applySetpoint(const struct setpoint *sp, uint64_t rxNs) {
+    int repeat = sp->id == limits.id && sp->angle == limits.angle && sp->minLimit == limits.minLimit &&
+                 sp->maxLimit == limits.maxLimit;
+    uint64_t issuedNs = motor_clock_ns();
+
+    if (sp->minLimit > sp->angle || sp->angle > sp->maxLimit) {
+        fprintf(stderr, "Ignoring setpoint %d outside [%d, %d]\n", sp->angle, sp->minLimit, sp->maxLimit);
+        if (serialOut >= 0) {
+            char nak[64];
+            int len = snprintf(nak, sizeof(nak), "NAK %u %d %d %d\n", sp->id, limits.angle, limits.minLimit,
+                               limits.maxLimit);
+            if (write(serialOut, nak, len) != len) {
+                perror("Error writing setpoint nak");
+            }
+        }
+        return;
+    }
+    limits = *sp;
+    if (!repeat) {
+        printf("Setpoint: %d [%d, %d]\n", sp->angle, sp->minLimit, sp->maxLimit);
+        moveServo(sp->angle);
+        issuedNs = motor->issued_ns ? motor->issued_ns : motor_clock_ns();
+    }
+    if (serialOut >= 0) {
+        char ack[80];
+        int len = snprintf(ack, sizeof(ack), "ACK %u %d %d %d %llu\n", sp->id, sp->angle, sp->minLimit,
+                           sp->maxLimit, (unsigned long long)(issuedNs > rxNs ? (issuedNs - rxNs) / 1000 : 0));
+        if (write(serialOut, ack, len) != len) {
+            perror("Error writing setpoint ack");
+        }
+    }
 }
 
-// Function to determine sun direction based on sensor data (dummy placeholder)
-const char *determineSunDirection() {
-    // Placeholder for logic to determine direction
-    return "Unknown"; // Example return value
+// Actuation thread: act on frames until ingest closes the ring
+static void *actuate(void *arg) {
+    (void)arg;
+
+    // Everything is open and allocated; from here on the loop must not fault
+    if (rtCpu >= 0 && rt_enter(rtCpu, rtPriority) < 0) {
+        exit(1);
+    }
+
+    while (spsc_wait(&frames)) {
+        if (!(inOrder ? spsc_take_oldest(&frames, &frame) : spsc_take_newest(&frames, &frame))) {
+            continue;
+        }
+        const char *direction = determineSunDirection();
+        uint64_t decideNs = motor_clock_ns();
+        motor->frame = frame.seq;
+        motor->trace = frame.traceId;
+        motor->issued_ns = 0;
+
+        // In order (-q) every setpoint is applied in its place; otherwise the
+        // newest one, even if its frame was skipped
+        struct sensor_frame sp = frame;
+        int haveSetpoint = frame.isSetpoint;
+        if (!inOrder) {
+            pthread_mutex_lock(&setpointLock);
+            sp = pendingSetpoint;
+            haveSetpoint = setpointPending;
+            setpointPending = 0;
+            pthread_mutex_unlock(&setpointLock);
+        }
+        if (haveSetpoint) {
+            applySetpoint(&sp.setpoint, sp.rxNs);
+        }
+
+        // Perform motor control based on direction
+        if (frame.isSetpoint) {
+            // Nothing else to do
+        } else if (strcmp(direction, "Venstre") == 0) {
+            printf("Sun direction: Left\n");
+            rotateStepper(50, 0); // Rotate stepper left
+        } else if (strcmp(direction, "Højre") == 0) {
+            printf("Sun direction: Right\n");
+            rotateStepper(50, 1); // Rotate stepper right
+        } else if (strcmp(direction, "Op") == 0) {
+            printf("Sun direction: Up\n");
+            moveServo(limits.maxLimit); // Move servo up
+        } else if (strcmp(direction, "Ned") == 0) {
+            printf("Sun direction: Down\n");
+            moveServo(limits.minLimit); // Move servo down
+        } else {
+            printf("Sun direction: Unknown\n");
+        }
+        traceFrame(frame.rxNs, decideNs, motor->issued_ns);
+
+        if (delayMs > 0) {
+            usleep(delayMs * 1000); // Small delay between decisions
+        }
+    }
+    return NULL;
+}
+
+// SIGINT/SIGTERM end the loop (interrupting a blocking read) so the jitter
+// report is still printed
+static volatile sig_atomic_t stopping;
+
+static void stopSignal(int sig) {
+    (void)sig;
+    stopping = 1;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-s serial-dev] [-m motor-backend] [-l telemetry-dir | -n] [-L segments] [-d delay-ms]\n"
+                    "       [-t trace-file] [-q] [-R cpu[,priority]] [-J seconds]\n",
+            prog);
+    fprintf(stderr, "  motor backends: plat_drv[:tracker[,async]] (default), gpiod[:chip,servo,pin1..pin4], trace[:path[,sim]]\n");
+    fprintf(stderr, "  -L  telemetry log size in 4 MiB segments of 65535 records (default %d, see tlog.h)\n",
+            TLOG_DEFAULT_SEGMENTS);
+    fprintf(stderr, "  -q  act on every frame in order instead of only the newest\n");
+    fprintf(stderr, "  -R  real-time actuation thread: SCHED_FIFO on `cpu`, memory locked (for gpiod)\n");
+    fprintf(stderr, "  -J  only measure wake-up jitter at the step period, like cyclictest\n");
 }
 
-int main() {
-    // Open the serial port to read data from ESP32
-    FILE *serialInput = fopen("/dev/ttyS0", "r"); // Adjust serial port if necessary
+int main(int argc, char *argv[]) {
+    const char *serialDev = SERIAL_DEV;
+    const char *motorSpec = "plat_drv";
+    const char *logDir = TLOG_DIR;
+    unsigned int logSegments = 0;
+    double jitterSecs = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:m:l:nL:d:t:qR:J:")) != -1) {
+        switch (opt) {
+        case 's':
+            serialDev = optarg;
+            break;
+        case 'm':
+            motorSpec = optarg;
+            break;
+        case 'l':
+            logDir = optarg;
+            break;
+        case 'n':
+            logDir = NULL;
+            break;
+        case 'L':
+            logSegments = strtoul(optarg, NULL, 10);
+            if (!logSegments) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'd':
+            delayMs = atoi(optarg);
+            break;
+        case 't':
+            traceOut = fopen(optarg, "a");
+            if (!traceOut) {
+                perror("Error opening trace file");
+                return 1;
+            }
+            setvbuf(traceOut, NULL, _IOLBF, 0);
+            break;
+        case 'q':
+            inOrder = 1;
+            break;
+        case 'R':
+            if (rt_parse(optarg, &rtCpu, &rtPriority) < 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'J':
+            jitterSecs = atof(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (jitterSecs > 0) {
+        struct rt_jitter jitter = { 0 };
+        if (rtCpu >= 0 && rt_enter(rtCpu, rtPriority) < 0) {
+            return 1;
+        }
+        rt_cyclictest(jitterSecs, 2000000, &jitter);
+        rt_jitter_report(stdout, "step period 2000 us", &jitter);
+        return 0;
+    }
+
+    motor = motor_open(motorSpec);
+    if (!motor) {
+        return 1;
+    }
+
+    // Keep running without a log rather than refusing to track the sun
+    if (logDir && tlog_open(&telemetry, logDir, logSegments, 0) == 0) {
+        telemetry_enabled = 1;
+    } else if (logDir) {
+        fprintf(stderr, "Warning: telemetry log disabled\n");
+    }
+
+    // Open the serial port to read data from ESP32, and to acknowledge
+    // setpoints if it can be written
+    int serialFd = open(serialDev, O_RDWR | O_NOCTTY);
+    if (serialFd >= 0) {
+        serialOut = serialFd;
+    } else {
+        serialFd = open(serialDev, O_RDONLY | O_NOCTTY);
+    }
+    FILE *serialInput = serialFd >= 0 ? fdopen(serialFd, "r") : NULL;
     if (!serialInput) {
-        fprintf(stderr, "Error: Cannot open serial port\n");
+        fprintf(stderr, "Error: Cannot open serial port %s\n", serialDev);
+        return 1;
+    }
+
+    pthread_mutexattr_t lockAttr;
+    pthread_mutexattr_init(&lockAttr);
+    pthread_mutexattr_setprotocol(&lockAttr, PTHREAD_PRIO_INHERIT);
+    pthread_mutex_init(&telemetryLock, &lockAttr);
+    if (spsc_init(&frames, FRAME_SLOTS, sizeof(struct sensor_frame)) < 0) {
+        perror("Error creating frame ring");
         return 1;
     }
 
+    // Signals are handled by this (ingest) thread only, so they interrupt
+    // the blocking read and never a move in progress
+    struct sigaction stop = { .sa_handler = stopSignal };
+    sigset_t stopSet, oldSet;
+    pthread_t actuator;
+    sigemptyset(&stopSet);
+    sigaddset(&stopSet, SIGINT);
+    sigaddset(&stopSet, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSet, &oldSet);
+    if (pthread_create(&actuator, NULL, actuate, NULL) != 0) {
+        fprintf(stderr, "Error: Cannot start actuation thread\n");
+        return 1;
+    }
+    pthread_sigmask(SIG_SETMASK, &oldSet, NULL);
+    sigaction(SIGINT, &stop, NULL);
+    sigaction(SIGTERM, &stop, NULL);
+
     char line[256];
-    while (1) {
+    uint32_t frameSeq = 0;
+    while (!stopping) {
         if (fgets(line, sizeof(line), serialInput)) {
+            struct sensor_frame f = { .seq = frameSeq++, .rxNs = motor_clock_ns() };
+            if (telemetry_enabled) {
+                pthread_mutex_lock(&telemetryLock);
+                tlog_append_frame(&telemetry, line);
+                pthread_mutex_unlock(&telemetryLock);
+            }
+
             // Parse sensor data
-            parseSensorData(line);
-            const char *direction = determineSunDirection();
-
-            // Perform motor control based on direction
-            if (strcmp(direction, "Venstre") == 0) {
-                printf("Sun direction: Left\n");
-                rotateStepper(50, 0); // Rotate stepper left
-            } else if (strcmp(direction, "Højre") == 0) {
-                printf("Sun direction: Right\n");
-                rotateStepper(50, 1); // Rotate stepper right
-            } else if (strcmp(direction, "Op") == 0) {
-                printf("Sun direction: Up\n");
-                moveServo(90); // Move servo up
-            } else if (strcmp(direction, "Ned") == 0) {
-                printf("Sun direction: Down\n");
-                moveServo(0); // Move servo down
-            } else {
-                printf("Sun direction: Unknown\n");
+            parseSensorData(line, &f);
+            if (f.isSetpoint) {
+                pthread_mutex_lock(&setpointLock);
+                pendingSetpoint = f;
+                setpointPending = 1;
+                pthread_mutex_unlock(&setpointLock);
             }
+            spsc_push(&frames, &f);
+        } else if (feof(serialInput) || ferror(serialInput)) {
+            // Serial line hung up (or a replay finished)
+            break;
         }
-
-        usleep(100000); // Small delay between readings
     }
+    spsc_close(&frames);
+    pthread_join(actuator, NULL);
+    if (frames.stale || frames.dropped) {
+        fprintf(stderr, "frames %u, acted on %llu, stale %llu, dropped %llu\n", frameSeq,
+                (unsigned long long)frames.taken, (unsigned long long)frames.stale,
+                (unsigned long long)frames.dropped);
+    }
+    spsc_free(&frames);
 
     fclose(serialInput);
+    motor_close(motor);
+    rt_jitter_report(stderr, "gpiod steps", &rt_step_jitter);
+    if (traceOut) {
+        fclose(traceOut);
+    }
+    if (telemetry_enabled) {
+        tlog_close(&telemetry);
+    }
     return 0;
 }
@@ -0,0 +1,53 @@
+#include "motor.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static struct motor_backend *const backends[] = {
+    &motor_platdrv,
+    &motor_trace,
+    &motor_gpiod,
+};
+
+uint64_t motor_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+struct motor_backend *motor_open(const char *spec) {
+    const char *colon = strchr(spec, ':');
+    size_t len = colon ? (size_t)(colon - spec) : strlen(spec);
+
+    for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+        struct motor_backend *m = backends[i];
+
+        if (strlen(m->name) != len || strncmp(m->name, spec, len) != 0) {
+            continue;
+        }
+        // Each open gets its own copy, so one process can drive many motors
+        m = malloc(sizeof(*m));
+        if (!m) {
+            perror("Error allocating motor backend");
+            return NULL;
+        }
+        *m = *backends[i];
+        if (m->open && m->open(m, colon ? colon + 1 : NULL) < 0) {
+            free(m);
+            return NULL;
+        }
+        return m;
+    }
+
+    fprintf(stderr, "Error: unknown motor backend '%s'\n", spec);
+    return NULL;
+}
+
+void motor_close(struct motor_backend *m) {
+    if (m && m->close) {
+        m->close(m);
+    }
+    free(m);
+}
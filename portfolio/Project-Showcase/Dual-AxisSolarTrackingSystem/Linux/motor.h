@@ -0,0 +1,47 @@
+#ifndef MOTOR_H
+#define MOTOR_H
+
+#include <stdint.h>
+
+// Motor backend used by the controller to move the panel.
+//
+// A backend is chosen on the command line as "name[:argument]", e.g.
+// "plat_drv" for the Servo-Stepper character devices ("plat_drv:2" for the
+// third tracker, "plat_drv:2,async" to queue moves without waiting),
+// "gpiod" to drive the pins from userspace through /dev/gpiochip0 or
+// "trace:/tmp/cmds.txt" to only record what would have been done.
+struct motor_backend {
+    const char *name;
+    int (*open)(struct motor_backend *m, const char *arg);
+    void (*servo)(struct motor_backend *m, int angle);
+    void (*step)(struct motor_backend *m, int steps, int clockwise);
+    void (*close)(struct motor_backend *m);
+
+    // Optional: 1 while a move is running or queued, 0 when idle, -1 if the
+    // backend cannot tell right now
+    int (*busy)(struct motor_backend *m);
+    void *priv;
+
+    // Sequence number of the frame the next command is a reaction to, so
+    // backends that record commands can tie them back to their input
+    uint32_t frame;
+
+    // Trace id of that frame (0 if it carried none); backends pass it on to
+    // the driver and set issued_ns (CLOCK_MONOTONIC) right before the
+    // command is handed to the kernel
+    uint32_t trace;
+    uint64_t issued_ns;
+};
+
+uint64_t motor_clock_ns(void);
+
+extern struct motor_backend motor_platdrv;
+extern struct motor_backend motor_trace;
+extern struct motor_backend motor_gpiod;
+
+// Open a new instance of the backend described by `spec`; NULL on failure.
+// motor_close() releases it.
+struct motor_backend *motor_open(const char *spec);
+void motor_close(struct motor_backend *m);
+
+#endif
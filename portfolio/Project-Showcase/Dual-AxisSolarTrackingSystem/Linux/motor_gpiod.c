@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "gpioline.h"
+#include "motor.h"
+#include "rt.h"
+
+// Userspace GPIO backend: drives the same pins as the Servo-Stepper module
+// through the GPIO character device, so no matching kernel build or DT
+// overlay is needed.
+//
+// Argument: "[chip][,servo,pin1,pin2,pin3,pin4]", default
+// "gpiochip0,18,22,23,24,25" (the pins of Servo-Stepper.dts). The four
+// stepper lines are one line request, so every phase change is a single
+// GPIO_V2_LINE_SET_VALUES ioctl. Timing follows the driver: 2 ms per step
+// and one 20 ms PWM period per servo command, paced on absolute deadlines.
+// How late each step wake-up is goes into rt_step_jitter (see rt.h).
+#define STEP_PERIOD_NS 2000000ll
+#define SERVO_PERIOD_NS 20000000ll
+
+struct gpiod_priv {
+    int servo_fd;
+    int stepper_fd;
+};
+
+static void add_ns(struct timespec *t, long long ns) {
+    t->tv_nsec += ns;
+    while (t->tv_nsec >= 1000000000) {
+        t->tv_nsec -= 1000000000;
+        t->tv_sec++;
+    }
+}
+
+static void sleep_until(const struct timespec *t) {
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, t, NULL) == EINTR) {
+    }
+}
+
+// Returns how far past `t` we woke up
+static uint64_t sleep_until_late(const struct timespec *t) {
+    struct timespec now;
+    long long late;
+
+    sleep_until(t);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    late = (now.tv_sec - t->tv_sec) * 1000000000ll + (now.tv_nsec - t->tv_nsec);
+    return late > 0 ? late : 0;
+}
+
+static int gpiod_open(struct motor_backend *m, const char *arg) {
+    char chip[64] = "gpiochip0";
+    unsigned int pins[5] = { 18, 22, 23, 24, 25 };
+    struct gpiod_priv *p;
+    int chipFd;
+
+    if (!GPIOLINE_V2) {
+        fprintf(stderr, "Error: motor backend 'gpiod' is not available, built without the GPIO v2 uAPI "
+                        "(5.10+ kernel headers)\n");
+        return -1;
+    }
+    if (arg && *arg) {
+        size_t len = strcspn(arg, ",");
+        if (len) {
+            snprintf(chip, sizeof(chip), "%.*s", (int)len, arg);
+        }
+        if (arg[len] == ',' && sscanf(arg + len + 1, "%u,%u,%u,%u,%u", &pins[0], &pins[1], &pins[2], &pins[3],
+                                      &pins[4]) != 5) {
+            fprintf(stderr, "Error: gpiod backend wants chip,servo,pin1,pin2,pin3,pin4\n");
+            return -1;
+        }
+    }
+
+    chipFd = gpioline_open_chip(chip);
+    if (chipFd < 0) {
+        perror("Error opening GPIO chip");
+        return -1;
+    }
+    p = calloc(1, sizeof(*p));
+    if (!p) {
+        perror("Error allocating motor backend");
+        close(chipFd);
+        return -1;
+    }
+    p->servo_fd = gpioline_request(chipFd, &pins[0], 1, "solartracker-servo");
+    p->stepper_fd = gpioline_request(chipFd, &pins[1], 4, "solartracker-stepper");
+    close(chipFd); // Line requests stay valid on their own
+    if (p->servo_fd < 0 || p->stepper_fd < 0) {
+        perror("Error requesting GPIO lines");
+        close(p->servo_fd);
+        close(p->stepper_fd);
+        free(p);
+        return -1;
+    }
+    m->priv = p;
+    return 0;
+}
+
+static void gpiod_close(struct motor_backend *m) {
+    struct gpiod_priv *p = m->priv;
+
+    if (p) {
+        close(p->servo_fd);
+        close(p->stepper_fd);
+        free(p);
+        m->priv = NULL;
+    }
+}
+
+// One PWM period: 0.5-2.5 ms high for 0-180 degrees
+static void gpiod_servo(struct motor_backend *m, int angle) {
+    struct gpiod_priv *p = m->priv;
+    long long duty = (500 + (angle * 2000) / 180) * 1000ll;
+    struct timespec fall, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &fall);
+    end = fall;
+    add_ns(&fall, duty);
+    add_ns(&end, SERVO_PERIOD_NS);
+
+    m->issued_ns = motor_clock_ns();
+    gpioline_set(p->servo_fd, 1, 1);
+    sleep_until(&fall);
+    gpioline_set(p->servo_fd, 0, 1);
+    sleep_until(&end);
+}
+
+static void gpiod_step(struct motor_backend *m, int steps, int clockwise) {
+    struct gpiod_priv *p = m->priv;
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    m->issued_ns = motor_clock_ns();
+    for (int i = 0; i < steps; i++) {
+        if (gpioline_set(p->stepper_fd, gpioline_stepper_phase(i, clockwise), 0xf) < 0) {
+            perror("Error setting stepper lines");
+            break;
+        }
+        add_ns(&t, STEP_PERIOD_NS);
+        rt_jitter_add(&rt_step_jitter, sleep_until_late(&t));
+    }
+    gpioline_set(p->stepper_fd, 0, 0xf);
+}
+
+struct motor_backend motor_gpiod = {
+    .name = "gpiod",
+    .open = gpiod_open,
+    .servo = gpiod_servo,
+    .step = gpiod_step,
+    .close = gpiod_close,
+};
@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "motor.h"
+#include "plat_drv_status.h"
+
+// Device files of the Servo-Stepper driver. Tracker n (the n-th plat_drv
+// node in the device tree) has its servo on /dev/plat_drv<2n> and its
+// stepper on /dev/plat_drv<2n+1>.
+//
+// Argument: "<tracker>[,async]", tracker 0 by default. By default every
+// command blocks until the driver has finished the move. With ",async" the
+// device files stay open in non-blocking mode and a command only queues
+// the move in the driver, which is what an event loop driving many trackers
+// needs; a command the driver has no room for is dropped with a warning.
+// The tracker's status page is mapped as well, so whether it is still
+// moving can be checked without a syscall (see plat_drv_status.h).
+struct platdrv_priv {
+    char servo[32];
+    char stepper[32];
+    int async;
+    int servo_fd, stepper_fd; // Only kept open with ",async"
+    const struct plat_drv_status *status; // NULL if the driver has none
+    uint32_t faults_seen;
+};
+
+static int platdrv_open(struct motor_backend *m, const char *arg) {
+    int tracker = arg && *arg ? atoi(arg) : 0;
+    const char *comma = arg ? strchr(arg, ',') : NULL;
+    struct platdrv_priv *p;
+
+    if (tracker < 0) {
+        fprintf(stderr, "Error: invalid tracker number '%s'\n", arg);
+        return -1;
+    }
+    p = calloc(1, sizeof(*p));
+    if (!p) {
+        perror("Error allocating motor backend");
+        return -1;
+    }
+    snprintf(p->servo, sizeof(p->servo), "/dev/plat_drv%d", tracker * 2);
+    snprintf(p->stepper, sizeof(p->stepper), "/dev/plat_drv%d", tracker * 2 + 1);
+    p->async = comma && strcmp(comma + 1, "async") == 0;
+    p->servo_fd = p->stepper_fd = -1;
+
+    if (p->async) {
+        p->servo_fd = open(p->servo, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        p->stepper_fd = open(p->stepper, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (p->servo_fd < 0 || p->stepper_fd < 0) {
+            perror("Error opening motor device");
+            close(p->servo_fd);
+            close(p->stepper_fd);
+            free(p);
+            return -1;
+        }
+        // Older drivers have no status page; busy() then says it cannot tell
+        void *page = mmap(NULL, sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, p->stepper_fd, 0);
+        if (page != MAP_FAILED && ((const struct plat_drv_status *)page)->version == PLAT_DRV_STATUS_VERSION) {
+            p->status = page;
+        } else if (page != MAP_FAILED) {
+            munmap(page, sysconf(_SC_PAGESIZE));
+        }
+    }
+    m->priv = p;
+    return 0;
+}
+
+static void platdrv_close(struct motor_backend *m) {
+    struct platdrv_priv *p = m->priv;
+
+    if (p) {
+        if (p->async) {
+            if (p->status) {
+                munmap((void *)p->status, sysconf(_SC_PAGESIZE));
+            }
+            close(p->servo_fd);
+            close(p->stepper_fd);
+        }
+        free(p);
+        m->priv = NULL;
+    }
+}
+
+// Write one command to a driver node. The trace id is appended so the
+// driver can tag the first step edge it emits for this command.
+static void writeCommand(struct motor_backend *m, const char *device, int asyncFd, const char *cmd) {
+    char buffer[32];
+    int fd = asyncFd >= 0 ? asyncFd : open(device, O_WRONLY);
+    if (fd < 0) {
+        perror("Error opening motor device");
+        return;
+    }
+
+    snprintf(buffer, sizeof(buffer), "%s %u", cmd, m->trace);
+    m->issued_ns = motor_clock_ns();
+    if (write(fd, buffer, strlen(buffer)) < 0) {
+        if (errno == EAGAIN) {
+            fprintf(stderr, "Warning: %s queue full, command dropped\n", device);
+        } else {
+            perror("Error writing to motor device");
+        }
+    }
+
+    if (fd != asyncFd) {
+        close(fd);
+    }
+}
+
+// Function to move servo motor to a specific angle
+static void moveServo(struct motor_backend *m, int angle) {
+    struct platdrv_priv *p = m->priv;
+    char cmd[16];
+    snprintf(cmd, sizeof(cmd), "%d", angle);
+    writeCommand(m, p->servo, p->servo_fd, cmd);
+}
+
+// Function to rotate stepper motor; the driver generates the phase sequence
+static void rotateStepper(struct motor_backend *m, int steps, int clockwise) {
+    struct platdrv_priv *p = m->priv;
+    char cmd[24];
+    snprintf(cmd, sizeof(cmd), "%s %d", clockwise ? "forward" : "backward", steps);
+    writeCommand(m, p->stepper, p->stepper_fd, cmd);
+}
+
+static int platdrv_busy(struct motor_backend *m) {
+    struct platdrv_priv *p = m->priv;
+    struct plat_drv_status st;
+
+    if (!p->status) {
+        return -1;
+    }
+    plat_drv_status_read(p->status, &st);
+    if (st.faults & ~p->faults_seen) {
+        fprintf(stderr, "Warning: %s reports%s%s\n", p->stepper,
+                st.faults & PLAT_DRV_FAULT_REMOVED ? " device removed" : "",
+                st.faults & PLAT_DRV_FAULT_LATE ? " late step edges" : "");
+    }
+    p->faults_seen = st.faults;
+    return st.axis[PLAT_DRV_AXIS_SERVO].queue_depth || st.axis[PLAT_DRV_AXIS_STEPPER].queue_depth;
+}
+
+struct motor_backend motor_platdrv = {
+    .name = "plat_drv",
+    .open = platdrv_open,
+    .servo = moveServo,
+    .step = rotateStepper,
+    .close = platdrv_close,
+    .busy = platdrv_busy,
+};
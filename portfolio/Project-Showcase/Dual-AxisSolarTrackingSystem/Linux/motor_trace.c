@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "motor.h"
+
+// Recording stub: instead of moving anything, every command is written as
+//
+//   <CLOCK_MONOTONIC ns> <frame> servo <angle>
+//   <CLOCK_MONOTONIC ns> <frame> stepper forward|backward <steps>
+//
+// Argument: "<path>[,sim]". With ",sim" the stub also sleeps for as long as
+// the real hardware would take (2 ms per step), so replays keep the
+// controller's blocking behaviour.
+struct trace_priv {
+    FILE *out;
+    int simulate;
+};
+
+static int trace_open(struct motor_backend *m, const char *arg) {
+    struct trace_priv *t;
+    char path[256];
+    const char *comma;
+
+    if (!arg || !*arg) {
+        arg = "/dev/stdout";
+    }
+    comma = strchr(arg, ',');
+    snprintf(path, sizeof(path), "%.*s", comma ? (int)(comma - arg) : (int)strlen(arg), arg);
+
+    t = calloc(1, sizeof(*t));
+    if (!t) {
+        perror("Error allocating motor backend");
+        return -1;
+    }
+    t->simulate = comma && strcmp(comma + 1, "sim") == 0;
+    t->out = fopen(path, "w");
+    if (!t->out) {
+        perror("Error opening motor trace");
+        free(t);
+        return -1;
+    }
+    // One line per command, visible to a reader as soon as it is issued
+    setvbuf(t->out, NULL, _IOLBF, 0);
+    m->priv = t;
+    return 0;
+}
+
+static void trace_servo(struct motor_backend *m, int angle) {
+    struct trace_priv *t = m->priv;
+    m->issued_ns = motor_clock_ns();
+    fprintf(t->out, "%llu %u servo %d\n", (unsigned long long)m->issued_ns, m->frame, angle);
+    if (t->simulate) {
+        usleep(20000); // One 20 ms PWM period
+    }
+}
+
+static void trace_step(struct motor_backend *m, int steps, int clockwise) {
+    struct trace_priv *t = m->priv;
+    m->issued_ns = motor_clock_ns();
+    fprintf(t->out, "%llu %u stepper %s %d\n", (unsigned long long)m->issued_ns, m->frame,
+            clockwise ? "forward" : "backward", steps);
+    if (t->simulate) {
+        usleep(2000 * steps);
+    }
+}
+
+static void trace_close(struct motor_backend *m) {
+    struct trace_priv *t = m->priv;
+    if (t) {
+        fclose(t->out);
+        free(t);
+        m->priv = NULL;
+    }
+}
+
+struct motor_backend motor_trace = {
+    .name = "trace",
+    .open = trace_open,
+    .servo = trace_servo,
+    .step = trace_step,
+    .close = trace_close,
+};
@@ -0,0 +1,64 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+// Status page of a Servo-Stepper tracker, shared by the driver and userspace.
+//
+// Either device node of a tracker can be mmap'd read-only (one page, offset
+// 0, the file opened for reading) to see the state of both axes without a
+// syscall. The driver updates the page under a sequence counter: seq is odd
+// while an update is in progress, so a reader copies the page and retries
+// if seq was odd or changed meanwhile (plat_drv_status_read()).
+//
+// poll() on a device node reports, for that axis:
+//   POLLIN   idle: nothing moving and nothing queued
+//   POLLOUT  room in the command queue, write() will not block
+//   POLLPRI  a fault flag is set
+//   POLLHUP  the tracker has been removed
+#ifndef PLAT_DRV_STATUS_H
+#define PLAT_DRV_STATUS_H
+
+#include <linux/types.h>
+
+#define PLAT_DRV_STATUS_VERSION 1
+
+enum plat_drv_axis {
+    PLAT_DRV_AXIS_SERVO,
+    PLAT_DRV_AXIS_STEPPER,
+};
+
+// Fault flags
+#define PLAT_DRV_FAULT_REMOVED (1u << 0) // Device removed, write() fails with ENODEV
+#define PLAT_DRV_FAULT_LATE    (1u << 1) // A stepper edge ran a step period late;
+                                         // sticky until the debugfs reset
+
+struct plat_drv_axis_status {
+    __s64 position;      // Servo: angle; stepper: steps since load, forward positive
+    __s64 target;        // Position once everything queued has run
+    __s32 velocity;      // Stepper: steps/s, negative backward, 0 when stopped
+    __u32 queue_depth;   // Commands queued, the one in progress included
+    __u32 queued_seq;    // Commands accepted so far
+    __u32 done_seq;      // Commands finished so far
+};
+
+struct plat_drv_status {
+    __u32 seq;
+    __u32 version;       // PLAT_DRV_STATUS_VERSION
+    __u32 faults;        // PLAT_DRV_FAULT_*
+    __u32 reserved;
+    __u64 updated_ns;    // CLOCK_MONOTONIC of the last update
+    struct plat_drv_axis_status axis[2]; // Indexed by enum plat_drv_axis
+};
+
+#ifndef __KERNEL__
+// Take a consistent copy of a mapped status page
+static inline void plat_drv_status_read(const struct plat_drv_status *page, struct plat_drv_status *out) {
+    __u32 seq;
+
+    do {
+        while ((seq = __atomic_load_n(&page->seq, __ATOMIC_ACQUIRE)) & 1) {
+        }
+        __builtin_memcpy(out, (const void *)page, sizeof(*out));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&page->seq, __ATOMIC_RELAXED) != seq);
+}
+#endif
+
+#endif
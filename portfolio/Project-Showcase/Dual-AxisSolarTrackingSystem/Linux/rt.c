@@ -0,0 +1,152 @@
+#define _GNU_SOURCE
+#include "rt.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <malloc.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#define PREFAULT_STACK (512 * 1024)
+
+struct rt_jitter rt_step_jitter;
+
+int rt_parse(const char *spec, int *cpu, int *priority) {
+    char *end;
+
+    *cpu = strtol(spec, &end, 10);
+    *priority = RT_DEFAULT_PRIORITY;
+    if (end == spec || *cpu < 0) {
+        return -1;
+    }
+    if (*end == ',') {
+        *priority = strtol(end + 1, &end, 10);
+    }
+    return *end || *priority < 1 || *priority > 99 ? -1 : 0;
+}
+
+// Touch the stack we may need so no page fault happens in the loop
+static void prefault_stack(void) {
+    char stack[PREFAULT_STACK];
+
+    memset(stack, 0, sizeof(stack));
+    // Make the buffer look used, or the compiler drops the memset as a dead store
+    __asm__ volatile("" : : "r"(stack) : "memory");
+}
+
+// Is `cpu` in the kernel's isolated list (e.g. "2-3,6")?
+static int cpu_isolated(int cpu) {
+    FILE *f = fopen("/sys/devices/system/cpu/isolated", "r");
+    int lo, hi, found = 0;
+    char sep;
+
+    if (!f) {
+        return 0;
+    }
+    while (!found && fscanf(f, "%d", &lo) == 1) {
+        hi = lo;
+        if (fscanf(f, "%c", &sep) == 1 && sep == '-' && fscanf(f, "%d", &hi) == 1) {
+            fscanf(f, "%c", &sep);
+        }
+        found = cpu >= lo && cpu <= hi;
+    }
+    fclose(f);
+    return found;
+}
+
+int rt_enter(int cpu, int priority) {
+    struct sched_param param = { .sched_priority = priority };
+    cpu_set_t set;
+
+    // Keep freed memory instead of returning it to the kernel, so later
+    // allocations do not fault either
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+        perror("Error locking memory");
+        return -1;
+    }
+    prefault_stack();
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+        perror("Error pinning to CPU");
+        return -1;
+    }
+    if (!cpu_isolated(cpu)) {
+        fprintf(stderr, "Warning: CPU %d is not isolated (isolcpus=), expect interference\n", cpu);
+    }
+    if (sched_setscheduler(0, SCHED_FIFO, &param) < 0) {
+        perror("Error switching to SCHED_FIFO");
+        return -1;
+    }
+    return 0;
+}
+
+void rt_jitter_add(struct rt_jitter *j, uint64_t late_ns) {
+    uint64_t us = late_ns / 1000;
+
+    if (!j->count || late_ns < j->min_ns) {
+        j->min_ns = late_ns;
+    }
+    if (late_ns > j->max_ns) {
+        j->max_ns = late_ns;
+    }
+    if (late_ns > RT_BUDGET_NS) {
+        j->over_budget++;
+    }
+    j->count++;
+    j->sum_ns += late_ns;
+    j->hist[us < RT_HIST_US ? us : RT_HIST_US]++;
+}
+
+static double percentile_us(const struct rt_jitter *j, double p) {
+    uint64_t target = (uint64_t)(p * j->count), seen = 0;
+
+    for (int b = 0; b <= RT_HIST_US; b++) {
+        seen += j->hist[b];
+        if (seen > target) {
+            return b < RT_HIST_US ? b + 1 : j->max_ns / 1000.0;
+        }
+    }
+    return j->max_ns / 1000.0;
+}
+
+void rt_jitter_report(FILE *out, const char *name, const struct rt_jitter *j) {
+    if (!j->count) {
+        return;
+    }
+    fprintf(out, "%s: %llu wake-ups, latency min %.1f avg %.1f p99 %.0f p99.9 %.0f max %.1f us, "
+                 "%llu over the %llu us budget\n",
+            name, (unsigned long long)j->count, j->min_ns / 1000.0, j->sum_ns / 1000.0 / j->count,
+            percentile_us(j, 0.99), percentile_us(j, 0.999), j->max_ns / 1000.0,
+            (unsigned long long)j->over_budget, RT_BUDGET_NS / 1000);
+
+    // Non-empty buckets, cyclictest style: "<us> <count>"
+    for (int b = 0; b <= RT_HIST_US; b++) {
+        if (j->hist[b]) {
+            fprintf(out, "  %s%5d %u\n", b < RT_HIST_US ? " " : ">", b, j->hist[b]);
+        }
+    }
+}
+
+void rt_cyclictest(double seconds, uint64_t period_ns, struct rt_jitter *j) {
+    struct timespec next, now;
+    uint64_t loops = (uint64_t)(seconds * 1e9 / period_ns);
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for (uint64_t i = 0; i < loops; i++) {
+        next.tv_nsec += period_ns;
+        while (next.tv_nsec >= 1000000000) {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR) {
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        rt_jitter_add(j, (now.tv_sec - next.tv_sec) * 1000000000ll + (now.tv_nsec - next.tv_nsec));
+    }
+}
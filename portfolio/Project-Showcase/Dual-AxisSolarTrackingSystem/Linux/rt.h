@@ -0,0 +1,38 @@
+#ifndef RT_H
+#define RT_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Opt-in real-time mode for the thread that paces motor steps from
+// userspace (the gpiod backend). Entering it locks and prefaults all memory,
+// pins the thread to one CPU, ideally one kept free with isolcpus=, and
+// switches it to SCHED_FIFO. Paced loops sleep with
+// clock_nanosleep(TIMER_ABSTIME) and record how late each wake-up was.
+
+#define RT_DEFAULT_PRIORITY 80
+#define RT_BUDGET_NS 200000ull   // 10% of the 2 ms step period
+#define RT_HIST_US 2000          // 1 us buckets, then one overflow bucket
+
+struct rt_jitter {
+    uint64_t count, sum_ns, min_ns, max_ns, over_budget;
+    uint32_t hist[RT_HIST_US + 1];
+};
+
+// Wake-up lateness of the gpiod backend's steps
+extern struct rt_jitter rt_step_jitter;
+
+// Parse "cpu[,priority]"; returns 0 or -1
+int rt_parse(const char *spec, int *cpu, int *priority);
+
+// Put the calling thread into real-time mode; returns 0 or -1 (reported)
+int rt_enter(int cpu, int priority);
+
+void rt_jitter_add(struct rt_jitter *j, uint64_t late_ns);
+void rt_jitter_report(FILE *out, const char *name, const struct rt_jitter *j);
+
+// cyclictest-style measurement: wake every `period_ns` for `seconds` on an
+// absolute grid and record the lateness of each wake-up
+void rt_cyclictest(double seconds, uint64_t period_ns, struct rt_jitter *j);
+
+#endif
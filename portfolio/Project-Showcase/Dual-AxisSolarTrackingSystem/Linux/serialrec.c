@@ -0,0 +1,212 @@
+// serialrec - capture the ESP32 serial stream with timestamps.
+//
+//   serialrec [-b baud] [-p] <device> <recording>
+//   serialrec -c <text> <recording>
+//
+// Every chunk read from <device> is appended to <recording> (see srec.h).
+// With -p the bytes are also forwarded to a new pseudo-terminal whose name
+// is printed, so the controller can keep running on live data while it is
+// being recorded:  controller -s /dev/pts/N
+//
+// -c converts a text file of "<milliseconds><TAB><line>" entries into a
+// recording, which is how the replay regression fixtures are written.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "srec.h"
+
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+static uint64_t clock_ns(clockid_t clk) {
+    struct timespec ts;
+    clock_gettime(clk, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// B0 for a rate the tty layer has no constant for
+static speed_t baud_to_speed(int baud) {
+    switch (baud) {
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    default: return B0;
+    }
+}
+
+static int write_chunk(FILE *out, uint64_t t_ns, const void *data, uint32_t len) {
+    struct srec_chunk chunk = { .t_ns = t_ns, .len = len };
+    if (fwrite(&chunk, sizeof(chunk), 1, out) != 1 || fwrite(data, 1, len, out) != len) {
+        perror("Error writing recording");
+        return -1;
+    }
+    return 0;
+}
+
+static FILE *create_recording(const char *path, uint64_t start_realtime_ns) {
+    struct srec_header hdr = { .start_realtime_ns = start_realtime_ns };
+    FILE *out = fopen(path, "wb");
+
+    if (!out) {
+        perror("Error creating recording");
+        return NULL;
+    }
+    memcpy(hdr.magic, SREC_MAGIC, sizeof(hdr.magic));
+    fwrite(&hdr, sizeof(hdr), 1, out);
+    return out;
+}
+
+static int convert_text(const char *textPath, const char *outPath) {
+    char line[512];
+    FILE *in = fopen(textPath, "r");
+    FILE *out;
+
+    if (!in) {
+        perror("Error opening text input");
+        return 1;
+    }
+    out = create_recording(outPath, clock_ns(CLOCK_REALTIME));
+    if (!out) {
+        fclose(in);
+        return 1;
+    }
+
+    while (fgets(line, sizeof(line), in)) {
+        char *tab = strchr(line, '\t');
+        if (line[0] == '#' || !tab) {
+            continue;
+        }
+        uint64_t t_ns = strtoull(line, NULL, 10) * 1000000ull;
+        write_chunk(out, t_ns, tab + 1, strlen(tab + 1));
+    }
+
+    fclose(in);
+    return fclose(out) == 0 ? 0 : 1;
+}
+
+static int open_forward_pty(void) {
+    struct termios tio;
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) {
+        perror("Error creating pty");
+        return -1;
+    }
+    // Raw on the slave side, so the controller sees the bytes unmodified
+    int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    if (slave >= 0) {
+        tcgetattr(slave, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(slave, TCSANOW, &tio);
+        close(slave);
+    }
+    fprintf(stderr, "Forwarding to %s\n", ptsname(master));
+    return master;
+}
+
+int main(int argc, char *argv[]) {
+    int baud = 115200, forward = 0, convert = 0, opt;
+
+    while ((opt = getopt(argc, argv, "b:pc")) != -1) {
+        switch (opt) {
+        case 'b':
+            baud = atoi(optarg);
+            if (baud_to_speed(baud) == B0) {
+                fprintf(stderr, "Error: unsupported baud rate %s (9600, 19200, 38400, 57600, 115200, 230400, "
+                                "460800 or 921600)\n", optarg);
+                return 1;
+            }
+            break;
+        case 'p':
+            forward = 1;
+            break;
+        case 'c':
+            convert = 1;
+            break;
+        default:
+            goto usage;
+        }
+    }
+    if (argc - optind != 2) {
+        goto usage;
+    }
+    if (convert) {
+        return convert_text(argv[optind], argv[optind + 1]);
+    }
+
+    int fd = open(argv[optind], O_RDONLY | O_NOCTTY);
+    if (fd < 0) {
+        perror("Error opening serial port");
+        return 1;
+    }
+    if (isatty(fd)) {
+        struct termios tio;
+        tcgetattr(fd, &tio);
+        cfmakeraw(&tio);
+        cfsetspeed(&tio, baud_to_speed(baud));
+        tio.c_cc[VMIN] = 1;
+        tio.c_cc[VTIME] = 0;
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+
+    int pty = forward ? open_forward_pty() : -1;
+    if (forward && pty < 0) {
+        return 1;
+    }
+
+    FILE *out = create_recording(argv[optind + 1], clock_ns(CLOCK_REALTIME));
+    if (!out) {
+        return 1;
+    }
+
+    struct sigaction sa = { .sa_handler = on_signal };
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    uint64_t start = clock_ns(CLOCK_MONOTONIC);
+    unsigned long long chunks = 0, bytes = 0;
+    char buf[4096];
+    while (!stop) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        if (write_chunk(out, clock_ns(CLOCK_MONOTONIC) - start, buf, n) < 0) {
+            break;
+        }
+        if (pty >= 0 && write(pty, buf, n) < 0) {
+            perror("Error forwarding to pty");
+        }
+        chunks++;
+        bytes += n;
+    }
+
+    fclose(out);
+    fprintf(stderr, "Recorded %llu bytes in %llu chunks\n", bytes, chunks);
+    return 0;
+
+usage:
+    fprintf(stderr, "Usage: %s [-b baud] [-p] <device> <recording>\n", argv[0]);
+    fprintf(stderr, "       %s -c <text> <recording>\n", argv[0]);
+    return 2;
+}
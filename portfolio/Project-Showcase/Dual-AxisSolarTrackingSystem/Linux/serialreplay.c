@@ -0,0 +1,359 @@
+// serialreplay - feed a serial recording into the controller.
+//
+//   serialreplay [-x speed] [-o trace] [-c controller] [-w idle-ms] [-s] [-v]
+//                <recording> [-- controller-args...]
+//
+// The controller is started on the slave side of a pseudo-terminal with its
+// motors replaced by the "trace" backend, and the recording is written to
+// the master side at the original pace (-x 1, the default), N times faster
+// (-x N) or as fast as the controller accepts it (-x 0). With -s the stub
+// takes as long as the real motors would, so moves block the controller.
+//
+// The command trace ("<frame> <command>", one line per motion command) goes
+// to -o or stdout and, with the controller's -q (every frame in order), is
+// deterministic for a given recording, so it can be diffed against a
+// known-good trace. Throughput and per-command latency
+// (frame fully written to the pty -> command issued) are reported on stderr.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "srec.h"
+
+#define MAX_ARGS 32
+
+struct replay {
+    int master;
+    int trace;             // Read end of the controller's trace pipe
+    FILE *out;
+
+    uint64_t *frame_tx;    // Time each frame's newline was accepted by the pty
+    size_t frames, frame_cap;
+
+    uint64_t *latency;     // Per command, in nanoseconds
+    size_t nlatency, latency_cap;
+    size_t commands;
+    uint64_t last_command;  // When the last trace line arrived
+
+    char pending[512];     // Partial trace line
+    size_t pending_len;
+};
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void *grow(void *p, size_t *cap, size_t elem) {
+    *cap = *cap ? *cap * 2 : 1024;
+    p = realloc(p, *cap * elem);
+    if (!p) {
+        perror("Error allocating memory");
+        exit(1);
+    }
+    return p;
+}
+
+static void handle_trace_line(struct replay *r, char *line) {
+    unsigned long long ts;
+    unsigned int frame;
+    int consumed = 0;
+
+    if (sscanf(line, "%llu %u %n", &ts, &frame, &consumed) < 2 || !consumed) {
+        return;
+    }
+    fprintf(r->out, "%u %s\n", frame, line + consumed);
+
+    if (frame < r->frames) {
+        if (r->nlatency == r->latency_cap) {
+            r->latency = grow(r->latency, &r->latency_cap, sizeof(*r->latency));
+        }
+        r->latency[r->nlatency++] = ts > r->frame_tx[frame] ? ts - r->frame_tx[frame] : 0;
+    }
+    r->commands++;
+    r->last_command = monotonic_ns();
+}
+
+// Consume whatever the controller has traced so far; 0 on EOF
+static int read_trace(struct replay *r) {
+    char buf[4096];
+    ssize_t n = read(r->trace, buf, sizeof(buf));
+
+    if (n <= 0) {
+        return n < 0 && errno == EAGAIN;
+    }
+    for (ssize_t i = 0; i < n; i++) {
+        if (buf[i] == '\n') {
+            r->pending[r->pending_len] = '\0';
+            handle_trace_line(r, r->pending);
+            r->pending_len = 0;
+        } else if (r->pending_len < sizeof(r->pending) - 1) {
+            r->pending[r->pending_len++] = buf[i];
+        }
+    }
+    return 1;
+}
+
+// Wait until `deadline` (or until the pty is writable if want_write),
+// servicing the trace pipe meanwhile
+static void wait_until(struct replay *r, uint64_t deadline, int want_write) {
+    for (;;) {
+        struct pollfd fds[2] = {
+            { .fd = r->trace, .events = POLLIN },
+            { .fd = r->master, .events = want_write ? POLLOUT : 0 },
+        };
+        uint64_t now = monotonic_ns();
+        int timeout = -1;
+
+        if (!want_write) {
+            if (now >= deadline) {
+                return;
+            }
+            timeout = (deadline - now + 999999) / 1000000;
+        }
+        if (poll(fds, 2, timeout) < 0 && errno != EINTR) {
+            return;
+        }
+        if (fds[0].revents & (POLLIN | POLLHUP)) {
+            read_trace(r);
+        }
+        if (want_write && (fds[1].revents & (POLLOUT | POLLERR | POLLHUP))) {
+            return;
+        }
+    }
+}
+
+static void send_chunk(struct replay *r, const uint8_t *data, uint32_t len) {
+    while (len) {
+        // A frame counts as sent when the write carrying its newline starts
+        uint64_t now = monotonic_ns();
+        ssize_t n = write(r->master, data, len);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                wait_until(r, 0, 1);
+                continue;
+            }
+            perror("Error writing to pty");
+            return;
+        }
+
+        for (ssize_t i = 0; i < n; i++) {
+            if (data[i] == '\n') {
+                if (r->frames == r->frame_cap) {
+                    r->frame_tx = grow(r->frame_tx, &r->frame_cap, sizeof(*r->frame_tx));
+                }
+                r->frame_tx[r->frames++] = now;
+            }
+        }
+        data += n;
+        len -= n;
+    }
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile_us(const uint64_t *sorted, size_t n, double p) {
+    size_t i = (size_t)(p * (n - 1) + 0.5);
+    return sorted[i] / 1000.0;
+}
+
+static pid_t start_controller(const char *controller, const char *slave, int trace_fd, int simulate,
+                              char **extra, int nextra, int verbose) {
+    char traceSpec[64];
+    char *args[MAX_ARGS + 8];
+    int argc = 0;
+    pid_t pid;
+
+    snprintf(traceSpec, sizeof(traceSpec), "trace:/dev/fd/%d%s", trace_fd, simulate ? ",sim" : "");
+    args[argc++] = (char *)controller;
+    args[argc++] = "-s";
+    args[argc++] = (char *)slave;
+    args[argc++] = "-m";
+    args[argc++] = traceSpec;
+    args[argc++] = "-n";
+    for (int i = 0; i < nextra && i < MAX_ARGS; i++) {
+        args[argc++] = extra[i];
+    }
+    args[argc] = NULL;
+
+    pid = fork();
+    if (pid == 0) {
+        if (!verbose) {
+            int devnull = open("/dev/null", O_WRONLY);
+            dup2(devnull, STDOUT_FILENO);
+        }
+        execvp(controller, args);
+        perror("Error starting controller");
+        _exit(127);
+    }
+    return pid;
+}
+
+int main(int argc, char *argv[]) {
+    const char *controller = "./controller";
+    const char *tracePath = NULL;
+    double speed = 1.0;
+    int idleMs = 1000, simulate = 0, verbose = 0, opt;
+
+    while ((opt = getopt(argc, argv, "x:o:c:w:sv")) != -1) {
+        switch (opt) {
+        case 'x':
+            speed = atof(optarg);
+            break;
+        case 'o':
+            tracePath = optarg;
+            break;
+        case 'c':
+            controller = optarg;
+            break;
+        case 'w':
+            idleMs = atoi(optarg);
+            break;
+        case 's':
+            simulate = 1;
+            break;
+        case 'v':
+            verbose = 1;
+            break;
+        default:
+            goto usage;
+        }
+    }
+    if (optind >= argc) {
+        goto usage;
+    }
+
+    // Load the whole recording; they are small compared to RAM
+    int fd = open(argv[optind], O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        perror("Error opening recording");
+        return 1;
+    }
+    const uint8_t *rec = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (rec == MAP_FAILED || st.st_size < (off_t)sizeof(struct srec_header) ||
+        memcmp(rec, SREC_MAGIC, 8) != 0) {
+        fprintf(stderr, "Error: %s is not a serial recording\n", argv[optind]);
+        return 1;
+    }
+
+    struct replay r = { .out = stdout };
+    if (tracePath) {
+        r.out = fopen(tracePath, "w");
+        if (!r.out) {
+            perror("Error opening trace output");
+            return 1;
+        }
+    }
+
+    // Pseudo-terminal standing in for /dev/ttyS0
+    r.master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (r.master < 0 || grantpt(r.master) < 0 || unlockpt(r.master) < 0) {
+        perror("Error creating pty");
+        return 1;
+    }
+    const char *slave = ptsname(r.master);
+    int slaveFd = open(slave, O_RDWR | O_NOCTTY);
+    struct termios tio;
+    tcgetattr(slaveFd, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slaveFd, TCSANOW, &tio);
+    fcntl(r.master, F_SETFL, O_NONBLOCK);
+
+    int pipefd[2];
+    if (pipe(pipefd) < 0) {
+        perror("Error creating trace pipe");
+        return 1;
+    }
+    fcntl(pipefd[0], F_SETFD, FD_CLOEXEC);
+    r.trace = pipefd[0];
+    fcntl(r.trace, F_SETFL, O_NONBLOCK);
+
+    char **extra = argv + optind + 1;
+    int nextra = argc - optind - 1;
+    pid_t pid = start_controller(controller, slave, pipefd[1], simulate, extra, nextra, verbose);
+    close(pipefd[1]);
+    if (pid < 0) {
+        perror("Error forking controller");
+        return 1;
+    }
+    // Keep our slave fd open until the end so the pty is not hung up early
+    signal(SIGPIPE, SIG_IGN);
+
+    // Replay
+    uint64_t start = monotonic_ns();
+    size_t off = sizeof(struct srec_header);
+    unsigned long long bytes = 0;
+    while (off + sizeof(struct srec_chunk) <= (size_t)st.st_size) {
+        const struct srec_chunk *chunk = (const void *)(rec + off);
+        off += sizeof(*chunk);
+        if (off + chunk->len > (size_t)st.st_size) {
+            break;
+        }
+        if (speed > 0) {
+            wait_until(&r, start + (uint64_t)(chunk->t_ns / speed), 0);
+        }
+        send_chunk(&r, rec + off, chunk->len);
+        off += chunk->len;
+        bytes += chunk->len;
+    }
+    uint64_t sent = monotonic_ns();
+
+    // Let the controller work through its backlog, then hang up the line
+    uint64_t seen;
+    do {
+        seen = r.commands;
+        wait_until(&r, monotonic_ns() + (uint64_t)idleMs * 1000000ull, 0);
+    } while (r.commands != seen);
+
+    close(slaveFd);
+    close(r.master);
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    while (read_trace(&r) > 0) {
+    }
+    if (r.out != stdout) {
+        fclose(r.out);
+    }
+
+    // Report; the trailing idle wait is not counted as controller time
+    uint64_t done = r.last_command > sent ? r.last_command : sent;
+    double sendSecs = (sent - start) / 1e9;
+    double busySecs = (done - start) / 1e9;
+    fprintf(stderr, "frames %zu bytes %llu commands %zu\n", r.frames, bytes, r.commands);
+    fprintf(stderr, "replay %.3f s, controller %.3f s, %.1f frames/s, %.1f commands/s\n", sendSecs, busySecs,
+            busySecs > 0 ? r.frames / busySecs : 0.0, busySecs > 0 ? r.commands / busySecs : 0.0);
+    size_t nlat = r.nlatency;
+    if (nlat) {
+        qsort(r.latency, nlat, sizeof(*r.latency), cmp_u64);
+        fprintf(stderr, "latency us: min %.0f p50 %.0f p90 %.0f p99 %.0f max %.0f\n", r.latency[0] / 1000.0,
+                percentile_us(r.latency, nlat, 0.50), percentile_us(r.latency, nlat, 0.90),
+                percentile_us(r.latency, nlat, 0.99), r.latency[nlat - 1] / 1000.0);
+    }
+
+    free(r.frame_tx);
+    free(r.latency);
+    munmap((void *)rec, st.st_size);
+    return 0;
+
+usage:
+    fprintf(stderr, "Usage: %s [-x speed] [-o trace] [-c controller] [-w idle-ms] [-s] [-v] <recording> [-- args]\n",
+            argv[0]);
+    return 2;
+}
@@ -0,0 +1,114 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+// Tracepoints for the Servo-Stepper driver (plat_drv).
+//
+//   trace-cmd record -e plat_drv <workload>
+//   perf record -e 'plat_drv:*' -a <workload>
+//
+// Times in the events are CLOCK_MONOTONIC nanoseconds; late_ns is how long
+// after its programmed expiry the hrtimer that produced the edge ran.
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM plat_drv
+
+#if !defined(_SERVO_STEPPER_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _SERVO_STEPPER_TRACE_H
+
+#include <linux/tracepoint.h>
+
+// A command was accepted by write(); depth counts it and everything ahead of
+// it on the same axis, including the move in progress
+TRACE_EVENT(plat_drv_command,
+    TP_PROTO(int tracker, int axis, int value, unsigned int trace, unsigned int depth),
+    TP_ARGS(tracker, axis, value, trace, depth),
+    TP_STRUCT__entry(
+        __field(int, tracker)
+        __field(int, axis)
+        __field(int, value)
+        __field(unsigned int, trace)
+        __field(unsigned int, depth)
+    ),
+    TP_fast_assign(
+        __entry->tracker = tracker;
+        __entry->axis = axis;
+        __entry->value = value;
+        __entry->trace = trace;
+        __entry->depth = depth;
+    ),
+    TP_printk("tracker=%d axis=%s value=%d trace=%u depth=%u", __entry->tracker,
+              __entry->axis ? "stepper" : "servo", __entry->value, __entry->trace, __entry->depth)
+);
+
+// One stepper phase change; phase holds the four coil levels, coil 1 first
+TRACE_EVENT(plat_drv_step,
+    TP_PROTO(int tracker, unsigned int index, unsigned int phase, s64 late_ns, unsigned int trace),
+    TP_ARGS(tracker, index, phase, late_ns, trace),
+    TP_STRUCT__entry(
+        __field(int, tracker)
+        __field(unsigned int, index)
+        __field(unsigned int, phase)
+        __field(s64, late_ns)
+        __field(unsigned int, trace)
+    ),
+    TP_fast_assign(
+        __entry->tracker = tracker;
+        __entry->index = index;
+        __entry->phase = phase;
+        __entry->late_ns = late_ns;
+        __entry->trace = trace;
+    ),
+    TP_printk("tracker=%d step=%u phase=%u%u%u%u late_ns=%lld trace=%u", __entry->tracker, __entry->index,
+              (__entry->phase >> 3) & 1, (__entry->phase >> 2) & 1, (__entry->phase >> 1) & 1,
+              __entry->phase & 1, __entry->late_ns, __entry->trace)
+);
+
+// One servo PWM period finished; width and period are as actually emitted
+TRACE_EVENT(plat_drv_pwm_period,
+    TP_PROTO(int tracker, int angle, u32 width_ns, u32 period_ns, s64 late_ns),
+    TP_ARGS(tracker, angle, width_ns, period_ns, late_ns),
+    TP_STRUCT__entry(
+        __field(int, tracker)
+        __field(int, angle)
+        __field(u32, width_ns)
+        __field(u32, period_ns)
+        __field(s64, late_ns)
+    ),
+    TP_fast_assign(
+        __entry->tracker = tracker;
+        __entry->angle = angle;
+        __entry->width_ns = width_ns;
+        __entry->period_ns = period_ns;
+        __entry->late_ns = late_ns;
+    ),
+    TP_printk("tracker=%d angle=%d width_ns=%u period_ns=%u late_ns=%lld", __entry->tracker, __entry->angle,
+              __entry->width_ns, __entry->period_ns, __entry->late_ns)
+);
+
+// A command finished; duration runs from its first edge to the end
+TRACE_EVENT(plat_drv_move_done,
+    TP_PROTO(int tracker, int axis, int value, unsigned int trace, u64 duration_ns),
+    TP_ARGS(tracker, axis, value, trace, duration_ns),
+    TP_STRUCT__entry(
+        __field(int, tracker)
+        __field(int, axis)
+        __field(int, value)
+        __field(unsigned int, trace)
+        __field(u64, duration_ns)
+    ),
+    TP_fast_assign(
+        __entry->tracker = tracker;
+        __entry->axis = axis;
+        __entry->value = value;
+        __entry->trace = trace;
+        __entry->duration_ns = duration_ns;
+    ),
+    TP_printk("tracker=%d axis=%s value=%d trace=%u duration_ns=%llu", __entry->tracker,
+              __entry->axis ? "stepper" : "servo", __entry->value, __entry->trace, __entry->duration_ns)
+);
+
+#endif
+
+// The header lives next to the driver, not in include/trace/events
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE servo_stepper_trace
+#include <trace/define_trace.h>
@@ -0,0 +1,132 @@
+#include "spsc.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+int spsc_init(struct spsc_ring *r, size_t slots, size_t elem) {
+    memset(r, 0, sizeof(*r));
+    r->efd = -1;
+    if (!slots || (slots & (slots - 1))) {
+        errno = EINVAL;
+        return -1;
+    }
+    r->mask = slots - 1;
+    r->elem = elem;
+    r->seq = calloc(slots, sizeof(*r->seq));
+    r->data = calloc(slots, elem);
+    r->efd = eventfd(0, EFD_CLOEXEC);
+    if (!r->seq || !r->data || r->efd < 0) {
+        spsc_free(r);
+        return -1;
+    }
+    return 0;
+}
+
+void spsc_free(struct spsc_ring *r) {
+    free(r->seq);
+    free(r->data);
+    if (r->efd >= 0) {
+        close(r->efd);
+    }
+    r->seq = NULL;
+    r->data = NULL;
+    r->efd = -1;
+}
+
+static void kick(struct spsc_ring *r) {
+    uint64_t one = 1;
+    ssize_t n = write(r->efd, &one, sizeof(one));
+    (void)n; // Only fails if the counter is saturated, which still wakes
+}
+
+void spsc_push(struct spsc_ring *r, const void *item) {
+    uint64_t i = r->head;
+    size_t slot = i & r->mask;
+
+    __atomic_store_n(&r->seq[slot], 2 * i + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(r->data + slot * r->elem, item, r->elem);
+    __atomic_store_n(&r->seq[slot], 2 * i + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&r->head, i + 1, __ATOMIC_RELEASE);
+    kick(r);
+}
+
+void spsc_close(struct spsc_ring *r) {
+    __atomic_store_n(&r->closed, 1, __ATOMIC_RELEASE);
+    kick(r);
+}
+
+// Copy item `i`; 0 if the producer has overwritten it meanwhile
+static int read_slot(struct spsc_ring *r, uint64_t i, void *item) {
+    size_t slot = i & r->mask;
+    uint64_t before = __atomic_load_n(&r->seq[slot], __ATOMIC_ACQUIRE);
+
+    if (before != 2 * i + 2) {
+        return 0;
+    }
+    memcpy(item, r->data + slot * r->elem, r->elem);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&r->seq[slot], __ATOMIC_RELAXED) == before;
+}
+
+// Skip to `i`, counting what was lost on the way
+static void skip_to(struct spsc_ring *r, uint64_t i, uint64_t head) {
+    uint64_t oldest = head > r->mask + 1 ? head - (r->mask + 1) : 0;
+
+    if (r->tail < oldest) {
+        r->dropped += oldest - r->tail;
+        r->tail = oldest;
+    }
+    if (i > r->tail) {
+        r->stale += i - r->tail;
+        r->tail = i;
+    }
+}
+
+int spsc_take_newest(struct spsc_ring *r, void *item) {
+    for (;;) {
+        uint64_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        if (head == r->tail) {
+            return 0;
+        }
+        skip_to(r, head - 1, head);
+        if (read_slot(r, head - 1, item)) {
+            r->tail = head;
+            r->taken++;
+            return 1;
+        }
+    }
+}
+
+int spsc_take_oldest(struct spsc_ring *r, void *item) {
+    for (;;) {
+        uint64_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        if (head == r->tail) {
+            return 0;
+        }
+        skip_to(r, r->tail, head);
+        if (read_slot(r, r->tail, item)) {
+            r->tail++;
+            r->taken++;
+            return 1;
+        }
+    }
+}
+
+int spsc_wait(struct spsc_ring *r) {
+    uint64_t count;
+
+    while (__atomic_load_n(&r->head, __ATOMIC_ACQUIRE) == r->tail) {
+        if (__atomic_load_n(&r->closed, __ATOMIC_ACQUIRE)) {
+            // A push may have raced with the close
+            return __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) != r->tail;
+        }
+        if (read(r->efd, &count, sizeof(count)) < 0 && errno != EINTR) {
+            return 0;
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,44 @@
+#ifndef SPSC_H
+#define SPSC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bounded single-producer/single-consumer ring of fixed-size items that
+// never blocks the producer: when the ring is full, the oldest unread item
+// is overwritten. Each slot is a small seqlock (odd while being written, 2 *
+// (index + 1) once it holds item `index`), so the consumer can detect that a
+// slot it is copying was overwritten under it and retry with a newer item.
+//
+// The consumer either takes the newest item, counting everything it skips
+// as stale, or takes items in order. Items overwritten before the consumer
+// got to them are counted as dropped. An eventfd wakes a waiting consumer.
+struct spsc_ring {
+    uint64_t head;            // Items pushed so far; written by the producer only
+    uint64_t tail;            // Next item to read; consumer only
+    size_t mask, elem;
+    uint64_t *seq;            // Per slot
+    unsigned char *data;      // slots * elem bytes
+    int efd;
+    int closed;
+
+    // Consumer-side statistics
+    uint64_t taken, stale, dropped;
+};
+
+// `slots` must be a power of two
+int spsc_init(struct spsc_ring *r, size_t slots, size_t elem);
+void spsc_free(struct spsc_ring *r);
+
+// Producer
+void spsc_push(struct spsc_ring *r, const void *item);
+void spsc_close(struct spsc_ring *r);
+
+// Consumer; both return 1 with an item copied to `item`, or 0 if empty
+int spsc_take_newest(struct spsc_ring *r, void *item);
+int spsc_take_oldest(struct spsc_ring *r, void *item);
+
+// Block until something was pushed; 0 once the ring is closed and drained
+int spsc_wait(struct spsc_ring *r);
+
+#endif
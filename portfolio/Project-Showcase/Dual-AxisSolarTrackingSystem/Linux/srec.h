@@ -0,0 +1,31 @@
+#ifndef SREC_H
+#define SREC_H
+
+#include <stdint.h>
+
+// Serial recording format shared by serialrec and serialreplay.
+//
+// A file is a header followed by chunks, one per read() from the port:
+//
+//   struct srec_header
+//   struct srec_chunk, <len> raw bytes
+//   struct srec_chunk, <len> raw bytes
+//   ...
+//
+// Chunk times are CLOCK_MONOTONIC nanoseconds since the recording started,
+// so replays keep the original inter-arrival timing and burstiness.
+
+#define SREC_MAGIC "SREC0001"
+
+struct srec_header {
+    char magic[8];
+    uint64_t start_realtime_ns; // Wall-clock time of the first chunk
+};
+
+struct srec_chunk {
+    uint64_t t_ns;
+    uint32_t len;
+    uint32_t reserved;
+};
+
+#endif
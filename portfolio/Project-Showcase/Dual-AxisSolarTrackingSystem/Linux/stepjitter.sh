@@ -0,0 +1,65 @@
+#!/bin/sh
+# stepjitter.sh - measure stepper step-timing jitter from the plat_drv tracepoints.
+#
+#   stepjitter.sh [-t tracker] [-n steps] [-l "load command"]
+#
+# Clears the driver's debugfs statistics, records plat_drv:plat_drv_step
+# through tracefs while one long move runs (optionally with a load generator
+# such as "stress-ng --cpu 4" alongside), then reports the spread of the
+# intervals between consecutive step edges (nominally 2 ms) and the driver's
+# own timer lateness histogram. Needs root, tracefs and debugfs.
+set -e
+
+TRACKER=0
+STEPS=2000
+LOAD=
+while getopts "t:n:l:" opt; do
+    case $opt in
+    t) TRACKER=$OPTARG ;;
+    n) STEPS=$OPTARG ;;
+    l) LOAD=$OPTARG ;;
+    *) echo "Usage: $0 [-t tracker] [-n steps] [-l \"load command\"]" >&2; exit 2 ;;
+    esac
+done
+DEV=/dev/plat_drv$((TRACKER * 2 + 1))
+
+TRACEFS=/sys/kernel/tracing
+[ -d $TRACEFS/events ] || TRACEFS=/sys/kernel/debug/tracing
+DEBUGFS=/sys/kernel/debug/plat_drv/tracker$TRACKER/stepper
+EVENT=$TRACEFS/events/plat_drv/plat_drv_step
+OUT=$(mktemp)
+trap 'echo 0 > $EVENT/enable; echo 0 > $EVENT/filter; rm -f $OUT; [ -n "$LOADPID" ] && kill $LOADPID 2>/dev/null' EXIT
+
+if [ -n "$LOAD" ]; then
+    $LOAD > /dev/null 2>&1 &
+    LOADPID=$!
+    sleep 1
+fi
+
+echo 1 > $DEBUGFS/reset
+echo > $TRACEFS/trace
+echo mono > $TRACEFS/trace_clock
+echo "tracker == $TRACKER" > $EVENT/filter
+echo 1 > $EVENT/enable
+echo "forward $STEPS" > $DEV   # Blocks until the move is done
+echo 0 > $EVENT/enable
+cp $TRACEFS/trace $OUT
+
+# Interval between consecutive edges, in microseconds
+awk '/plat_drv_step:/ {
+        for (i = 1; i <= NF; i++) if ($i ~ /^[0-9]+\.[0-9]+:$/) { t = substr($i, 1, length($i) - 1) * 1e6; break }
+        if (n++) printf "%.1f\n", t - last
+        last = t
+    }' $OUT | sort -n | awk '
+    { v[NR] = $1; sum += $1; sq += $1 * $1 }
+    END {
+        if (NR == 0) { print "no step events recorded"; exit 1 }
+        mean = sum / NR
+        printf "intervals %d  mean %.1f us  stddev %.1f us\n", NR, mean, sqrt(sq / NR - mean * mean)
+        printf "min %.1f  p50 %.1f  p99 %.1f  p99.9 %.1f  max %.1f us\n", v[1], v[int(NR * 0.5) + 1],
+               v[int(NR * 0.99) + 1], v[int(NR * 0.999) + 1], v[NR]
+    }'
+
+echo
+echo "driver timer lateness:"
+cat $DEBUGFS/lateness
@@ -0,0 +1,364 @@
+// telemcollect - receive tracker telemetry datagrams from a whole field.
+//
+//   telemcollect [-g group] [-p port] [-i iface-addr] [-n ring] [-r report-s]
+//                [-T seconds] [-I idle-ms] [-v]
+//
+// Joins the multicast group (default 239.255.42.1:5005, see telemetry.h)
+// and reads datagrams in batches with recvmmsg(). Each datagram is filed
+// under its device id: the newest -n samples (default 64) are kept in a
+// ring per device, and per device the collector counts
+//
+//   rx         datagrams accepted
+//   lost       sequence numbers never seen
+//   reordered  datagrams that arrived after a later one (not counted lost)
+//   dup        sequence numbers seen twice, or arriving 64 or more behind
+//              the newest, where a late one cannot be told from a repeat;
+//              neither is taken off lost
+//   reboots    sequence restarted together with the uptime
+//
+// Every -r seconds (default 10) and on exit a report goes to stdout: one
+// total line, then a line per device that lost or reordered anything (per
+// device with -v, including its newest sample). A -g address that is not
+// multicast is simply the address to bind, which is how test/telemetry
+// runs on loopback without multicast routing.
+//
+// Exits after -T seconds, once no datagram has arrived for -I ms after the
+// first one, or on SIGINT/SIGTERM.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <endian.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "telemetry.h"
+
+#define BATCH 64
+#define WINDOW 64           // Sequence numbers behind the newest that can still be placed
+#define POLL_MS 100
+
+struct device {
+    uint32_t id;
+    int used;
+    uint32_t top;           // Highest sequence number seen
+    uint64_t seen;          // Bit n: top - n has arrived
+    uint32_t last_uptime_ms;
+    uint64_t rx, lost, reordered, dup, reboots;
+    struct telem_v1 *ring;
+    uint32_t ring_head;     // Samples stored so far; newest at (head - 1) % ring_len
+};
+
+static struct device *table;
+static size_t table_cap, ndevices;
+static uint32_t ring_len = 64;
+static uint64_t bad_datagrams;
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static size_t slot_of(uint32_t id, size_t cap) {
+    return (id * 2654435761u) & (cap - 1);
+}
+
+// Open addressing, kept under 70% full
+static struct device *device_for(uint32_t id) {
+    if ((ndevices + 1) * 10 > table_cap * 7) {
+        size_t cap = table_cap ? table_cap * 2 : 1024;
+        struct device *grown = calloc(cap, sizeof(*grown));
+        if (!grown) {
+            perror("Error allocating memory");
+            exit(1);
+        }
+        for (size_t i = 0; i < table_cap; i++) {
+            if (table[i].used) {
+                size_t s = slot_of(table[i].id, cap);
+                while (grown[s].used) {
+                    s = (s + 1) & (cap - 1);
+                }
+                grown[s] = table[i];
+            }
+        }
+        free(table);
+        table = grown;
+        table_cap = cap;
+    }
+
+    size_t s = slot_of(id, table_cap);
+    while (table[s].used && table[s].id != id) {
+        s = (s + 1) & (table_cap - 1);
+    }
+    struct device *d = &table[s];
+    if (!d->used) {
+        d->used = 1;
+        d->id = id;
+        d->ring = calloc(ring_len, sizeof(*d->ring));
+        if (!d->ring) {
+            perror("Error allocating memory");
+            exit(1);
+        }
+        ndevices++;
+    }
+    return d;
+}
+
+static void account(struct device *d, uint32_t seq, uint32_t uptime_ms) {
+    // A restart begins a new sequence with a small uptime; a late datagram
+    // is older in both and does not
+    int restarted = d->rx && seq < WINDOW && seq < d->top && uptime_ms + 1000 < d->last_uptime_ms;
+    if (restarted) {
+        d->reboots++;
+    }
+    if (!d->rx || restarted) {
+        d->top = seq;
+        d->seen = 1;
+        d->last_uptime_ms = uptime_ms;
+    } else if (seq > d->top) {
+        uint32_t gap = seq - d->top;
+        d->lost += gap - 1;
+        d->seen = gap < 64 ? (d->seen << gap) | 1 : 1;
+        d->top = seq;
+        d->last_uptime_ms = uptime_ms;
+    } else {
+        uint32_t behind = d->top - seq;
+        // Past the window a duplicate cannot be told from a late datagram;
+        // either way it stays counted as lost
+        if (behind >= WINDOW || (d->seen & (1ull << behind))) {
+            d->dup++;
+            return;
+        }
+        d->seen |= 1ull << behind;
+        d->reordered++;
+        if (d->lost) {
+            d->lost--; // Counted as lost when the later one came in
+        }
+    }
+    d->rx++;
+}
+
+static void receive(const uint8_t *buf, size_t len) {
+    struct telem_v1 t;
+
+    if (len < sizeof(t)) {
+        bad_datagrams++;
+        return;
+    }
+    memcpy(&t, buf, sizeof(t));
+    if (le16toh(t.magic) != TELEM_MAGIC || t.version < TELEM_VERSION) {
+        bad_datagrams++;
+        return;
+    }
+    t.device = le32toh(t.device);
+    t.seq = le32toh(t.seq);
+    t.uptime_ms = le32toh(t.uptime_ms);
+    t.temp_centi = (int16_t)le16toh(t.temp_centi);
+    t.humidity_centi = le16toh(t.humidity_centi);
+    for (int i = 0; i < TELEM_MAX_LIGHT; i++) {
+        t.light[i] = le16toh(t.light[i]);
+    }
+
+    struct device *d = device_for(t.device);
+    account(d, t.seq, t.uptime_ms);
+    d->ring[d->ring_head++ % ring_len] = t;
+}
+
+static int by_id(const void *a, const void *b) {
+    const struct device *x = *(const struct device *const *)a, *y = *(const struct device *const *)b;
+    return x->id < y->id ? -1 : x->id > y->id;
+}
+
+static void report(int verbose) {
+    uint64_t rx = 0, lost = 0, reordered = 0, dup = 0, reboots = 0;
+    struct device **list = malloc((ndevices ? ndevices : 1) * sizeof(*list));
+    size_t n = 0;
+
+    if (!list) {
+        perror("Error allocating memory");
+        exit(1);
+    }
+    for (size_t i = 0; i < table_cap; i++) {
+        struct device *d = &table[i];
+        if (!d->used) {
+            continue;
+        }
+        rx += d->rx;
+        lost += d->lost;
+        reordered += d->reordered;
+        dup += d->dup;
+        reboots += d->reboots;
+        list[n++] = d;
+    }
+    qsort(list, n, sizeof(*list), by_id);
+
+    printf("total devices %zu rx %llu lost %llu reordered %llu dup %llu reboots %llu bad %llu\n", ndevices,
+           (unsigned long long)rx, (unsigned long long)lost, (unsigned long long)reordered, (unsigned long long)dup,
+           (unsigned long long)reboots, (unsigned long long)bad_datagrams);
+    for (size_t i = 0; i < n; i++) {
+        struct device *d = list[i];
+        if (!verbose && !d->lost && !d->reordered && !d->dup) {
+            continue;
+        }
+        printf("device %08x rx %llu lost %llu reordered %llu dup %llu reboots %llu", d->id,
+               (unsigned long long)d->rx, (unsigned long long)d->lost, (unsigned long long)d->reordered,
+               (unsigned long long)d->dup, (unsigned long long)d->reboots);
+        if (verbose && d->ring_head) {
+            const struct telem_v1 *t = &d->ring[(d->ring_head - 1) % ring_len];
+            printf(" seq %u up %u ms", t->seq, t->uptime_ms);
+            if (t->temp_centi != TELEM_NO_TEMP) {
+                printf(" temp %.2f", t->temp_centi / 100.0);
+            }
+            if (t->humidity_centi != TELEM_NO_HUMIDITY) {
+                printf(" hum %.2f", t->humidity_centi / 100.0);
+            }
+            printf(" dir %u rssi %d", t->direction, t->rssi);
+        }
+        putchar('\n');
+    }
+    fflush(stdout);
+    free(list);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr,
+            "Usage: %s [-g group] [-p port] [-i iface-addr] [-n ring] [-r report-s] [-T seconds] [-I idle-ms] "
+            "[-v]\n",
+            name);
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    const char *group = TELEM_GROUP, *iface = NULL;
+    int port = TELEM_PORT, report_s = 10, verbose = 0, opt;
+    double run_s = 0;
+    long idle_ms = 0;
+
+    while ((opt = getopt(argc, argv, "g:p:i:n:r:T:I:v")) != -1) {
+        switch (opt) {
+        case 'g':
+            group = optarg;
+            break;
+        case 'p':
+            port = atoi(optarg);
+            break;
+        case 'i':
+            iface = optarg;
+            break;
+        case 'n':
+            ring_len = (uint32_t)atoi(optarg);
+            break;
+        case 'r':
+            report_s = atoi(optarg);
+            break;
+        case 'T':
+            run_s = atof(optarg);
+            break;
+        case 'I':
+            idle_ms = atol(optarg);
+            break;
+        case 'v':
+            verbose = 1;
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (optind != argc || ring_len == 0) {
+        usage(argv[0]);
+    }
+
+    struct in_addr group_addr;
+    if (inet_pton(AF_INET, group, &group_addr) != 1) {
+        fprintf(stderr, "Error: bad group address %s\n", group);
+        return 1;
+    }
+    int multicast = IN_MULTICAST(ntohl(group_addr.s_addr));
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        perror("Error creating socket");
+        return 1;
+    }
+    int one = 1, rcvbuf = 4 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    struct timeval tv = {0, POLL_MS * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr = group_addr; // Binding the group filters out other groups on the port
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("Error binding socket");
+        return 1;
+    }
+    if (multicast) {
+        struct ip_mreq mreq;
+        mreq.imr_multiaddr = group_addr;
+        mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (iface && inet_pton(AF_INET, iface, &mreq.imr_interface) != 1) {
+            fprintf(stderr, "Error: bad interface address %s\n", iface);
+            return 1;
+        }
+        if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+            perror("Error joining multicast group");
+            return 1;
+        }
+    }
+
+    struct sigaction sa = {0};
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    static uint8_t bufs[BATCH][512];
+    struct iovec iov[BATCH];
+    struct mmsghdr msgs[BATCH];
+    for (int i = 0; i < BATCH; i++) {
+        iov[i].iov_base = bufs[i];
+        iov[i].iov_len = sizeof(bufs[i]);
+        memset(&msgs[i], 0, sizeof(msgs[i]));
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    uint64_t start = now_ns(), next_report = start + (uint64_t)report_s * 1000000000ull, last_rx = 0;
+    while (!stop) {
+        int n = recvmmsg(fd, msgs, BATCH, MSG_WAITFORONE, NULL);
+        uint64_t now = now_ns();
+        if (n > 0) {
+            for (int i = 0; i < n; i++) {
+                receive(bufs[i], msgs[i].msg_len);
+            }
+            last_rx = now;
+        }
+        if (run_s > 0 && now - start >= (uint64_t)(run_s * 1e9)) {
+            break;
+        }
+        if (idle_ms > 0 && last_rx && now - last_rx >= (uint64_t)idle_ms * 1000000ull) {
+            break;
+        }
+        if (report_s > 0 && now >= next_report) {
+            report(verbose);
+            next_report += (uint64_t)report_s * 1000000000ull;
+        }
+    }
+
+    report(verbose);
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,40 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+
+// Telemetry datagram multicast by every tracker, one per sample snapshot,
+// received by telemcollect and produced by telemgen. The ESP32 side is
+// Esp32/include/Telemetry.h; the two layouts must stay identical.
+//
+// All fields are little-endian. Receivers ignore datagrams with another
+// magic, a newer version they do not know, or a length below the size of
+// the version they decode; newer versions only ever append fields.
+
+#define TELEM_MAGIC 0x5354  // "TS"
+#define TELEM_VERSION 1
+#define TELEM_GROUP "239.255.42.1"
+#define TELEM_PORT 5005
+#define TELEM_MAX_LIGHT 8
+
+#define TELEM_NO_TEMP INT16_MIN
+#define TELEM_NO_HUMIDITY UINT16_MAX
+
+struct telem_v1 {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t nlight;          // Entries of light[] in use
+    uint32_t device;         // Last four bytes of the factory MAC
+    uint32_t seq;            // Per device, from 0 at boot
+    uint32_t uptime_ms;
+    int16_t temp_centi;      // 0.01 degC, TELEM_NO_TEMP without a sensor
+    uint16_t humidity_centi; // 0.01 %RH, TELEM_NO_HUMIDITY without a sensor
+    uint16_t light[TELEM_MAX_LIGHT]; // Raw 12-bit ADC readings
+    uint8_t direction;       // Index into light[] of the brightest sensor
+    int8_t rssi;             // dBm
+    uint16_t reserved;
+} __attribute__((packed));
+
+_Static_assert(sizeof(struct telem_v1) == 40, "telemetry datagram layout");
+
+#endif
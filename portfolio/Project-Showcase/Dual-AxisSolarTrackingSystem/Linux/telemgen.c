@@ -0,0 +1,249 @@
+// telemgen - simulate a field of trackers sending telemetry.
+//
+//   telemgen [-g group] [-p port] [-n devices] [-r rate-hz] [-T seconds]
+//            [-l loss-%] [-x reorder-%] [-s seed] [-t ttl]
+//
+// Every simulated device sends the datagram of telemetry.h at -r Hz
+// (default 1) to the group (default 239.255.42.1:5005) for -T seconds
+// (default 5), with a sweeping sun, slow temperature drift and its own
+// phase so the field is spread over the period. Datagrams go out with
+// sendmmsg(), paced every millisecond.
+//
+// -l drops that share of datagrams without sending them and -x swaps that
+// share with the next datagram of the same device, so telemcollect's
+// loss and reorder accounting can be checked: the totals it should report
+// are printed to stderr at the end,
+//
+//   sent <n> dropped <n> reordered <n>
+//
+// A device's first and last datagrams are sent as they are: a collector
+// cannot tell a lost first datagram from a device it started listening to
+// late, nor a lost last one from one still on its way.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <endian.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "telemetry.h"
+
+#define BATCH 64
+#define TICK_NS 1000000ull
+
+struct sim {
+    uint32_t seq;
+    uint64_t next_ns;       // Due time of the next datagram, from start
+    int held;               // A datagram waits to go out after the next one
+    struct telem_v1 pending;
+};
+
+static int fd;
+static struct sockaddr_in dest;
+static struct telem_v1 out[BATCH];
+static int nout;
+static uint64_t sent, dropped, reordered;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void flush(void) {
+    struct iovec iov[BATCH];
+    struct mmsghdr msgs[BATCH];
+    int done = 0;
+
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < nout; i++) {
+        iov[i].iov_base = &out[i];
+        iov[i].iov_len = sizeof(out[i]);
+        msgs[i].msg_hdr.msg_name = &dest;
+        msgs[i].msg_hdr.msg_namelen = sizeof(dest);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    while (done < nout) {
+        int n = sendmmsg(fd, msgs + done, nout - done, 0);
+        if (n < 0) {
+            perror("Error sending telemetry");
+            exit(1);
+        }
+        done += n;
+    }
+    sent += nout;
+    nout = 0;
+}
+
+static void send_one(const struct telem_v1 *t) {
+    out[nout++] = *t;
+    if (nout == BATCH) {
+        flush();
+    }
+}
+
+static void fill(struct telem_v1 *t, uint32_t device, uint32_t seq, uint64_t ms) {
+    double sun = fmod(ms / 60000.0 + device * 0.37, 2 * M_PI); // One sweep a minute
+    int brightest = 0;
+
+    memset(t, 0, sizeof(*t));
+    t->magic = htole16(TELEM_MAGIC);
+    t->version = TELEM_VERSION;
+    t->nlight = 4;
+    t->device = htole32(device);
+    t->seq = htole32(seq);
+    t->uptime_ms = htole32((uint32_t)ms);
+    t->temp_centi = (int16_t)htole16((int16_t)(2000 + 500 * sin(ms / 600000.0 + device)));
+    t->humidity_centi = htole16((uint16_t)(4500 + (device % 2000)));
+    for (int i = 0; i < 4; i++) {
+        double v = 2000 + 1900 * cos(sun - i * M_PI / 2);
+        uint16_t raw = (uint16_t)v;
+        t->light[i] = htole16(raw);
+        if (raw > le16toh(t->light[brightest])) {
+            brightest = i;
+        }
+    }
+    t->direction = brightest;
+    t->rssi = -40 - (int8_t)(device % 50);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr,
+            "Usage: %s [-g group] [-p port] [-n devices] [-r rate-hz] [-T seconds] [-l loss-%%] [-x reorder-%%] "
+            "[-s seed] [-t ttl]\n",
+            name);
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    const char *group = TELEM_GROUP;
+    int port = TELEM_PORT, ndevices = 1, ttl = 1, opt;
+    double rate = 1, run_s = 5, loss = 0, reorder = 0;
+    unsigned seed = 1;
+
+    while ((opt = getopt(argc, argv, "g:p:n:r:T:l:x:s:t:")) != -1) {
+        switch (opt) {
+        case 'g':
+            group = optarg;
+            break;
+        case 'p':
+            port = atoi(optarg);
+            break;
+        case 'n':
+            ndevices = atoi(optarg);
+            break;
+        case 'r':
+            rate = atof(optarg);
+            break;
+        case 'T':
+            run_s = atof(optarg);
+            break;
+        case 'l':
+            loss = atof(optarg);
+            break;
+        case 'x':
+            reorder = atof(optarg);
+            break;
+        case 's':
+            seed = (unsigned)atoi(optarg);
+            break;
+        case 't':
+            ttl = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (optind != argc || ndevices <= 0 || rate <= 0 || run_s <= 0) {
+        usage(argv[0]);
+    }
+    srand(seed);
+
+    dest.sin_family = AF_INET;
+    dest.sin_port = htons(port);
+    if (inet_pton(AF_INET, group, &dest.sin_addr) != 1) {
+        fprintf(stderr, "Error: bad group address %s\n", group);
+        return 1;
+    }
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        perror("Error creating socket");
+        return 1;
+    }
+    unsigned char mttl = ttl, loop = 1;
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &mttl, sizeof(mttl));
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    int sndbuf = 4 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+    struct sim *sims = calloc(ndevices, sizeof(*sims));
+    if (!sims) {
+        perror("Error allocating memory");
+        return 1;
+    }
+    uint64_t period_ns = (uint64_t)(1e9 / rate), run_ns = (uint64_t)(run_s * 1e9);
+    uint32_t count = (uint32_t)(run_ns / period_ns); // Datagrams per device
+    if (!count) {
+        count = 1;
+    }
+    for (int d = 0; d < ndevices; d++) {
+        sims[d].next_ns = period_ns * d / ndevices;
+    }
+
+    uint64_t start = now_ns();
+    int active = ndevices;
+    while (active) {
+        uint64_t now = now_ns() - start;
+        for (int d = 0; d < ndevices; d++) {
+            struct sim *s = &sims[d];
+            if (s->seq == count || s->next_ns > now) {
+                continue;
+            }
+            struct telem_v1 t;
+            int first = s->seq == 0, last = s->seq + 1 == count;
+            // Device ids look like the last four bytes of an Espressif MAC
+            fill(&t, 0x24a16000u + d, s->seq, s->next_ns / 1000000);
+            s->seq++;
+            s->next_ns += period_ns;
+            if (last) {
+                active--;
+            }
+
+            if (!first && !last && rand() % 10000 < loss * 100) {
+                dropped++;
+                continue;
+            }
+            if (!first && !last && !s->held && rand() % 10000 < reorder * 100) {
+                s->pending = t;
+                s->held = 1;
+                continue;
+            }
+            send_one(&t);
+            if (s->held) {
+                send_one(&s->pending); // Now behind a later one
+                s->held = 0;
+                reordered++;
+            }
+        }
+        flush();
+        uint64_t next = (now / TICK_NS + 1) * TICK_NS;
+        uint64_t left = next + start - now_ns();
+        if (active && (int64_t)left > 0) {
+            struct timespec ts = {0, (long)left};
+            nanosleep(&ts, NULL);
+        }
+    }
+
+    fprintf(stderr, "sent %llu dropped %llu reordered %llu\n", (unsigned long long)sent,
+            (unsigned long long)dropped, (unsigned long long)reordered);
+    free(sims);
+    close(fd);
+    return 0;
+}
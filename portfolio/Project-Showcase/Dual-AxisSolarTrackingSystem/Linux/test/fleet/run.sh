@@ -0,0 +1,36 @@
+#!/bin/sh
+# Drive two trackers through the fleet controller from FIFOs and check the
+# motor trace of each. A tracker acts on its newest frame only, so of the
+# two frames east receives at once only the second may be executed. Run
+# from the Linux/ directory after building (make APP_CC=gcc check).
+set -e
+
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+mkfifo "$tmp/east.fifo" "$tmp/west.fifo"
+cat > "$tmp/fleet.conf" <<CONF
+# name serial motor
+east $tmp/east.fifo trace:$tmp/east.trace
+west $tmp/west.fifo trace:$tmp/west.trace
+CONF
+
+timeout 10 ./fleet -o "$tmp/fleet.conf" 2>"$tmp/stats" &
+pid=$!
+printf 'Venstre 1 0 0\nHøjre 2 0 0\n' > "$tmp/east.fifo"
+printf 'Op 3 0 0\n' > "$tmp/west.fifo"
+wait $pid
+
+status=0
+check() {
+    if [ "$(cut -d' ' -f2- "$tmp/$1.trace")" = "$2" ]; then
+        echo "PASS fleet $1"
+    else
+        echo "FAIL fleet $1: got '$(cat "$tmp/$1.trace")', expected '$2'"
+        cat "$tmp/stats"
+        status=1
+    fi
+}
+check east "1 stepper forward 50"
+check west "0 servo 90"
+exit $status
@@ -0,0 +1,57 @@
+# Check one axis of one tracker against the plat_drv_sim edge log.
+#
+#   awk -v mode=stepper -v base=<first line> -v dir=forward|backward \
+#       -v steps=<n> -v jitter=<us> -f edges.awk <edge log>
+#   awk -v mode=servo -v base=<first line> -v angle=<deg> -v jitter=<us> \
+#       -f edges.awk <edge log>
+#
+# Prints "ok <summary>" or "FAIL <reason>" and exits non-zero on failure.
+BEGIN {
+    split("1001 1100 0110 0011", phases, " ")
+    n = 0; coil = 0; fail = ""
+}
+/^#/ { next }
+mode == "stepper" && $2 > base && $2 <= base + 4 {
+    # The driver sets coils 1-4 in order for every phase
+    if ($2 - base != coil + 1) {
+        if (fail == "") fail = "coil " $2 - base " set out of order at " $1
+        next
+    }
+    if (coil == 0) { ts[n] = $1; pat[n] = "" }
+    pat[n] = pat[n] $3
+    if (++coil == 4) { coil = 0; n++ }
+}
+mode == "servo" && $2 == base {
+    if ($3 == 1 && !rise) rise = $1
+    else if ($3 == 0 && rise && !fall) fall = $1
+}
+END {
+    if (mode == "servo") {
+        want = (500 + int(angle * 2000 / 180)) * 1000
+        width = fall - rise
+        if (!rise || !fall) fail = "no pulse"
+        else if (width - want > jitter * 1000 || want - width > jitter * 1000)
+            fail = sprintf("width %.1f us, want %.1f us", width / 1000, want / 1000)
+        if (fail != "") { print "FAIL " fail; exit 1 }
+        printf "ok width %.1f us (want %.1f)\n", width / 1000, want / 1000
+        exit 0
+    }
+
+    if (fail == "" && coil) fail = "partial phase at the end"
+    if (fail == "" && n != steps + 1) fail = sprintf("%d phases, want %d steps and a release", n, steps)
+    if (fail == "" && pat[n - 1] != "0000") fail = "coils not released, last phase " pat[n - 1]
+    for (i = 0; fail == "" && i < steps; i++) {
+        idx = dir == "forward" ? i % 4 : 3 - i % 4
+        if (pat[i] != phases[idx + 1]) fail = sprintf("step %d phase %s, want %s", i, pat[i], phases[idx + 1])
+    }
+    # Every edge, the release included, is due on the 2 ms grid of the first
+    worst = 0
+    for (i = 1; i < n; i++) {
+        dev = ts[i] - ts[0] - i * 2000000
+        if (dev < 0) dev = -dev
+        if (dev > worst) worst = dev
+    }
+    if (fail == "" && worst > jitter * 1000) fail = sprintf("edge %.1f us off the 2 ms grid", worst / 1000)
+    if (fail != "") { print "FAIL " fail; exit 1 }
+    printf "ok %d steps, worst edge %.1f us off the grid\n", steps, worst / 1000
+}
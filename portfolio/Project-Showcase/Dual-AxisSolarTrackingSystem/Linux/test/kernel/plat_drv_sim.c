@@ -0,0 +1,304 @@
+    // SPDX-License-Identifier: GPL-2.0
+    // plat_drv_sim - simulated GPIO lines for testing the Servo-Stepper module
+    // without a Pi.
+    //
+    //   insmod Servo-Stepper.ko && insmod plat_drv_sim.ko trackers=2
+    //
+    // Registers a GPIO chip "plat_drv_sim" with five lines per tracker (servo,
+    // then stepper coils 1-4), a GPIO lookup table mapping them to the
+    // driver's gpios 0-4, and one "plat_drv" platform device per tracker, so
+    // the driver probes exactly as it does from the device tree.
+    //
+    // gpio-sim itself cannot be used: its lines sleep, and the driver sets
+    // them from hrtimer callbacks. This chip is spinlocked instead and
+    // records every set call (changed or not) with its CLOCK_MONOTONIC time:
+    //
+    //   /sys/kernel/debug/plat_drv_sim/edges   "<ns> <line> <value>" per set,
+    //                                          oldest first, after a
+    //                                          "# lost <n>" line counting
+    //                                          records that overflowed the
+    //                                          log; any write clears it
+    //
+    // One stepper phase is therefore four consecutive records, coil 1 first.
+    // Values are physical levels. Odd trackers' lines are looked up active
+    // low, as the Pi overlay declares them, so the suite sees it if the
+    // driver ever drives logical values instead.
+    #include <linux/module.h>
+    #include <linux/platform_device.h>
+    #include <linux/gpio/driver.h>
+    #include <linux/gpio/machine.h>
+    #include <linux/debugfs.h>
+    #include <linux/seq_file.h>
+    #include <linux/spinlock.h>
+    #include <linux/ktime.h>
+    #include <linux/slab.h>
+    #include <linux/vmalloc.h>
+    #include <linux/version.h>
+
+    #define SIM_LABEL "plat_drv_sim"
+    #define LINES_PER_TRACKER 5
+    #define MAX_SIM_TRACKERS 8
+    #define EDGE_SLOTS 65536 // Must be a power of two
+
+    static unsigned int trackers = 1;
+    module_param(trackers, uint, 0444);
+    MODULE_PARM_DESC(trackers, "Number of simulated trackers (1-8)");
+
+    struct sim_edge {
+        u64 ts_ns;
+        u16 line;
+        u8 value;
+    };
+
+    // Edge log, a ring keeping the newest EDGE_SLOTS records
+    static DEFINE_SPINLOCK(edges_lock);
+    static struct sim_edge *edges;
+    static u64 edge_count;
+    static DECLARE_BITMAP(levels, MAX_SIM_TRACKERS * LINES_PER_TRACKER);
+
+    static struct dentry *debug_dir;
+    static struct gpiod_lookup_table *lookups[MAX_SIM_TRACKERS];
+    static struct platform_device *pdevs[MAX_SIM_TRACKERS];
+
+    static void sim_record(unsigned int offset, int value) {
+        u64 now = ktime_get_ns();
+        unsigned long flags;
+        struct sim_edge *e;
+
+        spin_lock_irqsave(&edges_lock, flags);
+        assign_bit(offset, levels, value);
+        e = &edges[edge_count++ & (EDGE_SLOTS - 1)];
+        e->ts_ns = now;
+        e->line = offset;
+        e->value = !!value;
+        spin_unlock_irqrestore(&edges_lock, flags);
+    }
+
+    static int sim_get(struct gpio_chip *gc, unsigned int offset) {
+        return test_bit(offset, levels);
+    }
+
+    #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 17, 0)
+    static int sim_set(struct gpio_chip *gc, unsigned int offset, int value) {
+        sim_record(offset, value);
+        return 0;
+    }
+    #else
+    static void sim_set(struct gpio_chip *gc, unsigned int offset, int value) {
+        sim_record(offset, value);
+    }
+    #endif
+
+    static int sim_direction_output(struct gpio_chip *gc, unsigned int offset, int value) {
+        sim_record(offset, value);
+        return 0;
+    }
+
+    static int sim_get_direction(struct gpio_chip *gc, unsigned int offset) {
+        return GPIO_LINE_DIRECTION_OUT;
+    }
+
+    static struct gpio_chip sim_chip = {
+        .label = SIM_LABEL,
+        .owner = THIS_MODULE,
+        .base = -1,
+        .can_sleep = false,
+        .get = sim_get,
+        .set = sim_set,
+        .direction_output = sim_direction_output,
+        .get_direction = sim_get_direction,
+    };
+
+    // debugfs edges: opening takes a snapshot, so a slow reader does not see
+    // the log move under it
+    struct edges_snapshot {
+        u64 lost;       // Records that fell off the ring
+        size_t count;
+        struct sim_edge e[];
+    };
+
+    // Position 0 is a "# lost <n>" header, record i is at position i + 1
+    static void *edges_start(struct seq_file *m, loff_t *pos) {
+        struct edges_snapshot *snap = m->private;
+
+        return *pos <= snap->count ? pos : NULL;
+    }
+
+    static void *edges_next(struct seq_file *m, void *v, loff_t *pos) {
+        ++*pos;
+        return edges_start(m, pos);
+    }
+
+    static void edges_stop(struct seq_file *m, void *v) {
+    }
+
+    static int edges_show(struct seq_file *m, void *v) {
+        struct edges_snapshot *snap = m->private;
+        loff_t pos = *(loff_t *)v;
+        struct sim_edge *e;
+
+        if (pos == 0) {
+            seq_printf(m, "# lost %llu\n", snap->lost);
+            return 0;
+        }
+        e = &snap->e[pos - 1];
+        seq_printf(m, "%llu %u %u\n", e->ts_ns, e->line, e->value);
+        return 0;
+    }
+
+    static const struct seq_operations edges_seq_ops = {
+        .start = edges_start,
+        .next = edges_next,
+        .stop = edges_stop,
+        .show = edges_show,
+    };
+
+    static int edges_open(struct inode *inode, struct file *filep) {
+        struct edges_snapshot *snap;
+        unsigned long flags;
+        u64 first;
+        int err;
+
+        snap = vmalloc(struct_size(snap, e, EDGE_SLOTS));
+        if (!snap) {
+            return -ENOMEM;
+        }
+        spin_lock_irqsave(&edges_lock, flags);
+        first = edge_count > EDGE_SLOTS ? edge_count - EDGE_SLOTS : 0;
+        snap->lost = first;
+        snap->count = edge_count - first;
+        for (size_t i = 0; i < snap->count; i++) {
+            snap->e[i] = edges[(first + i) & (EDGE_SLOTS - 1)];
+        }
+        spin_unlock_irqrestore(&edges_lock, flags);
+
+        err = seq_open(filep, &edges_seq_ops);
+        if (err) {
+            vfree(snap);
+            return err;
+        }
+        ((struct seq_file *)filep->private_data)->private = snap;
+        return 0;
+    }
+
+    static int edges_release(struct inode *inode, struct file *filep) {
+        vfree(((struct seq_file *)filep->private_data)->private);
+        return seq_release(inode, filep);
+    }
+
+    // Any write clears the log, e.g. before a test case
+    static ssize_t edges_write(struct file *filep, const char __user *ubuf, size_t count, loff_t *f_pos) {
+        unsigned long flags;
+
+        spin_lock_irqsave(&edges_lock, flags);
+        edge_count = 0;
+        spin_unlock_irqrestore(&edges_lock, flags);
+        return count;
+    }
+
+    static const struct file_operations edges_fops = {
+        .owner = THIS_MODULE,
+        .open = edges_open,
+        .read = seq_read,
+        .llseek = seq_lseek,
+        .write = edges_write,
+        .release = edges_release,
+    };
+
+    // gpios 0-4 of platform device plat_drv.<n> are lines 5n .. 5n+4, active
+    // low for odd n
+    static struct gpiod_lookup_table *sim_lookup_create(unsigned int n) {
+        struct gpiod_lookup_table *t;
+
+        t = kzalloc(struct_size(t, table, LINES_PER_TRACKER + 1), GFP_KERNEL);
+        if (!t) {
+            return NULL;
+        }
+        t->dev_id = kasprintf(GFP_KERNEL, "plat_drv.%u", n);
+        if (!t->dev_id) {
+            kfree(t);
+            return NULL;
+        }
+        for (int i = 0; i < LINES_PER_TRACKER; i++) {
+            t->table[i] = (struct gpiod_lookup)GPIO_LOOKUP_IDX(SIM_LABEL, n * LINES_PER_TRACKER + i, NULL, i,
+                                                                n % 2 ? GPIO_ACTIVE_LOW : GPIO_ACTIVE_HIGH);
+        }
+        gpiod_add_lookup_table(t);
+        return t;
+    }
+
+    static void sim_lookup_destroy(struct gpiod_lookup_table *t) {
+        gpiod_remove_lookup_table(t);
+        kfree(t->dev_id);
+        kfree(t);
+    }
+
+    static void sim_teardown(void) {
+        for (int i = MAX_SIM_TRACKERS - 1; i >= 0; i--) {
+            if (pdevs[i]) {
+                platform_device_unregister(pdevs[i]);
+                pdevs[i] = NULL;
+            }
+            if (lookups[i]) {
+                sim_lookup_destroy(lookups[i]);
+                lookups[i] = NULL;
+            }
+        }
+    }
+
+    static int __init plat_drv_sim_init(void) {
+        int err;
+
+        if (trackers < 1 || trackers > MAX_SIM_TRACKERS) {
+            pr_err("trackers must be 1-%d\n", MAX_SIM_TRACKERS);
+            return -EINVAL;
+        }
+        edges = vzalloc(EDGE_SLOTS * sizeof(*edges));
+        if (!edges) {
+            return -ENOMEM;
+        }
+
+        sim_chip.ngpio = trackers * LINES_PER_TRACKER;
+        err = gpiochip_add_data(&sim_chip, NULL);
+        if (err) {
+            vfree(edges);
+            return err;
+        }
+        debug_dir = debugfs_create_dir("plat_drv_sim", NULL);
+        debugfs_create_file("edges", 0600, debug_dir, NULL, &edges_fops);
+
+        // Lookup tables first: the driver probes as soon as a device appears
+        for (unsigned int i = 0; i < trackers; i++) {
+            lookups[i] = sim_lookup_create(i);
+            if (!lookups[i]) {
+                err = -ENOMEM;
+                goto err_teardown;
+            }
+            pdevs[i] = platform_device_register_simple("plat_drv", i, NULL, 0);
+            if (IS_ERR(pdevs[i])) {
+                err = PTR_ERR(pdevs[i]);
+                pdevs[i] = NULL;
+                goto err_teardown;
+            }
+        }
+        return 0;
+
+    err_teardown:
+        sim_teardown();
+        debugfs_remove_recursive(debug_dir);
+        gpiochip_remove(&sim_chip);
+        vfree(edges);
+        return err;
+    }
+
+    static void __exit plat_drv_sim_exit(void) {
+        sim_teardown();
+        debugfs_remove_recursive(debug_dir);
+        gpiochip_remove(&sim_chip);
+        vfree(edges);
+    }
+
+    module_init(plat_drv_sim_init);
+    module_exit(plat_drv_sim_exit);
+    MODULE_LICENSE("GPL");
+    MODULE_DESCRIPTION("Simulated GPIO lines and devices for testing the Servo-Stepper driver");
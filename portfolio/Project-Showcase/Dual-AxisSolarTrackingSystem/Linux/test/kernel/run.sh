@@ -0,0 +1,114 @@
+#!/bin/sh
+# Kernel test suite for the Servo-Stepper module on simulated GPIO lines.
+#
+#   make kernel-check [KDIR=/path/to/linux]      any x86 Linux host
+#   test/kernel/run.sh --guest                   inside a VM (or a scratch
+#                                                box) with the modules built
+#
+# Builds Servo-Stepper.ko and plat_drv_sim.ko against KDIR, boots that
+# kernel with virtme-ng and runs this script again inside the VM with
+# --guest. There the driver binds to plat_drv_sim's lines and every edge it
+# emits is read back from the sim chip's edge log:
+#
+#   phases    every step has the right coil pattern, and the coils are
+#             released at the end of the move
+#   steps     phase count and the driver's debugfs step counter match
+#   pwm       the servo pulse is 0.5 ms + angle / 90 ms wide
+#   jitter    every step edge is within JITTER_US of the 2 ms grid
+#   trackers  two trackers moving at once do not disturb each other
+#   idle      every line is low after probe, and tracker 1, whose lines
+#             are active low like the Pi overlay's, pulses and steps with
+#             the same physical levels as tracker 0
+#   status    poll() wakes when a move is done and the mmap'd status page
+#             tracks position, target and queue (statuscheck.c)
+#
+# KDIR must be a built x86 kernel tree with CONFIG_GPIOLIB, CONFIG_DEBUG_FS
+# and CONFIG_HIGH_RES_TIMERS, e.g. from "vng --build". Without vng the
+# modules are only built; without KDIR the test is skipped. The Pi's own
+# 5.4 build is "make modules" (KERNELDIR). JITTER_US (default 500) is generous on purpose: a
+# VM's timers are not the Pi's.
+set -e
+
+here=$(dirname "$0")
+JITTER_US=${JITTER_US:-500}
+
+guest() {
+    dbg=/sys/kernel/debug
+    mountpoint -q $dbg || mount -t debugfs none $dbg
+    insmod ./Servo-Stepper.ko
+    insmod $here/plat_drv_sim.ko trackers=2
+    trap 'rmmod plat_drv_sim; rmmod Servo-Stepper' EXIT
+    edges=$dbg/plat_drv_sim/edges
+    status=0
+
+    result() {
+        if [ "${2%% *}" = ok ]; then
+            echo "PASS $1 (${2#ok })"
+        else
+            echo "FAIL $1: ${2#FAIL }"
+            status=1
+        fi
+    }
+
+    # stepper <tracker> <forward|backward> <steps>: check the last move
+    stepper() {
+        awk -v mode=stepper -v base=$(($1 * 5)) -v dir=$2 -v steps=$3 -v jitter=$JITTER_US \
+            -f $here/edges.awk $edges || true
+    }
+
+    # Probe set every line low; each line's last record is its level
+    r=$(awk '!/^#/ { v[$2] = $3 } END { for (l in v) if (v[l]) bad = bad " " l; n = length(v)
+        print bad == "" && n == 10 ? "ok " n " lines low" : "FAIL lines high:" bad " of " n }' $edges)
+    result "idle" "$r"
+
+    for move in "forward 50" "backward 10" "forward 1000"; do
+        echo 1 > $dbg/plat_drv/tracker0/stepper/reset
+        echo > $edges
+        echo "$move" > /dev/plat_drv1
+        result "stepper $move" "$(stepper 0 $move)"
+        count=$(awk '$1 == "steps" { print $2 }' $dbg/plat_drv/tracker0/stepper/stats)
+        [ "$count" = "${move#* }" ] && r="ok $count" || r="FAIL debugfs steps $count"
+        result "stepper $move count" "$r"
+    done
+
+    for angle in 0 45 90 180; do
+        echo > $edges
+        echo $angle > /dev/plat_drv0
+        result "servo $angle" "$(awk -v mode=servo -v base=0 -v angle=$angle -v jitter=$JITTER_US \
+            -f $here/edges.awk $edges || true)"
+    done
+
+    echo > $edges
+    echo 90 > /dev/plat_drv2
+    result "servo 90 active low" "$(awk -v mode=servo -v base=5 -v angle=90 -v jitter=$JITTER_US \
+        -f $here/edges.awk $edges || true)"
+
+    echo > $edges
+    echo "forward 200" > /dev/plat_drv1 &
+    echo "backward 200" > /dev/plat_drv3
+    wait
+    result "trackers 0" "$(stepper 0 forward 200)"
+    result "trackers 1" "$(stepper 1 backward 200)"
+
+    $here/statuscheck /dev/plat_drv1 100 || status=1
+
+    exit $status
+}
+
+if [ "$1" = --guest ]; then
+    guest
+fi
+
+KDIR=${KDIR:-/lib/modules/$(uname -r)/build}
+if [ ! -f "$KDIR/Makefile" ]; then
+    echo "SKIP kernel (needs a kernel tree in KDIR)"
+    exit 0
+fi
+make -C "$KDIR" M="$PWD" modules
+make -C "$KDIR" M="$PWD/$here" modules
+${CC:-cc} -O2 -Wall -o $here/statuscheck $here/statuscheck.c
+if ! command -v vng > /dev/null; then
+    echo "SKIP kernel run (modules built against $KDIR; needs virtme-ng to boot it)"
+    exit 0
+fi
+vng --run "$KDIR" --user root --rwdir "$PWD" --exec "cd '$PWD' && $here/run.sh --guest"
@@ -0,0 +1,87 @@
+// statuscheck - exercise poll() and the mmap'd status page of a stepper
+// node: queue a move without blocking, wait for it with poll(POLLIN) and
+// check what the status page says afterwards.
+//
+//   statuscheck /dev/plat_drv1 <steps>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "../../plat_drv_status.h"
+
+static int failed;
+
+static void expect(int ok, const char *what, long long got, long long want) {
+    if (!ok) {
+        printf("FAIL status %s: %lld, want %lld\n", what, got, want);
+        failed = 1;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    struct plat_drv_status before, after;
+    const struct plat_drv_status *page;
+    const struct plat_drv_axis_status *as;
+    struct pollfd pfd;
+    char cmd[32];
+    int steps, fd;
+
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <stepper node> <steps>\n", argv[0]);
+        return 2;
+    }
+    steps = atoi(argv[2]);
+    fd = open(argv[1], O_RDWR | O_NONBLOCK);
+    if (fd < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+    page = mmap(NULL, sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, fd, 0);
+    if (page == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    if (mmap(NULL, sysconf(_SC_PAGESIZE), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) != MAP_FAILED) {
+        printf("FAIL status page is writable\n");
+        failed = 1;
+    }
+    plat_drv_status_read(page, &before);
+    expect(before.version == PLAT_DRV_STATUS_VERSION, "version", before.version, PLAT_DRV_STATUS_VERSION);
+
+    snprintf(cmd, sizeof(cmd), "forward %d", steps);
+    if (write(fd, cmd, strlen(cmd)) < 0) {
+        perror("write");
+        return 1;
+    }
+
+    // Moving: not idle yet, the page shows where it is headed
+    pfd = (struct pollfd){ .fd = fd, .events = POLLIN };
+    expect(poll(&pfd, 1, 0) == 0, "idle right after queueing", 1, 0);
+    plat_drv_status_read(page, &after);
+    as = &after.axis[PLAT_DRV_AXIS_STEPPER];
+    expect(as->target == before.axis[PLAT_DRV_AXIS_STEPPER].target + steps, "target", as->target,
+           before.axis[PLAT_DRV_AXIS_STEPPER].target + steps);
+    expect(as->queue_depth == 1, "queue depth while moving", as->queue_depth, 1);
+
+    // Done: poll wakes on completion and the page has settled
+    expect(poll(&pfd, 1, steps * 2 + 1000) == 1 && (pfd.revents & POLLIN), "poll on completion", pfd.revents,
+           POLLIN);
+    plat_drv_status_read(page, &after);
+    as = &after.axis[PLAT_DRV_AXIS_STEPPER];
+    expect(as->position == before.axis[PLAT_DRV_AXIS_STEPPER].position + steps, "position", as->position,
+           before.axis[PLAT_DRV_AXIS_STEPPER].position + steps);
+    expect(as->position == as->target, "position at target", as->position, as->target);
+    expect(as->velocity == 0, "velocity when stopped", as->velocity, 0);
+    expect(as->queue_depth == 0, "queue depth when idle", as->queue_depth, 0);
+    expect(as->done_seq == as->queued_seq, "done_seq", as->done_seq, as->queued_seq);
+    expect(!(after.seq & 1), "seq even", after.seq, after.seq + 1);
+
+    if (!failed) {
+        printf("PASS status (%d steps, position %lld)\n", steps, (long long)as->position);
+    }
+    return failed;
+}
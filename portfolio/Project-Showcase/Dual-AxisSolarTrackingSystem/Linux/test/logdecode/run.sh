@@ -0,0 +1,32 @@
+#!/bin/sh
+# Decode every captured ESP32 log stream in this directory and compare with
+# the expected text. Each capture is also decoded 40 times back to back from
+# a pipe, so frames straddle the decoder's read buffer. The .bin files were
+# written by Esp32/lib/BinLog on the host build. Run from the Linux/
+# directory after building (make APP_CC=gcc check).
+set -e
+
+dir=$(dirname "$0")
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+status=0
+
+for capture in "$dir"/*.bin; do
+    name=$(basename "$capture" .bin)
+    : >"$tmp/$name.bin"
+    : >"$tmp/$name.expected"
+    for i in $(seq 40); do
+        cat "$capture" >>"$tmp/$name.bin"
+        cat "$dir/$name.expected" >>"$tmp/$name.expected"
+    done
+    ./logdecode "$capture" >"$tmp/$name.out"
+    if diff -u "$dir/$name.expected" "$tmp/$name.out" &&
+        cat "$tmp/$name.bin" | ./logdecode | cmp -s - "$tmp/$name.expected"; then
+        echo "PASS logdecode $name"
+    else
+        echo "FAIL logdecode $name"
+        status=1
+    fi
+done
+
+exit $status
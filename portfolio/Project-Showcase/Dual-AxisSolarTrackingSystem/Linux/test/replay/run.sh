@@ -0,0 +1,24 @@
+#!/bin/sh
+# Replay every fixture in this directory through the controller as fast as
+# possible and compare the resulting motor command trace with the expected
+# one. Run from the Linux/ directory after building (make APP_CC=gcc check).
+set -e
+
+dir=$(dirname "$0")
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+status=0
+
+for fixture in "$dir"/*.txt; do
+    name=$(basename "$fixture" .txt)
+    ./serialrec -c "$fixture" "$tmp/$name.srec"
+    ./serialreplay -x 0 -w 300 -o "$tmp/$name.trace" "$tmp/$name.srec" -- -d 0 -q 2>"$tmp/$name.stats"
+    if diff -u "$dir/$name.expected" "$tmp/$name.trace"; then
+        echo "PASS $name ($(head -1 "$tmp/$name.stats"))"
+    else
+        echo "FAIL $name"
+        status=1
+    fi
+done
+
+exit $status
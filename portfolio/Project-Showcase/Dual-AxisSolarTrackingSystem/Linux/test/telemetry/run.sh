@@ -0,0 +1,27 @@
+#!/bin/sh
+# Send a field of simulated trackers through telemcollect and check that
+# the loss and reorder it reports per device add up to what telemgen
+# injected. Uses unicast loopback so it needs no multicast route. Run
+# from the Linux/ directory after building (make APP_CC=gcc check).
+set -e
+
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+port=$((20000 + $$ % 20000))
+
+timeout 30 ./telemcollect -g 127.0.0.1 -p $port -r 0 -I 1000 >"$tmp/report" &
+pid=$!
+sleep 0.2
+./telemgen -g 127.0.0.1 -p $port -n 2000 -r 5 -T 2 -l 2 -x 3 -s 7 2>"$tmp/sent"
+wait $pid
+
+# sent <n> dropped <n> reordered <n>
+read -r _ sent _ dropped _ reordered <"$tmp/sent"
+expected="total devices 2000 rx $sent lost $dropped reordered $reordered dup 0 reboots 0 bad 0"
+got=$(head -n 1 "$tmp/report")
+if [ "$got" = "$expected" ]; then
+    echo "PASS telemetry"
+else
+    echo "FAIL telemetry: got '$got', expected '$expected'"
+    exit 1
+fi
@@ -0,0 +1,418 @@
+#include "tlog.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static uint32_t crc32c_table[256];
+
+// Build the CRC-32C (Castagnoli, reflected 0x82F63B78) lookup table
+static void crc32c_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc >> 1) ^ (0x82F63B78u & -(crc & 1));
+        }
+        crc32c_table[i] = crc;
+    }
+}
+
+uint32_t tlog_crc32c(uint32_t crc, const void *data, size_t len) {
+    const uint8_t *p = data;
+
+    if (crc32c_table[1] == 0) {
+        crc32c_init();
+    }
+    crc = ~crc;
+    while (len--) {
+        crc = crc32c_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts); // vDSO, no syscall
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static uint32_t header_crc(const struct tlog_segment_header *hdr) {
+    return tlog_crc32c(0, hdr, offsetof(struct tlog_segment_header, crc));
+}
+
+static uint32_t record_crc(const struct tlog_record *rec) {
+    return tlog_crc32c(0, rec, offsetof(struct tlog_record, crc));
+}
+
+int tlog_segment_valid(const struct tlog_segment_header *hdr, size_t map_size) {
+    return map_size >= 2 * TLOG_RECORD_SIZE &&
+           hdr->magic == TLOG_MAGIC &&
+           hdr->version == TLOG_VERSION &&
+           hdr->record_size == TLOG_RECORD_SIZE &&
+           hdr->capacity <= map_size / TLOG_RECORD_SIZE - 1 &&
+           hdr->crc == header_crc(hdr);
+}
+
+int tlog_record_valid(const struct tlog_record *rec, uint32_t generation) {
+    return __atomic_load_n(&rec->commit, __ATOMIC_ACQUIRE) == (TLOG_COMMIT ^ generation) &&
+           rec->len <= TLOG_PAYLOAD_MAX &&
+           rec->crc == record_crc(rec);
+}
+
+static void segment_name(char *buf, size_t size, unsigned int index) {
+    snprintf(buf, size, "seg-%04u.tlog", index);
+}
+
+// Map segment file `index`, creating and preallocating it if necessary
+static void *map_segment(struct tlog *log, unsigned int index) {
+    char name[32];
+    struct stat st;
+    void *map;
+    int fd;
+
+    segment_name(name, sizeof(name), index);
+    fd = openat(log->dirfd, name, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror("Error opening telemetry segment");
+        return NULL;
+    }
+
+    // Reserve the blocks up front so a full SD card fails here, not with
+    // SIGBUS on a later store into the mapping
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size < log->segment_size) {
+        int err = posix_fallocate(fd, 0, log->segment_size);
+        if (err && ftruncate(fd, log->segment_size) < 0) {
+            errno = err;
+            perror("Error allocating telemetry segment");
+            close(fd);
+            return NULL;
+        }
+    }
+
+    map = mmap(NULL, log->segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("Error mapping telemetry segment");
+        return NULL;
+    }
+    madvise(map, log->segment_size, MADV_SEQUENTIAL);
+    return map;
+}
+
+static void unmap_segment(struct tlog *log) {
+    if (log->hdr) {
+        msync(log->hdr, log->segment_size, MS_ASYNC);
+        munmap(log->hdr, log->segment_size);
+        log->hdr = NULL;
+        log->records = NULL;
+    }
+}
+
+// Make segment `index` the active one and stamp it with a new generation
+static int start_segment(struct tlog *log, unsigned int index, uint32_t generation) {
+    struct tlog_segment_header *hdr = map_segment(log, index);
+
+    if (!hdr) {
+        return -1;
+    }
+
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic = TLOG_MAGIC;
+    hdr->version = TLOG_VERSION;
+    hdr->record_size = TLOG_RECORD_SIZE;
+    hdr->generation = generation;
+    hdr->capacity = log->segment_size / TLOG_RECORD_SIZE - 1;
+    hdr->created_ns = now_ns();
+    hdr->crc = header_crc(hdr);
+
+    log->current = index;
+    log->hdr = hdr;
+    log->records = (struct tlog_record *)(hdr + 1);
+    log->capacity = hdr->capacity;
+    log->next = 0;
+    return 0;
+}
+
+static int rotate(struct tlog *log) {
+    uint32_t generation = log->hdr->generation + 1;
+    unsigned int index = (log->current + 1) % log->segments;
+
+    unmap_segment(log);
+    return start_segment(log, index, generation);
+}
+
+// Find the newest segment on disk and the first free slot in it
+static int resume(struct tlog *log) {
+    struct tlog_segment_header hdr;
+    uint32_t best_generation = 0;
+    int best = -1;
+
+    for (unsigned int i = 0; i < log->segments; i++) {
+        char name[32];
+        int fd;
+
+        segment_name(name, sizeof(name), i);
+        fd = openat(log->dirfd, name, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        if (pread(fd, &hdr, sizeof(hdr), 0) == sizeof(hdr) &&
+            tlog_segment_valid(&hdr, log->segment_size) &&
+            hdr.generation >= best_generation) {
+            best_generation = hdr.generation;
+            best = i;
+        }
+        close(fd);
+    }
+
+    if (best < 0) {
+        return start_segment(log, 0, 1);
+    }
+
+    log->hdr = map_segment(log, best);
+    if (!log->hdr) {
+        return -1;
+    }
+    log->current = best;
+    log->records = (struct tlog_record *)(log->hdr + 1);
+    log->capacity = log->hdr->capacity;
+
+    // Records are committed strictly in order, so the committed slots form
+    // a prefix of the segment and the end can be found by bisection
+    uint32_t lo = 0, hi = log->capacity;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (tlog_record_valid(&log->records[mid], best_generation)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    log->next = lo;
+    log->seq = lo ? log->records[lo - 1].seq + 1 : 0;
+
+    if (log->next == log->capacity) {
+        return rotate(log);
+    }
+    return 0;
+}
+
+int tlog_open(struct tlog *log, const char *dir, unsigned int segments, size_t segment_size) {
+    memset(log, 0, sizeof(*log));
+    log->segments = segments ? segments : TLOG_DEFAULT_SEGMENTS;
+    log->segment_size = segment_size ? segment_size : TLOG_DEFAULT_SEGMENT_SIZE;
+    log->segment_size &= ~(size_t)(TLOG_RECORD_SIZE - 1);
+
+    if (log->segment_size < 2 * TLOG_RECORD_SIZE) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (mkdir(dir, 0755) < 0 && errno != EEXIST) {
+        perror("Error creating telemetry directory");
+        return -1;
+    }
+    log->dirfd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (log->dirfd < 0) {
+        perror("Error opening telemetry directory");
+        return -1;
+    }
+
+    if (resume(log) < 0) {
+        close(log->dirfd);
+        log->dirfd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+void tlog_close(struct tlog *log) {
+    unmap_segment(log);
+    if (log->dirfd >= 0) {
+        close(log->dirfd);
+        log->dirfd = -1;
+    }
+}
+
+int tlog_append(struct tlog *log, uint16_t type, const void *payload, size_t len) {
+    struct tlog_record *rec;
+    uint64_t ts = now_ns();
+
+    if (!log->hdr) {
+        return -1;
+    }
+    if (log->next == log->capacity && rotate(log) < 0) {
+        return -1;
+    }
+    // CLOCK_REALTIME stepped back (an NTP step): start a new segment, so
+    // ts_ns stays sorted within each one for readers that bisect on it
+    if (log->next && ts < log->records[log->next - 1].ts_ns && rotate(log) < 0) {
+        return -1;
+    }
+    if (len > TLOG_PAYLOAD_MAX) {
+        len = TLOG_PAYLOAD_MAX;
+    }
+
+    rec = &log->records[log->next++];
+    rec->ts_ns = ts;
+    rec->seq = log->seq++;
+    rec->type = type;
+    rec->len = len;
+    memcpy(rec->payload, payload, len);
+    memset(rec->payload + len, 0, TLOG_PAYLOAD_MAX - len);
+    rec->crc = record_crc(rec);
+    __atomic_store_n(&rec->commit, TLOG_COMMIT ^ log->hdr->generation, __ATOMIC_RELEASE);
+    return 0;
+}
+
+int tlog_sample_text(const struct tlog_sample *sample, char *buf, size_t size) {
+    int dirlen = (int)strnlen(sample->direction, sizeof(sample->direction));
+
+    if (sample->light < 0) {
+        return snprintf(buf, size, "%.*s %u %u %u", dirlen, sample->direction, sample->trace_id,
+                        sample->capture_us, sample->tx_us);
+    }
+    return snprintf(buf, size, "%.*s %u %u %u %d", dirlen, sample->direction, sample->trace_id,
+                    sample->capture_us, sample->tx_us, sample->light);
+}
+
+// A traced frame as a TLOG_SAMPLE; 0 unless it is exactly what
+// tlog_sample_text() prints, so nothing of the line is lost
+static int frame_sample(const char *line, size_t len, struct tlog_sample *sample) {
+    char text[128];
+    size_t word = strcspn(line, " ,\t\r\n");
+    unsigned int trace, cap, tx;
+    int light = -1, fields;
+
+    if (!word || word >= TLOG_DIRECTION_MAX || len >= sizeof(text)) {
+        return 0;
+    }
+    fields = sscanf(line + word, "%u %u %u %d", &trace, &cap, &tx, &light);
+    if (fields < 3 || light < -1 || light > INT16_MAX) {
+        return 0;
+    }
+    memset(sample, 0, sizeof(*sample));
+    memcpy(sample->direction, line, word);
+    sample->trace_id = trace;
+    sample->capture_us = cap;
+    sample->tx_us = tx;
+    sample->light = fields == 4 ? light : -1;
+    return (size_t)tlog_sample_text(sample, text, sizeof(text)) == len && memcmp(text, line, len) == 0;
+}
+
+int tlog_append_frame(struct tlog *log, const char *line) {
+    size_t len = strcspn(line, "\r\n");
+    struct tlog_sample sample;
+
+    if (frame_sample(line, len, &sample)) {
+        return tlog_append(log, TLOG_SAMPLE, &sample, sizeof(sample));
+    }
+    return tlog_append(log, TLOG_FRAME, line, len);
+}
+
+int tlog_append_command(struct tlog *log, uint8_t axis, int dir, int value) {
+    struct tlog_command cmd = {
+        .axis = axis,
+        .dir = dir,
+        .value = value,
+    };
+    return tlog_append(log, TLOG_COMMAND, &cmd, sizeof(cmd));
+}
+
+void tlog_flush(struct tlog *log) {
+    if (log->hdr) {
+        msync(log->hdr, log->segment_size, MS_ASYNC);
+    }
+}
+
+static int by_generation(const void *a, const void *b) {
+    const struct tlog_view *sa = a, *sb = b;
+    return (sa->hdr->generation > sb->hdr->generation) - (sa->hdr->generation < sb->hdr->generation);
+}
+
+static int view_segment(int dirfd, const char *name, struct tlog_view *seg) {
+    struct stat st;
+    void *map;
+    int fd = openat(dirfd, name, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) < 0 || st.st_size < 2 * TLOG_RECORD_SIZE) {
+        close(fd);
+        return -1;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    if (!tlog_segment_valid(map, st.st_size)) {
+        munmap(map, st.st_size);
+        return -1;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    seg->hdr = map;
+    seg->records = (const struct tlog_record *)(seg->hdr + 1);
+    seg->size = st.st_size;
+
+    // Committed records are a prefix of the segment
+    uint32_t lo = 0, hi = seg->hdr->capacity;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (seg->records[mid].commit == (TLOG_COMMIT ^ seg->hdr->generation)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    seg->count = lo;
+    return 0;
+}
+
+int tlog_map_dir(const char *path, struct tlog_view **segs, size_t *nsegs) {
+    DIR *dir = opendir(path);
+    struct tlog_view *v = NULL;
+    size_t n = 0, cap = 0;
+    struct dirent *de;
+
+    if (!dir) {
+        return -1;
+    }
+    while ((de = readdir(dir)) != NULL) {
+        if (strncmp(de->d_name, "seg-", 4) != 0) {
+            continue;
+        }
+        if (n == cap) {
+            struct tlog_view *grown = realloc(v, (cap ? cap * 2 : 16) * sizeof(*v));
+            if (!grown) {
+                break;
+            }
+            v = grown;
+            cap = cap ? cap * 2 : 16;
+        }
+        if (view_segment(dirfd(dir), de->d_name, &v[n]) == 0) {
+            n++;
+        }
+    }
+    closedir(dir);
+    qsort(v, n, sizeof(*v), by_generation);
+    *segs = v;
+    *nsegs = n;
+    return 0;
+}
+
+void tlog_unmap_dir(struct tlog_view *segs, size_t nsegs) {
+    for (size_t s = 0; s < nsegs; s++) {
+        munmap((void *)segs[s].hdr, segs[s].size);
+    }
+    free(segs);
+}
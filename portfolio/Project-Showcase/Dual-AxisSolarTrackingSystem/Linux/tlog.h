@@ -0,0 +1,152 @@
+#ifndef TLOG_H
+#define TLOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Append-only binary telemetry log.
+//
+// The log is a ring of fixed-size segment files (seg-0000.tlog ...) in one
+// directory. Each segment starts with a 64-byte header followed by 64-byte
+// records. The active segment is mmap'd, so appending a record is a memcpy
+// into the page cache and never a syscall; the kernel writes dirty pages
+// back on its own schedule. Only rotating to the next segment touches the
+// file system.
+//
+// A record is valid when its commit word equals TLOG_COMMIT ^ generation of
+// the segment it sits in and its CRC matches. The commit word is stored last
+// with release ordering, so a record torn by a crash or power cut is simply
+// not committed, and stale records left over from the segment's previous
+// lap around the ring never match the new generation.
+//
+// Timestamps are CLOCK_REALTIME, which can step back at an NTP sync. The
+// writer then moves on to the next segment, so ts_ns never decreases within
+// a segment, though it may between segments.
+
+#define TLOG_MAGIC      0x474f4c54u // "TLOG"
+#define TLOG_VERSION    1
+#define TLOG_COMMIT     0x54494d43u // "CMIT"
+#define TLOG_RECORD_SIZE 64
+#define TLOG_PAYLOAD_MAX 40
+
+// Retention: the ring holds segments * 65535 records, after which the oldest
+// segment is overwritten. The controller logs about two records a second
+// (one frame a second and the command it caused), so the default 1 GiB
+// keeps some three months. Segment files are only created as the ring
+// reaches them. The controller's -L sets the segment count, e.g. -L 1024
+// for a year; shrinking it leaves the extra files to be read but no longer
+// written.
+#define TLOG_DEFAULT_SEGMENTS     256
+#define TLOG_DEFAULT_SEGMENT_SIZE (4u << 20) // 4 MiB, 65535 records
+
+// Record types
+enum tlog_type {
+    TLOG_FRAME = 1,   // Raw line received from the ESP32
+    TLOG_COMMAND = 2, // Motion command issued to a motor
+    TLOG_SAMPLE = 3,  // Traced frame from the ESP32, stored binary
+};
+
+// A TLOG_FRAME payload is cut at TLOG_PAYLOAD_MAX bytes, so one that fills
+// it may have lost its tail. A traced frame,
+//
+//   <direction> <trace id> <capture us> <tx us> [<light>]
+//
+// outgrows that once the ids and micros() get long, so tlog_append_frame()
+// stores it as a TLOG_SAMPLE instead whenever tlog_sample_text() gives the
+// line back byte for byte.
+#define TLOG_DIRECTION_MAX 26
+
+struct tlog_sample {
+    uint32_t trace_id;
+    uint32_t capture_us;   // ESP32 micros() when the light sensors were read
+    uint32_t tx_us;        // ESP32 micros() when the frame was sent
+    int16_t light;         // Brightest reading, -1 if the frame carried none
+    char direction[TLOG_DIRECTION_MAX]; // NUL padded
+};
+
+// Motion command payload (TLOG_COMMAND)
+enum tlog_axis {
+    TLOG_AXIS_SERVO = 0,
+    TLOG_AXIS_STEPPER = 1,
+};
+
+struct tlog_command {
+    uint8_t axis;     // enum tlog_axis
+    int8_t dir;       // Stepper: 1 clockwise, 0 counter-clockwise
+    int16_t value;    // Servo angle or stepper step count
+};
+
+struct tlog_segment_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t generation;   // Increases by one every time a segment is (re)started
+    uint32_t capacity;     // Number of records that fit in the segment
+    uint64_t created_ns;   // CLOCK_REALTIME when the segment was started
+    uint8_t reserved[36];
+    uint32_t crc;          // CRC-32C of the bytes above
+};
+
+struct tlog_record {
+    uint64_t ts_ns;        // CLOCK_REALTIME in nanoseconds
+    uint32_t seq;          // Global record sequence number
+    uint16_t type;         // enum tlog_type
+    uint16_t len;          // Payload bytes in use
+    uint8_t payload[TLOG_PAYLOAD_MAX];
+    uint32_t crc;          // CRC-32C of ts_ns..payload
+    uint32_t commit;       // TLOG_COMMIT ^ segment generation, written last
+};
+
+_Static_assert(sizeof(struct tlog_segment_header) == TLOG_RECORD_SIZE, "tlog header must be one record");
+_Static_assert(sizeof(struct tlog_record) == TLOG_RECORD_SIZE, "tlog record must be 64 bytes");
+_Static_assert(sizeof(struct tlog_sample) <= TLOG_PAYLOAD_MAX, "tlog sample must fit a record");
+
+struct tlog {
+    int dirfd;
+    unsigned int segments;
+    size_t segment_size;
+    unsigned int current;        // Index of the active segment file
+    struct tlog_segment_header *hdr;
+    struct tlog_record *records; // First record of the active segment
+    uint32_t capacity;
+    uint32_t next;               // Slot the next append goes to
+    uint32_t seq;
+};
+
+uint32_t tlog_crc32c(uint32_t crc, const void *data, size_t len);
+
+// Open (or create) the log in `dir`. Existing segments are scanned so the
+// writer resumes after the last committed record. Pass 0 for defaults.
+int tlog_open(struct tlog *log, const char *dir, unsigned int segments, size_t segment_size);
+void tlog_close(struct tlog *log);
+
+// Append one record. Returns 0, or -1 if rotating to a new segment failed.
+int tlog_append(struct tlog *log, uint16_t type, const void *payload, size_t len);
+int tlog_append_frame(struct tlog *log, const char *line);
+int tlog_append_command(struct tlog *log, uint8_t axis, int dir, int value);
+
+// Ask the kernel to start writing back what has been appended so far.
+void tlog_flush(struct tlog *log);
+
+// Reader side: check a mapped segment and its records.
+int tlog_segment_valid(const struct tlog_segment_header *hdr, size_t map_size);
+int tlog_record_valid(const struct tlog_record *rec, uint32_t generation);
+
+// The frame line a TLOG_SAMPLE was made from, without the newline; returns
+// its length as snprintf() does
+int tlog_sample_text(const struct tlog_sample *sample, char *buf, size_t size);
+
+// A segment mapped read-only; its committed records are records[0..count)
+struct tlog_view {
+    const struct tlog_segment_header *hdr;
+    const struct tlog_record *records;
+    size_t size;
+    uint32_t count;
+};
+
+// Map every valid segment in `dir`, oldest generation first. Returns 0, or
+// -1 with errno set if the directory cannot be read.
+int tlog_map_dir(const char *dir, struct tlog_view **segs, size_t *nsegs);
+void tlog_unmap_dir(struct tlog_view *segs, size_t nsegs);
+
+#endif
@@ -0,0 +1,147 @@
+// tlogread - dump or scan the controller's binary telemetry log.
+//
+// Every segment is mmap'd read-only and records are decoded in place, so a
+// scan runs at memory bandwidth once the files are in the page cache.
+//
+//   tlogread [-f from] [-t to] [-y frame|command] [-c] <dir>
+//
+//   -f, -t  Time range in Unix seconds (fractions allowed)
+//   -y      Only show one record type
+//   -c      Count matching records and report scan throughput instead of
+//           printing them
+//
+// Frames print as "frame <line>"; a raw frame that filled its record may
+// have lost its tail and is marked " [truncated]".
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tlog.h"
+
+// First record in the segment with ts_ns >= from. Only sorted within a
+// segment (see tlog.h), so every segment is bounded and searched on its own.
+static uint32_t lower_bound(const struct tlog_view *seg, uint64_t from) {
+    uint32_t lo = 0, hi = seg->count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (seg->records[mid].ts_ns < from) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static void print_record(const struct tlog_record *rec) {
+    printf("%llu.%09llu %u ", (unsigned long long)(rec->ts_ns / 1000000000ull),
+           (unsigned long long)(rec->ts_ns % 1000000000ull), rec->seq);
+
+    if (rec->type == TLOG_FRAME) {
+        // A frame that fills the payload may have been cut short
+        printf("frame %.*s%s\n", rec->len, (const char *)rec->payload,
+               rec->len == TLOG_PAYLOAD_MAX ? " [truncated]" : "");
+    } else if (rec->type == TLOG_SAMPLE && rec->len >= sizeof(struct tlog_sample)) {
+        char line[128];
+        tlog_sample_text((const struct tlog_sample *)rec->payload, line, sizeof(line));
+        printf("frame %s\n", line);
+    } else if (rec->type == TLOG_COMMAND && rec->len >= sizeof(struct tlog_command)) {
+        const struct tlog_command *cmd = (const void *)rec->payload;
+        if (cmd->axis == TLOG_AXIS_SERVO) {
+            printf("command servo %d\n", cmd->value);
+        } else {
+            printf("command stepper %s %d\n", cmd->dir ? "forward" : "backward", cmd->value);
+        }
+    } else {
+        printf("type %u len %u\n", rec->type, rec->len);
+    }
+}
+
+static uint64_t parse_time(const char *arg) {
+    return (uint64_t)(strtod(arg, NULL) * 1e9);
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t from = 0, to = UINT64_MAX;
+    int type = 0, count_only = 0, opt;
+
+    while ((opt = getopt(argc, argv, "f:t:y:c")) != -1) {
+        switch (opt) {
+        case 'f':
+            from = parse_time(optarg);
+            break;
+        case 't':
+            to = parse_time(optarg);
+            break;
+        case 'y':
+            type = strcmp(optarg, "frame") == 0 ? TLOG_FRAME : strcmp(optarg, "command") == 0 ? TLOG_COMMAND : atoi(optarg);
+            break;
+        case 'c':
+            count_only = 1;
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-f from] [-t to] [-y frame|command] [-c] <dir>\n", argv[0]);
+            return 2;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "Usage: %s [-f from] [-t to] [-y frame|command] [-c] <dir>\n", argv[0]);
+        return 2;
+    }
+
+    struct tlog_view *segs;
+    size_t nsegs;
+    if (tlog_map_dir(argv[optind], &segs, &nsegs) < 0) {
+        perror("Error opening telemetry directory");
+        return 1;
+    }
+
+    struct timespec t0, t1;
+    uint64_t matched = 0, scanned = 0, corrupt = 0, bytes = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    for (size_t s = 0; s < nsegs; s++) {
+        const struct tlog_view *seg = &segs[s];
+        uint32_t generation = seg->hdr->generation;
+
+        if (!seg->count || seg->records[0].ts_ns > to || seg->records[seg->count - 1].ts_ns < from) {
+            continue;
+        }
+
+        for (uint32_t i = lower_bound(seg, from); i < seg->count; i++) {
+            const struct tlog_record *rec = &seg->records[i];
+
+            if (rec->ts_ns > to) {
+                break;
+            }
+            scanned++;
+            bytes += sizeof(*rec);
+            if (!tlog_record_valid(rec, generation)) {
+                corrupt++;
+                continue;
+            }
+            // Samples are frames as well
+            if (type && rec->type != type && !(type == TLOG_FRAME && rec->type == TLOG_SAMPLE)) {
+                continue;
+            }
+            matched++;
+            if (!count_only) {
+                print_record(rec);
+            }
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    if (count_only) {
+        double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+        printf("segments %zu scanned %llu matched %llu corrupt %llu\n", nsegs,
+               (unsigned long long)scanned, (unsigned long long)matched, (unsigned long long)corrupt);
+        printf("scan %.3f s, %.1f MB/s, %.1f Mrecords/s\n", secs,
+               secs > 0 ? bytes / secs / 1e6 : 0.0, secs > 0 ? scanned / secs / 1e6 : 0.0);
+    }
+
+    tlog_unmap_dir(segs, nsegs);
+    return corrupt ? 3 : 0;
+}
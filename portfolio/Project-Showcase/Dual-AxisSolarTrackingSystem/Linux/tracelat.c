@@ -0,0 +1,401 @@
+// tracelat - per-stage latency from LDR sample to first motor step edge.
+//
+//   tracelat [-e esp32.log] [-k kernel.log] [-b baud] [-w frame-bytes] [-H] <controller.trace>
+//
+// Joins three logs on the trace id carried in every sensor frame:
+//
+//   ESP32 debug serial   "trace <id> cap <us> tx <us>"      (optional, -e)
+//   controller -t file   "trace <id> cap <us> tx <us> rx <ns> decide <ns> write <ns>"
+//   kernel tracepoints   plat_drv_step / plat_drv_move_done with trace=<id>
+//                        (optional, -k)
+//
+// and reports min/percentiles for each stage, with log2 histograms on -H:
+//
+//   sample   capture -> frame TX           ESP32 loop work (display, logging)
+//   link     frame TX -> controller RX     UART, tty buffer and read backlog
+//   decide   RX -> direction decided       controller parsing
+//   issue    decided -> write() entry      controller dispatch
+//   driver   write() entry -> first edge   syscall and driver
+//   total    capture -> first edge (or write() entry without -k)
+//
+// -k takes what trace_pipe printed with the trace clock set to
+// CLOCK_MONOTONIC, the clock the controller stamps with:
+//
+//   cd /sys/kernel/tracing
+//   echo mono > trace_clock
+//   echo 1 > events/plat_drv/plat_drv_step/enable
+//   echo 1 > events/plat_drv/plat_drv_move_done/enable
+//   cat trace_pipe > /tmp/kernel.trace
+//
+// A stepper move's first edge is its step=0 event; a servo move's is its
+// move_done event less duration_ns. trace_pipe has microsecond resolution.
+//
+// The ESP32 and the Pi do not share a clock. The link stage is therefore
+// measured relative to the fastest frame seen: the smallest RX - TX
+// difference is taken to be the pure wire time of a frame (-w bytes at -b
+// baud), and a linear drift between the two clocks is removed using the
+// fastest frame of each half of the run.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+enum stage {
+    STAGE_SAMPLE,
+    STAGE_LINK,
+    STAGE_DECIDE,
+    STAGE_ISSUE,
+    STAGE_DRIVER,
+    STAGE_TOTAL,
+    STAGE_COUNT
+};
+
+static const char *const stage_names[STAGE_COUNT] = {
+    "sample", "link", "decide", "issue", "driver", "total",
+};
+
+struct trace_entry {
+    uint32_t id;
+    int seen_esp, seen_linux;
+    uint64_t cap_us, tx_us;         // ESP32 clock, unwrapped
+    uint64_t rx_ns, decide_ns, write_ns, edge_ns; // Pi CLOCK_MONOTONIC
+};
+
+struct samples {
+    uint64_t *v; // Nanoseconds
+    size_t n, cap;
+};
+
+static struct trace_entry *entries;
+static size_t nentries, entries_cap;
+
+// Newest entry for each id (modulo the table size). Trace ids restart when
+// the ESP32 reboots; a repeated id then simply refers to the newer frame.
+#define ID_SLOTS 65536
+static size_t id_slot[ID_SLOTS];
+
+static struct trace_entry *entry_for(uint32_t id, int create) {
+    size_t slot = id_slot[id % ID_SLOTS];
+
+    if (slot && entries[slot - 1].id == id) {
+        return &entries[slot - 1];
+    }
+    if (!create) {
+        return NULL;
+    }
+    if (nentries == entries_cap) {
+        entries_cap = entries_cap ? entries_cap * 2 : 4096;
+        entries = realloc(entries, entries_cap * sizeof(*entries));
+        if (!entries) {
+            perror("Error allocating memory");
+            exit(1);
+        }
+    }
+    memset(&entries[nentries], 0, sizeof(*entries));
+    entries[nentries].id = id;
+    id_slot[id % ID_SLOTS] = ++nentries;
+    return &entries[nentries - 1];
+}
+
+static void add_sample(struct samples *s, uint64_t ns) {
+    if (s->n == s->cap) {
+        s->cap = s->cap ? s->cap * 2 : 1024;
+        s->v = realloc(s->v, s->cap * sizeof(*s->v));
+        if (!s->v) {
+            perror("Error allocating memory");
+            exit(1);
+        }
+    }
+    s->v[s->n++] = ns;
+}
+
+// micros() is 32 bits and wraps every ~71 minutes
+static uint64_t unwrap_us(uint32_t us, uint64_t *epoch, uint32_t *last) {
+    if (us < *last && *last - us > 0x80000000u) {
+        *epoch += 1ull << 32;
+    }
+    *last = us;
+    return *epoch + us;
+}
+
+static FILE *open_log(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+    return f;
+}
+
+static void read_esp_log(const char *path) {
+    uint64_t epoch = 0;
+    uint32_t last = 0;
+    char line[512];
+    FILE *f = open_log(path);
+
+    while (fgets(line, sizeof(line), f)) {
+        unsigned int id, cap, tx;
+        char *p = strstr(line, "trace ");
+        if (p && sscanf(p, "trace %u cap %u tx %u", &id, &cap, &tx) == 3) {
+            struct trace_entry *e = entry_for(id, 1);
+            e->seen_esp = 1;
+            e->tx_us = unwrap_us(tx, &epoch, &last);
+            e->cap_us = e->tx_us - (uint32_t)(tx - cap);
+        }
+    }
+    fclose(f);
+}
+
+static void read_controller_trace(const char *path) {
+    uint64_t epoch = 0;
+    uint32_t last = 0;
+    char line[512];
+    FILE *f = open_log(path);
+
+    while (fgets(line, sizeof(line), f)) {
+        unsigned int id, cap, tx;
+        unsigned long long rx, decide, wr;
+        if (sscanf(line, "trace %u cap %u tx %u rx %llu decide %llu write %llu", &id, &cap, &tx, &rx, &decide,
+                   &wr) == 6) {
+            struct trace_entry *e = entry_for(id, 1);
+            e->seen_linux = 1;
+            e->tx_us = unwrap_us(tx, &epoch, &last);
+            e->cap_us = e->tx_us - (uint32_t)(tx - cap);
+            e->rx_ns = rx;
+            e->decide_ns = decide;
+            e->write_ns = wr;
+        }
+    }
+    fclose(f);
+}
+
+// Value of " name=<n>" in a tracepoint line
+static int event_field(const char *p, const char *name, unsigned long long *v) {
+    char key[32];
+
+    snprintf(key, sizeof(key), " %s=", name);
+    p = strstr(p, key);
+    return p && sscanf(p + strlen(key), "%llu", v) == 1;
+}
+
+// The "<sec>.<usec>:" timestamp that trace_pipe puts right before ": <event>:"
+static int event_time(const char *line, const char *event, uint64_t *ns) {
+    const char *start = event, *dot;
+    unsigned long long sec, frac = 0;
+    int digits = 0;
+
+    while (start > line && start[-1] != ' ') {
+        start--;
+    }
+    if (sscanf(start, "%llu", &sec) != 1 || !(dot = strchr(start, '.')) || dot > event) {
+        return 0;
+    }
+    for (const char *d = dot + 1; d < event && *d >= '0' && *d <= '9' && digits < 9; d++, digits++) {
+        frac = frac * 10 + (*d - '0');
+    }
+    for (; digits < 9; digits++) {
+        frac *= 10;
+    }
+    *ns = sec * 1000000000ull + frac;
+    return 1;
+}
+
+static void read_kernel_log(const char *path) {
+    char line[512];
+    FILE *f = open_log(path);
+
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long long id, step, duration;
+        uint64_t ts, edge;
+        char *p;
+
+        if ((p = strstr(line, ": plat_drv_step: ")) && event_field(p, "step", &step) && step == 0 &&
+            event_field(p, "trace", &id) && event_time(line, p, &ts)) {
+            edge = ts;
+        } else if ((p = strstr(line, ": plat_drv_move_done: ")) && event_field(p, "trace", &id) &&
+                   event_field(p, "duration_ns", &duration) && event_time(line, p, &ts) && duration <= ts) {
+            edge = ts - duration;
+        } else {
+            continue;
+        }
+        // A frame may move both axes; its first edge is the earlier one
+        struct trace_entry *e = id ? entry_for(id, 0) : NULL;
+        if (e && (!e->edge_ns || edge < e->edge_ns)) {
+            e->edge_ns = edge;
+        }
+    }
+    fclose(f);
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double pct_us(const struct samples *s, double p) {
+    return s->v[(size_t)(p * (s->n - 1) + 0.5)] / 1000.0;
+}
+
+static void print_histogram(const char *name, const struct samples *s) {
+    size_t buckets[40] = { 0 }, peak = 0;
+
+    for (size_t i = 0; i < s->n; i++) {
+        uint64_t us = s->v[i] / 1000;
+        int b = 0;
+        while (us >> b && b < 39) {
+            b++;
+        }
+        buckets[b]++;
+    }
+    for (int b = 0; b < 40; b++) {
+        if (buckets[b] > peak) {
+            peak = buckets[b];
+        }
+    }
+
+    printf("\n%s (us)\n", name);
+    for (int b = 0; b < 40; b++) {
+        if (!buckets[b]) {
+            continue;
+        }
+        unsigned long long lo = b ? 1ull << (b - 1) : 0, hi = 1ull << b;
+        int bar = (int)(buckets[b] * 50 / peak);
+        printf("  %9llu - %-9llu %8zu %.*s\n", lo, hi, buckets[b], bar ? bar : 1,
+               "##################################################");
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const char *espLog = NULL, *kernelLog = NULL;
+    int baud = 115200, frameBytes = 24, histograms = 0, opt;
+
+    while ((opt = getopt(argc, argv, "e:k:b:w:H")) != -1) {
+        switch (opt) {
+        case 'e':
+            espLog = optarg;
+            break;
+        case 'k':
+            kernelLog = optarg;
+            break;
+        case 'b':
+            baud = atoi(optarg);
+            break;
+        case 'w':
+            frameBytes = atoi(optarg);
+            break;
+        case 'H':
+            histograms = 1;
+            break;
+        default:
+            goto usage;
+        }
+    }
+    if (optind >= argc) {
+        goto usage;
+    }
+
+    if (espLog) {
+        read_esp_log(espLog);
+    }
+    read_controller_trace(argv[optind]);
+    if (kernelLog) {
+        read_kernel_log(kernelLog);
+    }
+
+    // Clock alignment for the link stage: fastest frame of each half
+    size_t received = 0, sentOnly = 0;
+    int64_t minOff[2] = { INT64_MAX, INT64_MAX };
+    double minTx[2] = { 0, 0 };
+    uint64_t firstTx = 0, lastTx = 0;
+    for (size_t i = 0; i < nentries; i++) {
+        struct trace_entry *e = &entries[i];
+        if (!e->seen_linux) {
+            sentOnly += e->seen_esp;
+            continue;
+        }
+        if (!received++) {
+            firstTx = e->tx_us;
+        }
+        lastTx = e->tx_us;
+    }
+    uint64_t midTx = firstTx + (lastTx - firstTx) / 2;
+    for (size_t i = 0; i < nentries; i++) {
+        struct trace_entry *e = &entries[i];
+        if (!e->seen_linux) {
+            continue;
+        }
+        int half = e->tx_us > midTx;
+        int64_t off = (int64_t)e->rx_ns - (int64_t)(e->tx_us * 1000);
+        if (off < minOff[half]) {
+            minOff[half] = off;
+            minTx[half] = e->tx_us;
+        }
+    }
+    double slope = 0; // Drift in ns of offset per us of ESP32 time
+    if (minOff[0] != INT64_MAX && minOff[1] != INT64_MAX && minTx[1] > minTx[0]) {
+        slope = (minOff[1] - minOff[0]) / (minTx[1] - minTx[0]);
+    } else if (minOff[0] == INT64_MAX) {
+        minOff[0] = minOff[1];
+        minTx[0] = minTx[1];
+    }
+    double wireNs = frameBytes * 10.0 * 1e9 / baud;
+
+    struct samples stages[STAGE_COUNT] = { { 0 } };
+    for (size_t i = 0; i < nentries; i++) {
+        struct trace_entry *e = &entries[i];
+        if (!e->seen_linux) {
+            continue;
+        }
+        double baseline = minOff[0] + slope * ((double)e->tx_us - minTx[0]);
+        double link = (double)e->rx_ns - (double)e->tx_us * 1000 - baseline + wireNs;
+        uint64_t end = e->edge_ns ? e->edge_ns : e->write_ns;
+
+        add_sample(&stages[STAGE_SAMPLE], (e->tx_us - e->cap_us) * 1000);
+        add_sample(&stages[STAGE_LINK], link > 0 ? (uint64_t)link : 0);
+        add_sample(&stages[STAGE_DECIDE], e->decide_ns - e->rx_ns);
+        if (e->write_ns) {
+            add_sample(&stages[STAGE_ISSUE], e->write_ns - e->decide_ns);
+        }
+        if (e->write_ns && e->edge_ns) {
+            add_sample(&stages[STAGE_DRIVER], e->edge_ns - e->write_ns);
+        }
+        if (end) {
+            add_sample(&stages[STAGE_TOTAL], (e->tx_us - e->cap_us) * 1000 + (uint64_t)(link > 0 ? link : 0) +
+                                                 (end - e->rx_ns));
+        }
+    }
+
+    printf("frames received %zu, sent but not received %zu, clock drift %.1f ppm\n", received, sentOnly,
+           slope * 1000.0);
+    printf("%-8s %8s %10s %10s %10s %10s %10s\n", "stage", "count", "min us", "p50 us", "p90 us", "p99 us",
+           "max us");
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        struct samples *st = &stages[s];
+        if (!st->n) {
+            printf("%-8s %8zu\n", stage_names[s], st->n);
+            continue;
+        }
+        qsort(st->v, st->n, sizeof(*st->v), cmp_u64);
+        printf("%-8s %8zu %10.0f %10.0f %10.0f %10.0f %10.0f\n", stage_names[s], st->n, st->v[0] / 1000.0,
+               pct_us(st, 0.5), pct_us(st, 0.9), pct_us(st, 0.99), st->v[st->n - 1] / 1000.0);
+    }
+    if (histograms) {
+        for (int s = 0; s < STAGE_COUNT; s++) {
+            if (stages[s].n) {
+                print_histogram(stage_names[s], &stages[s]);
+            }
+        }
+    }
+
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        free(stages[s].v);
+    }
+    free(entries);
+    return 0;
+
+usage:
+    fprintf(stderr, "Usage: %s [-e esp32.log] [-k kernel.log] [-b baud] [-w frame-bytes] [-H] <controller.trace>\n",
+            argv[0]);
+    return 2;
+}
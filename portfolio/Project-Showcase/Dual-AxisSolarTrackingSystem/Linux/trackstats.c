@@ -0,0 +1,925 @@
+// trackstats - daily tracking, yield and motor duty reports from the
+// controller's telemetry logs.
+//
+//   trackstats [-j threads] [-J] [-z hours] [-W watts] [-n level] [name=]log...
+//   trackstats -B trackers[xdays] [-j threads]
+//
+// Each log is one tracker: a telemetry directory written by the controller
+// or fleet (-l), or a text dump of one made with tlogread, which is how
+// months of history are kept once the ring has wrapped. The tracker is
+// named after the log unless a name= prefix is given.
+//
+// Records are filed into one chunk per tracker and day and stored there by
+// column (frame times, light, direction; command times, axis, value), so
+// the reductions below are straight loops over small arrays of one type
+// that the compiler turns into SIMD code. Logs are ingested and chunks
+// aggregated on a work-stealing thread pool of -j workers (default: one
+// per CPU): each worker starts on its own share of the chunks, largest
+// first, and takes the smallest remaining ones from the others once its
+// own are done.
+//
+// One CSV row (JSON object with -J) per tracker and day:
+//
+//   frames          frames received
+//   tracking_error  mean over daylight minutes of (|R - L| + |U - D|) / n,
+//                   n the frames in that minute: 0 while the brightest
+//                   sensor alternates around the sun, 1 while the tracker
+//                   lags it all minute
+//   az_bias         (R - L) / frames, el_bias (U - D) / frames
+//   yield_wh        light / 4095 * -W watts over the time to the next frame
+//                   (at most GAP_MS); frames without a light reading, or
+//                   logged raw and possibly cut short, add nothing
+//   servo_moves, servo_degrees, stepper_steps
+//   motor_s         STEP_MS per step and SERVO_MS per servo command, as the
+//                   gpiod backend drives them; duty is motor_s per day
+//
+// followed by a row per tracker with date "all" and a row per day with
+// tracker "all". Times are UTC unless -z gives the trackers' offset in
+// hours; a minute whose brightest reading is below -n (default 100) is
+// night and left out of tracking_error.
+//
+// -B runs the aggregation on a synthetic fleet of trackers x days (default
+// 365) with 1, 2, 4 ... -j threads, checks that every run gives the same
+// result and prints the time and speedup of each.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "tlog.h"
+
+#define DAY_MS 86400000u
+#define MINUTES 1440
+#define GAP_MS 120000u      // Longest time one frame's light is held for
+#define STEP_MS 2           // Stepper step period of the gpiod backend
+#define SERVO_MS 20         // One PWM period per servo command
+#define FULL_LIGHT 4095.0
+
+enum dir { DIR_LEFT, DIR_RIGHT, DIR_UP, DIR_DOWN, DIR_OTHER };
+
+// One tracker's records of one day, by column. Times are ms since the
+// start of the day.
+struct chunk {
+    uint32_t tracker;
+    int32_t day;              // Days since the epoch, local
+    uint32_t nframes, framecap;
+    uint32_t *frame_ms;
+    int16_t *light;           // -1 if the frame carried none
+    int8_t *dir;              // enum dir
+    uint32_t ncmds, cmdcap;
+    uint32_t *cmd_ms;
+    int16_t *value;           // Servo angle or stepper steps
+    uint8_t *axis;            // enum tlog_axis
+    int unordered;            // Set when a record arrived out of time order
+    uint32_t index;           // In chunks[] and results[]
+};
+
+struct tracker {
+    const char *name;
+    const char *path;
+    int32_t first;            // Day of chunk_of[0]
+    uint32_t ndays;
+    uint32_t *chunk_of;       // Index into chunks + 1, 0 for a day without records
+    struct chunk **chunks;    // This tracker's chunks, in order of creation
+    uint32_t nchunks, chunkcap;
+    uint64_t bad;             // Records that failed their CRC or did not parse
+};
+
+// Sums for one chunk; rows are derived from merged sums
+struct agg {
+    uint64_t frames;
+    uint64_t dirs[4];
+    double error_sum;
+    uint64_t error_minutes;
+    uint64_t light_ms;        // Sum of light * ms held
+    uint64_t servo_moves;
+    uint64_t servo_degrees;
+    uint64_t stepper_steps;
+};
+
+static struct tracker *trackers;
+static uint32_t ntrackers;
+static struct chunk **chunks;
+static uint32_t nchunks;
+static struct agg *results;
+
+static int tzSeconds;
+static double watts = 100;
+static int nightLevel = 100;
+
+static void *xrealloc(void *p, size_t size) {
+    p = realloc(p, size);
+    if (!p) {
+        perror("Error allocating memory");
+        exit(1);
+    }
+    return p;
+}
+
+// ---------------------------------------------------------------------------
+// Work-stealing pool. Tasks are indices; nothing is added once it runs, so a
+// worker that finds every deque empty is done.
+
+struct deque {
+    pthread_mutex_t lock;
+    uint32_t *tasks;
+    uint32_t head, tail;      // Owner takes from head, thieves from tail
+};
+
+struct pool {
+    int nworkers;
+    struct deque *q;
+    void (*run)(uint32_t task);
+    atomic_uint steals;
+};
+
+struct worker {
+    struct pool *pool;
+    int id;
+};
+
+static int take(struct deque *q, int steal, uint32_t *task) {
+    int got = 0;
+    pthread_mutex_lock(&q->lock);
+    if (q->head < q->tail) {
+        *task = steal ? q->tasks[--q->tail] : q->tasks[q->head++];
+        got = 1;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return got;
+}
+
+static void *work(void *arg) {
+    struct worker *w = arg;
+    struct pool *p = w->pool;
+    uint32_t task;
+
+    for (;;) {
+        if (take(&p->q[w->id], 0, &task)) {
+            p->run(task);
+            continue;
+        }
+        int stolen = 0;
+        for (int k = 1; k < p->nworkers && !stolen; k++) {
+            stolen = take(&p->q[(w->id + k) % p->nworkers], 1, &task);
+        }
+        if (!stolen) {
+            return NULL;
+        }
+        atomic_fetch_add_explicit(&p->steals, 1, memory_order_relaxed);
+        p->run(task);
+    }
+}
+
+// Runs tasks[0..n), given largest first, on `nworkers` threads; returns
+// the number of tasks stolen
+static unsigned run_pool(const uint32_t *tasks, uint32_t n, int nworkers, void (*run)(uint32_t)) {
+    struct pool p = { .nworkers = nworkers, .run = run };
+    struct worker *w = xrealloc(NULL, nworkers * sizeof(*w));
+    pthread_t *threads = xrealloc(NULL, nworkers * sizeof(*threads));
+
+    p.q = xrealloc(NULL, nworkers * sizeof(*p.q));
+    atomic_init(&p.steals, 0);
+    for (int i = 0; i < nworkers; i++) {
+        pthread_mutex_init(&p.q[i].lock, NULL);
+        p.q[i].tasks = xrealloc(NULL, (n / nworkers + 1) * sizeof(uint32_t));
+        p.q[i].head = p.q[i].tail = 0;
+    }
+    // Dealt round robin, so every deque runs from its largest to its smallest
+    for (uint32_t t = 0; t < n; t++) {
+        struct deque *q = &p.q[t % nworkers];
+        q->tasks[q->tail++] = tasks[t];
+    }
+    for (int i = 0; i < nworkers; i++) {
+        w[i].pool = &p;
+        w[i].id = i;
+        if (i && pthread_create(&threads[i], NULL, work, &w[i]) != 0) {
+            perror("Error starting worker");
+            exit(1);
+        }
+    }
+    work(&w[0]);
+    for (int i = 1; i < nworkers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    for (int i = 0; i < nworkers; i++) {
+        pthread_mutex_destroy(&p.q[i].lock);
+        free(p.q[i].tasks);
+    }
+    unsigned steals = atomic_load(&p.steals);
+    free(p.q);
+    free(threads);
+    free(w);
+    return steals;
+}
+
+// ---------------------------------------------------------------------------
+// Ingest
+
+static struct chunk *chunk_for(struct tracker *t, uint32_t id, int32_t day) {
+    if (!t->ndays) {
+        t->first = day;
+    }
+    if (day < t->first) {
+        uint32_t shift = t->first - day;
+        t->chunk_of = xrealloc(t->chunk_of, (t->ndays + shift) * sizeof(uint32_t));
+        memmove(t->chunk_of + shift, t->chunk_of, t->ndays * sizeof(uint32_t));
+        memset(t->chunk_of, 0, shift * sizeof(uint32_t));
+        t->ndays += shift;
+        t->first = day;
+    } else if ((uint32_t)(day - t->first) >= t->ndays) {
+        uint32_t ndays = day - t->first + 1;
+        t->chunk_of = xrealloc(t->chunk_of, ndays * sizeof(uint32_t));
+        memset(t->chunk_of + t->ndays, 0, (ndays - t->ndays) * sizeof(uint32_t));
+        t->ndays = ndays;
+    }
+    uint32_t *slot = &t->chunk_of[day - t->first];
+    if (!*slot) {
+        struct chunk *c = calloc(1, sizeof(*c));
+        if (!c) {
+            perror("Error allocating memory");
+            exit(1);
+        }
+        c->tracker = id;
+        c->day = day;
+        if (t->nchunks == t->chunkcap) {
+            t->chunkcap = t->chunkcap ? t->chunkcap * 2 : 64;
+            t->chunks = xrealloc(t->chunks, t->chunkcap * sizeof(*t->chunks));
+        }
+        t->chunks[t->nchunks++] = c;
+        *slot = t->nchunks;
+    }
+    return t->chunks[*slot - 1];
+}
+
+static void split_time(uint64_t ts_ns, int32_t *day, uint32_t *ms) {
+    int64_t local = (int64_t)(ts_ns / 1000000) + (int64_t)tzSeconds * 1000;
+    int64_t d = local >= 0 ? local / DAY_MS : -((-local + DAY_MS - 1) / DAY_MS);
+    *day = (int32_t)d;
+    *ms = (uint32_t)(local - d * DAY_MS);
+}
+
+static void add_frame(struct tracker *t, uint32_t id, uint64_t ts_ns, int light, int dir) {
+    int32_t day;
+    uint32_t ms;
+    split_time(ts_ns, &day, &ms);
+    struct chunk *c = chunk_for(t, id, day);
+    if (c->nframes == c->framecap) {
+        c->framecap = c->framecap ? c->framecap * 2 : 1024;
+        c->frame_ms = xrealloc(c->frame_ms, c->framecap * sizeof(*c->frame_ms));
+        c->light = xrealloc(c->light, c->framecap * sizeof(*c->light));
+        c->dir = xrealloc(c->dir, c->framecap * sizeof(*c->dir));
+    }
+    if (c->nframes && ms < c->frame_ms[c->nframes - 1]) {
+        c->unordered = 1;
+    }
+    c->frame_ms[c->nframes] = ms;
+    c->light[c->nframes] = light;
+    c->dir[c->nframes] = dir;
+    c->nframes++;
+}
+
+static void add_command(struct tracker *t, uint32_t id, uint64_t ts_ns, int axis, int value) {
+    int32_t day;
+    uint32_t ms;
+    split_time(ts_ns, &day, &ms);
+    struct chunk *c = chunk_for(t, id, day);
+    if (c->ncmds == c->cmdcap) {
+        c->cmdcap = c->cmdcap ? c->cmdcap * 2 : 1024;
+        c->cmd_ms = xrealloc(c->cmd_ms, c->cmdcap * sizeof(*c->cmd_ms));
+        c->value = xrealloc(c->value, c->cmdcap * sizeof(*c->value));
+        c->axis = xrealloc(c->axis, c->cmdcap * sizeof(*c->axis));
+    }
+    if (c->ncmds && ms < c->cmd_ms[c->ncmds - 1]) {
+        c->unordered = 1;
+    }
+    c->cmd_ms[c->ncmds] = ms;
+    c->value[c->ncmds] = value;
+    c->axis[c->ncmds] = axis;
+    c->ncmds++;
+}
+
+static int direction_of(const char *word, size_t len) {
+    return len == 7 && memcmp(word, "Venstre", 7) == 0 ? DIR_LEFT
+         : len == 6 && memcmp(word, "Højre", 6) == 0   ? DIR_RIGHT
+         : len == 2 && memcmp(word, "Op", 2) == 0      ? DIR_UP
+         : len == 3 && memcmp(word, "Ned", 3) == 0     ? DIR_DOWN
+                                                       : DIR_OTHER;
+}
+
+static int light_of(int light) {
+    return light >= 0 && light <= 4095 ? light : -1;
+}
+
+// A frame as the ESP32 sends it, <direction> [<trace id> <capture us>
+// <tx us> [<light>]], split on the controller's delimiters. A frame that
+// may have been cut short (`truncated`) keeps its direction but not its
+// light: the last number would be a prefix of the reading.
+static void parse_frame(const char *text, size_t len, int truncated, int *dir, int *light) {
+    char line[128];
+    if (len >= sizeof(line)) {
+        len = sizeof(line) - 1;
+        truncated = 1;
+    }
+    memcpy(line, text, len);
+    line[len] = '\0';
+
+    size_t word = strcspn(line, " ,\t\r\n");
+    *dir = direction_of(line, word);
+    unsigned long trace, cap, tx;
+    int l;
+    *light = !truncated && sscanf(line + word, "%lu %lu %lu %d", &trace, &cap, &tx, &l) == 4 ? light_of(l) : -1;
+}
+
+static void ingest_tlog(struct tracker *t, uint32_t id) {
+    struct tlog_view *segs;
+    size_t nsegs;
+    if (tlog_map_dir(t->path, &segs, &nsegs) < 0) {
+        fprintf(stderr, "Error opening %s: %s\n", t->path, strerror(errno));
+        exit(1);
+    }
+    for (size_t s = 0; s < nsegs; s++) {
+        for (uint32_t i = 0; i < segs[s].count; i++) {
+            const struct tlog_record *rec = &segs[s].records[i];
+            if (!tlog_record_valid(rec, segs[s].hdr->generation)) {
+                t->bad++;
+            } else if (rec->type == TLOG_FRAME) {
+                int dir, light;
+                parse_frame((const char *)rec->payload, rec->len, rec->len == TLOG_PAYLOAD_MAX, &dir, &light);
+                add_frame(t, id, rec->ts_ns, light, dir);
+            } else if (rec->type == TLOG_SAMPLE && rec->len >= sizeof(struct tlog_sample)) {
+                const struct tlog_sample *sample = (const void *)rec->payload;
+                size_t word = strnlen(sample->direction, sizeof(sample->direction));
+                add_frame(t, id, rec->ts_ns, light_of(sample->light), direction_of(sample->direction, word));
+            } else if (rec->type == TLOG_COMMAND && rec->len >= sizeof(struct tlog_command)) {
+                const struct tlog_command *cmd = (const void *)rec->payload;
+                add_command(t, id, rec->ts_ns, cmd->axis, cmd->value);
+            }
+        }
+    }
+    tlog_unmap_dir(segs, nsegs);
+}
+
+// tlogread output: <s>.<ns> <seq> frame <line> | command servo <angle> |
+// command stepper forward|backward <steps>
+static void ingest_text(struct tracker *t, uint32_t id) {
+    FILE *in = strcmp(t->path, "-") == 0 ? stdin : fopen(t->path, "r");
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+
+    if (!in) {
+        fprintf(stderr, "Error opening %s: %s\n", t->path, strerror(errno));
+        exit(1);
+    }
+    while ((len = getline(&line, &cap, in)) > 0) {
+        unsigned long long sec, ns;
+        unsigned seq;
+        int at = 0, value;
+        char axis[8], way[9];
+
+        if (line[len - 1] == '\n') {
+            line[--len] = '\0';
+        }
+        if (sscanf(line, "%llu.%9llu %u %n", &sec, &ns, &seq, &at) < 3 || !at) {
+            t->bad++;
+            continue;
+        }
+        uint64_t ts = sec * 1000000000ull + ns;
+        if (strncmp(line + at, "frame ", 6) == 0 || strcmp(line + at, "frame") == 0) {
+            int dir, light;
+            char *text = line + at + (line[at + 5] ? 6 : 5);
+            size_t textLen = strlen(text);
+            int truncated = textLen >= 12 && strcmp(text + textLen - 12, " [truncated]") == 0;
+            parse_frame(text, textLen, truncated, &dir, &light);
+            add_frame(t, id, ts, light, dir);
+        } else if (sscanf(line + at, "command %7s %d", axis, &value) == 2 && strcmp(axis, "servo") == 0) {
+            add_command(t, id, ts, TLOG_AXIS_SERVO, value);
+        } else if (sscanf(line + at, "command %7s %8s %d", axis, way, &value) == 3 && strcmp(axis, "stepper") == 0) {
+            add_command(t, id, ts, TLOG_AXIS_STEPPER, value);
+        } else {
+            t->bad++;
+        }
+    }
+    free(line);
+    if (in != stdin) {
+        fclose(in);
+    }
+}
+
+static void ingest(uint32_t id) {
+    struct stat st;
+    struct tracker *t = &trackers[id];
+    if (strcmp(t->path, "-") != 0 && stat(t->path, &st) == 0 && S_ISDIR(st.st_mode)) {
+        ingest_tlog(t, id);
+    } else {
+        ingest_text(t, id);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Aggregation
+
+static int by_frame_time(const void *a, const void *b) {
+    const uint64_t *x = a, *y = b;
+    return (*x > *y) - (*x < *y);
+}
+
+// Puts a chunk's records back in time order; rare (clock steps, merged
+// dumps), so it simply sorts (time, index) pairs
+static void sort_chunk(struct chunk *c) {
+    uint32_t n = c->nframes > c->ncmds ? c->nframes : c->ncmds;
+    uint64_t *keys = xrealloc(NULL, (n ? n : 1) * sizeof(*keys));
+    uint32_t *ms = xrealloc(NULL, (n ? n : 1) * sizeof(*ms));
+    int16_t *v16 = xrealloc(NULL, (n ? n : 1) * sizeof(*v16));
+    int8_t *v8 = xrealloc(NULL, (n ? n : 1) * sizeof(*v8));
+
+    for (uint32_t i = 0; i < c->nframes; i++) {
+        keys[i] = (uint64_t)c->frame_ms[i] << 32 | i;
+    }
+    qsort(keys, c->nframes, sizeof(*keys), by_frame_time);
+    for (uint32_t i = 0; i < c->nframes; i++) {
+        uint32_t from = (uint32_t)keys[i];
+        ms[i] = c->frame_ms[from];
+        v16[i] = c->light[from];
+        v8[i] = c->dir[from];
+    }
+    memcpy(c->frame_ms, ms, c->nframes * sizeof(*ms));
+    memcpy(c->light, v16, c->nframes * sizeof(*v16));
+    memcpy(c->dir, v8, c->nframes * sizeof(*v8));
+
+    for (uint32_t i = 0; i < c->ncmds; i++) {
+        keys[i] = (uint64_t)c->cmd_ms[i] << 32 | i;
+    }
+    qsort(keys, c->ncmds, sizeof(*keys), by_frame_time);
+    for (uint32_t i = 0; i < c->ncmds; i++) {
+        uint32_t from = (uint32_t)keys[i];
+        ms[i] = c->cmd_ms[from];
+        v16[i] = c->value[from];
+        v8[i] = c->axis[from];
+    }
+    memcpy(c->cmd_ms, ms, c->ncmds * sizeof(*ms));
+    memcpy(c->value, v16, c->ncmds * sizeof(*v16));
+    for (uint32_t i = 0; i < c->ncmds; i++) {
+        c->axis[i] = v8[i];
+    }
+    c->unordered = 0;
+    free(keys);
+    free(ms);
+    free(v16);
+    free(v8);
+}
+
+static void aggregate(uint32_t index) {
+    struct chunk *c = chunks[index];
+    struct agg a = {0};
+    uint32_t n = c->nframes;
+
+    if (c->unordered) {
+        sort_chunk(c);
+    }
+    a.frames = n;
+
+    // Direction totals: compare-and-add over the direction column
+    uint32_t left = 0, right = 0, up = 0, down = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        left += c->dir[i] == DIR_LEFT;
+        right += c->dir[i] == DIR_RIGHT;
+        up += c->dir[i] == DIR_UP;
+        down += c->dir[i] == DIR_DOWN;
+    }
+    a.dirs[DIR_LEFT] = left;
+    a.dirs[DIR_RIGHT] = right;
+    a.dirs[DIR_UP] = up;
+    a.dirs[DIR_DOWN] = down;
+
+    // Yield: each frame's light held until the next frame, at most GAP_MS
+    uint64_t lightMs = 0;
+    for (uint32_t i = 0; i + 1 < n; i++) {
+        uint32_t dt = c->frame_ms[i + 1] - c->frame_ms[i];
+        dt = dt < GAP_MS ? dt : GAP_MS;
+        uint32_t l = c->light[i] > 0 ? (uint32_t)c->light[i] : 0;
+        lightMs += (uint64_t)(l * dt);
+    }
+    if (n) {
+        uint32_t dt = DAY_MS - c->frame_ms[n - 1];
+        dt = dt < GAP_MS ? dt : GAP_MS;
+        lightMs += (uint64_t)(c->light[n - 1] > 0 ? c->light[n - 1] : 0) * dt;
+    }
+    a.light_ms = lightMs;
+
+    // Tracking error per minute
+    uint16_t count[MINUTES][4];
+    int16_t brightest[MINUTES];
+    memset(count, 0, sizeof(count));
+    for (int m = 0; m < MINUTES; m++) {
+        brightest[m] = INT16_MIN;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t m = c->frame_ms[i] / 60000;
+        if (c->dir[i] != DIR_OTHER && count[m][(int)c->dir[i]] < UINT16_MAX) {
+            count[m][(int)c->dir[i]]++;
+        }
+        if (c->light[i] > brightest[m]) {
+            brightest[m] = c->light[i];
+        }
+    }
+    for (int m = 0; m < MINUTES; m++) {
+        int total = count[m][DIR_LEFT] + count[m][DIR_RIGHT] + count[m][DIR_UP] + count[m][DIR_DOWN];
+        // -1: no frame that minute carried a light reading, so count it
+        if (total && (brightest[m] < 0 || brightest[m] >= nightLevel)) {
+            a.error_sum += (double)(abs(count[m][DIR_RIGHT] - count[m][DIR_LEFT]) +
+                                    abs(count[m][DIR_UP] - count[m][DIR_DOWN])) / total;
+            a.error_minutes++;
+        }
+    }
+
+    // Motor work: compare-and-add over the command columns, then the servo
+    // travel, which needs the previous angle
+    uint32_t moves = 0;
+    int64_t steps = 0;
+    for (uint32_t i = 0; i < c->ncmds; i++) {
+        moves += c->axis[i] == TLOG_AXIS_SERVO;
+        steps += c->axis[i] == TLOG_AXIS_STEPPER ? abs(c->value[i]) : 0;
+    }
+    a.servo_moves = moves;
+    a.stepper_steps = steps;
+    int prev = -1;
+    for (uint32_t i = 0; i < c->ncmds; i++) {
+        if (c->axis[i] == TLOG_AXIS_SERVO) {
+            if (prev >= 0) {
+                a.servo_degrees += abs(c->value[i] - prev);
+            }
+            prev = c->value[i];
+        }
+    }
+
+    results[index] = a;
+}
+
+static void merge(struct agg *into, const struct agg *a) {
+    into->frames += a->frames;
+    for (int d = 0; d < 4; d++) {
+        into->dirs[d] += a->dirs[d];
+    }
+    into->error_sum += a->error_sum;
+    into->error_minutes += a->error_minutes;
+    into->light_ms += a->light_ms;
+    into->servo_moves += a->servo_moves;
+    into->servo_degrees += a->servo_degrees;
+    into->stepper_steps += a->stepper_steps;
+}
+
+// ---------------------------------------------------------------------------
+// Output
+
+static int json;
+static int rows;
+
+static void print_row(const char *tracker, int32_t day, int alldays, uint32_t ndays, const struct agg *a) {
+    char date[16];
+    if (alldays) {
+        strcpy(date, "all");
+    } else {
+        time_t t = (time_t)day * 86400;
+        struct tm tm;
+        gmtime_r(&t, &tm);
+        strftime(date, sizeof(date), "%Y-%m-%d", &tm);
+    }
+    uint64_t dirs = a->dirs[0] + a->dirs[1] + a->dirs[2] + a->dirs[3];
+    double error = a->error_minutes ? a->error_sum / a->error_minutes : 0;
+    double az = dirs ? ((double)a->dirs[DIR_RIGHT] - a->dirs[DIR_LEFT]) / dirs : 0;
+    double el = dirs ? ((double)a->dirs[DIR_UP] - a->dirs[DIR_DOWN]) / dirs : 0;
+    double yield = a->light_ms / FULL_LIGHT * watts / 3600000.0;
+    double motor = (a->stepper_steps * STEP_MS + a->servo_moves * SERVO_MS) / 1000.0;
+    double duty = motor / (86400.0 * (ndays ? ndays : 1));
+
+    if (json) {
+        printf("%s\n  {\"tracker\":\"%s\",\"date\":\"%s\",\"frames\":%llu,\"tracking_error\":%.4f,"
+               "\"az_bias\":%.4f,\"el_bias\":%.4f,\"yield_wh\":%.2f,\"servo_moves\":%llu,"
+               "\"servo_degrees\":%llu,\"stepper_steps\":%llu,\"motor_s\":%.3f,\"duty\":%.6f}",
+               rows ? "," : "[", tracker, date, (unsigned long long)a->frames, error, az, el, yield,
+               (unsigned long long)a->servo_moves, (unsigned long long)a->servo_degrees,
+               (unsigned long long)a->stepper_steps, motor, duty);
+    } else {
+        if (!rows) {
+            printf("tracker,date,frames,tracking_error,az_bias,el_bias,yield_wh,servo_moves,servo_degrees,"
+                   "stepper_steps,motor_s,duty\n");
+        }
+        printf("%s,%s,%llu,%.4f,%.4f,%.4f,%.2f,%llu,%llu,%llu,%.3f,%.6f\n", tracker, date,
+               (unsigned long long)a->frames, error, az, el, yield, (unsigned long long)a->servo_moves,
+               (unsigned long long)a->servo_degrees, (unsigned long long)a->stepper_steps, motor, duty);
+    }
+    rows++;
+}
+
+static void report(void) {
+    int32_t first = INT32_MAX, last = INT32_MIN;
+    for (uint32_t i = 0; i < ntrackers; i++) {
+        struct tracker *t = &trackers[i];
+        struct agg total = {0};
+        uint32_t days = 0;
+        for (uint32_t d = 0; d < t->ndays; d++) {
+            if (t->chunk_of[d]) {
+                struct chunk *c = t->chunks[t->chunk_of[d] - 1];
+                print_row(t->name, c->day, 0, 1, &results[c->index]);
+                merge(&total, &results[c->index]);
+                days++;
+                first = c->day < first ? c->day : first;
+                last = c->day > last ? c->day : last;
+            }
+        }
+        print_row(t->name, 0, 1, days, &total);
+    }
+
+    // Fleet per day
+    if (first <= last) {
+        uint32_t ndays = last - first + 1;
+        struct agg *fleet = calloc(ndays, sizeof(*fleet));
+        struct agg all = {0};
+        uint32_t *trackerDays = calloc(ndays, sizeof(*trackerDays));
+        if (!fleet || !trackerDays) {
+            perror("Error allocating memory");
+            exit(1);
+        }
+        for (uint32_t i = 0; i < nchunks; i++) {
+            merge(&fleet[chunks[i]->day - first], &results[i]);
+            trackerDays[chunks[i]->day - first]++;
+        }
+        for (uint32_t d = 0; d < ndays; d++) {
+            if (trackerDays[d]) {
+                print_row("all", first + d, 0, trackerDays[d], &fleet[d]);
+                merge(&all, &fleet[d]);
+            }
+        }
+        print_row("all", 0, 1, nchunks, &all);
+        free(fleet);
+        free(trackerDays);
+    }
+    if (json) {
+        printf(rows ? "\n]\n" : "[]\n");
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Synthetic fleet for -B: frames every 60 s at night, every 5 s by day and
+// every 500 ms while two clouds pass, each followed by its motor command
+
+static uint32_t xorshift(uint32_t *s) {
+    *s ^= *s << 13;
+    *s ^= *s >> 17;
+    *s ^= *s << 5;
+    return *s;
+}
+
+static void synthesize(uint32_t index) {
+    struct chunk *c = chunks[index];
+    uint32_t seed = c->tracker * 2654435761u ^ (uint32_t)c->day * 40503u ^ 0x9E3779B9u;
+    uint32_t cloud[2];
+    xorshift(&seed);
+    for (int k = 0; k < 2; k++) {
+        cloud[k] = (8 + xorshift(&seed) % 8) * 3600000u;
+    }
+
+    uint32_t cap = 20000;
+    c->frame_ms = xrealloc(NULL, cap * sizeof(*c->frame_ms));
+    c->light = xrealloc(NULL, cap * sizeof(*c->light));
+    c->dir = xrealloc(NULL, cap * sizeof(*c->dir));
+    c->cmd_ms = xrealloc(NULL, cap * sizeof(*c->cmd_ms));
+    c->value = xrealloc(NULL, cap * sizeof(*c->value));
+    c->axis = xrealloc(NULL, cap * sizeof(*c->axis));
+
+    for (uint32_t ms = xorshift(&seed) % 1000; ms < DAY_MS && c->nframes < cap;) {
+        double h = ms / 3600000.0;
+        int inCloud = (ms - cloud[0] < 600000u) || (ms - cloud[1] < 600000u);
+        int light = 20 + xorshift(&seed) % 30;
+        uint32_t step = 60000;
+        if (h >= 6 && h < 20) {
+            light += (int)(3000 * sin(M_PI * (h - 6) / 14) * (inCloud && (ms / 30000) % 2 ? 0.3 : 1));
+            step = inCloud ? 500 : 5000;
+        }
+        int dir = xorshift(&seed) % 4;
+        uint32_t i = c->nframes++;
+        c->frame_ms[i] = ms;
+        c->light[i] = light;
+        c->dir[i] = dir;
+        c->cmd_ms[i] = ms + 1;
+        c->axis[i] = dir <= DIR_RIGHT ? TLOG_AXIS_STEPPER : TLOG_AXIS_SERVO;
+        c->value[i] = dir <= DIR_RIGHT ? 50 : dir == DIR_UP ? 90 : 0;
+        c->ncmds++;
+        ms += step;
+    }
+}
+
+static double seconds_since(const struct timespec *t0) {
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (t1.tv_sec - t0->tv_sec) + (t1.tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+static uint32_t *size_order(void);
+
+static int bench(const char *spec, int maxThreads) {
+    unsigned ntr = 0, ndays = 365;
+    if (sscanf(spec, "%ux%u", &ntr, &ndays) < 1 || !ntr || !ndays) {
+        fprintf(stderr, "Error: -B wants trackers[xdays]\n");
+        return 2;
+    }
+    ntrackers = ntr;
+    nchunks = ntr * ndays;
+    chunks = xrealloc(NULL, nchunks * sizeof(*chunks));
+    for (uint32_t i = 0; i < nchunks; i++) {
+        chunks[i] = calloc(1, sizeof(**chunks));
+        if (!chunks[i]) {
+            perror("Error allocating memory");
+            return 1;
+        }
+        chunks[i]->tracker = i / ndays;
+        chunks[i]->day = 20000 + i % ndays;
+    }
+
+    struct timespec t0;
+    uint32_t *order = xrealloc(NULL, nchunks * sizeof(*order));
+    for (uint32_t i = 0; i < nchunks; i++) {
+        order[i] = i;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    run_pool(order, nchunks, maxThreads, synthesize);
+    free(order);
+    uint64_t frames = 0, bytes = 0;
+    for (uint32_t i = 0; i < nchunks; i++) {
+        frames += chunks[i]->nframes;
+        bytes += chunks[i]->nframes * 7ull + chunks[i]->ncmds * 7ull;
+    }
+    printf("synthetic %u trackers x %u days: %llu frames, %.1f MB of columns, generated in %.2f s\n", ntr, ndays,
+           (unsigned long long)frames, bytes / 1e6, seconds_since(&t0));
+
+    order = size_order();
+    struct agg *reference = NULL;
+    double base = 0;
+    int status = 0;
+    results = xrealloc(NULL, nchunks * sizeof(*results));
+    for (int threads = 1; threads <= maxThreads; threads = threads * 2 > maxThreads && threads < maxThreads
+                                                              ? maxThreads : threads * 2) {
+        double best = 0;
+        unsigned steals = 0;
+        for (int run = 0; run < 3; run++) {
+            memset(results, 0, nchunks * sizeof(*results));
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            steals = run_pool(order, nchunks, threads, aggregate);
+            double secs = seconds_since(&t0);
+            best = run == 0 || secs < best ? secs : best;
+        }
+        if (!reference) {
+            reference = xrealloc(NULL, nchunks * sizeof(*reference));
+            memcpy(reference, results, nchunks * sizeof(*reference));
+            base = best;
+        } else if (memcmp(reference, results, nchunks * sizeof(*reference)) != 0) {
+            printf("FAIL %d threads: results differ from 1 thread\n", threads);
+            status = 1;
+        }
+        printf("threads %3d  %8.3f s  %8.1f Mframes/s  %6.1f MB/s  speedup %5.2f  steals %u\n", threads, best,
+               frames / best / 1e6, bytes / best / 1e6, base / best, steals);
+        if (threads == maxThreads) {
+            break;
+        }
+    }
+    free(reference);
+    free(order);
+    return status;
+}
+
+// Chunk indices, most frames first
+static int by_size(const void *a, const void *b) {
+    const struct chunk *x = chunks[*(const uint32_t *)a], *y = chunks[*(const uint32_t *)b];
+    uint32_t sx = x->nframes + x->ncmds, sy = y->nframes + y->ncmds;
+    return (sx < sy) - (sx > sy);
+}
+
+static uint32_t *size_order(void) {
+    uint32_t *order = xrealloc(NULL, (nchunks ? nchunks : 1) * sizeof(*order));
+    for (uint32_t i = 0; i < nchunks; i++) {
+        order[i] = i;
+    }
+    qsort(order, nchunks, sizeof(*order), by_size);
+    return order;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr,
+            "Usage: %s [-j threads] [-J] [-z hours] [-W watts] [-n level] [name=]log...\n"
+            "       %s -B trackers[xdays] [-j threads]\n",
+            name, name);
+}
+
+int main(int argc, char *argv[]) {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int nthreads = ncpu > 0 ? (int)ncpu : 1;
+    const char *benchSpec = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "j:Jz:W:n:B:")) != -1) {
+        switch (opt) {
+        case 'j':
+            nthreads = atoi(optarg);
+            break;
+        case 'J':
+            json = 1;
+            break;
+        case 'z':
+            tzSeconds = (int)(atof(optarg) * 3600);
+            break;
+        case 'W':
+            watts = atof(optarg);
+            break;
+        case 'n':
+            nightLevel = atoi(optarg);
+            break;
+        case 'B':
+            benchSpec = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+    if (benchSpec) {
+        return bench(benchSpec, nthreads);
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    ntrackers = argc - optind;
+    trackers = calloc(ntrackers, sizeof(*trackers));
+    uint32_t *order = xrealloc(NULL, ntrackers * sizeof(*order));
+    if (!trackers) {
+        perror("Error allocating memory");
+        return 1;
+    }
+    for (uint32_t i = 0; i < ntrackers; i++) {
+        char *arg = argv[optind + i];
+        char *eq = strchr(arg, '=');
+        if (eq) {
+            *eq = '\0';
+            trackers[i].name = arg;
+            trackers[i].path = eq + 1;
+        } else {
+            const char *slash = strrchr(arg, '/');
+            while (slash && slash[1] == '\0' && slash > arg) { // "dir/"
+                const char *p = slash - 1;
+                while (p > arg && *p != '/') {
+                    p--;
+                }
+                slash = *p == '/' ? p : NULL;
+            }
+            trackers[i].name = slash ? strndup(slash + 1, strcspn(slash + 1, "/")) : arg;
+            trackers[i].path = arg;
+        }
+        order[i] = i;
+    }
+
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    run_pool(order, ntrackers, nthreads < (int)ntrackers ? nthreads : (int)ntrackers, ingest);
+    free(order);
+    double ingestSecs = seconds_since(&t0);
+
+    uint64_t frames = 0, commands = 0, bad = 0;
+    for (uint32_t i = 0; i < ntrackers; i++) {
+        struct tracker *t = &trackers[i];
+        chunks = xrealloc(chunks, (nchunks + t->nchunks + 1) * sizeof(*chunks));
+        for (uint32_t c = 0; c < t->nchunks; c++) {
+            t->chunks[c]->index = nchunks;
+            chunks[nchunks++] = t->chunks[c];
+            frames += t->chunks[c]->nframes;
+            commands += t->chunks[c]->ncmds;
+        }
+        bad += t->bad;
+    }
+
+    results = calloc(nchunks ? nchunks : 1, sizeof(*results));
+    order = size_order();
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    unsigned steals = run_pool(order, nchunks, nthreads, aggregate);
+    double aggSecs = seconds_since(&t0);
+    free(order);
+
+    report();
+    fprintf(stderr, "trackers %u chunks %u frames %llu commands %llu bad %llu; ingest %.3f s, "
+            "aggregate %.3f s on %d threads (%u stolen)\n", ntrackers, nchunks, (unsigned long long)frames,
+            (unsigned long long)commands, (unsigned long long)bad, ingestSecs, aggSecs, nthreads, steals);
+    return bad ? 3 : 0;
+}
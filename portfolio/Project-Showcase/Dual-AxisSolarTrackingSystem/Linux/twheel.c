@@ -0,0 +1,102 @@
+#include "twheel.h"
+
+#include <stdlib.h>
+
+int twheel_init(struct twheel *w, uint32_t timers, uint32_t slots, uint64_t tick_ns, uint64_t now_ns) {
+    uint32_t n = 1;
+
+    while (n < slots) {
+        n <<= 1;
+    }
+    w->tick_ns = tick_ns;
+    w->tick = now_ns / tick_ns;
+    w->mask = n - 1;
+    w->slots = malloc(n * sizeof(*w->slots));
+    w->timers = calloc(timers ? timers : 1, sizeof(*w->timers));
+    w->armed = calloc(timers ? timers : 1, 1);
+    if (!w->slots || !w->timers || !w->armed) {
+        twheel_free(w);
+        return -1;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        w->slots[i] = TWHEEL_NONE;
+    }
+    return 0;
+}
+
+void twheel_free(struct twheel *w) {
+    free(w->slots);
+    free(w->timers);
+    free(w->armed);
+    w->slots = NULL;
+    w->timers = NULL;
+    w->armed = NULL;
+}
+
+static uint64_t expiry_tick(const struct twheel *w, uint64_t due_ns) {
+    return (due_ns + w->tick_ns - 1) / w->tick_ns;
+}
+
+void twheel_cancel(struct twheel *w, uint32_t id) {
+    struct twheel_timer *t = &w->timers[id];
+
+    if (!w->armed[id]) {
+        return;
+    }
+    if (t->prev != TWHEEL_NONE) {
+        w->timers[t->prev].next = t->next;
+    } else {
+        w->slots[expiry_tick(w, t->due_ns) & w->mask] = t->next;
+    }
+    if (t->next != TWHEEL_NONE) {
+        w->timers[t->next].prev = t->prev;
+    }
+    w->armed[id] = 0;
+}
+
+void twheel_schedule(struct twheel *w, uint32_t id, uint64_t due_ns) {
+    struct twheel_timer *t = &w->timers[id];
+    uint32_t *head;
+
+    twheel_cancel(w, id);
+    // Overdue timers go into the slot of the next tick to run; due_ns is
+    // moved as well so cancel finds the same slot. The caller's original
+    // deadline is lost, which only matters for lateness accounting of
+    // timers that were already late when armed.
+    if (due_ns < w->tick * w->tick_ns) {
+        due_ns = w->tick * w->tick_ns;
+    }
+    head = &w->slots[expiry_tick(w, due_ns) & w->mask];
+    t->due_ns = due_ns;
+    t->prev = TWHEEL_NONE;
+    t->next = *head;
+    if (*head != TWHEEL_NONE) {
+        w->timers[*head].prev = id;
+    }
+    *head = id;
+    w->armed[id] = 1;
+}
+
+void twheel_advance(struct twheel *w, uint64_t now_ns, twheel_fn fire, void *ctx) {
+    uint64_t last = now_ns / w->tick_ns;
+
+    while (w->tick <= last) {
+        // Step past the tick first, so a timer re-armed from `fire` lands
+        // in a later tick rather than in the slot being walked
+        uint64_t tick = w->tick++;
+        uint32_t id = w->slots[tick & w->mask];
+
+        while (id != TWHEEL_NONE) {
+            struct twheel_timer *t = &w->timers[id];
+            uint32_t next = t->next;
+
+            // Timers a whole number of laps away share the slot; skip them
+            if (expiry_tick(w, t->due_ns) <= tick) {
+                uint64_t due = t->due_ns;
+                twheel_cancel(w, id);
+                fire(ctx, id, due, now_ns);
+            }
+            id = next;
+        }
+    }
+}
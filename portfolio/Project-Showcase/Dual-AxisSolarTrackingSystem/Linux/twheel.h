@@ -0,0 +1,44 @@
+#ifndef TWHEEL_H
+#define TWHEEL_H
+
+#include <stdint.h>
+
+// Hashed timer wheel for a fixed population of one-shot timers.
+//
+// Timer i belongs to object i of the caller's array (the fleet controller
+// uses one per tracker), so timers need no allocation and are linked
+// through 32-bit indices. A timer due at time t sits in slot
+// (t / tick_ns) % slots; scheduling and cancelling are O(1), and advancing
+// the wheel by one tick only walks one slot. Timers further away than one
+// revolution stay in their slot until their lap comes round.
+
+#define TWHEEL_NONE UINT32_MAX
+
+struct twheel_timer {
+    uint64_t due_ns;       // Requested expiry (CLOCK_MONOTONIC)
+    uint32_t next, prev;   // Slot list links, TWHEEL_NONE at the ends
+};
+
+struct twheel {
+    uint64_t tick_ns;
+    uint64_t tick;         // Next tick to run
+    uint32_t mask;         // Slots - 1
+    uint32_t *slots;       // First timer in each slot
+    struct twheel_timer *timers;
+    uint8_t *armed;
+};
+
+// `slots` is rounded up to a power of two. Returns 0, or -1 without memory.
+int twheel_init(struct twheel *w, uint32_t timers, uint32_t slots, uint64_t tick_ns, uint64_t now_ns);
+void twheel_free(struct twheel *w);
+
+// (Re)arm timer `id` for `due_ns`; a time in the past fires on the next advance
+void twheel_schedule(struct twheel *w, uint32_t id, uint64_t due_ns);
+void twheel_cancel(struct twheel *w, uint32_t id);
+
+// Run every timer due up to `now_ns`. Timers are one-shot; `fire` may
+// schedule the timer it is called for again, but must not touch others.
+typedef void (*twheel_fn)(void *ctx, uint32_t id, uint64_t due_ns, uint64_t now_ns);
+void twheel_advance(struct twheel *w, uint64_t now_ns, twheel_fn fire, void *ctx);
+
+#endif